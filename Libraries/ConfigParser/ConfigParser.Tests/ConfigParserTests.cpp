@@ -108,6 +108,57 @@ namespace ConfigParserTests
 			Assert::AreEqual(L"", defaultServerInstance->service_config.service_account.c_str());
 			Assert::AreEqual(L"", defaultServerInstance->service_config.service_password.c_str());
 
+			// should get an instance from the default zone
+			auto injectedNvEncInstance = Object<NvEncConfig>::Get();
+
+			// should get an instance from zone 1
+			auto defaultNvEncInstance = Object<NvEncConfig>::Get<1>();
+
+			// should be parsed from disk (see nvEncConfig.json in the test directory)
+			Assert::AreEqual(true, injectedNvEncInstance->use_software_encoding);
+			Assert::IsTrue(((uint32_t)1234) == injectedNvEncInstance->capture_fps);
+			Assert::IsTrue(((uint32_t)5678) == injectedNvEncInstance->capture_conversion_threads);
+			Assert::IsTrue(((uint32_t)91011) == injectedNvEncInstance->capture_pipeline_depth);
+			Assert::AreEqual("dropNewest", injectedNvEncInstance->capture_pipeline_drop_policy.c_str());
+			Assert::AreEqual(true, injectedNvEncInstance->skip_unchanged_frames);
+			Assert::IsTrue(((uint32_t)1213) == injectedNvEncInstance->unchanged_frame_keep_alive_ms);
+			Assert::IsTrue(((size_t)2) == injectedNvEncInstance->adaptation_ladder.size());
+			Assert::AreEqual(1.0, injectedNvEncInstance->adaptation_ladder[0]);
+			Assert::AreEqual(0.5, injectedNvEncInstance->adaptation_ladder[1]);
+			Assert::IsTrue(((uint32_t)1415) == injectedNvEncInstance->adaptation_hysteresis_ms);
+			Assert::AreEqual("frame_timing.json", injectedNvEncInstance->frame_timing_trace_file.c_str());
+			Assert::AreEqual("capture.y4m", injectedNvEncInstance->capture_record_file.c_str());
+			Assert::AreEqual(true, injectedNvEncInstance->latency_probe);
+			Assert::AreEqual("i420", injectedNvEncInstance->capture_output_format.c_str());
+			Assert::AreEqual("null", injectedNvEncInstance->encoder_backend.c_str());
+			Assert::IsTrue(((uint32_t)1617) == injectedNvEncInstance->null_encoder_frame_size);
+			Assert::IsTrue(((int32_t)18) == injectedNvEncInstance->qp_map_max_delta);
+			Assert::AreEqual(0.25, injectedNvEncInstance->qp_map_inner_radius);
+			Assert::AreEqual(0.75, injectedNvEncInstance->qp_map_outer_radius);
+			Assert::IsTrue(((uint32_t)19) == injectedNvEncInstance->encoder_pool_size);
+			Assert::IsTrue(((uint32_t)2021) == injectedNvEncInstance->encoder_pool_idle_timeout_ms);
+
+			// should be default initialized
+			Assert::AreEqual(false, defaultNvEncInstance->use_software_encoding);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->capture_fps);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->capture_conversion_threads);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->capture_pipeline_depth);
+			Assert::AreEqual("", defaultNvEncInstance->capture_pipeline_drop_policy.c_str());
+			Assert::AreEqual(false, defaultNvEncInstance->skip_unchanged_frames);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->unchanged_frame_keep_alive_ms);
+			Assert::IsTrue(defaultNvEncInstance->adaptation_ladder.empty());
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->adaptation_hysteresis_ms);
+			Assert::AreEqual("", defaultNvEncInstance->frame_timing_trace_file.c_str());
+			Assert::AreEqual("", defaultNvEncInstance->capture_record_file.c_str());
+			Assert::AreEqual(false, defaultNvEncInstance->latency_probe);
+			Assert::AreEqual("", defaultNvEncInstance->capture_output_format.c_str());
+			Assert::AreEqual("", defaultNvEncInstance->encoder_backend.c_str());
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->null_encoder_frame_size);
+			Assert::IsTrue(((int32_t)0) == defaultNvEncInstance->qp_map_max_delta);
+			Assert::AreEqual(0.0, defaultNvEncInstance->qp_map_inner_radius);
+			Assert::AreEqual(0.0, defaultNvEncInstance->qp_map_outer_radius);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->encoder_pool_size);
+			Assert::IsTrue(((uint32_t)0) == defaultNvEncInstance->encoder_pool_idle_timeout_ms);
 		}
 	};
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace StreamingToolkit
 {
@@ -138,5 +139,59 @@ namespace StreamingToolkit
 
 		/* Capture frame rate							*/
 		uint32_t		capture_fps;
+
+		/* Threads used for frame conversion			*/
+		uint32_t		capture_conversion_threads;
+
+		/* Frames queued for the capture thread			*/
+		uint32_t		capture_pipeline_depth;
+
+		/* Full queue policy: dropOldest or dropNewest	*/
+		std::string		capture_pipeline_drop_policy;
+
+		/* Skipping frames identical to the previous one	*/
+		bool			skip_unchanged_frames;
+
+		/* Unchanged frame re-send interval, 0 to drop	*/
+		uint32_t		unchanged_frame_keep_alive_ms;
+
+		/* Resolution scale factors, software encoder only	*/
+		std::vector<double>	adaptation_ladder;
+
+		/* Delay before stepping up the resolution		*/
+		uint32_t		adaptation_hysteresis_ms;
+
+		/* Frame timing trace written on exit, if set	*/
+		std::string		frame_timing_trace_file;
+
+		/* Y4M file the captured frames are recorded to	*/
+		std::string		capture_record_file;
+
+		/* Stamping frame IDs to measure latency		*/
+		bool			latency_probe;
+
+		/* CPU conversion output, only i420		*/
+		std::string		capture_output_format;
+
+		/* Encoder backend: nvenc, software or null		*/
+		std::string		encoder_backend;
+
+		/* Bytes per frame sent by the null encoder		*/
+		uint32_t		null_encoder_frame_size;
+
+		/* Foveation QP delta away from the gaze, 0 = off	*/
+		int32_t			qp_map_max_delta;
+
+		/* Full quality radius, fraction of eye height	*/
+		double			qp_map_inner_radius;
+
+		/* Radius where the maximum QP delta is reached	*/
+		double			qp_map_outer_radius;
+
+		/* Encoder sessions kept warm, 0 = no pooling	*/
+		uint32_t		encoder_pool_size;
+
+		/* Idle time before extra sessions are released	*/
+		uint32_t		encoder_pool_idle_timeout_ms;
 	} NvEncConfig;
 }
@@ -220,5 +220,99 @@ void ConfigParser::ParseNvEncConfig(const std::string& path, StreamingToolkit::N
 		{
 			nvEncConfig->capture_fps = root.get("serverFrameCaptureFPS", NULL).asInt();
 		}
+
+		if (root.isMember("captureConversionThreads"))
+		{
+			nvEncConfig->capture_conversion_threads = root.get("captureConversionThreads", NULL).asInt();
+		}
+
+		if (root.isMember("capturePipelineDepth"))
+		{
+			nvEncConfig->capture_pipeline_depth = root.get("capturePipelineDepth", NULL).asInt();
+		}
+
+		if (root.isMember("capturePipelineDropPolicy"))
+		{
+			nvEncConfig->capture_pipeline_drop_policy = root.get("capturePipelineDropPolicy", NULL).asString();
+		}
+
+		if (root.isMember("skipUnchangedFrames"))
+		{
+			nvEncConfig->skip_unchanged_frames = root.get("skipUnchangedFrames", NULL).asBool();
+		}
+
+		if (root.isMember("unchangedFrameKeepAliveMs"))
+		{
+			nvEncConfig->unchanged_frame_keep_alive_ms = root.get("unchangedFrameKeepAliveMs", NULL).asInt();
+		}
+
+		if (root.isMember("adaptationLadder"))
+		{
+			auto ladderNode = root.get("adaptationLadder", NULL);
+			for (Json::ArrayIndex i = 0; i < ladderNode.size(); i++)
+			{
+				nvEncConfig->adaptation_ladder.push_back(ladderNode[i].asDouble());
+			}
+		}
+
+		if (root.isMember("adaptationHysteresisMs"))
+		{
+			nvEncConfig->adaptation_hysteresis_ms = root.get("adaptationHysteresisMs", NULL).asInt();
+		}
+
+		if (root.isMember("frameTimingTraceFile"))
+		{
+			nvEncConfig->frame_timing_trace_file = root.get("frameTimingTraceFile", NULL).asString();
+		}
+
+		if (root.isMember("captureRecordFile"))
+		{
+			nvEncConfig->capture_record_file = root.get("captureRecordFile", NULL).asString();
+		}
+
+		if (root.isMember("latencyProbe"))
+		{
+			nvEncConfig->latency_probe = root.get("latencyProbe", NULL).asBool();
+		}
+
+		if (root.isMember("captureOutputFormat"))
+		{
+			nvEncConfig->capture_output_format = root.get("captureOutputFormat", NULL).asString();
+		}
+
+		if (root.isMember("encoderBackend"))
+		{
+			nvEncConfig->encoder_backend = root.get("encoderBackend", NULL).asString();
+		}
+
+		if (root.isMember("nullEncoderFrameSize"))
+		{
+			nvEncConfig->null_encoder_frame_size = root.get("nullEncoderFrameSize", NULL).asInt();
+		}
+
+		if (root.isMember("qpMapMaxDelta"))
+		{
+			nvEncConfig->qp_map_max_delta = root.get("qpMapMaxDelta", NULL).asInt();
+		}
+
+		if (root.isMember("qpMapInnerRadius"))
+		{
+			nvEncConfig->qp_map_inner_radius = root.get("qpMapInnerRadius", NULL).asDouble();
+		}
+
+		if (root.isMember("qpMapOuterRadius"))
+		{
+			nvEncConfig->qp_map_outer_radius = root.get("qpMapOuterRadius", NULL).asDouble();
+		}
+
+		if (root.isMember("encoderPoolSize"))
+		{
+			nvEncConfig->encoder_pool_size = root.get("encoderPoolSize", NULL).asInt();
+		}
+
+		if (root.isMember("encoderPoolIdleTimeoutMs"))
+		{
+			nvEncConfig->encoder_pool_idle_timeout_ms = root.get("encoderPoolIdleTimeoutMs", NULL).asInt();
+		}
 	}
 }
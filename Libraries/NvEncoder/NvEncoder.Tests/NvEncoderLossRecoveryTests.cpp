@@ -0,0 +1,188 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "NvEncoderLossRecovery.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace NvEncoderTests
+{
+	NvEncLossRecoveryConfig GetLossRecoveryConfig()
+	{
+		NvEncLossRecoveryConfig config;
+		config.invalidateRefFramesEnableFlag = true;
+		config.intraRefreshEnableFlag = true;
+		config.intraRefreshDuration = 4;
+		config.escalationWindowMs = 1000;
+		return config;
+	}
+
+	// Encodes |count| frames 10ms apart, the first one with |action|.
+	// Frame i uses input timestamp i and RTP timestamp 100 * i.
+	void EncodeFrames(CNvEncoderLossRecovery* recovery, uint64_t* frame, int count,
+		NvEncRecoveryAction action = NV_ENC_RECOVERY_NONE)
+	{
+		for (int i = 0; i < count; i++, (*frame)++)
+		{
+			recovery->OnFrameEncoded(*frame, static_cast<uint32_t>(*frame * 100),
+				i == 0 ? action : NV_ENC_RECOVERY_NONE, *frame * 10);
+		}
+	}
+
+	TEST_CLASS(NvEncoderLossRecoveryTests)
+	{
+	public:
+
+		TEST_METHOD(LossRecovery_Starts_With_IDR)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			Assert::IsTrue(NV_ENC_RECOVERY_IDR == recovery.OnKeyFrameRequest(0));
+		}
+
+		TEST_METHOD(LossRecovery_Invalidates_Lost_And_Later_Frames)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 10, NV_ENC_RECOVERY_IDR);
+			EncodeFrames(&recovery, &frame, 200);
+
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES ==
+				recovery.OnFrameLost(207 * 100, frame * 10, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)3) == numRefFrames);
+			for (uint32_t i = 0; i < numRefFrames; i++)
+			{
+				Assert::IsTrue(((uint64_t)207 + i) == refFrames[i]);
+			}
+		}
+
+		TEST_METHOD(LossRecovery_Matches_Inexact_Timestamps)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			// Newer than every frame encoded.
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_NONE ==
+				recovery.OnFrameLost(250 * 100, frame * 10, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)0) == numRefFrames);
+
+			// Between two frames, the later one is the first that may be lost.
+			Assert::IsTrue(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES ==
+				recovery.OnFrameLost(196 * 100 + 50, frame * 10, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)3) == numRefFrames);
+			for (uint32_t i = 0; i < numRefFrames; i++)
+			{
+				Assert::IsTrue(((uint64_t)197 + i) == refFrames[i]);
+			}
+		}
+
+		TEST_METHOD(LossRecovery_Handles_Timestamp_Wraparound)
+		{
+			// The RTP timestamps wrap around from frame 195.
+			const uint32_t kFirstRtpTimestamp = static_cast<uint32_t>(0) - 195 * 100;
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			for (uint64_t frame = 0; frame < 200; frame++)
+			{
+				recovery.OnFrameEncoded(frame, kFirstRtpTimestamp + static_cast<uint32_t>(frame * 100),
+					frame == 0 ? NV_ENC_RECOVERY_IDR : NV_ENC_RECOVERY_NONE, frame * 10);
+			}
+
+			// After the wraparound, the frames before it are older.
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES ==
+				recovery.OnFrameLost(kFirstRtpTimestamp + 196 * 100 + 50, 2000, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)3) == numRefFrames);
+			Assert::IsTrue(((uint64_t)197) == refFrames[0]);
+
+			// Before the wraparound, the frames after it are newer.
+			Assert::IsTrue(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES ==
+				recovery.OnFrameLost(kFirstRtpTimestamp + 193 * 100 + 50, 2000, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)3) == numRefFrames);
+			Assert::IsTrue(((uint64_t)194) == refFrames[0]);
+			Assert::IsTrue(((uint64_t)196) == refFrames[2]);
+
+			// Older than every reference frame.
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH ==
+				recovery.OnFrameLost(kFirstRtpTimestamp + 150 * 100, 2000, refFrames, &numRefFrames));
+		}
+
+		TEST_METHOD(LossRecovery_Falls_Back_To_Intra_Refresh)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			// Older than the reference list.
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH ==
+				recovery.OnFrameLost(100 * 100, frame * 10, refFrames, &numRefFrames));
+			Assert::IsTrue(((uint32_t)0) == numRefFrames);
+
+			// Keyframe requests don't say what was lost.
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH == recovery.OnKeyFrameRequest(frame * 10));
+		}
+
+		TEST_METHOD(LossRecovery_Ignores_Feedback_During_Recovery)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			recovery.SetRtt(100);
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH == recovery.OnKeyFrameRequest(frame * 10));
+			EncodeFrames(&recovery, &frame, 2, NV_ENC_RECOVERY_INTRA_REFRESH);
+
+			// The wave is still being encoded.
+			Assert::IsTrue(NV_ENC_RECOVERY_NONE == recovery.OnKeyFrameRequest(frame * 10));
+
+			// The wave is out, but the request was sent before it arrived.
+			EncodeFrames(&recovery, &frame, 2);
+			Assert::IsTrue(NV_ENC_RECOVERY_NONE == recovery.OnKeyFrameRequest(frame * 10 + 50));
+		}
+
+		TEST_METHOD(LossRecovery_Escalates_When_Recovery_Fails)
+		{
+			CNvEncoderLossRecovery recovery(GetLossRecoveryConfig());
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES ==
+				recovery.OnFrameLost(195 * 100, frame * 10, refFrames, &numRefFrames));
+			EncodeFrames(&recovery, &frame, 5, NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES);
+
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH ==
+				recovery.OnFrameLost(202 * 100, frame * 10, refFrames, &numRefFrames));
+			EncodeFrames(&recovery, &frame, 10, NV_ENC_RECOVERY_INTRA_REFRESH);
+
+			Assert::IsTrue(NV_ENC_RECOVERY_IDR == recovery.OnKeyFrameRequest(frame * 10));
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			// Outside the escalation window, starts over with the cheapest recovery.
+			Assert::IsTrue(NV_ENC_RECOVERY_INTRA_REFRESH == recovery.OnKeyFrameRequest(frame * 10));
+		}
+
+		TEST_METHOD(LossRecovery_Uses_IDR_When_Nothing_Else_Is_Enabled)
+		{
+			NvEncLossRecoveryConfig config = GetLossRecoveryConfig();
+			config.invalidateRefFramesEnableFlag = false;
+			config.intraRefreshEnableFlag = false;
+			CNvEncoderLossRecovery recovery(config);
+			uint64_t frame = 0;
+			EncodeFrames(&recovery, &frame, 200, NV_ENC_RECOVERY_IDR);
+
+			uint64_t refFrames[MAX_INVALIDATED_REF_FRAMES];
+			uint32_t numRefFrames = 0;
+			Assert::IsTrue(NV_ENC_RECOVERY_IDR ==
+				recovery.OnFrameLost(199 * 100, frame * 10, refFrames, &numRefFrames));
+			Assert::IsTrue(NV_ENC_RECOVERY_IDR == recovery.OnKeyFrameRequest(frame * 10));
+		}
+	};
+}
@@ -0,0 +1,285 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <atomic>
+#include <map>
+#include <set>
+
+#include "NvEncoderOutputQueue.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace NvEncoderTests
+{
+	// Serves canned bitstreams in place of NVENC.
+	class MockEncoder : public INvHWEncoder
+	{
+	public:
+		MockEncoder() :
+			m_lockCalls(0),
+			m_blockingLockCalls(0),
+			m_unmatchedUnlockCalls(0),
+			m_maxLocked(0)
+		{
+		}
+
+		// Sets the next frame encoded into |buffer|. The first |busyCount|
+		// lock attempts report the frame as not ready.
+		void Encode(NV_ENC_OUTPUT_PTR buffer, const std::vector<uint8_t>& data,
+			int busyCount = 0, NVENCSTATUS status = NV_ENC_SUCCESS)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			Frame& frame = m_frames[buffer];
+			frame.data = data;
+			frame.busyCount = busyCount;
+			frame.status = status;
+		}
+
+		NVENCSTATUS NvEncLockBitstream(NV_ENC_LOCK_BITSTREAM* lockBitstreamBufferParams) override
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_lockCalls++;
+			m_blockingLockCalls += lockBitstreamBufferParams->doNotWait ? 0 : 1;
+
+			Frame& frame = m_frames[lockBitstreamBufferParams->outputBitstream];
+			if (frame.busyCount > 0)
+			{
+				frame.busyCount--;
+				return NV_ENC_ERR_LOCK_BUSY;
+			}
+
+			if (frame.status != NV_ENC_SUCCESS)
+			{
+				return frame.status;
+			}
+
+			lockBitstreamBufferParams->bitstreamBufferPtr = frame.data.data();
+			lockBitstreamBufferParams->bitstreamSizeInBytes = static_cast<uint32_t>(frame.data.size());
+			lockBitstreamBufferParams->pictureType = NV_ENC_PIC_TYPE_P;
+			m_locked.insert(lockBitstreamBufferParams->outputBitstream);
+			m_maxLocked = std::max(m_maxLocked, m_locked.size());
+			return NV_ENC_SUCCESS;
+		}
+
+		NVENCSTATUS NvEncUnlockBitstream(NV_ENC_OUTPUT_PTR bitstreamBuffer) override
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_unmatchedUnlockCalls += m_locked.erase(bitstreamBuffer) == 1 ? 0 : 1;
+			return NV_ENC_SUCCESS;
+		}
+
+		bool IsLocked(NV_ENC_OUTPUT_PTR buffer)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_locked.count(buffer) > 0;
+		}
+
+		int lock_calls()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_lockCalls;
+		}
+
+		int blocking_lock_calls()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_blockingLockCalls;
+		}
+
+		int unmatched_unlock_calls()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_unmatchedUnlockCalls;
+		}
+
+		size_t max_locked()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_maxLocked;
+		}
+
+	private:
+		struct Frame
+		{
+			std::vector<uint8_t> data;
+			int busyCount;
+			NVENCSTATUS status;
+		};
+
+		std::mutex m_mutex;
+		std::map<NV_ENC_OUTPUT_PTR, Frame> m_frames;
+		std::set<NV_ENC_OUTPUT_PTR> m_locked;
+		int m_lockCalls;
+		int m_blockingLockCalls;
+		int m_unmatchedUnlockCalls;
+		size_t m_maxLocked;
+	};
+
+	NV_ENC_OUTPUT_PTR GetBuffer(int index)
+	{
+		return reinterpret_cast<NV_ENC_OUTPUT_PTR>(static_cast<uintptr_t>(index + 1));
+	}
+
+	TEST_CLASS(NvEncoderOutputQueueTests)
+	{
+	public:
+
+		TEST_METHOD(OutputQueue_Writes_Packets_In_Submission_Order)
+		{
+			MockEncoder encoder;
+			std::vector<std::vector<uint8_t>> written;
+			std::vector<uint64_t> sequences;
+			CNvEncoderOutputQueue queue(&encoder, [&](const NvEncOutputPacket& packet)
+			{
+				written.push_back(packet.data);
+				sequences.push_back(packet.sequence);
+			});
+
+			// Cycles through 4 bitstream buffers like an encoder would,
+			// reusing each one once its previous frame is out.
+			const int bufferCount = 4;
+			uint64_t pending[bufferCount] = {};
+			for (int i = 0; i < 20; i++)
+			{
+				int index = i % bufferCount;
+				if (i >= bufferCount)
+				{
+					queue.WaitForOutput(pending[index]);
+				}
+
+				encoder.Encode(GetBuffer(index), std::vector<uint8_t>(i + 1, static_cast<uint8_t>(i)), i % 3);
+				pending[index] = queue.Submit(GetBuffer(index));
+				Assert::IsTrue(((uint64_t)i) == pending[index]);
+			}
+
+			queue.Flush();
+
+			Assert::IsTrue(((size_t)20) == written.size());
+			for (int i = 0; i < 20; i++)
+			{
+				Assert::IsTrue(((uint64_t)i) == sequences[i]);
+				Assert::IsTrue(std::vector<uint8_t>(i + 1, static_cast<uint8_t>(i)) == written[i]);
+			}
+
+			Assert::IsTrue(((uint64_t)20) == queue.GetWrittenCount());
+			Assert::IsTrue(((uint64_t)0) == queue.GetFailedCount());
+			Assert::AreEqual(0, encoder.blocking_lock_calls());
+			Assert::AreEqual(0, encoder.unmatched_unlock_calls());
+		}
+
+		TEST_METHOD(OutputQueue_Retries_Busy_Bitstreams)
+		{
+			MockEncoder encoder;
+			std::atomic<int> writeCount(0);
+			CNvEncoderOutputQueue queue(&encoder, [&](const NvEncOutputPacket& packet)
+			{
+				writeCount++;
+			});
+
+			encoder.Encode(GetBuffer(0), std::vector<uint8_t>(16, 1), 3);
+			queue.Submit(GetBuffer(0));
+			queue.Flush();
+
+			Assert::AreEqual(4, encoder.lock_calls());
+			Assert::AreEqual(1, writeCount.load());
+		}
+
+		TEST_METHOD(OutputQueue_Unlocks_Before_Consumer_Finishes)
+		{
+			MockEncoder encoder;
+			std::mutex consumerMutex;
+			std::condition_variable consumerCondition;
+			bool release = false;
+			CNvEncoderOutputQueue queue(&encoder, [&](const NvEncOutputPacket& packet)
+			{
+				std::unique_lock<std::mutex> lock(consumerMutex);
+				consumerCondition.wait(lock, [&] { return release; });
+			});
+
+			// The buffers become reusable while the consumer is stuck.
+			for (int i = 0; i < 3; i++)
+			{
+				encoder.Encode(GetBuffer(i), std::vector<uint8_t>(64, 2));
+				queue.WaitForOutput(queue.Submit(GetBuffer(i)));
+				Assert::IsFalse(encoder.IsLocked(GetBuffer(i)));
+			}
+
+			Assert::IsTrue(((uint64_t)0) == queue.GetWrittenCount());
+
+			{
+				std::lock_guard<std::mutex> lock(consumerMutex);
+				release = true;
+			}
+
+			consumerCondition.notify_all();
+			queue.Flush();
+
+			Assert::IsTrue(((uint64_t)3) == queue.GetWrittenCount());
+			Assert::IsTrue(((size_t)1) == encoder.max_locked());
+		}
+
+		TEST_METHOD(OutputQueue_Reuses_Pooled_Packets)
+		{
+			MockEncoder encoder;
+			CNvEncoderOutputQueue queue(&encoder, nullptr, 2);
+			for (int i = 0; i < 100; i++)
+			{
+				encoder.Encode(GetBuffer(i), std::vector<uint8_t>(256, 3));
+				queue.Submit(GetBuffer(i));
+			}
+
+			queue.Flush();
+
+			Assert::IsTrue(((uint64_t)100) == queue.GetWrittenCount());
+			Assert::IsTrue(queue.GetAllocatedPacketCount() <= 2);
+		}
+
+		TEST_METHOD(OutputQueue_Counts_Failed_Bitstreams)
+		{
+			MockEncoder encoder;
+			std::atomic<int> writeCount(0);
+			CNvEncoderOutputQueue queue(&encoder, [&](const NvEncOutputPacket& packet)
+			{
+				writeCount++;
+			});
+
+			encoder.Encode(GetBuffer(0), std::vector<uint8_t>(8, 4));
+			encoder.Encode(GetBuffer(1), std::vector<uint8_t>(), 0, NV_ENC_ERR_INVALID_PARAM);
+			encoder.Encode(GetBuffer(2), std::vector<uint8_t>(8, 4));
+			for (int i = 0; i < 3; i++)
+			{
+				queue.Submit(GetBuffer(i));
+			}
+
+			queue.Flush();
+
+			Assert::AreEqual(2, writeCount.load());
+			Assert::IsTrue(((uint64_t)2) == queue.GetWrittenCount());
+			Assert::IsTrue(((uint64_t)1) == queue.GetFailedCount());
+		}
+
+		TEST_METHOD(OutputQueue_Drains_On_Destruction)
+		{
+			MockEncoder encoder;
+			std::atomic<int> writeCount(0);
+			{
+				CNvEncoderOutputQueue queue(&encoder, [&](const NvEncOutputPacket& packet)
+				{
+					writeCount++;
+				});
+
+				for (int i = 0; i < 10; i++)
+				{
+					encoder.Encode(GetBuffer(i), std::vector<uint8_t>(32, 5), 1);
+					queue.Submit(GetBuffer(i));
+				}
+			}
+
+			Assert::AreEqual(10, writeCount.load());
+			for (int i = 0; i < 10; i++)
+			{
+				Assert::IsFalse(encoder.IsLocked(GetBuffer(i)));
+			}
+		}
+	};
+}
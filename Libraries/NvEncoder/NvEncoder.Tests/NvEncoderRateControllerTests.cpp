@@ -0,0 +1,149 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "NvEncoderRateController.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace NvEncoderTests
+{
+	NvEncRateControlConfig GetRateControlConfig()
+	{
+		NvEncRateControlConfig config;
+		config.minBitrate = 1000000;
+		config.maxBitrate = 20000000;
+		config.minIntervalMs = 1000;
+		config.hysteresis = 0.1;
+		config.maxStepUp = 1.25;
+		config.vbvBufferFrames = 1.0;
+		return config;
+	}
+
+	// Commits the updates, as if every reconfiguration succeeded.
+	bool UpdateAndCommit(CNvEncoderRateController* controller, uint32_t bitrate, uint32_t framerate,
+		uint64_t nowMs, NvEncRateControlUpdate* update)
+	{
+		if (!controller->Update(bitrate, framerate, nowMs, update))
+		{
+			return false;
+		}
+
+		controller->Commit(*update, nowMs);
+		return true;
+	}
+
+	TEST_CLASS(NvEncoderRateControllerTests)
+	{
+	public:
+
+		TEST_METHOD(RateController_Ignores_Small_Changes)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(5000000, 60);
+
+			NvEncRateControlUpdate update;
+			Assert::IsFalse(UpdateAndCommit(&controller, 5400000, 60, 5000, &update));
+			Assert::IsFalse(UpdateAndCommit(&controller, 4600000, 60, 6000, &update));
+			Assert::IsTrue(((uint32_t)5000000) == controller.GetBitrate());
+		}
+
+		TEST_METHOD(RateController_Applies_Drops_Immediately)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(5000000, 60);
+
+			NvEncRateControlUpdate update;
+			Assert::IsTrue(UpdateAndCommit(&controller, 3000000, 60, 100, &update));
+			Assert::IsTrue(((uint32_t)3000000) == update.bitrate);
+
+			// A second drop within the interval still goes through.
+			Assert::IsTrue(UpdateAndCommit(&controller, 2000000, 60, 150, &update));
+			Assert::IsTrue(((uint32_t)2000000) == update.bitrate);
+
+			// Clamped to the configured floor.
+			Assert::IsTrue(UpdateAndCommit(&controller, 100000, 60, 200, &update));
+			Assert::IsTrue(((uint32_t)1000000) == update.bitrate);
+		}
+
+		TEST_METHOD(RateController_Rate_Limits_And_Steps_Up_Raises)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(4000000, 60);
+
+			NvEncRateControlUpdate update;
+			Assert::IsTrue(UpdateAndCommit(&controller, 2000000, 60, 0, &update));
+
+			// Too soon after the drop.
+			Assert::IsFalse(UpdateAndCommit(&controller, 8000000, 60, 500, &update));
+
+			Assert::IsTrue(UpdateAndCommit(&controller, 8000000, 60, 1000, &update));
+			Assert::IsTrue(((uint32_t)2500000) == update.bitrate);
+
+			Assert::IsFalse(UpdateAndCommit(&controller, 8000000, 60, 1999, &update));
+			Assert::IsTrue(UpdateAndCommit(&controller, 8000000, 60, 2000, &update));
+			Assert::IsTrue(((uint32_t)3125000) == update.bitrate);
+		}
+
+		TEST_METHOD(RateController_Applies_Framerate_Changes)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(6000000, 60);
+
+			NvEncRateControlUpdate update;
+			Assert::IsTrue(UpdateAndCommit(&controller, 6000000, 30, 10, &update));
+			Assert::IsTrue(((uint32_t)6000000) == update.bitrate);
+			Assert::IsTrue(((uint32_t)30) == update.framerate);
+			Assert::IsTrue(((uint32_t)200000) == update.vbvBufferSize);
+
+			Assert::IsFalse(UpdateAndCommit(&controller, 6000000, 30, 20, &update));
+			Assert::IsFalse(UpdateAndCommit(&controller, 6000000, 0, 30, &update));
+
+			// Raises wait for the interval.
+			Assert::IsFalse(UpdateAndCommit(&controller, 6000000, 60, 500, &update));
+			Assert::IsTrue(UpdateAndCommit(&controller, 6000000, 60, 1010, &update));
+			Assert::IsTrue(((uint32_t)60) == update.framerate);
+		}
+
+		TEST_METHOD(RateController_Ignores_Framerate_Jitter)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(6000000, 60);
+
+			NvEncRateControlUpdate update;
+			uint32_t framerates[] = { 59, 61, 58, 62, 60 };
+			for (uint64_t i = 0; i < 50; i++)
+			{
+				Assert::IsFalse(UpdateAndCommit(&controller, 6000000, framerates[i % 5], i * 100, &update));
+			}
+
+			// A bitrate change keeps the current framerate.
+			Assert::IsTrue(UpdateAndCommit(&controller, 4000000, 59, 5000, &update));
+			Assert::IsTrue(((uint32_t)60) == update.framerate);
+		}
+
+		TEST_METHOD(RateController_Keeps_Settings_Until_Committed)
+		{
+			CNvEncoderRateController controller(GetRateControlConfig());
+			controller.Reset(5000000, 60);
+
+			// The reconfiguration failed, the next estimate tries again.
+			NvEncRateControlUpdate update;
+			Assert::IsTrue(controller.Update(3000000, 60, 100, &update));
+			Assert::IsTrue(((uint32_t)5000000) == controller.GetBitrate());
+			Assert::IsTrue(controller.Update(3000000, 60, 200, &update));
+			Assert::IsTrue(((uint32_t)3000000) == update.bitrate);
+
+			controller.Commit(update, 200);
+			Assert::IsTrue(((uint32_t)3000000) == controller.GetBitrate());
+			Assert::IsFalse(controller.Update(3000000, 60, 300, &update));
+		}
+
+		TEST_METHOD(RateController_Sizes_VBV_From_Per_Frame_Budget)
+		{
+			Assert::IsTrue(((uint32_t)100000) == CNvEncoderRateController::ComputeVBVBufferSize(6000000, 60, 1.0));
+			Assert::IsTrue(((uint32_t)200000) == CNvEncoderRateController::ComputeVBVBufferSize(6000000, 60, 2.0));
+			Assert::IsTrue(((uint32_t)100000) == CNvEncoderRateController::ComputeVBVBufferSize(6000000, 60, 0.0));
+			Assert::IsTrue(((uint32_t)0) == CNvEncoderRateController::ComputeVBVBufferSize(6000000, 0, 1.0));
+		}
+	};
+}
@@ -0,0 +1,131 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <memory>
+#include <thread>
+
+#include "NvSpscRing.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace NvEncoderTests
+{
+	TEST_CLASS(NvSpscRingTests)
+	{
+	public:
+
+		TEST_METHOD(SpscRing_Capacity_Rounds_Up_To_Power_Of_Two)
+		{
+			CNvSpscRing<int> ring;
+
+			Assert::IsFalse(ring.Initialize(0));
+			Assert::IsTrue(ring.Initialize(5));
+			Assert::IsTrue(((uint32_t)8) == ring.GetCapacity());
+			Assert::IsTrue(ring.Initialize(8));
+			Assert::IsTrue(((uint32_t)8) == ring.GetCapacity());
+		}
+
+		TEST_METHOD(SpscRing_Full_And_Empty)
+		{
+			CNvSpscRing<int> ring;
+			ring.Initialize(4);
+
+			int item = 0;
+			Assert::IsTrue(ring.IsEmpty());
+			Assert::IsFalse(ring.TryPop(&item));
+			Assert::IsTrue(ring.Front() == NULL);
+
+			for (int i = 0; i < 4; i++)
+			{
+				Assert::IsTrue(ring.TryPush(i));
+			}
+
+			Assert::IsFalse(ring.TryPush(4));
+			Assert::IsTrue(((uint32_t)4) == ring.GetCount());
+
+			Assert::AreEqual(0, *ring.Front());
+			ring.Pop();
+			Assert::IsTrue(ring.TryPush(4));
+
+			for (int i = 1; i <= 4; i++)
+			{
+				Assert::IsTrue(ring.TryPop(&item));
+				Assert::AreEqual(i, item);
+			}
+
+			Assert::IsTrue(ring.IsEmpty());
+		}
+
+		TEST_METHOD(SpscRing_Moves_Items)
+		{
+			CNvSpscRing<std::unique_ptr<int>> ring;
+			ring.Initialize(2);
+
+			Assert::IsTrue(ring.TryPush(std::unique_ptr<int>(new int(7))));
+
+			std::unique_ptr<int> item;
+			Assert::IsTrue(ring.TryPop(&item));
+			Assert::AreEqual(7, *item);
+		}
+
+		TEST_METHOD(SpscRing_Concurrent_Stress)
+		{
+			// Several independent producer and consumer pairs run at once,
+			// small rings make the indices wrap and both sides hit the full
+			// and empty cases often.
+			const int pairCount = 4;
+			const uint32_t itemCount = 200000;
+			CNvSpscRing<uint32_t> rings[pairCount];
+			bool ordered[pairCount];
+			uint64_t sums[pairCount];
+			std::vector<std::thread> threads;
+			for (int pair = 0; pair < pairCount; pair++)
+			{
+				rings[pair].Initialize(1u << pair);
+				ordered[pair] = true;
+				sums[pair] = 0;
+
+				CNvSpscRing<uint32_t>* pRing = &rings[pair];
+				threads.push_back(std::thread([pRing, itemCount]
+				{
+					for (uint32_t i = 0; i < itemCount; i++)
+					{
+						while (!pRing->TryPush(i))
+						{
+							std::this_thread::yield();
+						}
+					}
+				}));
+
+				bool* pOrdered = &ordered[pair];
+				uint64_t* pSum = &sums[pair];
+				threads.push_back(std::thread([pRing, pOrdered, pSum, itemCount]
+				{
+					for (uint32_t i = 0; i < itemCount; i++)
+					{
+						uint32_t item = 0;
+						while (!pRing->TryPop(&item))
+						{
+							std::this_thread::yield();
+						}
+
+						*pOrdered &= item == i;
+						*pSum += item;
+					}
+				}));
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+
+			for (int pair = 0; pair < pairCount; pair++)
+			{
+				Assert::IsTrue(ordered[pair]);
+				Assert::IsTrue(((uint64_t)itemCount * (itemCount - 1) / 2) == sums[pair]);
+				Assert::IsTrue(rings[pair].IsEmpty());
+			}
+		}
+	};
+}
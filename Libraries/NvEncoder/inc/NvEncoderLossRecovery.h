@@ -0,0 +1,88 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#pragma once
+
+#include <deque>
+#include <stdint.h>
+
+// Matches the size of the H.264 reference picture list.
+#define MAX_INVALIDATED_REF_FRAMES 16
+#define DEFAULT_RECOVERY_ESCALATION_MS 1000
+
+typedef enum _NvEncRecoveryAction
+{
+    NV_ENC_RECOVERY_NONE = 0,
+    NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES,
+    NV_ENC_RECOVERY_INTRA_REFRESH,
+    NV_ENC_RECOVERY_IDR,
+}NvEncRecoveryAction;
+
+typedef struct _NvEncLossRecoveryConfig
+{
+    int              invalidateRefFramesEnableFlag;
+    int              intraRefreshEnableFlag;
+    uint32_t         intraRefreshDuration;
+    uint32_t         escalationWindowMs;
+}NvEncLossRecoveryConfig;
+
+// Chooses how the encoder recovers from loss reported by the receiver.
+//
+// A report naming the first lost frame invalidates that frame and every
+// later one still usable as a reference, the next frame then predicts from
+// what the receiver already has. A keyframe request (PLI or FIR) doesn't
+// say what was lost and starts an intra refresh wave, which spreads the
+// intra blocks over |intraRefreshDuration| frames instead of sending one
+// large IDR frame.
+//
+// Feedback arriving while a recovery is in flight, or less than one round
+// trip after it, describes the stream before the recovery and is ignored.
+// Feedback within |escalationWindowMs| after that means the recovery didn't
+// work, and the next one goes a step further. A full IDR frame is only sent
+// once the cheaper recoveries have failed or aren't enabled.
+class CNvEncoderLossRecovery
+{
+public:
+    CNvEncoderLossRecovery(const NvEncLossRecoveryConfig& config);
+
+    // Records a frame submitted to NVENC with the recovery it carried.
+    // |inputTimeStamp| is the timestamp NVENC knows the frame by and
+    // |rtpTimestamp| the one loss reports refer to.
+    void OnFrameEncoded(uint64_t inputTimeStamp, uint32_t rtpTimestamp, NvEncRecoveryAction action, uint64_t nowMs);
+
+    NvEncRecoveryAction OnKeyFrameRequest(uint64_t nowMs);
+
+    // |rtpTimestamp| is the lost frame, or a timestamp before it when the
+    // exact frame isn't known. On NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES,
+    // fills |pRefFrames| with the input timestamps to invalidate, at most
+    // MAX_INVALIDATED_REF_FRAMES.
+    NvEncRecoveryAction OnFrameLost(uint32_t rtpTimestamp, uint64_t nowMs, uint64_t* pRefFrames, uint32_t* pNumRefFrames);
+
+    void SetRtt(uint32_t rttMs) { m_uRttMs = rttMs; }
+
+private:
+    typedef struct _EncodedFrame
+    {
+        uint64_t     inputTimeStamp;
+        uint32_t     rtpTimestamp;
+    }EncodedFrame;
+
+    NvEncRecoveryAction SelectAction(NvEncRecoveryAction preferred, uint64_t nowMs);
+    NvEncRecoveryAction GetSupportedAction(NvEncRecoveryAction action);
+
+    NvEncLossRecoveryConfig         m_config;
+    std::deque<EncodedFrame>        m_refFrames;
+    NvEncRecoveryAction             m_lastAction;
+    bool                            m_bRecovering;
+    uint32_t                        m_uWaveFramesLeft;
+    uint64_t                        m_uRecoveredMs;
+    uint32_t                        m_uRttMs;
+};
@@ -0,0 +1,115 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NvHWEncoder.h"
+#include "NvSpscRing.h"
+
+// Delay between two lock attempts on a bitstream that isn't ready yet.
+#define OUTPUT_POLL_INTERVAL_US 250
+
+// Encoded frame copied out of an NVENC bitstream buffer.
+typedef struct _NvEncOutputPacket
+{
+    std::vector<uint8_t>  data;
+    uint64_t              sequence;
+    uint64_t              outputTimeStamp;
+    NV_ENC_PIC_TYPE       pictureType;
+}NvEncOutputPacket;
+
+// Drains encoded frames without blocking the encoding thread.
+//
+// A completion thread waits on the submitted bitstream buffers in order,
+// copies each frame into a pooled packet and unlocks the buffer right away,
+// so NVENC can reuse it. A writer thread then hands the packets to the
+// consumer, whose disk or network I/O never runs under a bitstream lock.
+// At most |maxQueuedPackets| packets wait for the writer; the completion
+// thread stalls beyond that instead of growing the pool.
+//
+// Submissions go through a lock-free ring, the submitting thread only
+// takes the mutex to wake an idle completion thread.
+//
+// Only used by VideoTestRunner. The streaming plugins encode through the
+// patched WebRTC H264EncoderImpl, which doesn't use this queue.
+class CNvEncoderOutputQueue
+{
+public:
+    typedef std::function<void(const NvEncOutputPacket& packet)> PacketCallback;
+
+    CNvEncoderOutputQueue(INvHWEncoder* pEncoder, PacketCallback onPacket, uint32_t maxQueuedPackets = 8,
+                          uint32_t maxPendingOutputs = 32);
+    ~CNvEncoderOutputQueue();
+
+    // Queues the bitstream of a frame submitted to NVENC, in submission
+    // order and from a single thread. |hOutputEvent| is the completion
+    // event in async mode, NULL in sync mode. Spins while more than
+    // |maxPendingOutputs| frames wait for completion. Returns the frame
+    // sequence number.
+    uint64_t                                             Submit(NV_ENC_OUTPUT_PTR hBitstreamBuffer, HANDLE hOutputEvent = NULL);
+
+    // Blocks until the frame has been copied out and its bitstream buffer
+    // can be reused.
+    void                                                 WaitForOutput(uint64_t sequence);
+
+    // Blocks until every submitted frame reached the consumer.
+    void                                                 Flush();
+
+    uint64_t                                             GetWrittenCount();
+    uint64_t                                             GetFailedCount();
+    uint32_t                                             GetAllocatedPacketCount();
+
+private:
+    typedef struct _PendingOutput
+    {
+        NV_ENC_OUTPUT_PTR hBitstreamBuffer;
+        HANDLE            hOutputEvent;
+    }PendingOutput;
+
+    void                                                 CompletionThread();
+    void                                                 WriterThread();
+    NVENCSTATUS                                          LockBitstream(const PendingOutput& pending, NV_ENC_LOCK_BITSTREAM* pLockBitstreamData);
+    std::unique_ptr<NvEncOutputPacket>                   AcquirePacket();
+    void                                                 Retire(std::unique_ptr<NvEncOutputPacket> packet);
+
+    INvHWEncoder*                                        m_pEncoder;
+    PacketCallback                                       m_onPacket;
+    uint32_t                                             m_uMaxQueuedPackets;
+    uint32_t                                             m_uAllocatedPackets;
+
+    CNvSpscRing<PendingOutput>                           m_pending;
+    std::deque<std::unique_ptr<NvEncOutputPacket>>       m_ready;
+    std::vector<std::unique_ptr<NvEncOutputPacket>>      m_freePackets;
+    std::atomic<uint64_t>                                m_uSubmitted;
+    uint64_t                                             m_uCompleted;
+    uint64_t                                             m_uWritten;
+    uint64_t                                             m_uFailed;
+    bool                                                 m_bStopping;
+    bool                                                 m_bCompletionDone;
+    std::atomic<bool>                                    m_bCompletionIdle;
+
+    std::mutex                                           m_mutex;
+    std::condition_variable                              m_pendingCondition;
+    std::condition_variable                              m_readyCondition;
+    std::condition_variable                              m_packetCondition;
+    std::condition_variable                              m_progressCondition;
+    std::thread                                          m_completionThread;
+    std::thread                                          m_writerThread;
+};
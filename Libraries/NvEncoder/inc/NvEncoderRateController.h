@@ -0,0 +1,84 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define DEFAULT_RECONFIGURE_INTERVAL_MS 1000
+#define DEFAULT_BITRATE_HYSTERESIS      0.1
+#define DEFAULT_MAX_BITRATE_STEP_UP     1.25
+#define DEFAULT_VBV_BUFFER_FRAMES       1.0
+
+typedef struct _NvEncRateControlConfig
+{
+    uint32_t         minBitrate;
+    uint32_t         maxBitrate;
+    uint32_t         minIntervalMs;
+    double           hysteresis;
+    double           maxStepUp;
+    double           vbvBufferFrames;
+}NvEncRateControlConfig;
+
+// Rate control settings an encoder should be reconfigured with.
+typedef struct _NvEncRateControlUpdate
+{
+    uint32_t         bitrate;
+    uint32_t         framerate;
+    uint32_t         vbvBufferSize;
+}NvEncRateControlUpdate;
+
+// Turns bandwidth estimates into encoder reconfigurations.
+//
+// Estimates arrive many times per second and jitter around the link rate,
+// while each reconfiguration restarts rate control. Bitrate changes smaller
+// than |hysteresis| of the current rate are ignored. Drops are applied right
+// away, a congested link needs the lower rate now. Raises wait at least
+// |minIntervalMs| after the previous change and grow the rate by at most
+// |maxStepUp|, so a short spike in the estimate can't overshoot the link.
+// The measured framerate jitters by a frame or two around the capture rate
+// and goes through the same band and interval, without the step limit.
+//
+// The VBV buffer holds |vbvBufferFrames| frames worth of bits at the new
+// rate, which caps the size of a single frame near the per-frame budget.
+class CNvEncoderRateController
+{
+public:
+    CNvEncoderRateController(const NvEncRateControlConfig& config);
+
+    // Sets the rate control settings the encoder was created with.
+    void Reset(uint32_t bitrate, uint32_t framerate);
+
+    // Returns true and fills |pUpdate| when the encoder should be
+    // reconfigured for the target rates. |nowMs| is a monotonic clock.
+    // The settings only change once Commit() is called.
+    bool Update(uint32_t targetBitrate, uint32_t targetFramerate, uint64_t nowMs, NvEncRateControlUpdate* pUpdate) const;
+
+    // Records the update the encoder was reconfigured with.
+    void Commit(const NvEncRateControlUpdate& update, uint64_t nowMs);
+
+    uint32_t GetBitrate() const { return m_uBitrate; }
+    uint32_t GetFramerate() const { return m_uFramerate; }
+    uint32_t GetVBVBufferSize() const;
+
+    static uint32_t ComputeVBVBufferSize(uint32_t bitrate, uint32_t framerate, double vbvBufferFrames);
+
+private:
+    // Returns |target| if it is outside the hysteresis band around |current|
+    // and may be applied at |nowMs|, |current| otherwise.
+    uint32_t ApplyHysteresis(uint32_t current, uint32_t target, uint64_t nowMs) const;
+
+    NvEncRateControlConfig          m_config;
+    uint32_t                        m_uBitrate;
+    uint32_t                        m_uFramerate;
+    uint64_t                        m_uLastChangeMs;
+    bool                            m_bChanged;
+};
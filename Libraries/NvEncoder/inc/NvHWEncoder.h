@@ -77,6 +77,7 @@ typedef struct _EncodeConfig
     int  enableAsyncMode;
     int  preloadedFrameCount;
     int  enableTemporalAQ;
+    int  enableExtQPDeltaMap;
 }EncodeConfig;
 
 typedef struct _EncodeInputBuffer
@@ -122,6 +123,7 @@ typedef struct _NvEncPictureCommand
 {
     bool bResolutionChangePending;
     bool bBitrateChangePending;
+    bool bFramerateChangePending;
     bool bForceIDR;
     bool bForceIntraRefresh;
     bool bInvalidateRefFrames;
@@ -131,6 +133,7 @@ typedef struct _NvEncPictureCommand
 
     uint32_t newBitrate;
     uint32_t newVBVSize;
+    uint32_t newFramerate;
 
     uint32_t  intraRefreshDuration;
 
@@ -154,7 +157,20 @@ struct MEOnlyConfig
     unsigned int referenceFrameIndex;
 };
 
-class CNvHWEncoder
+// Bitstream access needed to drain encoded frames, split out of
+// CNvHWEncoder so output handling can be tested without NVENC.
+class INvHWEncoder
+{
+public:
+    virtual ~INvHWEncoder() {}
+
+    // May return NV_ENC_ERR_LOCK_BUSY when doNotWait is set and the frame
+    // isn't encoded yet.
+    virtual NVENCSTATUS NvEncLockBitstream(NV_ENC_LOCK_BITSTREAM* lockBitstreamBufferParams) = 0;
+    virtual NVENCSTATUS NvEncUnlockBitstream(NV_ENC_OUTPUT_PTR bitstreamBuffer) = 0;
+};
+
+class CNvHWEncoder : public INvHWEncoder
 {
 public:
     uint32_t                                             m_EncodeIdx;
@@ -194,8 +210,8 @@ public:
     NVENCSTATUS NvEncCreateMVBuffer(uint32_t size, void** bitstreamBuffer);
     NVENCSTATUS NvEncDestroyMVBuffer(NV_ENC_OUTPUT_PTR bitstreamBuffer);
     NVENCSTATUS NvRunMotionEstimationOnly(MotionEstimationBuffer *pMEBuffer, MEOnlyConfig *pMEOnly);
-    NVENCSTATUS NvEncLockBitstream(NV_ENC_LOCK_BITSTREAM* lockBitstreamBufferParams);
-    NVENCSTATUS NvEncUnlockBitstream(NV_ENC_OUTPUT_PTR bitstreamBuffer);
+    NVENCSTATUS NvEncLockBitstream(NV_ENC_LOCK_BITSTREAM* lockBitstreamBufferParams) override;
+    NVENCSTATUS NvEncUnlockBitstream(NV_ENC_OUTPUT_PTR bitstreamBuffer) override;
     NVENCSTATUS NvEncLockInputBuffer(void* inputBuffer, void** bufferDataPtr, uint32_t* pitch);
     NVENCSTATUS NvEncUnlockInputBuffer(NV_ENC_INPUT_PTR inputBuffer);
     NVENCSTATUS NvEncGetEncodeStats(NV_ENC_STAT* encodeStats);
@@ -0,0 +1,156 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+// Keeps the producer and consumer indices on separate cache lines.
+#define SPSC_RING_CACHE_LINE_SIZE 64
+
+// Lock-free ring for one producer thread and one consumer thread.
+//
+// The head is only written by the consumer and the tail by the producer,
+// both count up and wrap around, and the capacity is a power of two so a
+// mask maps them to slots. Each side caches the last index it read from
+// the other, so the shared cache line is only touched when the ring looks
+// full or empty.
+template<class T>
+class CNvSpscRing
+{
+public:
+    CNvSpscRing() :
+        m_uMask(0),
+        m_head(0),
+        m_uCachedTail(0),
+        m_tail(0),
+        m_uCachedHead(0)
+    {
+    }
+
+    // Allocates at least |uMinCapacity| slots and empties the ring. Not
+    // thread safe, must be called before either side uses the ring.
+    bool Initialize(uint32_t uMinCapacity)
+    {
+        if (uMinCapacity == 0 || uMinCapacity > 0x80000000u)
+        {
+            return false;
+        }
+
+        uint32_t uCapacity = 1;
+        while (uCapacity < uMinCapacity)
+        {
+            uCapacity <<= 1;
+        }
+
+        m_items.clear();
+        m_items.resize(uCapacity);
+        m_uMask = uCapacity - 1;
+        m_head.store(0, std::memory_order_relaxed);
+        m_tail.store(0, std::memory_order_relaxed);
+        m_uCachedTail = 0;
+        m_uCachedHead = 0;
+        return true;
+    }
+
+    uint32_t GetCapacity() const
+    {
+        return static_cast<uint32_t>(m_items.size());
+    }
+
+    // Producer side. Returns false when the ring is full.
+    bool TryPush(T item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_uCachedHead == GetCapacity())
+        {
+            m_uCachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_uCachedHead == GetCapacity())
+            {
+                return false;
+            }
+        }
+
+        m_items[tail & m_uMask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns the oldest item without removing it, or NULL
+    // when the ring is empty.
+    T* Front()
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_uCachedTail)
+        {
+            m_uCachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_uCachedTail)
+            {
+                return NULL;
+            }
+        }
+
+        return &m_items[head & m_uMask];
+    }
+
+    // Consumer side. Returns false when the ring is empty.
+    bool TryPop(T* pItem)
+    {
+        T* pFront = Front();
+        if (!pFront)
+        {
+            return false;
+        }
+
+        *pItem = std::move(*pFront);
+        Pop();
+        return true;
+    }
+
+    // Consumer side. Removes the item returned by Front().
+    void Pop()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Exact when called from either side while the other is idle,
+    // otherwise a snapshot.
+    uint32_t GetCount() const
+    {
+        // The head never passes the tail, loading it first keeps the count
+        // from wrapping.
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        return m_tail.load(std::memory_order_acquire) - head;
+    }
+
+    bool IsEmpty() const
+    {
+        return GetCount() == 0;
+    }
+
+private:
+    std::vector<T>              m_items;
+    uint32_t                    m_uMask;
+
+    // Consumer owned.
+    char                        m_consumerPadding[SPSC_RING_CACHE_LINE_SIZE];
+    std::atomic<uint32_t>       m_head;
+    uint32_t                    m_uCachedTail;
+
+    // Producer owned.
+    char                        m_producerPadding[SPSC_RING_CACHE_LINE_SIZE];
+    std::atomic<uint32_t>       m_tail;
+    uint32_t                    m_uCachedHead;
+    char                        m_tailPadding[SPSC_RING_CACHE_LINE_SIZE];
+};
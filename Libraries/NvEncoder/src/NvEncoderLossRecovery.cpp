@@ -0,0 +1,150 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#include "pch.h"
+#include "NvEncoderLossRecovery.h"
+
+CNvEncoderLossRecovery::CNvEncoderLossRecovery(const NvEncLossRecoveryConfig& config) :
+    m_config(config),
+    m_lastAction(NV_ENC_RECOVERY_NONE),
+    m_bRecovering(false),
+    m_uWaveFramesLeft(0),
+    m_uRecoveredMs(0),
+    m_uRttMs(0)
+{
+}
+
+void CNvEncoderLossRecovery::OnFrameEncoded(uint64_t inputTimeStamp, uint32_t rtpTimestamp, NvEncRecoveryAction action,
+                                            uint64_t nowMs)
+{
+    if (action == NV_ENC_RECOVERY_IDR)
+    {
+        // Nothing before an IDR frame can be referenced again.
+        m_refFrames.clear();
+    }
+
+    if (action == NV_ENC_RECOVERY_INTRA_REFRESH)
+    {
+        m_bRecovering = true;
+        m_uWaveFramesLeft = m_config.intraRefreshDuration > 0 ? m_config.intraRefreshDuration : 1;
+    }
+    else if (action != NV_ENC_RECOVERY_NONE)
+    {
+        // Takes effect with this frame.
+        m_bRecovering = false;
+        m_uRecoveredMs = nowMs;
+    }
+
+    if (action != NV_ENC_RECOVERY_NONE)
+    {
+        m_lastAction = action;
+    }
+
+    if (m_bRecovering && --m_uWaveFramesLeft == 0)
+    {
+        m_bRecovering = false;
+        m_uRecoveredMs = nowMs;
+    }
+
+    EncodedFrame frame = { inputTimeStamp, rtpTimestamp };
+    m_refFrames.push_back(frame);
+    if (m_refFrames.size() > MAX_INVALIDATED_REF_FRAMES)
+    {
+        m_refFrames.pop_front();
+    }
+}
+
+NvEncRecoveryAction CNvEncoderLossRecovery::OnKeyFrameRequest(uint64_t nowMs)
+{
+    return SelectAction(NV_ENC_RECOVERY_INTRA_REFRESH, nowMs);
+}
+
+NvEncRecoveryAction CNvEncoderLossRecovery::OnFrameLost(uint32_t rtpTimestamp, uint64_t nowMs, uint64_t* pRefFrames,
+                                                        uint32_t* pNumRefFrames)
+{
+    *pNumRefFrames = 0;
+    NvEncRecoveryAction action = SelectAction(NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES, nowMs);
+    if (action != NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES)
+    {
+        return action;
+    }
+
+    // RTP timestamps wrap around, the first frame not older than the
+    // reported one is the first that may be lost.
+    uint32_t lostIndex = 0;
+    while (lostIndex < m_refFrames.size() &&
+        static_cast<int32_t>(m_refFrames[lostIndex].rtpTimestamp - rtpTimestamp) < 0)
+    {
+        lostIndex++;
+    }
+
+    if (m_refFrames.empty() ||
+        static_cast<int32_t>(m_refFrames.front().rtpTimestamp - rtpTimestamp) > 0)
+    {
+        // Older than every reference frame, which may predict from it.
+        return GetSupportedAction(NV_ENC_RECOVERY_INTRA_REFRESH);
+    }
+
+    if (lostIndex == m_refFrames.size())
+    {
+        // Newer than every frame encoded, nothing to invalidate yet.
+        return NV_ENC_RECOVERY_NONE;
+    }
+
+    // Every frame after the lost one may reference it.
+    for (uint32_t i = lostIndex; i < m_refFrames.size(); i++)
+    {
+        pRefFrames[(*pNumRefFrames)++] = m_refFrames[i].inputTimeStamp;
+    }
+
+    m_refFrames.erase(m_refFrames.begin() + lostIndex, m_refFrames.end());
+    return action;
+}
+
+NvEncRecoveryAction CNvEncoderLossRecovery::SelectAction(NvEncRecoveryAction preferred, uint64_t nowMs)
+{
+    if (m_lastAction == NV_ENC_RECOVERY_NONE)
+    {
+        // Nothing was encoded yet, the first frame has to be an IDR.
+        return NV_ENC_RECOVERY_IDR;
+    }
+
+    uint64_t settledMs = m_uRecoveredMs + m_uRttMs;
+    if (m_bRecovering || nowMs < settledMs)
+    {
+        return NV_ENC_RECOVERY_NONE;
+    }
+
+    NvEncRecoveryAction action = preferred;
+    if (nowMs <= settledMs + m_config.escalationWindowMs && action <= m_lastAction)
+    {
+        action = m_lastAction == NV_ENC_RECOVERY_IDR ?
+            NV_ENC_RECOVERY_IDR : static_cast<NvEncRecoveryAction>(m_lastAction + 1);
+    }
+
+    return GetSupportedAction(action);
+}
+
+NvEncRecoveryAction CNvEncoderLossRecovery::GetSupportedAction(NvEncRecoveryAction action)
+{
+    if (action == NV_ENC_RECOVERY_INVALIDATE_REF_FRAMES && !m_config.invalidateRefFramesEnableFlag)
+    {
+        action = NV_ENC_RECOVERY_INTRA_REFRESH;
+    }
+
+    if (action == NV_ENC_RECOVERY_INTRA_REFRESH &&
+        (!m_config.intraRefreshEnableFlag || m_config.intraRefreshDuration == 0))
+    {
+        action = NV_ENC_RECOVERY_IDR;
+    }
+
+    return action;
+}
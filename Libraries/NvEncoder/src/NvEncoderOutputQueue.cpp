@@ -0,0 +1,264 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#include "pch.h"
+#include "NvEncoderOutputQueue.h"
+
+#include <chrono>
+
+CNvEncoderOutputQueue::CNvEncoderOutputQueue(INvHWEncoder* pEncoder, PacketCallback onPacket, uint32_t maxQueuedPackets,
+                                             uint32_t maxPendingOutputs) :
+    m_pEncoder(pEncoder),
+    m_onPacket(onPacket),
+    m_uMaxQueuedPackets(maxQueuedPackets > 0 ? maxQueuedPackets : 1),
+    m_uAllocatedPackets(0),
+    m_uSubmitted(0),
+    m_uCompleted(0),
+    m_uWritten(0),
+    m_uFailed(0),
+    m_bStopping(false),
+    m_bCompletionDone(false),
+    m_bCompletionIdle(false)
+{
+    m_pending.Initialize(maxPendingOutputs > 0 ? maxPendingOutputs : 1);
+    m_completionThread = std::thread(&CNvEncoderOutputQueue::CompletionThread, this);
+    m_writerThread = std::thread(&CNvEncoderOutputQueue::WriterThread, this);
+}
+
+CNvEncoderOutputQueue::~CNvEncoderOutputQueue()
+{
+    // Both threads drain their queues before exiting, so no submitted
+    // frame is left locked or unwritten.
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bStopping = true;
+    }
+
+    m_pendingCondition.notify_all();
+    m_completionThread.join();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bCompletionDone = true;
+    }
+
+    m_readyCondition.notify_all();
+    m_writerThread.join();
+}
+
+uint64_t CNvEncoderOutputQueue::Submit(NV_ENC_OUTPUT_PTR hBitstreamBuffer, HANDLE hOutputEvent)
+{
+    PendingOutput pending = { hBitstreamBuffer, hOutputEvent };
+    while (!m_pending.TryPush(pending))
+    {
+        std::this_thread::yield();
+    }
+
+    uint64_t sequence = m_uSubmitted.fetch_add(1);
+
+    // Pairs with the fence in CompletionThread, either the completion
+    // thread sees the new item or this thread sees it idle.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_bCompletionIdle.load())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingCondition.notify_one();
+    }
+
+    return sequence;
+}
+
+void CNvEncoderOutputQueue::WaitForOutput(uint64_t sequence)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_progressCondition.wait(lock, [this, sequence] { return m_uCompleted > sequence; });
+}
+
+void CNvEncoderOutputQueue::Flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_progressCondition.wait(lock, [this] { return m_uWritten + m_uFailed == m_uSubmitted; });
+}
+
+uint64_t CNvEncoderOutputQueue::GetWrittenCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uWritten;
+}
+
+uint64_t CNvEncoderOutputQueue::GetFailedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uFailed;
+}
+
+uint32_t CNvEncoderOutputQueue::GetAllocatedPacketCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_uAllocatedPackets;
+}
+
+void CNvEncoderOutputQueue::CompletionThread()
+{
+    while (true)
+    {
+        PendingOutput* pPending = m_pending.Front();
+        if (!pPending)
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_bCompletionIdle.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            m_pendingCondition.wait(lock, [this] { return m_bStopping || !m_pending.IsEmpty(); });
+            m_bCompletionIdle.store(false);
+            if (m_pending.IsEmpty())
+            {
+                return;
+            }
+
+            continue;
+        }
+
+        PendingOutput pending = *pPending;
+        uint64_t sequence = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            sequence = m_uCompleted;
+        }
+
+        // Takes the packet first, so a slow consumer stalls this thread
+        // rather than extending how long the bitstream stays locked.
+        std::unique_ptr<NvEncOutputPacket> packet = AcquirePacket();
+
+        NV_ENC_LOCK_BITSTREAM lockBitstreamData;
+        NVENCSTATUS nvStatus = LockBitstream(pending, &lockBitstreamData);
+        if (nvStatus == NV_ENC_SUCCESS)
+        {
+            const uint8_t* pData = static_cast<const uint8_t*>(lockBitstreamData.bitstreamBufferPtr);
+            packet->data.assign(pData, pData + lockBitstreamData.bitstreamSizeInBytes);
+            packet->sequence = sequence;
+            packet->outputTimeStamp = lockBitstreamData.outputTimeStamp;
+            packet->pictureType = lockBitstreamData.pictureType;
+            nvStatus = m_pEncoder->NvEncUnlockBitstream(pending.hBitstreamBuffer);
+        }
+
+        if (nvStatus != NV_ENC_SUCCESS)
+        {
+            PRINTERR("Failed to retrieve bitstream %llu (%d)\n", (unsigned long long)sequence, nvStatus);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending.Pop();
+            m_uCompleted++;
+            if (nvStatus == NV_ENC_SUCCESS)
+            {
+                m_ready.push_back(std::move(packet));
+            }
+            else
+            {
+                m_uFailed++;
+                m_freePackets.push_back(std::move(packet));
+            }
+        }
+
+        m_readyCondition.notify_one();
+        m_packetCondition.notify_one();
+        m_progressCondition.notify_all();
+    }
+}
+
+void CNvEncoderOutputQueue::WriterThread()
+{
+    while (true)
+    {
+        std::unique_ptr<NvEncOutputPacket> packet;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_readyCondition.wait(lock, [this] { return m_bCompletionDone || !m_ready.empty(); });
+            if (m_ready.empty())
+            {
+                return;
+            }
+
+            packet = std::move(m_ready.front());
+            m_ready.pop_front();
+        }
+
+        if (m_onPacket)
+        {
+            m_onPacket(*packet);
+        }
+
+        Retire(std::move(packet));
+    }
+}
+
+NVENCSTATUS CNvEncoderOutputQueue::LockBitstream(const PendingOutput& pending, NV_ENC_LOCK_BITSTREAM* pLockBitstreamData)
+{
+#if defined(NV_WINDOWS)
+    // In async mode the event fires once the frame is encoded, waiting here
+    // only blocks the completion thread.
+    if (pending.hOutputEvent)
+    {
+        WaitForSingleObject(pending.hOutputEvent, INFINITE);
+    }
+#endif
+
+    // In sync mode, polls until NVENC stops reporting the lock as busy.
+    NVENCSTATUS nvStatus = NV_ENC_SUCCESS;
+    do
+    {
+        memset(pLockBitstreamData, 0, sizeof(NV_ENC_LOCK_BITSTREAM));
+        SET_VER((*pLockBitstreamData), NV_ENC_LOCK_BITSTREAM);
+        pLockBitstreamData->outputBitstream = pending.hBitstreamBuffer;
+        pLockBitstreamData->doNotWait = 1;
+
+        nvStatus = m_pEncoder->NvEncLockBitstream(pLockBitstreamData);
+        if (nvStatus == NV_ENC_ERR_LOCK_BUSY)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(OUTPUT_POLL_INTERVAL_US));
+        }
+    } while (nvStatus == NV_ENC_ERR_LOCK_BUSY);
+
+    return nvStatus;
+}
+
+std::unique_ptr<NvEncOutputPacket> CNvEncoderOutputQueue::AcquirePacket()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_packetCondition.wait(lock, [this]
+    {
+        return !m_freePackets.empty() || m_uAllocatedPackets < m_uMaxQueuedPackets;
+    });
+
+    if (!m_freePackets.empty())
+    {
+        // Reused packets keep their capacity, steady state allocates nothing.
+        std::unique_ptr<NvEncOutputPacket> packet = std::move(m_freePackets.back());
+        m_freePackets.pop_back();
+        return packet;
+    }
+
+    m_uAllocatedPackets++;
+    return std::unique_ptr<NvEncOutputPacket>(new NvEncOutputPacket());
+}
+
+void CNvEncoderOutputQueue::Retire(std::unique_ptr<NvEncOutputPacket> packet)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freePackets.push_back(std::move(packet));
+        m_uWritten++;
+    }
+
+    m_packetCondition.notify_one();
+    m_progressCondition.notify_all();
+}
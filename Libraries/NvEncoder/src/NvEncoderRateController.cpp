@@ -0,0 +1,109 @@
+/*
+ * Copyright 1993-2015 NVIDIA Corporation.  All rights reserved.
+ *
+ * Please refer to the NVIDIA end user license agreement (EULA) associated
+ * with this source code for terms and conditions that govern your use of
+ * this software. Any use, reproduction, disclosure, or distribution of
+ * this software and related documentation outside the terms of the EULA
+ * is strictly prohibited.
+ *
+ */
+
+#include "pch.h"
+#include "NvEncoderRateController.h"
+
+CNvEncoderRateController::CNvEncoderRateController(const NvEncRateControlConfig& config) :
+    m_config(config),
+    m_uBitrate(0),
+    m_uFramerate(0),
+    m_uLastChangeMs(0),
+    m_bChanged(false)
+{
+}
+
+void CNvEncoderRateController::Reset(uint32_t bitrate, uint32_t framerate)
+{
+    m_uBitrate = bitrate;
+    m_uFramerate = framerate;
+    m_bChanged = false;
+}
+
+bool CNvEncoderRateController::Update(uint32_t targetBitrate, uint32_t targetFramerate, uint64_t nowMs,
+                                      NvEncRateControlUpdate* pUpdate) const
+{
+    if (targetBitrate == 0 || targetFramerate == 0)
+    {
+        return false;
+    }
+
+    uint32_t bitrate = targetBitrate;
+    if (bitrate < m_config.minBitrate)
+    {
+        bitrate = m_config.minBitrate;
+    }
+
+    if (m_config.maxBitrate > 0 && bitrate > m_config.maxBitrate)
+    {
+        bitrate = m_config.maxBitrate;
+    }
+
+    uint32_t newBitrate = ApplyHysteresis(m_uBitrate, bitrate, nowMs);
+    if (m_uBitrate > 0 && m_config.maxStepUp > 1.0 && newBitrate > m_uBitrate * m_config.maxStepUp)
+    {
+        newBitrate = static_cast<uint32_t>(m_uBitrate * m_config.maxStepUp);
+    }
+
+    uint32_t newFramerate = ApplyHysteresis(m_uFramerate, targetFramerate, nowMs);
+    if (newBitrate == m_uBitrate && newFramerate == m_uFramerate)
+    {
+        return false;
+    }
+
+    pUpdate->bitrate = newBitrate;
+    pUpdate->framerate = newFramerate;
+    pUpdate->vbvBufferSize = ComputeVBVBufferSize(newBitrate, newFramerate, m_config.vbvBufferFrames);
+    return true;
+}
+
+void CNvEncoderRateController::Commit(const NvEncRateControlUpdate& update, uint64_t nowMs)
+{
+    m_uBitrate = update.bitrate;
+    m_uFramerate = update.framerate;
+    m_uLastChangeMs = nowMs;
+    m_bChanged = true;
+}
+
+uint32_t CNvEncoderRateController::ApplyHysteresis(uint32_t current, uint32_t target, uint64_t nowMs) const
+{
+    if (current == 0 || target < current * (1.0 - m_config.hysteresis))
+    {
+        return target;
+    }
+
+    if (target > current * (1.0 + m_config.hysteresis) &&
+        (!m_bChanged || nowMs - m_uLastChangeMs >= m_config.minIntervalMs))
+    {
+        return target;
+    }
+
+    return current;
+}
+
+uint32_t CNvEncoderRateController::GetVBVBufferSize() const
+{
+    return ComputeVBVBufferSize(m_uBitrate, m_uFramerate, m_config.vbvBufferFrames);
+}
+
+uint32_t CNvEncoderRateController::ComputeVBVBufferSize(uint32_t bitrate, uint32_t framerate, double vbvBufferFrames)
+{
+    if (framerate == 0)
+    {
+        return 0;
+    }
+
+    // Never smaller than one frame, NVENC would have to drop to the
+    // maximum QP to fit an average frame.
+    double frames = vbvBufferFrames < 1.0 ? 1.0 : vbvBufferFrames;
+    double size = (static_cast<double>(bitrate) / framerate) * frames;
+    return size >= UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(size);
+}
@@ -284,7 +284,7 @@ NVENCSTATUS CNvHWEncoder::NvEncLockBitstream(NV_ENC_LOCK_BITSTREAM* lockBitstrea
     NVENCSTATUS nvStatus = NV_ENC_SUCCESS;
 
     nvStatus = m_pEncodeAPI->nvEncLockBitstream(m_hEncoder, lockBitstreamBufferParams);
-    if (nvStatus != NV_ENC_SUCCESS)
+    if (nvStatus != NV_ENC_SUCCESS && nvStatus != NV_ENC_ERR_LOCK_BUSY)
     {
         assert(0);
     }
@@ -538,7 +538,8 @@ NVENCSTATUS CNvHWEncoder::NvEncReconfigureEncoder(const NvEncPictureCommand *pEn
 {
     NVENCSTATUS nvStatus = NV_ENC_SUCCESS;
 
-    if (pEncPicCommand->bBitrateChangePending || pEncPicCommand->bResolutionChangePending)
+    if (pEncPicCommand->bBitrateChangePending || pEncPicCommand->bResolutionChangePending ||
+        pEncPicCommand->bFramerateChangePending)
     {
         if (pEncPicCommand->bResolutionChangePending)
         {
@@ -554,6 +555,16 @@ NVENCSTATUS CNvHWEncoder::NvEncReconfigureEncoder(const NvEncPictureCommand *pEn
             m_stCreateEncodeParams.darHeight = m_uCurHeight;
         }
 
+        if (pEncPicCommand->bFramerateChangePending)
+        {
+            if (pEncPicCommand->newFramerate == 0)
+            {
+                return NV_ENC_ERR_INVALID_PARAM;
+            }
+            m_stCreateEncodeParams.frameRateNum = pEncPicCommand->newFramerate;
+            m_stCreateEncodeParams.frameRateDen = 1;
+        }
+
         if (pEncPicCommand->bBitrateChangePending)
         {
             m_stEncodeConfig.rcParams.averageBitRate = pEncPicCommand->newBitrate;
@@ -884,7 +895,7 @@ NVENCSTATUS CNvHWEncoder::CreateEncoder(EncodeConfig *pEncCfg)
         }
     }
 
-    if (pEncCfg->qpDeltaMapFile)
+    if (pEncCfg->qpDeltaMapFile || pEncCfg->enableExtQPDeltaMap)
     {
         m_stEncodeConfig.rcParams.enableExtQPDeltaMap = 1;
     }
@@ -0,0 +1,328 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+#include "http_response_parser.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace SignalingClientTests
+{
+	const char kResponse[] =
+		"HTTP/1.1 200 OK\r\n"
+		"Pragma: 7\r\n"
+		"Content-Type: text/plain\r\n"
+		"Content-Length: 18\r\n"
+		"\r\n"
+		"renderer,8,1\n"
+		"a,9,1";
+
+	const char kChunkedResponse[] =
+		"HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n"
+		"\r\n"
+		"5;name=value\r\n"
+		"hello\r\n"
+		"6 ; quoted=\"a;b\"\r\n"
+		" world\r\n"
+		"0\r\n"
+		"Expires: never\r\n"
+		"X-Checksum: 1234\r\n"
+		"\r\n";
+
+	std::string GetBody(const HttpResponseParser& parser)
+	{
+		return std::string(parser.body(), parser.body_size());
+	}
+
+	TEST_CLASS(HttpResponseParserTests)
+	{
+	public:
+
+		TEST_METHOD(HttpParser_Parses_Response)
+		{
+			HttpResponseParser parser;
+			parser.Append(kResponse, sizeof(kResponse) - 1);
+
+			Assert::IsTrue(parser.is_complete());
+			Assert::AreEqual(200, parser.status());
+			Assert::AreEqual(1, parser.minor_version());
+			Assert::IsFalse(parser.connection_close());
+			Assert::IsTrue(parser.has_content_length());
+			Assert::AreEqual("renderer,8,1\na,9,1", GetBody(parser).c_str());
+
+			// Header names ignore case, values are trimmed.
+			std::string value;
+			size_t peer_id = 0;
+			Assert::IsTrue(parser.GetHeader("content-type", &value));
+			Assert::AreEqual("text/plain", value.c_str());
+			Assert::IsTrue(parser.GetHeader("PRAGMA", &peer_id));
+			Assert::IsTrue(peer_id == 7);
+			Assert::IsFalse(parser.GetHeader("X-Peer-Id", &value));
+
+			size_t offset = 0;
+			const char* line = nullptr;
+			size_t line_size = 0;
+			Assert::IsTrue(parser.GetBodyLine(&offset, &line, &line_size));
+			Assert::AreEqual("renderer,8,1", std::string(line, line_size).c_str());
+			Assert::IsTrue(parser.GetBodyLine(&offset, &line, &line_size));
+			Assert::AreEqual("a,9,1", std::string(line, line_size).c_str());
+			Assert::IsFalse(parser.GetBodyLine(&offset, &line, &line_size));
+		}
+
+		TEST_METHOD(HttpParser_Split_Reads_At_Every_Byte)
+		{
+			const std::string responses[] = { kResponse, kChunkedResponse };
+			for (const std::string& response : responses)
+			{
+				HttpResponseParser whole;
+				whole.Append(response.data(), response.size());
+				Assert::IsTrue(whole.is_complete());
+
+				// Completes only with the last byte, whatever the split.
+				for (size_t split = 1; split < response.size(); split++)
+				{
+					HttpResponseParser parser;
+					parser.Append(response.data(), split);
+					Assert::IsFalse(parser.is_complete());
+					Assert::IsTrue(parser.state() != HttpResponseParser::MALFORMED);
+
+					parser.Append(response.data() + split, response.size() - split);
+					Assert::IsTrue(parser.is_complete());
+					Assert::AreEqual(200, parser.status());
+					Assert::AreEqual(GetBody(whole).c_str(), GetBody(parser).c_str());
+				}
+
+				// One byte per read.
+				HttpResponseParser parser;
+				for (size_t i = 0; i < response.size(); i++)
+				{
+					Assert::IsFalse(parser.is_complete());
+					parser.Append(response.data() + i, 1);
+				}
+
+				Assert::IsTrue(parser.is_complete());
+				Assert::AreEqual(GetBody(whole).c_str(), GetBody(parser).c_str());
+			}
+		}
+
+		TEST_METHOD(HttpParser_Pipelined_Responses)
+		{
+			std::string data = std::string(kResponse) + kChunkedResponse +
+				"HTTP/1.1 204 No Content\r\n\r\n"
+				"HTTP/1.1 500 Internal Server Error\r\n"
+				"Connection: close\r\n"
+				"Content-Length: 5\r\n"
+				"\r\n"
+				"error"
+				"HTTP/1.1 2";
+
+			HttpResponseParser parser;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.is_complete());
+			Assert::AreEqual("renderer,8,1\na,9,1", GetBody(parser).c_str());
+
+			Assert::IsTrue(parser.Next() == HttpResponseParser::COMPLETE);
+			Assert::IsTrue(parser.is_chunked());
+			Assert::AreEqual("hello world", GetBody(parser).c_str());
+
+			// No Content responses have no body.
+			Assert::IsTrue(parser.Next() == HttpResponseParser::COMPLETE);
+			Assert::AreEqual(204, parser.status());
+			Assert::IsTrue(parser.body_size() == 0);
+
+			Assert::IsTrue(parser.Next() == HttpResponseParser::COMPLETE);
+			Assert::AreEqual(500, parser.status());
+			Assert::IsTrue(parser.connection_close());
+			Assert::AreEqual("error", GetBody(parser).c_str());
+			Assert::AreEqual("HTTP/1.1 2", std::string(parser.remaining(), parser.remaining_size()).c_str());
+
+			// The start of the next response is kept.
+			Assert::IsTrue(parser.Next() == HttpResponseParser::STATUS_LINE);
+			std::string rest = "00 OK\r\nContent-Length: 2\r\n\r\nok";
+			parser.Append(rest.data(), rest.size());
+			Assert::IsTrue(parser.is_complete());
+			Assert::AreEqual(200, parser.status());
+			Assert::AreEqual("ok", GetBody(parser).c_str());
+			Assert::IsTrue(parser.remaining_size() == 0);
+		}
+
+		TEST_METHOD(HttpParser_Chunked_Body_With_Extensions_And_Trailers)
+		{
+			std::string data = std::string(kChunkedResponse) + "HTTP/1.1 200 OK\r\n";
+
+			HttpResponseParser parser;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.is_complete());
+			Assert::IsTrue(parser.is_chunked());
+			Assert::IsFalse(parser.has_content_length());
+			Assert::AreEqual("hello world", GetBody(parser).c_str());
+
+			// Trailer fields aren't headers, and end with the body.
+			std::string value;
+			Assert::IsFalse(parser.GetHeader("Expires", &value));
+			Assert::AreEqual("HTTP/1.1 200 OK\r\n", std::string(parser.remaining(), parser.remaining_size()).c_str());
+		}
+
+		TEST_METHOD(HttpParser_Chunked_Ignores_Content_Length)
+		{
+			std::string data =
+				"HTTP/1.1 200 OK\r\n"
+				"Content-Length: 100\r\n"
+				"Transfer-Encoding: gzip, Chunked\r\n"
+				"\r\n"
+				"A\r\n"
+				"0123456789\r\n"
+				"0\r\n"
+				"\r\n";
+
+			HttpResponseParser parser;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.is_complete());
+			Assert::AreEqual("0123456789", GetBody(parser).c_str());
+		}
+
+		TEST_METHOD(HttpParser_Body_Until_End_Of_Stream)
+		{
+			std::string data =
+				"HTTP/1.0 200 OK\r\n"
+				"\r\n"
+				"until the end";
+
+			HttpResponseParser parser;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.state() == HttpResponseParser::BODY);
+			Assert::AreEqual(0, parser.minor_version());
+
+			// HTTP/1.0 connections close unless kept alive.
+			Assert::IsTrue(parser.connection_close());
+			Assert::IsTrue(parser.OnEndOfStream() == HttpResponseParser::COMPLETE);
+			Assert::AreEqual("until the end", GetBody(parser).c_str());
+		}
+
+		TEST_METHOD(HttpParser_Connection_Header)
+		{
+			std::string data =
+				"HTTP/1.0 200 OK\r\n"
+				"Connection: Keep-Alive\r\n"
+				"Content-Length: 0\r\n"
+				"\r\n"
+				"HTTP/1.1 200 OK\r\n"
+				"Connection: upgrade, close\r\n"
+				"Content-Length: 0\r\n"
+				"\r\n";
+
+			HttpResponseParser parser;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.is_complete());
+			Assert::IsFalse(parser.connection_close());
+			Assert::IsTrue(parser.Next() == HttpResponseParser::COMPLETE);
+			Assert::IsTrue(parser.connection_close());
+		}
+
+		TEST_METHOD(HttpParser_Malformed_Status_Line)
+		{
+			const char* responses[] =
+			{
+				"HTTP/2 200 OK\r\n",
+				"HTTP/1.1 OK\r\n",
+				"HTTP/1.1 2000 OK\r\n",
+				"HTTP/1.x 200 OK\r\n",
+				"ICY 200 OK\r\n",
+				"\r\n"
+			};
+
+			for (const char* response : responses)
+			{
+				HttpResponseParser parser;
+				parser.Append(response, strlen(response));
+				Assert::IsTrue(parser.state() == HttpResponseParser::MALFORMED);
+			}
+		}
+
+		TEST_METHOD(HttpParser_Malformed_Headers)
+		{
+			const char* responses[] =
+			{
+				// No colon
+				"HTTP/1.1 200 OK\r\nContent-Length 5\r\n\r\n",
+
+				// No name
+				"HTTP/1.1 200 OK\r\n: 5\r\n\r\n",
+
+				// Content-Length isn't a number
+				"HTTP/1.1 200 OK\r\nContent-Length: five\r\n\r\n",
+
+				// Chunk size isn't a number
+				"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+
+				// Chunk data longer than its size
+				"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n",
+
+				// Chunk size overflows
+				"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000000000000\r\n"
+			};
+
+			for (const char* response : responses)
+			{
+				HttpResponseParser parser;
+				parser.Append(response, strlen(response));
+				Assert::IsTrue(parser.state() == HttpResponseParser::MALFORMED);
+			}
+		}
+
+		TEST_METHOD(HttpParser_Oversized_Headers)
+		{
+			std::string value(64 * 1024, 'a');
+
+			// A single header line without its end.
+			HttpResponseParser parser;
+			std::string data = "HTTP/1.1 200 OK\r\nX-Large: " + value;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.state() == HttpResponseParser::MALFORMED);
+
+			// Many complete header lines.
+			parser.Reset();
+			data = "HTTP/1.1 200 OK\r\n";
+			parser.Append(data.data(), data.size());
+			std::string header = "X-Header: " + std::string(1000, 'b') + "\r\n";
+			for (int i = 0; i < 100 && parser.state() != HttpResponseParser::MALFORMED; i++)
+			{
+				parser.Append(header.data(), header.size());
+			}
+
+			Assert::IsTrue(parser.state() == HttpResponseParser::MALFORMED);
+
+			// A chunk size line without its end.
+			parser.Reset();
+			data = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n5;" + value + value;
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.state() == HttpResponseParser::MALFORMED);
+
+			// Headers just below the limit are accepted.
+			parser.Reset();
+			data = "HTTP/1.1 200 OK\r\nX-Large: " + std::string(60 * 1024, 'c') + "\r\nContent-Length: 0\r\n\r\n";
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.is_complete());
+		}
+
+		TEST_METHOD(HttpParser_Write_Buffer)
+		{
+			HttpResponseParser parser;
+			std::string data(kResponse);
+			for (size_t offset = 0; offset < data.size(); offset += 10)
+			{
+				size_t size = std::min<size_t>(10, data.size() - offset);
+				char* buffer = parser.GetWriteBuffer(0xffff);
+				memcpy(buffer, data.data() + offset, size);
+				parser.OnDataWritten(size);
+			}
+
+			Assert::IsTrue(parser.is_complete());
+			Assert::AreEqual("renderer,8,1\na,9,1", GetBody(parser).c_str());
+		}
+	};
+}
@@ -0,0 +1,299 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <stdint.h>
+#include <string>
+
+#include "websocket_frame_parser.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace SignalingClientTests
+{
+	const size_t kMaxMessageSize = 1024;
+
+	// Returns an unmasked frame, as servers send them. |first_byte| holds the
+	// FIN bit, the reserved bits and the opcode.
+	std::string MakeFrame(uint8_t first_byte, const std::string& payload)
+	{
+		std::string frame(1, static_cast<char>(first_byte));
+		if (payload.size() < 126)
+		{
+			frame += static_cast<char>(payload.size());
+		}
+		else if (payload.size() <= 0xffff)
+		{
+			frame += static_cast<char>(126);
+			frame += static_cast<char>(payload.size() >> 8);
+			frame += static_cast<char>(payload.size());
+		}
+		else
+		{
+			frame += static_cast<char>(127);
+			for (int i = 0; i < 8; i++)
+			{
+				frame += static_cast<char>(static_cast<uint64_t>(payload.size()) >> (56 - 8 * i));
+			}
+		}
+
+		return frame + payload;
+	}
+
+	// Returns a masked frame, as clients send them.
+	std::string MakeMaskedFrame(uint8_t first_byte, const std::string& payload)
+	{
+		std::string frame;
+		WebSocketFrameParser::WriteFrame(first_byte & 0x0f, payload.data(), payload.size(),
+			0x5a3c96e1, &frame);
+
+		frame[0] = static_cast<char>(first_byte);
+		return frame;
+	}
+
+	TEST_CLASS(WebSocketFrameParserTests)
+	{
+	public:
+
+		TEST_METHOD(WebSocketParser_Text_Message)
+		{
+			WebSocketFrameParser parser(kMaxMessageSize);
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+
+			std::string frame = MakeFrame(0x81, "{\"type\":\"signed_in\"}");
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::AreEqual("{\"type\":\"signed_in\"}", parser.payload().c_str());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+
+			frame = MakeFrame(0x82, std::string("\0\1\2", 3));
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::BINARY_MESSAGE);
+			Assert::IsTrue(parser.payload() == std::string("\0\1\2", 3));
+		}
+
+		TEST_METHOD(WebSocketParser_Split_Reads_At_Every_Byte)
+		{
+			// Covers the 7 and 16 bit payload lengths, masked or not.
+			std::string payloads[] =
+			{
+				std::string(),
+				std::string(125, 'a'),
+				std::string(126, 'b'),
+				std::string(1000, 'c')
+			};
+
+			for (const std::string& payload : payloads)
+			{
+				std::string frames[] = { MakeFrame(0x81, payload), MakeMaskedFrame(0x81, payload) };
+				for (const std::string& frame : frames)
+				{
+					for (size_t split = 1; split < frame.size(); split++)
+					{
+						WebSocketFrameParser parser(kMaxMessageSize);
+						parser.Append(frame.data(), split);
+						Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+
+						parser.Append(frame.data() + split, frame.size() - split);
+						Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+						Assert::IsTrue(parser.payload() == payload);
+						Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+					}
+				}
+			}
+
+			// The 64 bit length, one byte per read.
+			std::string payload(70000, 'd');
+			std::string frame = MakeFrame(0x81, payload);
+			WebSocketFrameParser parser(100000);
+			for (size_t i = 0; i < frame.size(); i++)
+			{
+				Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+				parser.Append(frame.data() + i, 1);
+			}
+
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::IsTrue(parser.payload() == payload);
+		}
+
+		TEST_METHOD(WebSocketParser_Burst_Of_Small_Frames)
+		{
+			// Ends with a partial frame, kept across the next write.
+			std::string data;
+			for (int i = 0; i < 1000; i++)
+			{
+				data += MakeFrame(0x81, std::to_string(i));
+			}
+
+			std::string last = MakeMaskedFrame(0x82, "last");
+			data += last.substr(0, 3);
+
+			WebSocketFrameParser parser(kMaxMessageSize);
+			parser.Append(data.data(), data.size());
+			for (int i = 0; i < 1000; i++)
+			{
+				Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+				Assert::AreEqual(std::to_string(i).c_str(), parser.payload().c_str());
+			}
+
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+			parser.Append(last.data() + 3, last.size() - 3);
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::BINARY_MESSAGE);
+			Assert::AreEqual("last", parser.payload().c_str());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+		}
+
+		TEST_METHOD(WebSocketParser_Masked_Frames)
+		{
+			// The masking key repeats over the payload.
+			std::string frame;
+			WebSocketFrameParser::WriteFrame(0x1, "Hello", 5, 0x5a3c96e1, &frame);
+			Assert::IsTrue(frame.size() == 2 + 4 + 5);
+			Assert::IsTrue(static_cast<uint8_t>(frame[0]) == 0x81);
+			Assert::IsTrue(static_cast<uint8_t>(frame[1]) == (0x80 | 5));
+			for (size_t i = 0; i < 5; i++)
+			{
+				Assert::IsTrue((frame[6 + i] ^ frame[2 + i % 4]) == "Hello"[i]);
+			}
+
+			WebSocketFrameParser parser(kMaxMessageSize);
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::AreEqual("Hello", parser.payload().c_str());
+
+			// Extended lengths are written in network order.
+			frame.clear();
+			WebSocketFrameParser::WriteFrame(0x2, std::string(300, 'x').data(), 300, 0, &frame);
+			Assert::IsTrue(static_cast<uint8_t>(frame[1]) == (0x80 | 126));
+			Assert::IsTrue(static_cast<uint8_t>(frame[2]) == 1 && static_cast<uint8_t>(frame[3]) == 44);
+
+			frame.clear();
+			WebSocketFrameParser::WriteFrame(0x2, std::string(0x10000, 'y').data(), 0x10000, 0, &frame);
+			Assert::IsTrue(static_cast<uint8_t>(frame[1]) == (0x80 | 127));
+			Assert::IsTrue(frame.compare(2, 8, std::string("\0\0\0\0\0\1\0\0", 8)) == 0);
+		}
+
+		TEST_METHOD(WebSocketParser_Fragmented_Message)
+		{
+			std::string data =
+				MakeFrame(0x01, "Hel") +
+				MakeFrame(0x89, "ping") +
+				MakeMaskedFrame(0x00, "lo, ") +
+				MakeFrame(0x80, "world");
+
+			WebSocketFrameParser parser(kMaxMessageSize);
+			parser.Append(data.data(), data.size());
+
+			// Control frames can come between fragments.
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::PING);
+			Assert::AreEqual("ping", parser.payload().c_str());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::AreEqual("Hello, world", parser.payload().c_str());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+
+			// A new message can follow.
+			std::string frame = MakeFrame(0x82, "next");
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::BINARY_MESSAGE);
+			Assert::AreEqual("next", parser.payload().c_str());
+		}
+
+		TEST_METHOD(WebSocketParser_Control_Frames)
+		{
+			std::string data =
+				MakeFrame(0x89, "") +
+				MakeFrame(0x8a, "pong") +
+				MakeFrame(0x88, std::string("\x03\xe8", 2) + "bye") +
+				MakeFrame(0x89, std::string(125, 'p'));
+
+			WebSocketFrameParser parser(kMaxMessageSize);
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::PING);
+			Assert::IsTrue(parser.payload().empty());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::PONG);
+			Assert::AreEqual("pong", parser.payload().c_str());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::CLOSE);
+			Assert::IsTrue(parser.payload() == std::string("\x03\xe8", 2) + "bye");
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::PING);
+			Assert::IsTrue(parser.payload().size() == 125);
+		}
+
+		TEST_METHOD(WebSocketParser_Protocol_Errors)
+		{
+			std::string frames[] =
+			{
+				// Fragmented control frame
+				MakeFrame(0x09, "ping"),
+
+				// Control frame over 125 bytes
+				MakeFrame(0x89, std::string(126, 'p')),
+
+				// Reserved control and data opcodes
+				MakeFrame(0x8b, ""),
+				MakeFrame(0x83, ""),
+
+				// Reserved bits
+				MakeFrame(0xc1, "compressed"),
+				MakeFrame(0x91, "a"),
+
+				// Continuation without a message
+				MakeFrame(0x80, "orphan"),
+
+				// New message before the last fragment
+				MakeFrame(0x01, "first") + MakeFrame(0x81, "second")
+			};
+
+			for (const std::string& frame : frames)
+			{
+				WebSocketFrameParser parser(kMaxMessageSize);
+				parser.Append(frame.data(), frame.size());
+				Assert::IsTrue(parser.Next() == WebSocketFrameParser::PROTOCOL_ERROR);
+			}
+		}
+
+		TEST_METHOD(WebSocketParser_Oversized_Messages)
+		{
+			// Frame larger than the limit, rejected from its header.
+			WebSocketFrameParser parser(kMaxMessageSize);
+			std::string frame = MakeFrame(0x81, std::string(kMaxMessageSize + 1, 'a'));
+			parser.Append(frame.data(), 4);
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::MESSAGE_TOO_BIG);
+
+			// 64 bit length beyond the address space.
+			parser.Reset();
+			std::string header("\x81\x7f\xff\xff\xff\xff\xff\xff\xff\xff", 10);
+			parser.Append(header.data(), header.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::MESSAGE_TOO_BIG);
+
+			// Fragments adding up to more than the limit.
+			parser.Reset();
+			std::string data =
+				MakeFrame(0x01, std::string(kMaxMessageSize / 2, 'b')) +
+				MakeFrame(0x00, std::string(kMaxMessageSize / 2, 'c')) +
+				MakeFrame(0x80, "d");
+
+			parser.Append(data.data(), data.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::MESSAGE_TOO_BIG);
+
+			// A message of the maximum size is accepted.
+			parser.Reset();
+			frame = MakeMaskedFrame(0x81, std::string(kMaxMessageSize, 'e'));
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::IsTrue(parser.payload().size() == kMaxMessageSize);
+		}
+
+		TEST_METHOD(WebSocketParser_Reset_Drops_Fragments)
+		{
+			WebSocketFrameParser parser(kMaxMessageSize);
+			std::string frame = MakeFrame(0x01, "partial") + MakeFrame(0x81, std::string(10, 'x')).substr(0, 5);
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::NEED_MORE_DATA);
+
+			parser.Reset();
+			frame = MakeFrame(0x81, "whole");
+			parser.Append(frame.data(), frame.size());
+			Assert::IsTrue(parser.Next() == WebSocketFrameParser::TEXT_MESSAGE);
+			Assert::AreEqual("whole", parser.payload().c_str());
+		}
+	};
+}
@@ -0,0 +1,7 @@
+// stdafx.cpp : source file that includes just the standard includes
+// SignalingClient.Tests.pch will be the pre-compiled header
+// stdafx.obj will contain the pre-compiled type information
+
+#include "stdafx.h"
+
+#pragma comment(lib, "webrtc.lib")
\ No newline at end of file
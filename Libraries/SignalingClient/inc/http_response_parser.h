@@ -0,0 +1,152 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_HTTP_RESPONSE_PARSER_H_
+#define WEBRTC_HTTP_RESPONSE_PARSER_H_
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Incremental HTTP/1.x response parser. Bytes are received straight into the
+// parser's buffer (GetWriteBuffer() then OnDataWritten()) and only the new
+// bytes are parsed, resuming where the previous read stopped. The status
+// line and headers are parsed once, as they complete. The body is exposed
+// as a slice of the buffer, valid until the next write, Next() or Reset().
+//
+// Bodies are delimited by Content-Length, chunked transfer encoding or the
+// end of the stream. Chunked bodies are decoded in place.
+class HttpResponseParser
+{
+public:
+	enum State
+	{
+		STATUS_LINE,
+		HEADERS,
+		BODY,
+		COMPLETE,
+		MALFORMED
+	};
+
+	HttpResponseParser();
+
+	// Returns room for at least |size| bytes at the end of the buffer.
+	char* GetWriteBuffer(size_t size);
+
+	// Parses |size| bytes written to the last GetWriteBuffer().
+	State OnDataWritten(size_t size);
+
+	// Copies and parses |size| bytes.
+	State Append(const char* data, size_t size);
+
+	// Completes a body delimited by the end of the stream.
+	State OnEndOfStream();
+
+	// Drops the complete response. Bytes received past its end are kept and
+	// parsed as the start of the next response.
+	State Next();
+
+	// Drops everything, keeping the buffer allocation.
+	void Reset();
+
+	State state() const { return state_; }
+
+	bool is_complete() const { return state_ == COMPLETE; }
+
+	// Status code, -1 until the status line is parsed.
+	int status() const { return status_; }
+
+	// 0 for HTTP/1.0, 1 for HTTP/1.1.
+	int minor_version() const { return minor_version_; }
+
+	bool has_content_length() const { return has_content_length_; }
+
+	size_t content_length() const { return content_length_; }
+
+	bool is_chunked() const { return chunked_; }
+
+	// True if the server asked to close the connection after this response.
+	bool connection_close() const { return connection_close_; }
+
+	// Looks |name| up in the parsed headers, ignoring case. The value is
+	// trimmed and points into the buffer.
+	bool GetHeader(const char* name, const char** value, size_t* value_size) const;
+
+	bool GetHeader(const char* name, std::string* value) const;
+
+	// Parses the decimal value of |name|.
+	bool GetHeader(const char* name, size_t* value) const;
+
+	// Body received so far, the whole body once complete.
+	const char* body() const;
+
+	size_t body_size() const;
+
+	// Returns the body line starting at |*offset|, without its terminator,
+	// and moves |*offset| to the next line. Returns false past the last line.
+	bool GetBodyLine(size_t* offset, const char** line, size_t* line_size) const;
+
+	// Bytes received past the end of the complete response, such as the
+	// first frames on a connection upgraded to WebSocket.
+	const char* remaining() const;
+
+	size_t remaining_size() const;
+
+private:
+	struct Header
+	{
+		size_t name;
+		size_t name_size;
+		size_t value;
+		size_t value_size;
+	};
+
+	// Parses from |parse_offset_| to the end of the buffered data.
+	State Parse();
+
+	bool ParseStatusLine(size_t begin, size_t end);
+
+	bool ParseHeader(size_t begin, size_t end);
+
+	// Called once the blank line after the headers is parsed.
+	void OnHeadersComplete();
+
+	// Decodes the chunks received since the last call.
+	void ParseChunks();
+
+	enum ChunkState
+	{
+		CHUNK_SIZE,
+		CHUNK_DATA,
+		CHUNK_DATA_END,
+		CHUNK_TRAILER
+	};
+
+	std::vector<char> buffer_;
+	size_t size_;
+	size_t parse_offset_;
+	size_t body_offset_;
+	size_t response_end_;
+	State state_;
+	int status_;
+	int minor_version_;
+	bool has_content_length_;
+	size_t content_length_;
+	bool connection_close_;
+	bool chunked_;
+	ChunkState chunk_state_;
+	size_t chunk_remaining_;
+
+	// End of the decoded chunked body.
+	size_t body_end_;
+	std::vector<Header> headers_;
+};
+
+#endif  // WEBRTC_HTTP_RESPONSE_PARSER_H_
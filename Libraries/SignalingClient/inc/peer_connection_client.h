@@ -11,6 +11,7 @@
 #ifndef WEBRTC_PEER_CONNECTION_CLIENT_H_
 #define WEBRTC_PEER_CONNECTION_CLIENT_H_
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
@@ -22,10 +23,10 @@
 #include "webrtc/base/signalthread.h"
 #include "webrtc/base/sigslot.h"
 
+#include "http_response_parser.h"
+#include "signaling_transport.h"
 #include "ssl_capable_socket.h"
 
-typedef std::map<int, std::string> Peers;
-
 struct PeerConnectionClientObserver
 {
 	virtual void OnSignedIn() = 0;  // Called when we're logged on.
@@ -72,6 +73,11 @@ public:
 
 	void RegisterObserver(PeerConnectionClientObserver* callback);
 
+	// Signals through |transport| instead of the HTTP requests, from the next
+	// Connect() on. Servers given as ws:// or wss:// use a
+	// WebSocketSignalingTransport unless a transport is set.
+	void SetTransport(std::unique_ptr<SignalingTransport> transport);
+
 	void Connect(const std::string& server, int port,
 				 const std::string& client_name);
 
@@ -105,6 +111,25 @@ protected:
 
 	bool ConnectControlSocket();
 
+	// Queues a request for the control socket, connecting it if needed.
+	bool SendControlRequest(const std::string& request);
+
+	// Writes the queued requests the connection can take. With keep-alive,
+	// requests are pipelined ahead of their responses.
+	void SendPendingRequests();
+
+	// Moves the unanswered requests back to the front of the queue, to be
+	// sent again on a new connection. Unless |unseen|, the server may have
+	// handled them already and only the idempotent ones are kept. Returns
+	// the number of requests dropped.
+	size_t RequeueSentRequests(bool unseen);
+
+	// Reports the outcome of a control request to the observers.
+	void NotifyMessageSent(int err);
+
+	// Handles a complete response to the oldest request on the control socket.
+	void OnControlResponse(const std::string& request);
+
 	void OnConnect(rtc::AsyncSocket* socket);
 
 	void OnHangingGetConnect(rtc::AsyncSocket* socket);
@@ -113,16 +138,9 @@ protected:
 
 	void OnMessageFromPeer(int peer_id, const std::string& message);
 
-	// Quick and dirty support for parsing HTTP header values.
-	bool GetHeaderValue(const std::string& data, size_t eoh,
-						const char* header_pattern, size_t* value);
-
-	bool GetHeaderValue(const std::string& data, size_t eoh,
-						const char* header_pattern, std::string* value);
-
-	// Returns true if the whole response has been read.
-	bool ReadIntoBuffer(rtc::AsyncSocket* socket, std::string* data,
-						size_t* content_length);
+	// Returns true if a whole response has been read. The socket is left
+	// open, even if the server asked to close it.
+	bool ReadIntoBuffer(rtc::AsyncSocket* socket, HttpResponseParser* response);
 
 	void OnRead(rtc::AsyncSocket* socket);
 
@@ -131,13 +149,11 @@ protected:
 	void OnHeartbeatGetRead(rtc::AsyncSocket* socket);
 
 	// Parses a single line entry in the form "<name>,<id>,<connected>"
-	bool ParseEntry(const std::string& entry, std::string* name, int* id,
-					bool* connected);
-
-	int GetResponseStatus(const std::string& response);
+	bool ParseEntry(const char* entry, size_t entry_size, std::string* name,
+					int* id, bool* connected);
 
-	int ParseServerResponse(const std::string& response, size_t content_length,
-							size_t* peer_id, size_t* eoh);
+	// Returns the peer id of the Pragma header, -1 if there is none.
+	size_t GetPeerId(const HttpResponseParser& response);
 
 	void OnClose(rtc::AsyncSocket* socket, int err);
 
@@ -145,6 +161,18 @@ protected:
 
 	void OnResolveResult(rtc::AsyncResolverInterface* resolver);
 
+	void OnTransportSignedIn(int id, const Peers& peers);
+
+	void OnTransportPeerConnected(int id, const std::string& name);
+
+	void OnTransportPeerDisconnected(int id);
+
+	void OnTransportMessageSent(int err);
+
+	void OnTransportDisconnected();
+
+	void OnTransportConnectionFailure();
+
 	std::string PrepareRequest(const std::string& method, const std::string& fragment, std::map<std::string, std::string> headers);
 
 	std::vector<PeerConnectionClientObserver*> callbacks_;
@@ -155,9 +183,19 @@ protected:
 	std::unique_ptr<SslCapableSocket> control_socket_;
 	std::unique_ptr<SslCapableSocket> hanging_get_;
 	std::unique_ptr<SslCapableSocket> heartbeat_get_;
-	std::string onconnect_data_;
-	std::string control_data_;
-	std::string notification_data_;
+	std::unique_ptr<SignalingTransport> transport_;
+	std::deque<std::string> pending_requests_;
+	std::deque<std::string> sent_requests_;
+
+	// True until the server closes a connection after a response, then
+	// every control request uses its own connection.
+	bool keep_alive_;
+
+	// Responses received on the current control connection.
+	size_t control_responses_;
+	HttpResponseParser control_response_;
+	HttpResponseParser notification_response_;
+	HttpResponseParser heartbeat_response_;
 	std::string client_name_;
 	std::string authorization_header_;
 	Peers peers_;
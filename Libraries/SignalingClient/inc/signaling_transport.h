@@ -0,0 +1,67 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_SIGNALING_TRANSPORT_H_
+#define WEBRTC_SIGNALING_TRANSPORT_H_
+
+#include <map>
+#include <string>
+
+#include "webrtc/base/sigslot.h"
+#include "webrtc/base/socketaddress.h"
+
+typedef std::map<int, std::string> Peers;
+
+// Carries the signaling protocol between PeerConnectionClient and the server,
+// in place of the sign_in, wait, message and heartbeat requests of the
+// peerconnection_server protocol. PeerConnectionClient keeps the state and
+// the peer list, and reports the signals below to its observers.
+class SignalingTransport
+{
+public:
+	virtual ~SignalingTransport() {}
+
+	// Connects to |server| and signs in as |client_name|. SignalSignedIn
+	// follows, or SignalConnectionFailure.
+	virtual bool SignIn(const rtc::SocketAddress& server, bool use_ssl,
+		const std::string& client_name, const std::string& authorization_header) = 0;
+
+	// Sends |message| to |peer_id|. SignalMessageSent follows once the
+	// message is handed to the network.
+	virtual bool SendToPeer(int peer_id, const std::string& message) = 0;
+
+	// Returns true while new messages have to wait for SignalMessageSent.
+	virtual bool IsSendingMessage() const = 0;
+
+	// Signs out. SignalDisconnected follows.
+	virtual bool SignOut() = 0;
+
+	// Closes the connection without signing out. No signal follows.
+	virtual void Close() = 0;
+
+	// Our ID, and the peers already signed in.
+	sigslot::signal2<int, const Peers&> SignalSignedIn;
+
+	sigslot::signal2<int, const std::string&> SignalPeerConnected;
+
+	sigslot::signal1<int> SignalPeerDisconnected;
+
+	sigslot::signal2<int, const std::string&> SignalMessageFromPeer;
+
+	sigslot::signal1<int> SignalMessageSent;
+
+	// Signed out, or the connection to the server was lost.
+	sigslot::signal0<> SignalDisconnected;
+
+	// The connection or the sign in failed.
+	sigslot::signal0<> SignalConnectionFailure;
+};
+
+#endif  // WEBRTC_SIGNALING_TRANSPORT_H_
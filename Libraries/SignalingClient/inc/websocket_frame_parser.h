@@ -0,0 +1,92 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_WEBSOCKET_FRAME_PARSER_H_
+#define WEBRTC_WEBSOCKET_FRAME_PARSER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Incremental WebSocket frame parser (RFC 6455). Bytes are received straight
+// into the parser's buffer (GetWriteBuffer() then OnDataWritten()) and Next()
+// returns the messages and control frames as they complete. Fragmented
+// messages are reassembled, and control frames can come between fragments.
+// Masked frames are unmasked.
+class WebSocketFrameParser
+{
+public:
+	enum Result
+	{
+		// No complete message or control frame is buffered.
+		NEED_MORE_DATA,
+		TEXT_MESSAGE,
+		BINARY_MESSAGE,
+		PING,
+		PONG,
+		CLOSE,
+
+		// The connection must be failed with a protocol error (1002).
+		PROTOCOL_ERROR,
+
+		// The connection must be failed with a message too big error (1009).
+		MESSAGE_TOO_BIG
+	};
+
+	// Frame opcodes
+	static const uint8_t kContinuationFrame = 0x0;
+	static const uint8_t kTextFrame = 0x1;
+	static const uint8_t kBinaryFrame = 0x2;
+	static const uint8_t kCloseFrame = 0x8;
+	static const uint8_t kPingFrame = 0x9;
+	static const uint8_t kPongFrame = 0xa;
+
+	// Messages and frames larger than |max_message_size| are rejected.
+	explicit WebSocketFrameParser(size_t max_message_size);
+
+	// Returns room for at least |size| bytes at the end of the buffer.
+	char* GetWriteBuffer(size_t size);
+
+	// Adds |size| bytes written to the last GetWriteBuffer().
+	void OnDataWritten(size_t size);
+
+	// Copies |size| bytes.
+	void Append(const char* data, size_t size);
+
+	// Parses the next message or control frame. Its payload is valid until
+	// the next call.
+	Result Next();
+
+	// Drops everything, keeping the buffer allocation.
+	void Reset();
+
+	// Payload of the message or control frame last returned by Next().
+	const std::string& payload() const { return payload_; }
+
+	// Appends a frame with |payload| masked by |mask|, as clients send them.
+	static void WriteFrame(uint8_t opcode, const char* payload, size_t size,
+		uint32_t mask, std::string* out);
+
+private:
+	const size_t max_message_size_;
+	std::vector<char> buffer_;
+	size_t size_;
+
+	// Start of the unparsed bytes in |buffer_|.
+	size_t read_offset_;
+
+	// Opcode of a fragmented message, 0 between messages.
+	uint8_t message_opcode_;
+	std::string message_;
+	std::string payload_;
+};
+
+#endif  // WEBRTC_WEBSOCKET_FRAME_PARSER_H_
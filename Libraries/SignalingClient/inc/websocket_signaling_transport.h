@@ -0,0 +1,119 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef WEBRTC_WEBSOCKET_SIGNALING_TRANSPORT_H_
+#define WEBRTC_WEBSOCKET_SIGNALING_TRANSPORT_H_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "webrtc/base/messagehandler.h"
+#include "webrtc/base/sigslot.h"
+#include "webrtc/base/thread.h"
+
+#include "http_response_parser.h"
+#include "signaling_transport.h"
+#include "ssl_capable_socket.h"
+#include "websocket_frame_parser.h"
+
+// Signaling over a single WebSocket connection (RFC 6455), which stays open
+// for the whole session instead of a hanging GET per notification. The
+// client signs in with the opening handshake, "GET /signaling?peer_name=<name>",
+// and the rest is JSON text frames:
+//
+//   server: {"type":"signed_in","id":7,"peers":[{"id":8,"name":"renderer"}]}
+//   server: {"type":"peer","id":8,"name":"renderer","connected":false}
+//   server: {"type":"message","from":8,"data":"..."}
+//   client: {"type":"message","to":8,"data":"..."}
+//   client: {"type":"sign_out"}
+//
+// The server closes the connection once the client has signed out. Pings
+// are answered with pongs, and the open connection stands in for the
+// heartbeat requests.
+class WebSocketSignalingTransport : public SignalingTransport,
+                                    public sigslot::has_slots<>,
+                                    public rtc::MessageHandler
+{
+public:
+	explicit WebSocketSignalingTransport(rtc::Thread* signaling_thread);
+
+	~WebSocketSignalingTransport();
+
+	bool SignIn(const rtc::SocketAddress& server, bool use_ssl,
+		const std::string& client_name, const std::string& authorization_header) override;
+
+	bool SendToPeer(int peer_id, const std::string& message) override;
+
+	bool IsSendingMessage() const override;
+
+	bool SignOut() override;
+
+	void Close() override;
+
+	// Emits SignalMessageSent for the messages written to the socket.
+	void OnMessage(rtc::Message* msg) override;
+
+private:
+	enum State
+	{
+		CLOSED,
+		CONNECTING,
+		HANDSHAKING,
+		OPEN,
+		SIGNING_OUT
+	};
+
+	void OnConnect(rtc::AsyncSocket* socket);
+
+	void OnRead(rtc::AsyncSocket* socket);
+
+	void OnWrite(rtc::AsyncSocket* socket);
+
+	void OnClose(rtc::AsyncSocket* socket, int err);
+
+	// Returns true if the server accepted the upgrade to WebSocket.
+	bool CheckHandshakeResponse();
+
+	// Handles the complete frames received. Returns false on a protocol error.
+	bool ParseFrames();
+
+	void OnTextMessage(const std::string& message);
+
+	// Writes a masked frame, buffering what the socket doesn't take.
+	void SendFrame(uint8_t opcode, const char* payload, size_t size);
+
+	// Writes the buffered frames as far as the socket takes them.
+	void Flush();
+
+	// Sends a close frame with |status| and closes the connection.
+	void Fail(uint16_t status);
+
+	// Closes the connection and emits SignalDisconnected.
+	void Disconnect();
+
+	rtc::Thread* signaling_thread_;
+	std::unique_ptr<SslCapableSocket> socket_;
+	State state_;
+	std::string handshake_request_;
+
+	// Sec-WebSocket-Accept expected from the server.
+	std::string accept_key_;
+	HttpResponseParser handshake_response_;
+	WebSocketFrameParser frame_parser_;
+	std::string write_buffer_;
+
+	// Messages not yet written to the socket.
+	int unsent_messages_;
+	bool close_sent_;
+};
+
+#endif  // WEBRTC_WEBSOCKET_SIGNALING_TRANSPORT_H_
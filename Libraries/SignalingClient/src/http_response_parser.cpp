@@ -0,0 +1,492 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "http_response_parser.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+	// Status line and headers beyond this size are rejected, as are chunk
+	// size and trailer lines.
+	const size_t kMaxHeadersSize = 64 * 1024;
+
+	const char kHttpVersionPrefix[] = "HTTP/1.";
+
+	// Header names are ASCII, which doesn't need the locale.
+	char ToLowerAscii(char c)
+	{
+		return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+	}
+
+	bool EqualsIgnoreCase(const char* a, size_t a_size, const char* b)
+	{
+		size_t i = 0;
+		for (; i < a_size && b[i]; i++)
+		{
+			if (ToLowerAscii(a[i]) != ToLowerAscii(b[i]))
+			{
+				return false;
+			}
+		}
+
+		return i == a_size && !b[i];
+	}
+
+	// Parses the leading hexadecimal digits of [begin, end).
+	bool ParseHexadecimal(const char* begin, const char* end, size_t* value)
+	{
+		size_t result = 0;
+		const char* digit = begin;
+		for (; digit < end && isxdigit(static_cast<unsigned char>(*digit)); digit++)
+		{
+			if (result > (static_cast<size_t>(-1) >> 4))
+			{
+				return false;
+			}
+
+			int c = ToLowerAscii(*digit);
+			result = result * 16 + (c <= '9' ? c - '0' : c - 'a' + 10);
+		}
+
+		*value = result;
+		return digit != begin;
+	}
+
+	// Parses the leading decimal digits of [begin, end).
+	bool ParseDecimal(const char* begin, const char* end, size_t* value)
+	{
+		size_t result = 0;
+		const char* digit = begin;
+		for (; digit < end && isdigit(static_cast<unsigned char>(*digit)); digit++)
+		{
+			result = result * 10 + (*digit - '0');
+		}
+
+		*value = result;
+		return digit != begin;
+	}
+
+	// Returns true if the comma-separated list [begin, end) holds |token|.
+	bool HasToken(const char* begin, const char* end, const char* token)
+	{
+		while (begin < end)
+		{
+			const char* comma = std::find(begin, end, ',');
+			const char* token_end = comma;
+			while (begin < token_end && isspace(static_cast<unsigned char>(*begin)))
+			{
+				begin++;
+			}
+
+			while (token_end > begin && isspace(static_cast<unsigned char>(token_end[-1])))
+			{
+				token_end--;
+			}
+
+			if (EqualsIgnoreCase(begin, token_end - begin, token))
+			{
+				return true;
+			}
+
+			begin = comma == end ? end : comma + 1;
+		}
+
+		return false;
+	}
+}
+
+HttpResponseParser::HttpResponseParser() :
+	size_(0)
+{
+	Reset();
+}
+
+char* HttpResponseParser::GetWriteBuffer(size_t size)
+{
+	if (buffer_.size() - size_ < size)
+	{
+		buffer_.resize(std::max(size_ + size, buffer_.size() * 2));
+	}
+
+	return buffer_.data() + size_;
+}
+
+HttpResponseParser::State HttpResponseParser::OnDataWritten(size_t size)
+{
+	size_ += size;
+	return Parse();
+}
+
+HttpResponseParser::State HttpResponseParser::Append(const char* data, size_t size)
+{
+	memcpy(GetWriteBuffer(size), data, size);
+	return OnDataWritten(size);
+}
+
+HttpResponseParser::State HttpResponseParser::OnEndOfStream()
+{
+	// A chunked body ends with its last chunk, not with the stream.
+	if (state_ == BODY && !has_content_length_ && !chunked_)
+	{
+		response_end_ = size_;
+		state_ = COMPLETE;
+	}
+
+	return state_;
+}
+
+HttpResponseParser::State HttpResponseParser::Next()
+{
+	size_t remaining = state_ == COMPLETE ? size_ - response_end_ : 0;
+	if (remaining > 0)
+	{
+		memmove(buffer_.data(), buffer_.data() + response_end_, remaining);
+	}
+
+	Reset();
+	size_ = remaining;
+	return Parse();
+}
+
+void HttpResponseParser::Reset()
+{
+	size_ = 0;
+	parse_offset_ = 0;
+	body_offset_ = 0;
+	response_end_ = 0;
+	state_ = STATUS_LINE;
+	status_ = -1;
+	minor_version_ = 0;
+	has_content_length_ = false;
+	content_length_ = 0;
+	connection_close_ = false;
+	chunked_ = false;
+	chunk_state_ = CHUNK_SIZE;
+	chunk_remaining_ = 0;
+	body_end_ = 0;
+	headers_.clear();
+}
+
+bool HttpResponseParser::GetHeader(const char* name, const char** value,
+	size_t* value_size) const
+{
+	for (const Header& header : headers_)
+	{
+		if (EqualsIgnoreCase(buffer_.data() + header.name, header.name_size, name))
+		{
+			*value = buffer_.data() + header.value;
+			*value_size = header.value_size;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool HttpResponseParser::GetHeader(const char* name, std::string* value) const
+{
+	const char* data = nullptr;
+	size_t size = 0;
+	if (!GetHeader(name, &data, &size))
+	{
+		return false;
+	}
+
+	value->assign(data, size);
+	return true;
+}
+
+bool HttpResponseParser::GetHeader(const char* name, size_t* value) const
+{
+	const char* data = nullptr;
+	size_t size = 0;
+	return GetHeader(name, &data, &size) && ParseDecimal(data, data + size, value);
+}
+
+const char* HttpResponseParser::body() const
+{
+	return buffer_.data() + body_offset_;
+}
+
+size_t HttpResponseParser::body_size() const
+{
+	if (chunked_)
+	{
+		return body_end_ - body_offset_;
+	}
+
+	if (state_ == COMPLETE)
+	{
+		return response_end_ - body_offset_;
+	}
+
+	return state_ == BODY ? size_ - body_offset_ : 0;
+}
+
+bool HttpResponseParser::GetBodyLine(size_t* offset, const char** line,
+	size_t* line_size) const
+{
+	size_t size = body_size();
+	if (*offset >= size)
+	{
+		return false;
+	}
+
+	const char* begin = body() + *offset;
+	const char* end = static_cast<const char*>(memchr(begin, '\n', size - *offset));
+	*offset = end ? end - body() + 1 : size;
+	if (!end)
+	{
+		end = body() + size;
+	}
+
+	*line = begin;
+	*line_size = end > begin && end[-1] == '\r' ? end - begin - 1 : end - begin;
+	return true;
+}
+
+const char* HttpResponseParser::remaining() const
+{
+	return buffer_.data() + response_end_;
+}
+
+size_t HttpResponseParser::remaining_size() const
+{
+	return state_ == COMPLETE ? size_ - response_end_ : 0;
+}
+
+HttpResponseParser::State HttpResponseParser::Parse()
+{
+	while (state_ == STATUS_LINE || state_ == HEADERS)
+	{
+		if (parse_offset_ > kMaxHeadersSize)
+		{
+			state_ = MALFORMED;
+			break;
+		}
+
+		// Only the bytes received since the last call are searched.
+		const char* begin = buffer_.data() + parse_offset_;
+		const char* eol = static_cast<const char*>(memchr(begin, '\n', size_ - parse_offset_));
+		if (!eol)
+		{
+			if (size_ > kMaxHeadersSize)
+			{
+				state_ = MALFORMED;
+			}
+
+			return state_;
+		}
+
+		size_t line_begin = parse_offset_;
+		size_t line_end = eol - buffer_.data();
+		parse_offset_ = line_end + 1;
+		if (line_end > line_begin && buffer_[line_end - 1] == '\r')
+		{
+			line_end--;
+		}
+
+		if (state_ == STATUS_LINE)
+		{
+			state_ = ParseStatusLine(line_begin, line_end) ? HEADERS : MALFORMED;
+		}
+		else if (line_end == line_begin)
+		{
+			OnHeadersComplete();
+		}
+		else if (!ParseHeader(line_begin, line_end))
+		{
+			state_ = MALFORMED;
+		}
+	}
+
+	if (state_ == BODY && chunked_)
+	{
+		ParseChunks();
+	}
+	else if (state_ == BODY && has_content_length_ && size_ - body_offset_ >= content_length_)
+	{
+		response_end_ = body_offset_ + content_length_;
+		state_ = COMPLETE;
+	}
+
+	return state_;
+}
+
+bool HttpResponseParser::ParseStatusLine(size_t begin, size_t end)
+{
+	// HTTP/1.<minor> <status> <reason>
+	const size_t prefix_size = sizeof(kHttpVersionPrefix) - 1;
+	const char* line = buffer_.data() + begin;
+	size_t size = end - begin;
+	if (size < prefix_size + 5 || memcmp(line, kHttpVersionPrefix, prefix_size) != 0 ||
+		!isdigit(static_cast<unsigned char>(line[prefix_size])) || line[prefix_size + 1] != ' ')
+	{
+		return false;
+	}
+
+	size_t status = 0;
+	if (!ParseDecimal(line + prefix_size + 2, line + size, &status) || status > 999)
+	{
+		return false;
+	}
+
+	minor_version_ = line[prefix_size] - '0';
+	status_ = static_cast<int>(status);
+
+	// HTTP/1.0 connections close unless kept alive.
+	connection_close_ = minor_version_ == 0;
+	return true;
+}
+
+bool HttpResponseParser::ParseHeader(size_t begin, size_t end)
+{
+	const char* line = buffer_.data() + begin;
+	const char* colon = static_cast<const char*>(memchr(line, ':', end - begin));
+	if (!colon || colon == line)
+	{
+		return false;
+	}
+
+	const char* value = colon + 1;
+	const char* value_end = buffer_.data() + end;
+	while (value < value_end && (*value == ' ' || *value == '\t'))
+	{
+		value++;
+	}
+
+	while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+	{
+		value_end--;
+	}
+
+	Header header;
+	header.name = begin;
+	header.name_size = colon - line;
+	header.value = value - buffer_.data();
+	header.value_size = value_end - value;
+	headers_.push_back(header);
+
+	// Headers driving the parser are interpreted once.
+	if (EqualsIgnoreCase(line, header.name_size, "Content-Length"))
+	{
+		has_content_length_ = ParseDecimal(value, value_end, &content_length_);
+		return has_content_length_;
+	}
+	else if (EqualsIgnoreCase(line, header.name_size, "Transfer-Encoding"))
+	{
+		chunked_ = HasToken(value, value_end, "chunked");
+	}
+	else if (EqualsIgnoreCase(line, header.name_size, "Connection"))
+	{
+		if (HasToken(value, value_end, "close"))
+		{
+			connection_close_ = true;
+		}
+		else if (HasToken(value, value_end, "keep-alive"))
+		{
+			connection_close_ = false;
+		}
+	}
+
+	return true;
+}
+
+void HttpResponseParser::OnHeadersComplete()
+{
+	body_offset_ = parse_offset_;
+	state_ = BODY;
+
+	body_end_ = body_offset_;
+
+	// Informational, No Content and Not Modified responses have no body.
+	if ((status_ >= 100 && status_ < 200) || status_ == 204 || status_ == 304)
+	{
+		has_content_length_ = true;
+		content_length_ = 0;
+		chunked_ = false;
+	}
+	else if (chunked_)
+	{
+		// Content-Length is ignored with chunked transfer encoding.
+		has_content_length_ = false;
+		content_length_ = 0;
+	}
+}
+
+void HttpResponseParser::ParseChunks()
+{
+	while (state_ == BODY)
+	{
+		if (chunk_state_ == CHUNK_DATA)
+		{
+			// Moves the chunk data next to the previous chunk.
+			size_t size = std::min(chunk_remaining_, size_ - parse_offset_);
+			memmove(buffer_.data() + body_end_, buffer_.data() + parse_offset_, size);
+			body_end_ += size;
+			parse_offset_ += size;
+			chunk_remaining_ -= size;
+			if (chunk_remaining_ > 0)
+			{
+				return;
+			}
+
+			chunk_state_ = CHUNK_DATA_END;
+			continue;
+		}
+
+		const char* begin = buffer_.data() + parse_offset_;
+		const char* eol = static_cast<const char*>(memchr(begin, '\n', size_ - parse_offset_));
+		if (!eol)
+		{
+			if (size_ - parse_offset_ > kMaxHeadersSize)
+			{
+				state_ = MALFORMED;
+			}
+
+			return;
+		}
+
+		const char* end = eol > begin && eol[-1] == '\r' ? eol - 1 : eol;
+		parse_offset_ = eol - buffer_.data() + 1;
+		if (chunk_state_ == CHUNK_SIZE)
+		{
+			// The size can be followed by extensions, which are ignored.
+			if (!ParseHexadecimal(begin, end, &chunk_remaining_))
+			{
+				state_ = MALFORMED;
+			}
+			else
+			{
+				chunk_state_ = chunk_remaining_ > 0 ? CHUNK_DATA : CHUNK_TRAILER;
+			}
+		}
+		else if (chunk_state_ == CHUNK_DATA_END)
+		{
+			if (end != begin)
+			{
+				state_ = MALFORMED;
+			}
+			else
+			{
+				chunk_state_ = CHUNK_SIZE;
+			}
+		}
+		else if (end == begin)
+		{
+			// Trailer fields are skipped up to the blank line ending the body.
+			response_end_ = parse_offset_;
+			state_ = COMPLETE;
+		}
+	}
+}
@@ -9,6 +9,7 @@
  */
 
 #include "peer_connection_client.h"
+#include "websocket_signaling_transport.h"
 #include "webrtc/base/checks.h"
 #include "webrtc/base/logging.h"
 #include "webrtc/base/nethelpers.h"
@@ -33,6 +34,31 @@ namespace
 
 	// The default value for the tick heartbeat, used to disable the heartbeat
 	const int kHeartbeatDefault = -1;
+
+	// Bytes requested from the socket per receive
+	const size_t kReadSize = 0xffff;
+
+	// Requests sent on a kept-alive control connection ahead of their responses
+	const size_t kMaxPipelinedRequests = 8;
+
+	// Parses the leading decimal digits of [begin, end), atoi style.
+	int ParseInt(const char* begin, const char* end)
+	{
+		int value = 0;
+		for (; begin < end && *begin >= '0' && *begin <= '9'; ++begin)
+		{
+			value = value * 10 + (*begin - '0');
+		}
+
+		return value;
+	}
+
+	// Returns true if sending |request| twice has the effect of sending it
+	// once. Only GET requests are, messages to peers are not.
+	bool IsIdempotent(const std::string& request)
+	{
+		return request.compare(0, 4, "GET ") == 0;
+	}
 }
 
 PeerConnectionClient::PeerConnectionClient() :
@@ -40,7 +66,9 @@ PeerConnectionClient::PeerConnectionClient() :
     state_(NOT_CONNECTED),
     my_id_(-1),
 	heartbeat_tick_ms_(kHeartbeatDefault),
-	server_address_ssl_(false)
+	server_address_ssl_(false),
+	keep_alive_(true),
+	control_responses_(0)
 {
 	// use the current thread or wrap a thread for signaling_thread_
 	auto thread = rtc::Thread::Current();
@@ -90,6 +118,22 @@ void PeerConnectionClient::RegisterObserver(PeerConnectionClientObserver* callba
 	callbacks_.push_back(callback);
 }
 
+void PeerConnectionClient::SetTransport(std::unique_ptr<SignalingTransport> transport)
+{
+	RTC_DCHECK(state_ == NOT_CONNECTED);
+	transport_ = std::move(transport);
+	if (transport_.get() != nullptr)
+	{
+		transport_->SignalSignedIn.connect(this, &PeerConnectionClient::OnTransportSignedIn);
+		transport_->SignalPeerConnected.connect(this, &PeerConnectionClient::OnTransportPeerConnected);
+		transport_->SignalPeerDisconnected.connect(this, &PeerConnectionClient::OnTransportPeerDisconnected);
+		transport_->SignalMessageFromPeer.connect(this, &PeerConnectionClient::OnMessageFromPeer);
+		transport_->SignalMessageSent.connect(this, &PeerConnectionClient::OnTransportMessageSent);
+		transport_->SignalDisconnected.connect(this, &PeerConnectionClient::OnTransportDisconnected);
+		transport_->SignalConnectionFailure.connect(this, &PeerConnectionClient::OnTransportConnectionFailure);
+	}
+}
+
 void PeerConnectionClient::Connect(const std::string& server, int port, 
 	const std::string& client_name)
 {
@@ -126,6 +170,17 @@ void PeerConnectionClient::Connect(const std::string& server, int port,
 	{
 		parsedServer = parsedServer.substr(7);
 	}
+	else if (parsedServer.substr(0, 6).compare("wss://") == 0 ||
+		parsedServer.substr(0, 5).compare("ws://") == 0)
+	{
+		server_address_ssl_ = parsedServer[2] == 's';
+		parsedServer = parsedServer.substr(server_address_ssl_ ? 6 : 5);
+		if (transport_.get() == nullptr)
+		{
+			SetTransport(std::unique_ptr<SignalingTransport>(
+				new WebSocketSignalingTransport(signaling_thread_)));
+		}
+	}
 
 	server_address_.SetIP(parsedServer);
 	server_address_.SetPort(port);
@@ -170,7 +225,8 @@ std::string PeerConnectionClient::PrepareRequest(const std::string& method, cons
 		result += (char)toupper(method[i]);
 	}
 
-	result += " " + fragment + " HTTP/1.0\r\n";
+	// HTTP/1.1 connections are kept alive unless the server closes them.
+	result += " " + fragment + " HTTP/1.1\r\n";
 
 	for (auto it = headers.begin(); it != headers.end(); ++it)
 	{
@@ -189,6 +245,18 @@ std::string PeerConnectionClient::PrepareRequest(const std::string& method, cons
 
 void PeerConnectionClient::DoConnect()
 {
+	if (transport_.get() != nullptr)
+	{
+		state_ = SIGNING_IN;
+		if (!transport_->SignIn(server_address_, server_address_ssl_, client_name_, authorization_header_))
+		{
+			state_ = NOT_CONNECTED;
+			std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnServerConnectionFailure(); });
+		}
+
+		return;
+	}
+
 	control_socket_.reset(new SslCapableSocket(server_address_.ipaddr().family(), server_address_ssl_, signaling_thread_));
 	hanging_get_.reset(new SslCapableSocket(server_address_.ipaddr().family(), server_address_ssl_, signaling_thread_));
 	heartbeat_get_.reset(new SslCapableSocket(server_address_.ipaddr().family(), server_address_ssl_, signaling_thread_));
@@ -197,7 +265,10 @@ void PeerConnectionClient::DoConnect()
 	std::string clientName = client_name_;
 	std::string hostName = server_address_.hostname();
 	
-	onconnect_data_ = PrepareRequest("GET", "/sign_in?peer_name=" + clientName, { {"Host", hostName} });
+	keep_alive_ = true;
+	pending_requests_.clear();
+	sent_requests_.clear();
+	pending_requests_.push_back(PrepareRequest("GET", "/sign_in?peer_name=" + clientName, { {"Host", hostName} }));
 
 	bool ret = ConnectControlSocket();
 	if (ret)
@@ -219,13 +290,17 @@ bool PeerConnectionClient::SendToPeer(int peer_id, const std::string& message)
 	}
 
 	RTC_DCHECK(is_connected());
-	RTC_DCHECK(control_socket_->GetState() == rtc::Socket::CS_CLOSED);
 	if (!is_connected() || peer_id == -1)
 	{
 		return false;
 	}
 
-	onconnect_data_ = PrepareRequest("POST",
+	if (transport_.get() != nullptr)
+	{
+		return transport_->SendToPeer(peer_id, message);
+	}
+
+	std::string request = PrepareRequest("POST",
 		"/message?peer_id=" + std::to_string(my_id_) + "&to=" + std::to_string(peer_id),
 		{
 			{"Host", server_address_.hostname()},
@@ -233,8 +308,7 @@ bool PeerConnectionClient::SendToPeer(int peer_id, const std::string& message)
 			{"Content-Type", "text/plain"}
 		});
 
-	onconnect_data_ += message;
-	return ConnectControlSocket();
+	return SendControlRequest(request + message);
 }
 
 bool PeerConnectionClient::SendHangUp(int peer_id)
@@ -244,7 +318,14 @@ bool PeerConnectionClient::SendHangUp(int peer_id)
 
 bool PeerConnectionClient::IsSendingMessage()
 {
-	return state_ == CONNECTED && control_socket_->GetState() != rtc::Socket::CS_CLOSED;
+	if (transport_.get() != nullptr)
+	{
+		return state_ == CONNECTED && transport_->IsSendingMessage();
+	}
+
+	// With keep-alive, messages are pipelined until the pipeline is full.
+	size_t requests = pending_requests_.size() + sent_requests_.size();
+	return state_ == CONNECTED && (keep_alive_ ? requests >= kMaxPipelinedRequests : requests > 0);
 }
 
 bool PeerConnectionClient::SignOut()
@@ -254,19 +335,31 @@ bool PeerConnectionClient::SignOut()
 		return true;
 	}
 
+	if (transport_.get() != nullptr)
+	{
+		if (my_id_ == -1)
+		{
+			// Can occur if the app is closed before we finish connecting.
+			Close();
+			return true;
+		}
+
+		state_ = SIGNING_OUT;
+		return transport_->SignOut();
+	}
+
 	if (hanging_get_->GetState() != rtc::Socket::CS_CLOSED)
 	{
 		hanging_get_->Close();
 	}
 
-	if (control_socket_->GetState() == rtc::Socket::CS_CLOSED) 
+	if (pending_requests_.empty() && sent_requests_.empty()) 
 	{
 		state_ = SIGNING_OUT;
 
 		if (my_id_ != -1)
 		{
-			onconnect_data_ = PrepareRequest("GET", "/sign_out?peer_id=" + std::to_string(my_id_), { {"Host", server_address_.hostname()} });
-			return ConnectControlSocket();
+			return SendControlRequest(PrepareRequest("GET", "/sign_out?peer_id=" + std::to_string(my_id_), { {"Host", server_address_.hostname()} }));
 		}
 		else
 		{
@@ -284,6 +377,11 @@ bool PeerConnectionClient::SignOut()
 
 bool PeerConnectionClient::Shutdown()
 {
+	if (transport_.get() != nullptr)
+	{
+		transport_->Close();
+	}
+
 	if (heartbeat_get_.get() != nullptr)
 	{
 		heartbeat_get_->Close();
@@ -299,6 +397,8 @@ bool PeerConnectionClient::Shutdown()
 		control_socket_->Close();
 	}
 
+	pending_requests_.clear();
+	sent_requests_.clear();
 	state_ = NOT_CONNECTED;
 	
 	return true;
@@ -307,9 +407,21 @@ bool PeerConnectionClient::Shutdown()
 
 void PeerConnectionClient::Close()
 {
-	control_socket_->Close();
-	hanging_get_->Close();
-	onconnect_data_.clear();
+	if (transport_.get() != nullptr)
+	{
+		transport_->Close();
+	}
+
+	if (control_socket_.get() != nullptr)
+	{
+		control_socket_->Close();
+		hanging_get_->Close();
+	}
+
+	pending_requests_.clear();
+	sent_requests_.clear();
+	control_response_.Reset();
+	notification_response_.Reset();
 	peers_.clear();
 	if (resolver_ != NULL)
 	{
@@ -334,17 +446,76 @@ bool PeerConnectionClient::ConnectControlSocket()
 	return true;
 }
 
+bool PeerConnectionClient::SendControlRequest(const std::string& request)
+{
+	pending_requests_.push_back(request);
+	if (control_socket_->GetState() == rtc::Socket::CS_CLOSED)
+	{
+		return ConnectControlSocket();
+	}
+
+	// Otherwise OnConnect() sends it once connected.
+	if (control_socket_->GetState() == rtc::Socket::CS_CONNECTED)
+	{
+		SendPendingRequests();
+	}
+
+	return true;
+}
+
+void PeerConnectionClient::SendPendingRequests()
+{
+	// Without keep-alive, the server answers a single request per connection.
+	size_t max_requests = keep_alive_ ? kMaxPipelinedRequests : 1;
+	while (!pending_requests_.empty() && sent_requests_.size() < max_requests)
+	{
+		const std::string& request = pending_requests_.front();
+		size_t sent = control_socket_->Send(request.c_str(), request.length());
+		RTC_DCHECK(sent == request.length());
+		sent_requests_.push_back(request);
+		pending_requests_.pop_front();
+	}
+}
+
+size_t PeerConnectionClient::RequeueSentRequests(bool unseen)
+{
+	size_t dropped = 0;
+	std::deque<std::string> requests;
+	for (auto it = sent_requests_.begin(); it != sent_requests_.end(); ++it)
+	{
+		if (unseen || IsIdempotent(*it))
+		{
+			requests.push_back(std::move(*it));
+		}
+		else
+		{
+			dropped++;
+		}
+	}
+
+	pending_requests_.insert(pending_requests_.begin(), requests.begin(), requests.end());
+	sent_requests_.clear();
+	return dropped;
+}
+
+void PeerConnectionClient::NotifyMessageSent(int err)
+{
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnMessageSent(err); });
+}
+
 void PeerConnectionClient::OnConnect(rtc::AsyncSocket* socket)
 {
-	RTC_DCHECK(!onconnect_data_.empty());
-	size_t sent = socket->Send(onconnect_data_.c_str(), onconnect_data_.length());
-	RTC_DCHECK(sent == onconnect_data_.length());
-	onconnect_data_.clear();
+	RTC_DCHECK(!pending_requests_.empty());
+	RTC_DCHECK(sent_requests_.empty());
+	control_response_.Reset();
+	control_responses_ = 0;
+	SendPendingRequests();
 }
 
 void PeerConnectionClient::OnHangingGetConnect(rtc::AsyncSocket* socket)
 {
 	auto req = PrepareRequest("GET", "/wait?peer_id=" + std::to_string(my_id_), { {"Host", server_address_.hostname()} });
+	notification_response_.Reset();
 
 	int sent = socket->Send(req.c_str(), req.length());
 	RTC_DCHECK(sent == req.length());
@@ -363,198 +534,193 @@ void PeerConnectionClient::OnMessageFromPeer(int peer_id, const std::string& mes
 	}
 }
 
-bool PeerConnectionClient::GetHeaderValue(const std::string& data, size_t eoh, 
-	const char* header_pattern, size_t* value)
+bool PeerConnectionClient::ReadIntoBuffer(rtc::AsyncSocket* socket,
+	HttpResponseParser* response)
 {
-	RTC_DCHECK(value != NULL);
-	size_t found = data.find(header_pattern);
-	if (found != std::string::npos && found < eoh)
+	// Receives straight into the parser's buffer, which only parses the new
+	// bytes of each read.
+	while (true)
 	{
-		*value = atoi(&data[found + strlen(header_pattern)]);
-		return true;
-	}
+		int bytes = socket->Recv(response->GetWriteBuffer(kReadSize), kReadSize, nullptr);
+		if (bytes <= 0)
+		{
+			break;
+		}
 
-	return false;
-}
+		response->OnDataWritten(bytes);
+	}
 
-bool PeerConnectionClient::GetHeaderValue(const std::string& data, size_t eoh, 
-	const char* header_pattern, std::string* value)
-{
-	RTC_DCHECK(value != NULL);
-	size_t found = data.find(header_pattern);
-	if (found != std::string::npos && found < eoh)
+	if (response->state() == HttpResponseParser::MALFORMED)
 	{
-		size_t begin = found + strlen(header_pattern);
-		size_t end = data.find("\r\n", begin);
-		if (end == std::string::npos)
-		{
-			end = eoh;
-		}
+		LOG(LS_ERROR) << "Malformed response from the server.";
+		response->Reset();
+		return false;
+	}
 
-		value->assign(data.substr(begin, end - begin));
-		return true;
+	if (response->state() == HttpResponseParser::BODY && !response->has_content_length() &&
+		!response->is_chunked())
+	{
+		LOG(LS_ERROR) << "No content length field specified by the server.";
 	}
 
-	return false;
+	// We haven't received everything.  Just continue to accept data.
+	return response->is_complete();
 }
 
-bool PeerConnectionClient::ReadIntoBuffer(rtc::AsyncSocket* socket, std::string* data, 
-	size_t* content_length)
+void PeerConnectionClient::OnRead(rtc::AsyncSocket* socket)
 {
-	char buffer[0xffff];
-	do 
+	if (!ReadIntoBuffer(socket, &control_response_))
 	{
-		int bytes = socket->Recv(buffer, sizeof(buffer), nullptr);
-		if (bytes <= 0)
-		{
-			break;
-		}
-
-		data->append(buffer, bytes);
+		return;
 	}
-	while (true);
 
-	bool ret = false;
-	size_t i = data->find("\r\n\r\n");
-	if (i != std::string::npos)
+	// Pipelined responses can arrive in a single read.
+	do
 	{
-		LOG(INFO) << "Headers received";
-		if (GetHeaderValue(*data, i, "\r\nContent-Length: ", content_length))
+		control_responses_++;
+		std::string request;
+		if (!sent_requests_.empty())
 		{
-			size_t total_response_size = (i + 4) + *content_length;
-			if (data->length() >= total_response_size)
-			{
-				ret = true;
-				std::string should_close;
-				const char kConnection[] = "\r\nConnection: ";
-				if (GetHeaderValue(*data, i, kConnection, &should_close) &&
-					should_close.compare("close") == 0)
-				{
-					socket->Close();
+			request = sent_requests_.front();
+			sent_requests_.pop_front();
+		}
 
-					// Since we closed the socket, there was no notification delivered
-					// to us.  Compensate by letting ourselves know.
-					OnClose(socket, 0);
-				}
-			}
-			else
-			{
-				// We haven't received everything.  Just continue to accept data.
-			}
+		bool connection_close = control_response_.connection_close();
+		if (connection_close)
+		{
+			// The server doesn't keep connections alive. Every request uses
+			// its own connection from now on. The server ignores the requests
+			// pipelined behind this one, they are sent again on the next
+			// connection.
+			keep_alive_ = false;
+			socket->Close();
+			RequeueSentRequests(true);
 		}
-		else
+
+		// OnControlResponse() reports failed requests.
+		if (control_response_.status() != 500)
 		{
-			LOG(LS_ERROR) << "No content length field specified by the server.";
+			NotifyMessageSent(0);
+		}
+
+		OnControlResponse(request);
+		if (control_socket_->GetState() == rtc::Socket::CS_CLOSED)
+		{
+			break;
 		}
 	}
+	while (control_response_.Next() == HttpResponseParser::COMPLETE);
 
-	return ret;
+	if (control_socket_->GetState() == rtc::Socket::CS_CLOSED)
+	{
+		control_response_.Reset();
+		if (!pending_requests_.empty() && state_ != NOT_CONNECTED)
+		{
+			ConnectControlSocket();
+		}
+	}
 }
 
-void PeerConnectionClient::OnRead(rtc::AsyncSocket* socket)
+void PeerConnectionClient::OnControlResponse(const std::string& request)
 {
-	size_t content_length = 0;
-	if (ReadIntoBuffer(socket, &control_data_, &content_length))
+	int status = control_response_.status();
+	if (status == 200) 
 	{
-		size_t peer_id = 0, eoh = 0;
-		int status = ParseServerResponse(control_data_, content_length, &peer_id, &eoh);
-		if (status == 200) 
+		if (my_id_ == -1) 
 		{
-			if (my_id_ == -1) 
+			// First response.  Let's store our server assigned ID.
+			RTC_DCHECK(state_ == SIGNING_IN);
+			my_id_ = static_cast<int>(GetPeerId(control_response_));
+			RTC_DCHECK(my_id_ != -1);
+
+			// The body of the response will be a list of already connected
+			// peers, parsed in place.
+			size_t pos = 0;
+			const char* entry = nullptr;
+			size_t entry_size = 0;
+			while (control_response_.GetBodyLine(&pos, &entry, &entry_size))
 			{
-				// First response.  Let's store our server assigned ID.
-				RTC_DCHECK(state_ == SIGNING_IN);
-				my_id_ = static_cast<int>(peer_id);
-				RTC_DCHECK(my_id_ != -1);
-
-				// The body of the response will be a list of already connected peers.
-				if (content_length)
+				int id = 0;
+				std::string name;
+				bool connected;
+				if (entry_size > 0 && ParseEntry(entry, entry_size, &name, &id, &connected) &&
+					id != my_id_)
 				{
-					size_t pos = eoh + 4;
-					while (pos < control_data_.size()) 
-					{
-						size_t eol = control_data_.find('\n', pos);
-						if (eol == std::string::npos)
-						{
-							break;
-						}
-
-						int id = 0;
-						std::string name;
-						bool connected;
-						if (ParseEntry(control_data_.substr(pos, eol - pos), 
-							&name, &id, &connected) && id != my_id_)
-						{
-							peers_[id] = name;
-							std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnPeerConnected(id, name); });
-						}
-
-						pos = eol + 1;
-					}
+					peers_[id] = name;
+					std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnPeerConnected(id, name); });
 				}
-
-				RTC_DCHECK(is_connected());
-				std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnSignedIn(); });
-			}
-			else if (state_ == SIGNING_OUT)
-			{
-				Close();
-				std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnDisconnected(); });
-			} 
-			else if (state_ == SIGNING_OUT_WAITING)
-			{
-				SignOut();
 			}
 
-			control_data_.clear();
+			RTC_DCHECK(is_connected());
+			std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnSignedIn(); });
 		}
-		else
+		else if (state_ == SIGNING_OUT)
 		{
-			LOG(LS_ERROR) << "Received error from server: " << std::to_string(status);
+			Close();
+			std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnDisconnected(); });
+		} 
+		else if (state_ == SIGNING_OUT_WAITING)
+		{
+			SignOut();
+		}
+	}
+	else
+	{
+		LOG(LS_ERROR) << "Received error from server: " << std::to_string(status);
 
-			// TODO(bengreenier): special case for azure 500 issue
-			// see https://github.com/CatalystCode/3dtoolkit/issues/45
-			if (status == 500)
+		// TODO(bengreenier): special case for azure 500 issue
+		// see https://github.com/CatalystCode/3dtoolkit/issues/45
+		if (status == 500)
+		{
+			// Retries on a new connection. The server may have handled the
+			// failed request and the ones pipelined behind it, so only
+			// idempotent requests are sent again and the others fail.
+			control_socket_->Close();
+			size_t dropped = RequeueSentRequests(false);
+			if (!request.empty() && IsIdempotent(request))
 			{
-				control_socket_->Close();
-				control_socket_->Connect(server_address_);
+				pending_requests_.push_front(request);
 			}
 			else
 			{
-				Close();
-				std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnDisconnected(); });
-				control_data_.clear();
+				dropped++;
 			}
-		}
 
-		if (state_ == SIGNING_IN) 
-		{
-			RTC_DCHECK(hanging_get_->GetState() == rtc::Socket::CS_CLOSED);
-			state_ = CONNECTED;
-			hanging_get_->Connect(server_address_);
-
-			if (heartbeat_tick_ms_ != kHeartbeatDefault)
+			for (size_t i = 0; i < dropped; ++i)
 			{
-				heartbeat_get_->Connect(server_address_);
+				NotifyMessageSent(status);
 			}
 		}
+		else
+		{
+			Close();
+			std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnDisconnected(); });
+		}
+	}
+
+	if (state_ == SIGNING_IN && is_connected()) 
+	{
+		RTC_DCHECK(hanging_get_->GetState() == rtc::Socket::CS_CLOSED);
+		state_ = CONNECTED;
+		hanging_get_->Connect(server_address_);
+
+		if (heartbeat_tick_ms_ != kHeartbeatDefault)
+		{
+			heartbeat_get_->Connect(server_address_);
+		}
 	}
 }
 
 void PeerConnectionClient::OnHangingGetRead(rtc::AsyncSocket* socket) 
 {
 	LOG(INFO) << __FUNCTION__;
-	size_t content_length = 0;
-	if (ReadIntoBuffer(socket, &notification_data_, &content_length))
+	if (ReadIntoBuffer(socket, &notification_response_))
 	{
-		size_t peer_id = 0, eoh = 0;
-		int status = ParseServerResponse(notification_data_, content_length, &peer_id, &eoh);
-
+		int status = notification_response_.status();
+		bool connection_close = notification_response_.connection_close();
 		if (status == 200) 
 		{
-			// Store the position where the body begins.
-			size_t pos = eoh + 4;
-
+			size_t peer_id = GetPeerId(notification_response_);
 			if (my_id_ == static_cast<int>(peer_id)) 
 			{
 				// A notification about a new member or a member that just
@@ -562,7 +728,9 @@ void PeerConnectionClient::OnHangingGetRead(rtc::AsyncSocket* socket)
 				int id = 0;
 				std::string name;
 				bool connected = false;
-				if (ParseEntry(notification_data_.substr(pos), &name, &id, &connected)) 
+				if (notification_response_.body_size() > 0 &&
+					ParseEntry(notification_response_.body(), notification_response_.body_size(),
+						&name, &id, &connected)) 
 				{
 					if (connected) 
 					{
@@ -578,7 +746,8 @@ void PeerConnectionClient::OnHangingGetRead(rtc::AsyncSocket* socket)
 			} 
 			else 
 			{
-				OnMessageFromPeer(static_cast<int>(peer_id), notification_data_.substr(pos));
+				OnMessageFromPeer(static_cast<int>(peer_id), std::string(
+					notification_response_.body(), notification_response_.body_size()));
 			}
 		}
 		else
@@ -599,7 +768,19 @@ void PeerConnectionClient::OnHangingGetRead(rtc::AsyncSocket* socket)
 			}
 		}
 
-		notification_data_.clear();
+		notification_response_.Reset();
+		if (hanging_get_->GetState() == rtc::Socket::CS_CONNECTED)
+		{
+			if (connection_close)
+			{
+				socket->Close();
+			}
+			else if (state_ == CONNECTED)
+			{
+				// Waits for the next notification on the same connection.
+				OnHangingGetConnect(socket);
+			}
+		}
 	}
 
 	if (hanging_get_->GetState() == rtc::Socket::CS_CLOSED && state_ == CONNECTED) 
@@ -608,65 +789,85 @@ void PeerConnectionClient::OnHangingGetRead(rtc::AsyncSocket* socket)
 	}
 }
 
-bool PeerConnectionClient::ParseEntry(const std::string& entry, std::string* name, 
-	int* id, bool* connected)
+bool PeerConnectionClient::ParseEntry(const char* entry, size_t entry_size,
+	std::string* name, int* id, bool* connected)
 {
 	RTC_DCHECK(name != NULL);
 	RTC_DCHECK(id != NULL);
 	RTC_DCHECK(connected != NULL);
-	RTC_DCHECK(!entry.empty());
+	RTC_DCHECK(entry_size > 0);
 
 	*connected = false;
-	size_t separator = entry.find(',');
-	if (separator != std::string::npos) 
+	const char* end = entry + entry_size;
+	const char* separator = std::find(entry, end, ',');
+	if (separator != end) 
 	{
-		*id = atoi(&entry[separator + 1]);
-		name->assign(entry.substr(0, separator));
-		separator = entry.find(',', separator + 1);
-		if (separator != std::string::npos) 
+		*id = ParseInt(separator + 1, end);
+		name->assign(entry, separator);
+		separator = std::find(separator + 1, end, ',');
+		if (separator != end) 
 		{
-			*connected = atoi(&entry[separator + 1]) ? true : false;
+			*connected = ParseInt(separator + 1, end) ? true : false;
 		}
 	}
 
 	return !name->empty();
 }
 
-int PeerConnectionClient::GetResponseStatus(const std::string& response) 
+size_t PeerConnectionClient::GetPeerId(const HttpResponseParser& response)
+{
+	// See comment in peer_channel.cc for why we use the Pragma header and
+	// not e.g. "X-Peer-Id".
+	size_t peer_id = -1;
+	response.GetHeader("Pragma", &peer_id);
+	return peer_id;
+}
+
+void PeerConnectionClient::OnTransportSignedIn(int id, const Peers& peers)
 {
-	int status = -1;
-	size_t pos = response.find(' ');
-	if (pos != std::string::npos)
+	RTC_DCHECK(state_ == SIGNING_IN);
+	my_id_ = id;
+	RTC_DCHECK(my_id_ != -1);
+
+	for (auto it = peers.begin(); it != peers.end(); ++it)
 	{
-		status = atoi(&response[pos + 1]);
+		if (it->first != my_id_)
+		{
+			OnTransportPeerConnected(it->first, it->second);
+		}
 	}
 
-	return status;
+	state_ = CONNECTED;
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnSignedIn(); });
 }
 
-int PeerConnectionClient::ParseServerResponse(const std::string& response, 
-	size_t content_length, size_t* peer_id, size_t* eoh)
+void PeerConnectionClient::OnTransportPeerConnected(int id, const std::string& name)
 {
-	int status = GetResponseStatus(response.c_str());
-	
-	if (status == 200)
-	{
+	peers_[id] = name;
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnPeerConnected(id, name); });
+}
 
-		*eoh = response.find("\r\n\r\n");
-		RTC_DCHECK(*eoh != std::string::npos);
-		if (*eoh == std::string::npos)
-		{
-			return -1;
-		}
+void PeerConnectionClient::OnTransportPeerDisconnected(int id)
+{
+	peers_.erase(id);
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnPeerDisconnected(id); });
+}
 
-		*peer_id = -1;
+void PeerConnectionClient::OnTransportMessageSent(int err)
+{
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnMessageSent(err); });
+}
 
-		// See comment in peer_channel.cc for why we use the Pragma header and
-		// not e.g. "X-Peer-Id".
-		GetHeaderValue(response, *eoh, "\r\nPragma: ", peer_id);
-	}
+void PeerConnectionClient::OnTransportDisconnected()
+{
+	Close();
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnDisconnected(); });
+}
 
-	return status;
+void PeerConnectionClient::OnTransportConnectionFailure()
+{
+	Close();
+	std::for_each(callbacks_.rbegin(), callbacks_.rend(), [](PeerConnectionClientObserver* o) { o->OnServerConnectionFailure(); });
 }
 
 void PeerConnectionClient::OnHeartbeatGetClose(rtc::AsyncSocket* socket, int err)
@@ -703,7 +904,38 @@ void PeerConnectionClient::OnClose(rtc::AsyncSocket* socket, int err)
 		} 
 		else 
 		{
-			std::for_each(callbacks_.rbegin(), callbacks_.rend(), [&](PeerConnectionClientObserver* o) { o->OnMessageSent(err); });
+			// Reports each request dropped, or else the closed connection.
+			size_t failures = 1;
+			if (socket == control_socket_.get())
+			{
+				control_response_.Reset();
+				size_t dropped = sent_requests_.size();
+				if (keep_alive_ && !sent_requests_.empty())
+				{
+					// The server closed the connection before answering every
+					// request, after an idle timeout or because it doesn't take
+					// pipelined requests. If none was answered, it handled none
+					// and they are sent again on a connection per request.
+					// Otherwise it may have handled some, only idempotent
+					// requests are sent again.
+					LOG(WARNING) << "Connection closed with " << sent_requests_.size() << " unanswered requests";
+					keep_alive_ = control_responses_ > 0;
+					dropped = RequeueSentRequests(!keep_alive_);
+				}
+
+				// Unanswered requests are dropped without keep-alive.
+				sent_requests_.clear();
+				failures = std::max<size_t>(dropped, 1);
+				if (!pending_requests_.empty() && state_ != NOT_CONNECTED)
+				{
+					ConnectControlSocket();
+				}
+			}
+
+			for (size_t i = 0; i < failures; ++i)
+			{
+				NotifyMessageSent(err);
+			}
 		}
 	} 
 	else 
@@ -732,7 +964,14 @@ void PeerConnectionClient::OnMessage(rtc::Message* msg)
 			return;
 		}
 
-		// if the socket is still open, close it and then reconnect to trigger the beat...
+		// reuses a kept-alive connection to send the beat...
+		if (heartbeat_get_->GetState() == rtc::Socket::ConnState::CS_CONNECTED)
+		{
+			OnHeartbeatGetConnect(heartbeat_get_.get());
+			return;
+		}
+
+		// if the socket is still connecting, close it and then reconnect to trigger the beat...
 		if (heartbeat_get_->GetState() != rtc::Socket::ConnState::CS_CLOSED)
 		{
 			heartbeat_get_->Close();
@@ -760,6 +999,7 @@ void PeerConnectionClient::SetAuthorizationHeader(const std::string& value)
 void PeerConnectionClient::OnHeartbeatGetConnect(rtc::AsyncSocket* socket)
 {
 	auto req = PrepareRequest("GET", "/heartbeat?peer_id=" + std::to_string(my_id_), { {"Host", server_address_.hostname()} });
+	heartbeat_response_.Reset();
 
 	int sent = socket->Send(req.c_str(), req.length());
 	RTC_DCHECK(sent == req.length());
@@ -767,24 +1007,25 @@ void PeerConnectionClient::OnHeartbeatGetConnect(rtc::AsyncSocket* socket)
 
 void PeerConnectionClient::OnHeartbeatGetRead(rtc::AsyncSocket* socket)
 {
-	std::string data;
-	size_t content_length = 0;
-	if (ReadIntoBuffer(socket, &data, &content_length))
+	if (ReadIntoBuffer(socket, &heartbeat_response_))
 	{
-		// empty data can sometimes occur, we wish to ignore it
-		if (data.empty())
+		int status = heartbeat_response_.status();
+		if (heartbeat_response_.connection_close())
 		{
-			return;
+			socket->Close();
 		}
 
-		size_t peer_id = 0, eoh = 0;
-		int status = GetResponseStatus(data);
-
+		heartbeat_response_.Reset();
 		if (status != 200)
 		{
 			LOG(INFO) << "heartbeat failed (" << status << ")" << (heartbeat_tick_ms_ != kHeartbeatDefault ? ", will retry" : "");
 		}
 	}
+	else
+	{
+		// Waits for the rest of the response.
+		return;
+	}
 
 	if (heartbeat_tick_ms_ != kHeartbeatDefault)
 	{
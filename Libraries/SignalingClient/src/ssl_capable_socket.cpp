@@ -80,21 +80,25 @@ int SslCapableSocket::Connect(const SocketAddress& addr)
 {
 	LOG(INFO) << __FUNCTION__ << "@" << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
+	int err = 0;
 	if (ssl_adapter_.get() == nullptr)
 	{
-		return socket_->Connect(addr);
+		err = socket_->Connect(addr);
 	}
 	else
 	{
-		int err = ssl_adapter_->StartSSL(addr.hostname().c_str(), false);
+		err = ssl_adapter_->StartSSL(addr.hostname().c_str(), false);
 
 		if (err == 0)
 		{
 			err = ssl_adapter_->Connect(addr);
 		}
-
-		return err;
 	}
+
+	// Requests pipelined on a kept-alive connection are written right away,
+	// instead of waiting for the previous one to be acknowledged.
+	socket_->SetOption(OPT_NODELAY, 1);
+	return err;
 }
 
 int SslCapableSocket::Send(const void* pv, size_t cb)
@@ -191,13 +195,15 @@ void SslCapableSocket::MapUnderlyingEvents(AsyncSocket* provider, AsyncSocket* o
 	provider->SignalCloseEvent.connect(this, &SslCapableSocket::RefireCloseEvent);
 }
 
+// Events are refired with this socket rather than the underlying one, so that
+// handlers can tell their sockets apart and always write through TLS.
 void SslCapableSocket::RefireReadEvent(AsyncSocket* socket)
 {
 	signaling_thread_->Invoke<void>(RTC_FROM_HERE, [&]
 	{
 		LOG(INFO) << __FUNCTION__ << "@" << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
-		this->SignalReadEvent.emit(socket);
+		this->SignalReadEvent.emit(this);
 	});
 }
 
@@ -207,7 +213,7 @@ void SslCapableSocket::RefireWriteEvent(AsyncSocket* socket)
 	{
 		LOG(INFO) << __FUNCTION__ << "@" << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
-		this->SignalWriteEvent.emit(socket);
+		this->SignalWriteEvent.emit(this);
 	});
 }
 
@@ -217,7 +223,7 @@ void SslCapableSocket::RefireConnectEvent(AsyncSocket* socket)
 	{
 		LOG(INFO) << __FUNCTION__ << "@" << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
-		this->SignalConnectEvent.emit(socket);
+		this->SignalConnectEvent.emit(this);
 	});
 }
 
@@ -227,6 +233,6 @@ void SslCapableSocket::RefireCloseEvent(AsyncSocket* socket, int err)
 	{
 		LOG(INFO) << __FUNCTION__ << "@" << std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
-		this->SignalCloseEvent.emit(socket, err);
+		this->SignalCloseEvent.emit(this, err);
 	});
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "websocket_frame_parser.h"
+
+#include <string.h>
+#include <algorithm>
+
+namespace
+{
+	// Control frames carry at most this many payload bytes
+	const size_t kMaxControlPayloadSize = 125;
+}
+
+WebSocketFrameParser::WebSocketFrameParser(size_t max_message_size) :
+	max_message_size_(max_message_size),
+	size_(0),
+	read_offset_(0),
+	message_opcode_(0)
+{
+}
+
+char* WebSocketFrameParser::GetWriteBuffer(size_t size)
+{
+	// Moves the unparsed bytes to the front once per write, rather than
+	// after every parsed frame.
+	if (read_offset_ > 0)
+	{
+		size_ -= read_offset_;
+		memmove(buffer_.data(), buffer_.data() + read_offset_, size_);
+		read_offset_ = 0;
+	}
+
+	if (buffer_.size() - size_ < size)
+	{
+		buffer_.resize(std::max(size_ + size, buffer_.size() * 2));
+	}
+
+	return buffer_.data() + size_;
+}
+
+void WebSocketFrameParser::OnDataWritten(size_t size)
+{
+	size_ += size;
+}
+
+void WebSocketFrameParser::Append(const char* data, size_t size)
+{
+	memcpy(GetWriteBuffer(size), data, size);
+	OnDataWritten(size);
+}
+
+WebSocketFrameParser::Result WebSocketFrameParser::Next()
+{
+	while (true)
+	{
+		const char* data = buffer_.data() + read_offset_;
+		const uint8_t* frame = reinterpret_cast<const uint8_t*>(data);
+		size_t available = size_ - read_offset_;
+		if (available < 2)
+		{
+			return NEED_MORE_DATA;
+		}
+
+		// Extensions aren't negotiated, so the reserved bits must be clear.
+		if ((frame[0] & 0x70) != 0)
+		{
+			return PROTOCOL_ERROR;
+		}
+
+		bool fin = (frame[0] & 0x80) != 0;
+		uint8_t opcode = frame[0] & 0x0f;
+		bool masked = (frame[1] & 0x80) != 0;
+		uint64_t payload_size = frame[1] & 0x7f;
+		size_t header_size = 2;
+		if (payload_size == 126)
+		{
+			header_size = 4;
+			if (available < header_size)
+			{
+				return NEED_MORE_DATA;
+			}
+
+			payload_size = (frame[2] << 8) | frame[3];
+		}
+		else if (payload_size == 127)
+		{
+			header_size = 10;
+			if (available < header_size)
+			{
+				return NEED_MORE_DATA;
+			}
+
+			payload_size = 0;
+			for (int i = 2; i < 10; i++)
+			{
+				payload_size = (payload_size << 8) | frame[i];
+			}
+		}
+
+		// Rejected before the payload is received.
+		if (payload_size > max_message_size_)
+		{
+			return MESSAGE_TOO_BIG;
+		}
+
+		size_t mask_offset = header_size;
+		header_size += masked ? 4 : 0;
+		size_t frame_size = header_size + static_cast<size_t>(payload_size);
+		if (available < frame_size)
+		{
+			return NEED_MORE_DATA;
+		}
+
+		payload_.assign(data + header_size, static_cast<size_t>(payload_size));
+		if (masked)
+		{
+			for (size_t i = 0; i < payload_.size(); i++)
+			{
+				payload_[i] ^= data[mask_offset + i % 4];
+			}
+		}
+
+		read_offset_ += frame_size;
+
+		// Control frames aren't fragmented, and can come between fragments.
+		if (opcode & 0x8)
+		{
+			if (!fin || payload_.size() > kMaxControlPayloadSize)
+			{
+				return PROTOCOL_ERROR;
+			}
+
+			switch (opcode)
+			{
+			case kPingFrame:
+				return PING;
+
+			case kPongFrame:
+				return PONG;
+
+			case kCloseFrame:
+				return CLOSE;
+
+			default:
+				return PROTOCOL_ERROR;
+			}
+		}
+
+		if (opcode == kContinuationFrame)
+		{
+			if (message_opcode_ == 0)
+			{
+				return PROTOCOL_ERROR;
+			}
+		}
+		else if (message_opcode_ != 0 || (opcode != kTextFrame && opcode != kBinaryFrame))
+		{
+			return PROTOCOL_ERROR;
+		}
+		else
+		{
+			message_opcode_ = opcode;
+			message_.clear();
+		}
+
+		if (message_.size() + payload_.size() > max_message_size_)
+		{
+			return MESSAGE_TOO_BIG;
+		}
+
+		message_.append(payload_);
+		if (fin)
+		{
+			Result result = message_opcode_ == kTextFrame ? TEXT_MESSAGE : BINARY_MESSAGE;
+			payload_.swap(message_);
+			message_.clear();
+			message_opcode_ = 0;
+			return result;
+		}
+	}
+}
+
+void WebSocketFrameParser::Reset()
+{
+	size_ = 0;
+	read_offset_ = 0;
+	message_opcode_ = 0;
+	message_.clear();
+	payload_.clear();
+}
+
+void WebSocketFrameParser::WriteFrame(uint8_t opcode, const char* payload, size_t size,
+	uint32_t mask, std::string* out)
+{
+	// FIN, opcode, masked payload length and the masking key.
+	char header[14];
+	size_t header_size = 2;
+	header[0] = static_cast<char>(0x80 | opcode);
+	if (size < 126)
+	{
+		header[1] = static_cast<char>(0x80 | size);
+	}
+	else if (size <= 0xffff)
+	{
+		header[1] = static_cast<char>(0x80 | 126);
+		header[2] = static_cast<char>(size >> 8);
+		header[3] = static_cast<char>(size);
+		header_size = 4;
+	}
+	else
+	{
+		header[1] = static_cast<char>(0x80 | 127);
+		for (int i = 0; i < 8; i++)
+		{
+			header[2 + i] = static_cast<char>(static_cast<uint64_t>(size) >> (56 - 8 * i));
+		}
+
+		header_size = 10;
+	}
+
+	memcpy(header + header_size, &mask, sizeof(mask));
+	const char* key = header + header_size;
+	header_size += sizeof(mask);
+
+	size_t payload_offset = out->size() + header_size;
+	out->append(header, header_size);
+	out->append(payload, size);
+	for (size_t i = 0; i < size; i++)
+	{
+		(*out)[payload_offset + i] ^= key[i % 4];
+	}
+}
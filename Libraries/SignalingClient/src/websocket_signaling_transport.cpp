@@ -0,0 +1,447 @@
+/*
+ *  Copyright 2017 The WebRTC Project Authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "websocket_signaling_transport.h"
+
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+
+#include "webrtc/base/base64.h"
+#include "webrtc/base/checks.h"
+#include "webrtc/base/helpers.h"
+#include "webrtc/base/logging.h"
+#include "webrtc/base/messagedigest.h"
+#include "third_party/jsoncpp/source/include/json/json.h"
+
+namespace
+{
+	// Path of the opening handshake, followed by the peer_name query
+	const char kSignalingPath[] = "/signaling";
+
+	// Appended to Sec-WebSocket-Key to compute Sec-WebSocket-Accept (RFC 6455)
+	const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+	// Close status codes
+	const uint16_t kCloseProtocolError = 1002;
+	const uint16_t kCloseMessageTooBig = 1009;
+
+	// Messages larger than this close the connection
+	const size_t kMaxMessageSize = 16 * 1024 * 1024;
+
+	// Bytes requested from the socket per receive
+	const size_t kReadSize = 0xffff;
+
+	// The message id we use to emit SignalMessageSent
+	const uint32_t kMessageSentId = 1;
+
+	int GetInt(const Json::Value& object, const char* name)
+	{
+		const Json::Value& value = object[name];
+		return value.isInt() ? value.asInt() : -1;
+	}
+
+	std::string GetString(const Json::Value& object, const char* name)
+	{
+		const Json::Value& value = object[name];
+		return value.isString() ? value.asString() : std::string();
+	}
+}
+
+WebSocketSignalingTransport::WebSocketSignalingTransport(rtc::Thread* signaling_thread) :
+	signaling_thread_(signaling_thread),
+	state_(CLOSED),
+	frame_parser_(kMaxMessageSize),
+	unsent_messages_(0),
+	close_sent_(false)
+{
+}
+
+WebSocketSignalingTransport::~WebSocketSignalingTransport()
+{
+	signaling_thread_->Clear(this);
+}
+
+bool WebSocketSignalingTransport::SignIn(const rtc::SocketAddress& server, bool use_ssl,
+	const std::string& client_name, const std::string& authorization_header)
+{
+	if (state_ != CLOSED)
+	{
+		return false;
+	}
+
+	// The socket is kept across sessions, as it can be signaling when the
+	// client signs in again.
+	if (!socket_)
+	{
+		socket_.reset(new SslCapableSocket(server.ipaddr().family(), use_ssl, signaling_thread_));
+		socket_->SignalConnectEvent.connect(this, &WebSocketSignalingTransport::OnConnect);
+		socket_->SignalReadEvent.connect(this, &WebSocketSignalingTransport::OnRead);
+		socket_->SignalWriteEvent.connect(this, &WebSocketSignalingTransport::OnWrite);
+		socket_->SignalCloseEvent.connect(this, &WebSocketSignalingTransport::OnClose);
+	}
+	else
+	{
+		socket_->SetUseSsl(use_ssl);
+	}
+
+	std::string nonce;
+	rtc::CreateRandomData(16, &nonce);
+	std::string key = rtc::Base64::Encode(nonce);
+	std::string accept = key + kWebSocketGuid;
+	char digest[20];
+	rtc::ComputeDigest(rtc::DIGEST_SHA_1, accept.data(), accept.size(), digest, sizeof(digest));
+	accept_key_ = rtc::Base64::Encode(std::string(digest, sizeof(digest)));
+
+	handshake_request_ = std::string("GET ") + kSignalingPath + "?peer_name=" + client_name + " HTTP/1.1\r\n"
+		"Host: " + server.hostname() + "\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Key: " + key + "\r\n"
+		"Sec-WebSocket-Version: 13\r\n";
+
+	if (!authorization_header.empty())
+	{
+		handshake_request_ += "Authorization: " + authorization_header + "\r\n";
+	}
+
+	handshake_request_ += "\r\n";
+	state_ = CONNECTING;
+	if (socket_->Connect(server) == SOCKET_ERROR)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool WebSocketSignalingTransport::SendToPeer(int peer_id, const std::string& message)
+{
+	if (state_ != OPEN)
+	{
+		return false;
+	}
+
+	Json::Value root;
+	root["type"] = "message";
+	root["to"] = peer_id;
+	root["data"] = message;
+	std::string frame = Json::FastWriter().write(root);
+	unsent_messages_++;
+	SendFrame(WebSocketFrameParser::kTextFrame, frame.data(), frame.size());
+	return true;
+}
+
+bool WebSocketSignalingTransport::IsSendingMessage() const
+{
+	return !write_buffer_.empty();
+}
+
+bool WebSocketSignalingTransport::SignOut()
+{
+	if (state_ != OPEN)
+	{
+		return false;
+	}
+
+	Json::Value root;
+	root["type"] = "sign_out";
+	std::string frame = Json::FastWriter().write(root);
+	state_ = SIGNING_OUT;
+	SendFrame(WebSocketFrameParser::kTextFrame, frame.data(), frame.size());
+	return true;
+}
+
+void WebSocketSignalingTransport::Close()
+{
+	if (socket_)
+	{
+		socket_->Close();
+	}
+
+	signaling_thread_->Clear(this);
+	state_ = CLOSED;
+	handshake_response_.Reset();
+	frame_parser_.Reset();
+	write_buffer_.clear();
+	unsent_messages_ = 0;
+	close_sent_ = false;
+}
+
+void WebSocketSignalingTransport::OnMessage(rtc::Message* msg)
+{
+	if (msg->message_id == kMessageSentId)
+	{
+		SignalMessageSent(0);
+	}
+}
+
+void WebSocketSignalingTransport::OnConnect(rtc::AsyncSocket* socket)
+{
+	if (state_ != CONNECTING)
+	{
+		return;
+	}
+
+	state_ = HANDSHAKING;
+	handshake_response_.Reset();
+	write_buffer_ = handshake_request_;
+	Flush();
+}
+
+void WebSocketSignalingTransport::OnRead(rtc::AsyncSocket* socket)
+{
+	if (state_ == CLOSED || state_ == CONNECTING)
+	{
+		return;
+	}
+
+	if (state_ == HANDSHAKING)
+	{
+		while (!handshake_response_.is_complete() &&
+			handshake_response_.state() != HttpResponseParser::MALFORMED)
+		{
+			int bytes = socket_->Recv(handshake_response_.GetWriteBuffer(kReadSize), kReadSize, nullptr);
+			if (bytes <= 0)
+			{
+				break;
+			}
+
+			handshake_response_.OnDataWritten(bytes);
+		}
+
+		if (!handshake_response_.is_complete() &&
+			handshake_response_.state() != HttpResponseParser::MALFORMED)
+		{
+			return;
+		}
+
+		if (!CheckHandshakeResponse())
+		{
+			LOG(LS_ERROR) << "The server refused the WebSocket upgrade: " << handshake_response_.status();
+			Close();
+			SignalConnectionFailure();
+			return;
+		}
+
+		// Frames sent right after the handshake can come with it.
+		frame_parser_.Append(handshake_response_.remaining(), handshake_response_.remaining_size());
+
+		handshake_response_.Reset();
+		state_ = OPEN;
+	}
+
+	while (true)
+	{
+		int bytes = socket_->Recv(frame_parser_.GetWriteBuffer(kReadSize), kReadSize, nullptr);
+		if (bytes <= 0)
+		{
+			break;
+		}
+
+		frame_parser_.OnDataWritten(bytes);
+	}
+
+	if (!ParseFrames())
+	{
+		Fail(kCloseProtocolError);
+	}
+}
+
+void WebSocketSignalingTransport::OnWrite(rtc::AsyncSocket* socket)
+{
+	if (state_ != CLOSED)
+	{
+		Flush();
+	}
+}
+
+void WebSocketSignalingTransport::OnClose(rtc::AsyncSocket* socket, int err)
+{
+	LOG(INFO) << __FUNCTION__ << " (" << err << ")";
+
+	State state = state_;
+	Close();
+	if (state == CONNECTING || state == HANDSHAKING)
+	{
+		SignalConnectionFailure();
+	}
+	else if (state != CLOSED)
+	{
+		SignalDisconnected();
+	}
+}
+
+bool WebSocketSignalingTransport::CheckHandshakeResponse()
+{
+	std::string upgrade;
+	std::string accept;
+	if (handshake_response_.status() != 101 ||
+		!handshake_response_.GetHeader("Upgrade", &upgrade) ||
+		!handshake_response_.GetHeader("Sec-WebSocket-Accept", &accept))
+	{
+		return false;
+	}
+
+	std::transform(upgrade.begin(), upgrade.end(), upgrade.begin(), ::tolower);
+	return upgrade == "websocket" && accept == accept_key_;
+}
+
+bool WebSocketSignalingTransport::ParseFrames()
+{
+	// Handlers can close the transport, which stops the parsing.
+	while (state_ == OPEN || state_ == SIGNING_OUT)
+	{
+		const std::string& payload = frame_parser_.payload();
+		switch (frame_parser_.Next())
+		{
+		case WebSocketFrameParser::NEED_MORE_DATA:
+			return true;
+
+		case WebSocketFrameParser::TEXT_MESSAGE:
+			OnTextMessage(payload);
+			break;
+
+		case WebSocketFrameParser::BINARY_MESSAGE:
+			// Binary messages aren't part of the protocol.
+			break;
+
+		case WebSocketFrameParser::PING:
+			SendFrame(WebSocketFrameParser::kPongFrame, payload.data(), payload.size());
+			break;
+
+		case WebSocketFrameParser::PONG:
+			break;
+
+		case WebSocketFrameParser::CLOSE:
+			// Echoes the status code, if any.
+			if (!close_sent_)
+			{
+				SendFrame(WebSocketFrameParser::kCloseFrame, payload.data(),
+					std::min<size_t>(payload.size(), 2));
+			}
+
+			Disconnect();
+			break;
+
+		case WebSocketFrameParser::MESSAGE_TOO_BIG:
+			Fail(kCloseMessageTooBig);
+			return true;
+
+		default:
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void WebSocketSignalingTransport::OnTextMessage(const std::string& message)
+{
+	Json::Reader reader;
+	Json::Value root;
+	if (!reader.parse(message, root) || !root.isObject())
+	{
+		LOG(LS_ERROR) << "Malformed signaling message.";
+		return;
+	}
+
+	std::string type = GetString(root, "type");
+	if (type == "signed_in")
+	{
+		Peers peers;
+		const Json::Value& entries = root["peers"];
+		for (Json::ArrayIndex i = 0; entries.isArray() && i < entries.size(); i++)
+		{
+			if (entries[i].isObject() && GetInt(entries[i], "id") != -1)
+			{
+				peers[GetInt(entries[i], "id")] = GetString(entries[i], "name");
+			}
+		}
+
+		SignalSignedIn(GetInt(root, "id"), peers);
+	}
+	else if (type == "peer")
+	{
+		const Json::Value& connected = root["connected"];
+		if (connected.isBool() && connected.asBool())
+		{
+			SignalPeerConnected(GetInt(root, "id"), GetString(root, "name"));
+		}
+		else
+		{
+			SignalPeerDisconnected(GetInt(root, "id"));
+		}
+	}
+	else if (type == "message")
+	{
+		SignalMessageFromPeer(GetInt(root, "from"), GetString(root, "data"));
+	}
+	else
+	{
+		LOG(WARNING) << "Unknown signaling message: " << type;
+	}
+}
+
+void WebSocketSignalingTransport::SendFrame(uint8_t opcode, const char* payload, size_t size)
+{
+	// Client frames are masked with a new key each.
+	WebSocketFrameParser::WriteFrame(opcode, payload, size, rtc::CreateRandomId(), &write_buffer_);
+	if (opcode == WebSocketFrameParser::kCloseFrame)
+	{
+		close_sent_ = true;
+	}
+
+	Flush();
+}
+
+void WebSocketSignalingTransport::Flush()
+{
+	// Waits for OnWrite if the socket doesn't take everything.
+	while (!write_buffer_.empty() && state_ != CONNECTING)
+	{
+		int sent = socket_->Send(write_buffer_.data(), write_buffer_.size());
+		if (sent <= 0)
+		{
+			break;
+		}
+
+		write_buffer_.erase(0, sent);
+	}
+
+	// Every message is reported, like the responses to message requests.
+	if (write_buffer_.empty())
+	{
+		for (; unsent_messages_ > 0; unsent_messages_--)
+		{
+			signaling_thread_->Post(RTC_FROM_HERE, this, kMessageSentId);
+		}
+	}
+}
+
+void WebSocketSignalingTransport::Fail(uint16_t status)
+{
+	LOG(LS_ERROR) << "Closing the signaling connection: " << status;
+
+	if (!close_sent_)
+	{
+		char payload[2] = { static_cast<char>(status >> 8), static_cast<char>(status) };
+		SendFrame(WebSocketFrameParser::kCloseFrame, payload, sizeof(payload));
+	}
+
+	Disconnect();
+}
+
+void WebSocketSignalingTransport::Disconnect()
+{
+	Close();
+	SignalDisconnected();
+}
@@ -0,0 +1,229 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "encoder_session_pool.h"
+
+#include "webrtc/api/video/i420_buffer.h"
+#include "webrtc/base/timeutils.h"
+#include "webrtc/modules/video_coding/include/video_error_codes.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	struct FakeEncoderStats
+	{
+		int created;
+		int initialized;
+		int released;
+		int lost_frames;
+	};
+
+	// Counts session setups and teardowns, every frame is encoded right away.
+	class FakeVideoEncoder : public BackendVideoEncoder
+	{
+	public:
+		explicit FakeVideoEncoder(FakeEncoderStats* stats) :
+			stats_(stats),
+			callback_(nullptr)
+		{
+			stats_->created++;
+		}
+
+		int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+			int32_t number_of_cores,
+			size_t max_payload_size) override
+		{
+			stats_->initialized++;
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t RegisterEncodeCompleteCallback(
+			webrtc::EncodedImageCallback* callback) override
+		{
+			callback_ = callback;
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t Release() override
+		{
+			stats_->released++;
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t Encode(const webrtc::VideoFrame& frame,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const std::vector<webrtc::FrameType>* frame_types) override
+		{
+			webrtc::EncodedImage encoded_image;
+			callback_->OnEncodedImage(encoded_image, nullptr, nullptr);
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override
+		{
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		void ReportFrameLoss(uint32_t rtp_timestamp) override
+		{
+			stats_->lost_frames++;
+		}
+
+	private:
+		FakeEncoderStats* stats_;
+		webrtc::EncodedImageCallback* callback_;
+	};
+
+	class CountingEncodedImageCallback : public webrtc::EncodedImageCallback
+	{
+	public:
+		CountingEncodedImageCallback() : frame_count(0) {}
+
+		webrtc::EncodedImageCallback::Result OnEncodedImage(
+			const webrtc::EncodedImage& encoded_image,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const webrtc::RTPFragmentationHeader* fragmentation) override
+		{
+			frame_count++;
+			return webrtc::EncodedImageCallback::Result(
+				webrtc::EncodedImageCallback::Result::OK);
+		}
+
+		int frame_count;
+	};
+
+	webrtc::VideoCodec GetCodecSettings(int width, int height)
+	{
+		webrtc::VideoCodec codec_settings;
+		codec_settings.codecType = webrtc::kVideoCodecH264;
+		codec_settings.width = width;
+		codec_settings.height = height;
+		codec_settings.maxFramerate = 60;
+		return codec_settings;
+	}
+
+	std::shared_ptr<EncoderSessionPool> CreatePool(FakeEncoderStats* stats,
+		size_t warm_sessions, int64_t idle_timeout_ms)
+	{
+		return std::make_shared<EncoderSessionPool>(
+			[stats]() { return new FakeVideoEncoder(stats); },
+			warm_sessions,
+			idle_timeout_ms);
+	}
+
+	TEST_CLASS(EncoderSessionPoolTests)
+	{
+	public:
+
+		TEST_METHOD(SessionPool_Reuses_Returned_Sessions)
+		{
+			FakeEncoderStats stats = {};
+			auto pool = CreatePool(&stats, 1, 60000);
+			webrtc::VideoCodec hd = GetCodecSettings(1280, 720);
+
+			Assert::IsTrue(pool->Acquire(hd) == nullptr);
+
+			std::unique_ptr<BackendVideoEncoder> encoder(pool->CreateEncoder());
+			BackendVideoEncoder* session = encoder.get();
+			pool->Return(hd, std::move(encoder));
+			Assert::IsTrue(((size_t)1) == pool->idle_count());
+
+			// Sessions are keyed by resolution.
+			Assert::IsTrue(pool->Acquire(GetCodecSettings(1920, 1080)) == nullptr);
+			Assert::IsTrue(pool->Acquire(hd).get() == session);
+			Assert::IsTrue(((uint64_t)1) == pool->hit_count());
+			Assert::IsTrue(((uint64_t)2) == pool->miss_count());
+			Assert::AreEqual(1, stats.created);
+		}
+
+		TEST_METHOD(SessionPool_Warms_Up_In_Background)
+		{
+			FakeEncoderStats stats = {};
+			auto pool = CreatePool(&stats, 2, 60000);
+			pool->WarmUp(GetCodecSettings(1280, 720));
+			pool->WaitForWarmUp();
+
+			Assert::IsTrue(((size_t)2) == pool->idle_count());
+			Assert::AreEqual(2, stats.created);
+			Assert::AreEqual(2, stats.initialized);
+
+			// Already warm, nothing new is created.
+			pool->WarmUp(GetCodecSettings(1280, 720));
+			pool->WaitForWarmUp();
+			Assert::AreEqual(2, stats.created);
+		}
+
+		TEST_METHOD(SessionPool_Evicts_Idle_Sessions)
+		{
+			FakeEncoderStats stats = {};
+			auto pool = CreatePool(&stats, 1, 1000);
+			webrtc::VideoCodec hd = GetCodecSettings(1280, 720);
+			webrtc::VideoCodec full_hd = GetCodecSettings(1920, 1080);
+			pool->WarmUp(hd);
+			pool->WaitForWarmUp();
+
+			auto first = pool->Acquire(hd);
+			std::unique_ptr<BackendVideoEncoder> second(pool->CreateEncoder());
+			std::unique_ptr<BackendVideoEncoder> third(pool->CreateEncoder());
+			pool->Return(hd, std::move(first));
+			pool->Return(hd, std::move(second));
+			pool->Return(full_hd, std::move(third));
+			Assert::IsTrue(((size_t)3) == pool->idle_count());
+
+			// Only the warmed session outlives the timeout.
+			pool->EvictIdleSessions(rtc::TimeMillis() + 1000);
+			Assert::IsTrue(((size_t)1) == pool->idle_count());
+			Assert::AreEqual(2, stats.released);
+			Assert::IsTrue(pool->Acquire(hd) != nullptr);
+		}
+
+		TEST_METHOD(SessionPool_Pooled_Encoder_Returns_Session_On_Release)
+		{
+			FakeEncoderStats stats = {};
+			auto pool = CreatePool(&stats, 1, 60000);
+			webrtc::VideoCodec hd = GetCodecSettings(1280, 720);
+			pool->WarmUp(hd);
+			pool->WaitForWarmUp();
+
+			CountingEncodedImageCallback callback;
+			webrtc::VideoFrame frame(webrtc::I420Buffer::Create(16, 16), 0, 0,
+				webrtc::kVideoRotation_0);
+
+			{
+				PooledVideoEncoder encoder(pool);
+				encoder.RegisterEncodeCompleteCallback(&callback);
+				Assert::AreEqual(WEBRTC_VIDEO_CODEC_OK, encoder.InitEncode(&hd, 1, 1200));
+				Assert::IsTrue(((size_t)0) == pool->idle_count());
+
+				encoder.Encode(frame, nullptr, nullptr);
+				encoder.Encode(frame, nullptr, nullptr);
+				Assert::AreEqual(2, callback.frame_count);
+			}
+
+			// The session went back without being torn down.
+			Assert::IsTrue(((size_t)1) == pool->idle_count());
+			Assert::AreEqual(1, stats.created);
+			Assert::AreEqual(0, stats.released);
+			Assert::IsTrue(pool->average_pooled_time_to_first_frame_ms() >= 0);
+			Assert::IsTrue(pool->average_cold_time_to_first_frame_ms() < 0);
+		}
+
+		TEST_METHOD(SessionPool_Pooled_Encoder_Forwards_Frame_Loss)
+		{
+			FakeEncoderStats stats = {};
+			auto pool = CreatePool(&stats, 1, 60000);
+			webrtc::VideoCodec hd = GetCodecSettings(1280, 720);
+			PooledVideoEncoder encoder(pool);
+
+			// No session to report to yet.
+			encoder.ReportFrameLoss(3000);
+			Assert::AreEqual(0, stats.lost_frames);
+
+			Assert::AreEqual(WEBRTC_VIDEO_CODEC_OK, encoder.InitEncode(&hd, 1, 1200));
+			encoder.ReportFrameLoss(6000);
+			Assert::AreEqual(1, stats.lost_frames);
+		}
+	};
+}
@@ -0,0 +1,73 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "frame_loss_detector.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	FrameLossDetector::Counters MakeCounters(int64_t plis, int64_t firs, int64_t packets_lost)
+	{
+		FrameLossDetector::Counters counters;
+		counters.plis = plis;
+		counters.firs = firs;
+		counters.packets_lost = packets_lost;
+		return counters;
+	}
+
+	TEST_CLASS(FrameLossDetectorTests)
+	{
+	public:
+
+		TEST_METHOD(FrameLoss_Recovered_Nacks_Take_No_Action)
+		{
+			// Each poll finds a few packets NACKed and retransmitted in time,
+			// the cumulative loss goes back down once they arrive.
+			FrameLossDetector detector(2, 2);
+			int64_t lost[] = { 3, 0, 4, 1, 5, 2, 2, 2 };
+			for (int64_t packets_lost : lost)
+			{
+				Assert::IsFalse(detector.Update(MakeCounters(0, 0, packets_lost)));
+			}
+		}
+
+		TEST_METHOD(FrameLoss_Key_Frame_Requests)
+		{
+			FrameLossDetector detector(2, 2);
+			Assert::IsTrue(detector.Update(MakeCounters(1, 0, 0)));
+			Assert::IsFalse(detector.Update(MakeCounters(1, 0, 0)));
+			Assert::IsTrue(detector.Update(MakeCounters(1, 1, 0)));
+			Assert::IsFalse(detector.Update(MakeCounters(1, 1, 0)));
+		}
+
+		TEST_METHOD(FrameLoss_Sustained_Packet_Loss)
+		{
+			// A lossy poll alone isn't reported.
+			FrameLossDetector detector(2, 2);
+			Assert::IsFalse(detector.Update(MakeCounters(0, 0, 10)));
+			Assert::IsTrue(detector.Update(MakeCounters(0, 0, 20)));
+
+			// The next report takes as many lossy polls.
+			Assert::IsFalse(detector.Update(MakeCounters(0, 0, 30)));
+			Assert::IsTrue(detector.Update(MakeCounters(0, 0, 40)));
+
+			// Losses at the threshold don't count.
+			Assert::IsFalse(detector.Update(MakeCounters(0, 0, 42)));
+			Assert::IsFalse(detector.Update(MakeCounters(0, 0, 44)));
+		}
+
+		TEST_METHOD(FrameLoss_Reset_Restarts_Counters)
+		{
+			FrameLossDetector detector(2, 2);
+			Assert::IsTrue(detector.Update(MakeCounters(5, 0, 100)));
+			Assert::IsFalse(detector.Update(MakeCounters(5, 0, 110)));
+
+			// A new peer connection starts from zero.
+			detector.Reset();
+			Assert::IsFalse(detector.Update(MakeCounters(0, 0, 0)));
+			Assert::IsTrue(detector.Update(MakeCounters(1, 0, 0)));
+		}
+	};
+}
@@ -0,0 +1,44 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <chrono>
+#include <thread>
+
+#include "frame_pacer.h"
+#include "plugindefs.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	TEST_CLASS(FramePacerTests)
+	{
+	public:
+
+		TEST_METHOD(FramePacer_Idle_Period_Skips_No_Slots)
+		{
+			FramePacer pacer(100);
+			for (int i = 0; i < 3; i++)
+			{
+				pacer.WaitForNextFrame();
+			}
+
+			// The render loop stops rendering, e.g. until the next connection.
+			std::this_thread::sleep_for(
+				std::chrono::milliseconds(FRAME_PACER_IDLE_THRESHOLD_MS + 200));
+
+			for (int i = 0; i < 3; i++)
+			{
+				pacer.WaitForNextFrame();
+			}
+
+			FramePacer::Stats stats = pacer.GetStats();
+			Assert::IsTrue(((uint64_t)6) == stats.frames);
+			Assert::IsTrue(((uint64_t)0) == stats.skipped_slots);
+
+			// The idle gap isn't an inter-frame interval.
+			Assert::IsTrue(stats.p99_interval_ms < FRAME_PACER_IDLE_THRESHOLD_MS);
+		}
+	};
+}
@@ -0,0 +1,147 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "frame_recorder.h"
+#include "replay_buffer_capturer.h"
+
+#include "webrtc/api/video/i420_buffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	const char kRecordingPath[] = "frame_recorder_test.y4m";
+
+	// Keeps a packed I420 copy of every frame.
+	class CopyingVideoSink : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		void OnFrame(const webrtc::VideoFrame& frame) override
+		{
+			frames.push_back(PackI420(frame.video_frame_buffer()));
+		}
+
+		static std::vector<uint8_t> PackI420(
+			const rtc::scoped_refptr<webrtc::VideoFrameBuffer>& buffer)
+		{
+			std::vector<uint8_t> data;
+			int chroma_width = (buffer->width() + 1) / 2;
+			int chroma_height = (buffer->height() + 1) / 2;
+			AppendPlane(buffer->DataY(), buffer->StrideY(), buffer->width(),
+				buffer->height(), &data);
+
+			AppendPlane(buffer->DataU(), buffer->StrideU(), chroma_width, chroma_height, &data);
+			AppendPlane(buffer->DataV(), buffer->StrideV(), chroma_width, chroma_height, &data);
+			return data;
+		}
+
+		std::vector<std::vector<uint8_t>> frames;
+
+	private:
+		static void AppendPlane(const uint8_t* plane, int stride, int width, int height,
+			std::vector<uint8_t>* data)
+		{
+			for (int y = 0; y < height; y++)
+			{
+				data->insert(data->end(), plane + y * stride, plane + y * stride + width);
+			}
+		}
+	};
+
+	rtc::scoped_refptr<webrtc::I420Buffer> CreatePatternBuffer(int width, int height,
+		int seed)
+	{
+		rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+			webrtc::I420Buffer::Create(width, height);
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				buffer->MutableDataY()[y * buffer->StrideY() + x] =
+					static_cast<uint8_t>(x * 7 + y * 3 + seed);
+			}
+		}
+
+		for (int y = 0; y < (height + 1) / 2; y++)
+		{
+			for (int x = 0; x < (width + 1) / 2; x++)
+			{
+				buffer->MutableDataU()[y * buffer->StrideU() + x] =
+					static_cast<uint8_t>(x + seed);
+
+				buffer->MutableDataV()[y * buffer->StrideV() + x] =
+					static_cast<uint8_t>(y + seed);
+			}
+		}
+
+		return buffer;
+	}
+
+	TEST_CLASS(FrameRecorderTests)
+	{
+	public:
+
+		TEST_METHOD(FrameRecorder_Replay_Returns_Recorded_Frames)
+		{
+			// Odd size, the chroma planes round up.
+			std::vector<std::vector<uint8_t>> expected;
+			FrameRecorder recorder;
+			Assert::IsTrue(recorder.Open(kRecordingPath, 30));
+			for (int i = 0; i < 3; i++)
+			{
+				rtc::scoped_refptr<webrtc::I420Buffer> buffer = CreatePatternBuffer(33, 17, i);
+				expected.push_back(CopyingVideoSink::PackI420(buffer));
+				recorder.OnFrame(webrtc::VideoFrame(buffer, 0, 0, webrtc::kVideoRotation_0));
+			}
+
+			// Y4M can't change the frame size.
+			recorder.OnFrame(webrtc::VideoFrame(CreatePatternBuffer(32, 16, 0), 0, 0,
+				webrtc::kVideoRotation_0));
+
+			recorder.Close();
+			FrameRecorder::Stats stats = recorder.GetStats();
+			Assert::IsTrue(((uint64_t)3) == stats.frames_recorded);
+			Assert::IsTrue(((uint64_t)1) == stats.frames_dropped);
+
+			CopyingVideoSink sink;
+			{
+				ReplayBufferCapturer capturer;
+				Assert::IsTrue(capturer.Open(kRecordingPath));
+				Assert::AreEqual(33, capturer.width());
+				Assert::AreEqual(17, capturer.height());
+				Assert::AreEqual(3, capturer.frame_count());
+				Assert::AreEqual(30, capturer.file_frame_rate());
+
+				capturer.SetFrameRate(0);
+				capturer.AddOrUpdateSink(&sink, rtc::VideoSinkWants());
+				capturer.Start(cricket::VideoFormat(33, 17,
+					cricket::VideoFormat::FpsToInterval(30), cricket::FOURCC_I420));
+
+				capturer.WaitForEnd();
+				capturer.Stop();
+				Assert::IsTrue(((uint64_t)3) == capturer.frames_sent());
+			}
+
+			Assert::IsTrue(expected == sink.frames);
+			remove(kRecordingPath);
+		}
+
+		TEST_METHOD(ReplayBufferCapturer_Rejects_Other_Files)
+		{
+			FILE* file = fopen(kRecordingPath, "wb");
+			fputs("YUV4MPEG2 W16 H16 F30:1 C444\nFRAME\n", file);
+			fclose(file);
+
+			ReplayBufferCapturer capturer;
+			Assert::IsFalse(capturer.Open(kRecordingPath));
+			Assert::IsFalse(capturer.Open("missing.y4m"));
+			remove(kRecordingPath);
+		}
+	};
+}
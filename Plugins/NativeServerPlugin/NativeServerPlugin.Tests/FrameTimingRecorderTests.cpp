@@ -0,0 +1,90 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <thread>
+#include <vector>
+
+#include "frame_timing.h"
+#include "memory_buffer_capturer.h"
+
+#include "webrtc/base/timeutils.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	// Stands in for ViEEncoder, which replaces the time stamp of a frame, and
+	// for H264EncoderImpl, which records the encoder stages.
+	class FrameTimingEncoder : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		void OnFrame(const webrtc::VideoFrame& frame) override
+		{
+			webrtc::VideoFrame encoder_frame = frame;
+			encoder_frame.set_render_time_ms(rtc::TimeMillis());
+			FrameTimingRecorder::Instance()->Record(encoder_frame.ntp_time_ms(), kFrameEncoderOut);
+			FrameTimingRecorder::Instance()->Record(encoder_frame.ntp_time_ms(), kFramePacketized);
+		}
+	};
+
+	TEST_CLASS(FrameTimingRecorderTests)
+	{
+	public:
+
+		TEST_METHOD(FrameTiming_Joins_Every_Stage_Of_A_Frame)
+		{
+			FrameTimingRecorder* recorder = FrameTimingRecorder::Instance();
+			recorder->SetEnabled(true);
+			recorder->GetHistograms(true);
+
+			FrameTimingEncoder encoder;
+			{
+				MemoryBufferCapturer capturer;
+				capturer.AddOrUpdateSink(&encoder, rtc::VideoSinkWants());
+				capturer.Start(cricket::VideoFormat(64, 64,
+					cricket::VideoFormat::FpsToInterval(60), cricket::FOURCC_I420));
+
+				std::vector<uint8_t> frame(64 * 64 * 4, 128);
+				capturer.SendFrame(frame.data(), 64 * 4, MemoryBufferCapturer::kPixelFormatRGBA,
+					64, 64);
+
+				capturer.Stop();
+			}
+
+			std::vector<FrameTimingRecorder::Histogram> histograms = recorder->GetHistograms(true);
+			recorder->SetEnabled(false);
+
+			// Memory frames aren't staged on the GPU.
+			Assert::IsTrue(((uint64_t)0) == histograms[kFrameStaged].total_count);
+			Assert::IsTrue(((uint64_t)1) == histograms[kFrameConverted].total_count);
+			Assert::IsTrue(((uint64_t)1) == histograms[kFrameEncoderIn].total_count);
+			Assert::IsTrue(((uint64_t)1) == histograms[kFrameEncoderOut].total_count);
+			Assert::IsTrue(((uint64_t)1) == histograms[kFramePacketized].total_count);
+		}
+
+		TEST_METHOD(FrameTiming_Releases_Rings_Of_Exited_Threads)
+		{
+			FrameTimingRecorder* recorder = FrameTimingRecorder::Instance();
+			recorder->SetEnabled(true);
+			recorder->GetHistograms(true);
+			size_t ring_count = recorder->GetThreadRingCount();
+
+			// The events of a thread are counted after it exits.
+			for (int64_t frame_id = 1000; frame_id < 1020; frame_id++)
+			{
+				std::thread([frame_id]()
+				{
+					FrameTimingRecorder::Instance()->Record(frame_id, kFrameRenderSubmitted);
+					FrameTimingRecorder::Instance()->Record(frame_id, kFrameEncoderIn);
+				}).join();
+			}
+
+			std::vector<FrameTimingRecorder::Histogram> histograms = recorder->GetHistograms(true);
+			recorder->SetEnabled(false);
+
+			Assert::IsTrue(((uint64_t)20) == histograms[kFrameEncoderIn].total_count);
+			Assert::IsTrue(recorder->GetThreadRingCount() <= ring_count);
+		}
+	};
+}
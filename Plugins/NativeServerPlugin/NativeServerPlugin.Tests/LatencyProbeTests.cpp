@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "latency_probe.h"
+#include "memory_buffer_capturer.h"
+#include "plugindefs.h"
+
+#include "webrtc/api/video/i420_buffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	// Gradient luma, which the pattern has to stand out from.
+	rtc::scoped_refptr<webrtc::I420Buffer> CreateGradientBuffer(int width, int height)
+	{
+		rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+			webrtc::I420Buffer::Create(width, height);
+
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				buffer->MutableDataY()[y * buffer->StrideY() + x] =
+					static_cast<uint8_t>((x + y) / 2);
+			}
+		}
+
+		memset(buffer->MutableDataU(), 90, buffer->StrideU() * ((height + 1) / 2));
+		memset(buffer->MutableDataV(), 160, buffer->StrideV() * ((height + 1) / 2));
+		return buffer;
+	}
+
+	TEST_CLASS(LatencyProbeTests)
+	{
+	public:
+
+		TEST_METHOD(LatencyProbe_Detects_Stamped_Id_Through_Noise)
+		{
+			rtc::scoped_refptr<webrtc::I420Buffer> buffer = CreateGradientBuffer(320, 240);
+			LatencyProbe::Id id = { 0xBEEF, 0xDEADBEEF };
+			Assert::IsTrue(LatencyProbe::StampI420(id,
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				buffer->width(), buffer->height()));
+
+			// Coding noise, including ringing at the cell edges.
+			srand(1);
+			for (int y = 0; y < buffer->height(); y++)
+			{
+				for (int x = 0; x < buffer->width(); x++)
+				{
+					uint8_t* pixel = buffer->MutableDataY() + y * buffer->StrideY() + x;
+					int amplitude = x % LATENCY_PROBE_CELL_SIZE < 2 ? 120 : 40;
+					int value = *pixel + rand() % (amplitude + 1) - amplitude / 2;
+					*pixel = static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+				}
+			}
+
+			LatencyProbe::Id detected = { 0 };
+			Assert::IsTrue(LatencyProbe::Detect(buffer->DataY(), buffer->StrideY(),
+				buffer->width(), buffer->height(), &detected));
+
+			Assert::IsTrue(id.sequence_number == detected.sequence_number);
+			Assert::IsTrue(id.capture_time_us == detected.capture_time_us);
+		}
+
+		TEST_METHOD(LatencyProbe_Rejects_Unstamped_And_Corrupted_Frames)
+		{
+			rtc::scoped_refptr<webrtc::I420Buffer> buffer = CreateGradientBuffer(320, 240);
+			LatencyProbe::Id detected = { 0 };
+			Assert::IsFalse(LatencyProbe::Detect(buffer->DataY(), buffer->StrideY(),
+				buffer->width(), buffer->height(), &detected));
+
+			LatencyProbe::Id id = { 1, 2 };
+			LatencyProbe::StampI420(id,
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				buffer->width(), buffer->height());
+
+			// Sets the second to last bit of the sequence number, the CRC no
+			// longer matches.
+			int cell = 4 + 14;
+			for (int y = 0; y < LATENCY_PROBE_CELL_SIZE; y++)
+			{
+				memset(buffer->MutableDataY() +
+					((cell / LATENCY_PROBE_GRID_SIZE) * LATENCY_PROBE_CELL_SIZE + y) *
+					buffer->StrideY() + (cell % LATENCY_PROBE_GRID_SIZE) * LATENCY_PROBE_CELL_SIZE,
+					235, LATENCY_PROBE_CELL_SIZE);
+			}
+
+			Assert::IsFalse(LatencyProbe::Detect(buffer->DataY(), buffer->StrideY(),
+				buffer->width(), buffer->height(), &detected));
+
+			// Smaller than the pattern.
+			Assert::IsFalse(LatencyProbe::StampI420(id,
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				LatencyProbe::GetPatternSize() - 1, buffer->height()));
+		}
+
+		TEST_METHOD(LatencyProbe_Echo_Message_Round_Trip)
+		{
+			LatencyProbe::Id id = { 65535, 4294967295u };
+			std::string message = LatencyProbe::CreateEchoMessage(id);
+			Assert::AreEqual("{\"type\":\"latency-probe\",\"body\":\"65535,4294967295\"}",
+				message.c_str());
+
+			LatencyProbe::Id parsed = { 0 };
+			Assert::IsTrue(LatencyProbe::ParseEchoBody("65535,4294967295", &parsed));
+			Assert::IsTrue(id.sequence_number == parsed.sequence_number);
+			Assert::IsTrue(id.capture_time_us == parsed.capture_time_us);
+			Assert::IsFalse(LatencyProbe::ParseEchoBody("65536,1", &parsed));
+			Assert::IsFalse(LatencyProbe::ParseEchoBody("1,", &parsed));
+			Assert::IsFalse(LatencyProbe::ParseEchoBody("1", &parsed));
+
+			// Wraps around the 32-bit clock.
+			LatencyProbe::Id wrapped = { 0, 0xFFFFFF00 };
+			Assert::IsTrue(((int64_t)0x200) == LatencyProbe::GetLatencyUs(wrapped, 0x100));
+		}
+
+		TEST_METHOD(LatencyProbe_Loopback_Measures_Every_Frame)
+		{
+			// The capturer stamps a copy, the caller's frame is left untouched.
+			rtc::scoped_refptr<webrtc::I420Buffer> source = CreateGradientBuffer(320, 240);
+			std::vector<uint8_t> source_y(source->DataY(),
+				source->DataY() + source->StrideY() * source->height());
+
+			LatencyProbeDetector detector;
+			{
+				MemoryBufferCapturer capturer;
+				capturer.EnableSoftwareEncoder();
+				capturer.EnableLatencyProbe();
+				capturer.AddOrUpdateSink(&detector, rtc::VideoSinkWants());
+				capturer.Start(cricket::VideoFormat(320, 240,
+					cricket::VideoFormat::FpsToInterval(60), cricket::FOURCC_I420));
+
+				for (int i = 0; i < 10; i++)
+				{
+					capturer.SendFrame(source->DataY(), source->StrideY(),
+						source->DataU(), source->StrideU(),
+						source->DataV(), source->StrideV(),
+						source->width(), source->height());
+				}
+
+				capturer.Stop();
+			}
+
+			Assert::IsTrue(source_y == std::vector<uint8_t>(source->DataY(),
+				source->DataY() + source->StrideY() * source->height()));
+
+			LatencyProbeDetector::Stats stats = detector.GetStats();
+			Assert::IsTrue(((uint64_t)10) == stats.frames_received);
+			Assert::IsTrue(((uint64_t)10) == stats.frames_detected);
+			Assert::IsTrue(((uint64_t)0) == stats.frames_missed);
+			Assert::IsTrue(stats.p50_latency_ms >= 0.0);
+			Assert::IsTrue(stats.max_latency_ms < 1000.0);
+
+			LatencyProbe::Id last_id = { 0 };
+			Assert::IsTrue(detector.GetLastId(&last_id));
+			Assert::IsTrue(9 == last_id.sequence_number);
+
+			// A re-sent frame isn't measured twice, a gap counts as missed.
+			detector.OnEcho(last_id);
+			last_id.sequence_number += 3;
+			detector.OnEcho(last_id);
+			stats = detector.GetStats();
+			Assert::IsTrue(((uint64_t)1) == stats.frames_repeated);
+			Assert::IsTrue(((uint64_t)2) == stats.frames_missed);
+		}
+	};
+}
@@ -0,0 +1,42 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "memory_buffer_capturer.h"
+
+#include "webrtc/api/video/i420_buffer.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	// Counts the releases of the caller's planes.
+	struct ReleaseCounter
+	{
+		int* count;
+
+		void operator()() { (*count)++; }
+	};
+
+	TEST_CLASS(MemoryBufferCapturerTests)
+	{
+	public:
+
+		TEST_METHOD(MemoryCapturer_Releases_Planes_When_Stopped)
+		{
+			rtc::scoped_refptr<webrtc::I420Buffer> source = webrtc::I420Buffer::Create(64, 64);
+			webrtc::I420Buffer::SetBlack(source.get());
+
+			int release_count = 0;
+			ReleaseCounter counter = { &release_count };
+			MemoryBufferCapturer capturer;
+			capturer.SendFrame(source->DataY(), source->StrideY(),
+				source->DataU(), source->StrideU(),
+				source->DataV(), source->StrideV(),
+				source->width(), source->height(), -1,
+				rtc::Callback0<void>(counter));
+
+			Assert::AreEqual(1, release_count);
+		}
+	};
+}
@@ -0,0 +1,94 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "null_video_encoder.h"
+
+#include "webrtc/api/video/i420_buffer.h"
+#include "webrtc/common_video/h264/h264_common.h"
+#include "webrtc/common_video/h264/sps_parser.h"
+#include "webrtc/media/base/mediaconstants.h"
+#include "webrtc/modules/video_coding/include/video_error_codes.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	// Keeps the NAL unit types and the SPS of the last encoded frame.
+	class NalUnitRecorder : public webrtc::EncodedImageCallback
+	{
+	public:
+		webrtc::EncodedImageCallback::Result OnEncodedImage(
+			const webrtc::EncodedImage& encoded_image,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const webrtc::RTPFragmentationHeader* fragmentation) override
+		{
+			nal_types.clear();
+			for (size_t i = 0; i < fragmentation->fragmentationVectorSize; i++)
+			{
+				const uint8_t* nal_unit = encoded_image._buffer +
+					fragmentation->fragmentationOffset[i];
+
+				nal_types.push_back(webrtc::H264::ParseNaluType(nal_unit[0]));
+				if (nal_types.back() == webrtc::H264::kSps)
+				{
+					sps = webrtc::SpsParser::ParseSps(
+						nal_unit + webrtc::H264::kNaluTypeSize,
+						fragmentation->fragmentationLength[i] - webrtc::H264::kNaluTypeSize);
+				}
+			}
+
+			return webrtc::EncodedImageCallback::Result(
+				webrtc::EncodedImageCallback::Result::OK);
+		}
+
+		std::vector<webrtc::H264::NaluType> nal_types;
+		rtc::Optional<webrtc::SpsParser::SpsState> sps;
+	};
+
+	TEST_CLASS(NullVideoEncoderTests)
+	{
+	public:
+
+		TEST_METHOD(NullEncoder_Sends_Parameter_Sets_Before_Idr)
+		{
+			cricket::VideoCodec codec(cricket::kH264CodecName);
+			codec.SetParam(cricket::kH264FmtpPacketizationMode, "1");
+			NullVideoEncoder encoder(codec, 3000);
+			NalUnitRecorder recorder;
+			encoder.RegisterEncodeCompleteCallback(&recorder);
+
+			webrtc::VideoCodec codec_settings;
+			codec_settings.codecType = webrtc::kVideoCodecH264;
+			codec_settings.width = 1920;
+			codec_settings.height = 1080;
+			Assert::AreEqual(WEBRTC_VIDEO_CODEC_OK, encoder.InitEncode(&codec_settings, 1, 1200));
+
+			webrtc::VideoFrame frame(webrtc::I420Buffer::Create(16, 16), 0, 0,
+				webrtc::kVideoRotation_0);
+
+			encoder.Encode(frame, nullptr, nullptr);
+			Assert::IsTrue(((size_t)3) == recorder.nal_types.size());
+			Assert::IsTrue(recorder.nal_types[0] == webrtc::H264::kSps);
+			Assert::IsTrue(recorder.nal_types[1] == webrtc::H264::kPps);
+			Assert::IsTrue(recorder.nal_types[2] == webrtc::H264::kIdr);
+
+			// The macroblock padding is cropped.
+			Assert::IsTrue(static_cast<bool>(recorder.sps));
+			Assert::IsTrue(((uint32_t)1920) == recorder.sps->width);
+			Assert::IsTrue(((uint32_t)1080) == recorder.sps->height);
+
+			// Delta frames only carry slices.
+			encoder.Encode(frame, nullptr, nullptr);
+			Assert::IsTrue(((size_t)1) == recorder.nal_types.size());
+			Assert::IsTrue(recorder.nal_types[0] == webrtc::H264::kSlice);
+
+			// Requested key frames repeat the parameter sets.
+			std::vector<webrtc::FrameType> frame_types(1, webrtc::kVideoFrameKey);
+			encoder.Encode(frame, nullptr, &frame_types);
+			Assert::IsTrue(((size_t)3) == recorder.nal_types.size());
+			Assert::IsTrue(recorder.nal_types[0] == webrtc::H264::kSps);
+			Assert::IsTrue(recorder.nal_types[2] == webrtc::H264::kIdr);
+		}
+	};
+}
@@ -0,0 +1,180 @@
+#include "stdafx.h"
+#include "CppUnitTest.h"
+
+#include "qp_map_generator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace StreamingToolkit;
+
+namespace NativeServerPluginTests
+{
+	TEST_CLASS(QpMapGeneratorTests)
+	{
+	public:
+
+		TEST_METHOD(QpMap_Disabled_Returns_Null)
+		{
+			QpMapGenerator generator;
+
+			Assert::IsTrue(generator.GetMap(1280, 720) == nullptr);
+			Assert::IsTrue(((uint64_t)0) == generator.build_count());
+		}
+
+		TEST_METHOD(QpMap_Size_Rounds_Up_To_Macroblocks)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+
+			// 1280x720 is 80x45 macroblocks, 1282x722 needs one more of each.
+			Assert::IsTrue(((size_t)(80 * 45)) == generator.GetMap(1280, 720)->size());
+			Assert::IsTrue(((size_t)(81 * 46)) == generator.GetMap(1282, 722)->size());
+		}
+
+		TEST_METHOD(QpMap_Mono_Foveation)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+
+			// 10x6 macroblocks, focus on the view center.
+			auto map = generator.GetMap(160, 96);
+			const int8_t expected[] =
+			{
+				10, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+				10, 10, 10, 10,  9,  8,  9, 10, 10, 10,
+				10, 10, 10,  9,  5,  2,  5,  9, 10, 10,
+				10, 10, 10,  8,  2,  0,  2,  8, 10, 10,
+				10, 10, 10,  9,  5,  2,  5,  9, 10, 10,
+				10, 10, 10, 10,  9,  8,  9, 10, 10, 10,
+			};
+
+			Assert::IsTrue(std::vector<int8_t>(expected, expected + 60) == *map);
+		}
+
+		TEST_METHOD(QpMap_Stereo_Has_One_Focus_Per_Eye)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+			generator.SetStereo(true);
+
+			// Each eye is 5x6 macroblocks, the delta is mirrored across eyes.
+			auto map = generator.GetMap(160, 96);
+			for (int y = 0; y < 6; y++)
+			{
+				for (int x = 0; x < 5; x++)
+				{
+					Assert::AreEqual((*map)[y * 10 + x], (*map)[y * 10 + x + 5]);
+				}
+			}
+
+			Assert::AreEqual((int8_t)0, (*map)[3 * 10 + 2]);
+			Assert::AreEqual((int8_t)0, (*map)[3 * 10 + 7]);
+			Assert::AreEqual((int8_t)10, (*map)[0]);
+		}
+
+		TEST_METHOD(QpMap_Gaze_Moves_Focus)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+			generator.SetFocusPoint(0, 0.0, 0.0);
+
+			auto map = generator.GetMap(160, 96);
+			Assert::AreEqual((int8_t)0, (*map)[0]);
+			Assert::AreEqual((int8_t)10, (*map)[59]);
+		}
+
+		TEST_METHOD(QpMap_Stereo_Toggle_Resets_Focus)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+			generator.SetFocusPoint(0, 0.0, 0.0);
+			generator.SetStereo(false);
+			Assert::AreEqual((int8_t)0, (*generator.GetMap(160, 96))[0]);
+
+			generator.SetStereo(true);
+			generator.SetStereo(false);
+			auto map = generator.GetMap(160, 96);
+			Assert::AreEqual((int8_t)10, (*map)[0]);
+			Assert::AreEqual((int8_t)0, (*map)[3 * 10 + 5]);
+		}
+
+		TEST_METHOD(QpMap_Parses_Gaze_Body)
+		{
+			int eye = -1;
+			double x = -1.0;
+			double y = -1.0;
+			Assert::IsTrue(QpMapGenerator::ParseGazeBody("1,0.25,0.75", &eye, &x, &y));
+			Assert::AreEqual(1, eye);
+			Assert::AreEqual(0.25, x);
+			Assert::AreEqual(0.75, y);
+			Assert::IsFalse(QpMapGenerator::ParseGazeBody("1,0.25", &eye, &x, &y));
+			Assert::IsFalse(QpMapGenerator::ParseGazeBody("1,0.25,", &eye, &x, &y));
+			Assert::IsFalse(QpMapGenerator::ParseGazeBody("left,0.25,0.75", &eye, &x, &y));
+			Assert::IsFalse(QpMapGenerator::ParseGazeBody("1,0.25,0.75,0", &eye, &x, &y));
+		}
+
+		TEST_METHOD(QpMap_Regions_Override_Foveation)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+			generator.SetRegions({ { 0.0, 0.0, 0.2, 0.34, -5 }, { 0.0, 0.0, 0.1, 0.17, 20 } });
+
+			auto map = generator.GetMap(160, 96);
+			Assert::AreEqual((int8_t)20, (*map)[0]);
+			Assert::AreEqual((int8_t)-5, (*map)[1]);
+			Assert::AreEqual((int8_t)-5, (*map)[10]);
+			Assert::AreEqual((int8_t)-5, (*map)[11]);
+			Assert::AreEqual((int8_t)10, (*map)[2]);
+			Assert::AreEqual((int8_t)0, (*map)[35]);
+		}
+
+		TEST_METHOD(QpMap_Regions_Only)
+		{
+			QpMapGenerator generator;
+			generator.SetRegions({ { 0.5, 0.5, 0.5, 0.5, 51 } });
+
+			auto map = generator.GetMap(160, 96);
+			Assert::AreEqual((int8_t)0, (*map)[0]);
+			Assert::AreEqual((int8_t)51, (*map)[59]);
+		}
+
+		TEST_METHOD(QpMap_Deltas_Are_Clamped)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(100, 0.0, 0.0);
+			generator.SetRegions({ { 0.0, 0.0, 0.1, 0.17, -100 } });
+
+			auto map = generator.GetMap(160, 96);
+			Assert::AreEqual((int8_t)-51, (*map)[0]);
+			Assert::AreEqual((int8_t)51, (*map)[59]);
+		}
+
+		TEST_METHOD(QpMap_Cached_Until_Inputs_Change)
+		{
+			QpMapGenerator generator;
+			generator.SetFoveation(10, 0.1, 0.4);
+
+			auto map = generator.GetMap(160, 96);
+			Assert::IsTrue(map == generator.GetMap(160, 96));
+
+			// Gaze jitter within the focus macroblock keeps the map.
+			generator.SetFocusPoint(0, 0.52, 0.51);
+			Assert::IsTrue(map == generator.GetMap(160, 96));
+			Assert::IsTrue(((uint64_t)1) == generator.build_count());
+
+			generator.SetFocusPoint(0, 0.8, 0.5);
+			auto moved = generator.GetMap(160, 96);
+			Assert::IsTrue(map != moved);
+			Assert::IsTrue(((uint64_t)2) == generator.build_count());
+
+			generator.SetStereo(true);
+			generator.GetMap(160, 96);
+			generator.GetMap(320, 96);
+			generator.SetRegions({ { 0.0, 0.0, 1.0, 1.0, 1 } });
+			generator.GetMap(320, 96);
+			Assert::IsTrue(((uint64_t)5) == generator.build_count());
+
+			// Maps handed out earlier are never modified.
+			Assert::AreEqual((int8_t)0, (*map)[3 * 10 + 5]);
+		}
+	};
+}
@@ -0,0 +1,63 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "webrtc/base/criticalsection.h"
+#include "webrtc/media/base/videosourceinterface.h"
+
+namespace StreamingToolkit
+{
+	// Capturer-side replacement for the WebRTC video adapter. Follows the
+	// resolution and frame rate requested by the sink through VideoSinkWants,
+	// moving along a ladder of scale factors. Stepping down happens as soon as
+	// the sink asks for fewer pixels, stepping up waits for the hysteresis
+	// interval since the last change and moves one step at a time.
+	class AdaptationController
+	{
+	public:
+		AdaptationController();
+
+		// |ladder| lists the scale factors applied to the captured frame size,
+		// from the largest to the smallest. An empty ladder disables resolution
+		// adaptation.
+		void SetLadder(const std::vector<double>& ladder, int hysteresis_ms);
+
+		void OnSinkWants(const rtc::VideoSinkWants& wants);
+
+		// Returns false if the frame should be dropped to match the requested
+		// frame rate, otherwise the size the frame should be scaled to.
+		bool AdaptFrame(int width, int height, int64_t time_ms,
+			int* out_width, int* out_height);
+
+		// Index of the current ladder step, 0 being full resolution.
+		int current_step() const;
+
+		uint64_t frames_dropped() const;
+
+	private:
+		// Returns the largest step that fits within the sink wants.
+		int GetWantedStep(int width, int height) const;
+
+		std::vector<double> ladder_;
+		int hysteresis_ms_;
+		int max_pixel_count_;
+		int target_pixel_count_;
+		int max_framerate_fps_;
+		int current_step_;
+		int64_t last_step_change_ms_;
+		int64_t next_frame_time_ms_;
+		uint64_t frames_dropped_;
+		rtc::CriticalSection lock_;
+	};
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "webrtc/media/base/codec.h"
+#include "webrtc/video_encoder.h"
+
+namespace webrtc
+{
+	class H264EncoderImpl;
+}
+
+namespace StreamingToolkit
+{
+	// Encoder handed out by EncoderBackendFactory, whatever the backend.
+	class BackendVideoEncoder : public webrtc::VideoEncoder
+	{
+	public:
+		// Reports that the receiver lost the frame with |rtp_timestamp|, or one
+		// sent after it. Encoders that can stop referencing these frames do so
+		// instead of sending a key frame, the others ignore it. May be called
+		// from any thread.
+		virtual void ReportFrameLoss(uint32_t rtp_timestamp) {}
+	};
+
+	// NVENC and OpenH264 backends, both served by the patched H264EncoderImpl.
+	class H264BackendEncoder : public BackendVideoEncoder
+	{
+	public:
+		explicit H264BackendEncoder(const cricket::VideoCodec& codec);
+
+		~H264BackendEncoder() override;
+
+		int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+			int32_t number_of_cores,
+			size_t max_payload_size) override;
+
+		int32_t RegisterEncodeCompleteCallback(
+			webrtc::EncodedImageCallback* callback) override;
+
+		int32_t Release() override;
+
+		int32_t Encode(const webrtc::VideoFrame& frame,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const std::vector<webrtc::FrameType>* frame_types) override;
+
+		int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override;
+
+		int32_t SetRateAllocation(const webrtc::BitrateAllocation& allocation,
+			uint32_t framerate) override;
+
+		int32_t SetPeriodicKeyFrames(bool enable) override;
+
+		webrtc::VideoEncoder::ScalingSettings GetScalingSettings() const override;
+
+		const char* ImplementationName() const override;
+
+		// See H264EncoderImpl::ReportFrameLoss().
+		void ReportFrameLoss(uint32_t rtp_timestamp) override;
+
+	private:
+		std::unique_ptr<webrtc::H264EncoderImpl> encoder_;
+	};
+}
@@ -27,6 +27,15 @@
 #include "webrtc/typedefs.h"
 
 #include "libyuv/convert.h"
+#include "libyuv/scale.h"
+
+#include "adaptation_controller.h"
+#include "capture_pipeline.h"
+#include "frame_buffer_pool.h"
+#include "frame_change_detector.h"
+#include "frame_converter.h"
+#include "frame_timing.h"
+#include "latency_probe.h"
 
 using namespace webrtc;
 
@@ -52,6 +61,7 @@ namespace StreamingToolkit
 
 		~BufferCapturer()
 		{
+			DisableCapturePipeline();
 			SignalDestroyed(this);
 		}
 
@@ -69,17 +79,114 @@ namespace StreamingToolkit
 		void RemoveSink(rtc::VideoSinkInterface<VideoFrame>* sink) override;
 		void EnableSoftwareEncoder(bool use_software_encoder = true);
 
+		void SetConversionThreadCount(int thread_count);
+
+		// Converts and delivers frames on a dedicated capture thread instead of
+		// the caller's thread, queuing up to |queue_depth| frames.
+		void EnableCapturePipeline(int queue_depth,
+			CapturePipeline::DropPolicy drop_policy = CapturePipeline::kDropOldest);
+
+		// Waits for the frame being captured and discards the queued ones.
+		void DisableCapturePipeline();
+
+		// Returns zeroed stats while the capture pipeline is disabled.
+		CapturePipeline::Stats GetCapturePipelineStats() const;
+
+		// Skips conversion and encoding of frames identical to the previous
+		// one. Unchanged frames are dropped, or the previous frame is re-sent
+		// every |keep_alive_interval_ms| when non-zero. Only frames read back
+		// on the CPU (software encoding) are checked.
+		void SkipUnchangedFrames(bool skip_unchanged_frames, int keep_alive_interval_ms = 0);
+
+		const FrameChangeDetector& frame_change_detector() const { return frame_change_detector_; }
+
+		// Sets the scale factors used to follow the resolution requested by
+		// the sink, see AdaptationController. Only frames converted on the CPU
+		// are scaled, frame rate requests apply to every frame. Capturers
+		// feeding a hardware encoder should pass an empty ladder, otherwise
+		// the ladder steps without any frame being scaled.
+		void SetAdaptationLadder(const std::vector<double>& ladder, int hysteresis_ms);
+
+		const AdaptationController& adaptation_controller() const { return adaptation_controller_; }
+
+		const FrameBufferPool& frame_buffer_pool() const { return frame_buffer_pool_; }
+
+		// Also delivers every frame to |sink|, before adaptation, see
+		// FrameRecorder. Frames are only recorded with software encoding since
+		// the hardware encoder reads the staging texture instead of the frame
+		// buffer. Null detaches the sink.
+		void SetRecordingSink(rtc::VideoSinkInterface<VideoFrame>* sink);
+
+		// Stamps a frame ID and the capture time into the top-left corner of
+		// every frame, see LatencyProbe. Frames are stamped after adaptation,
+		// on a copy of the frame buffer. Only software-encoded frames are
+		// stamped, the hardware encoder reads the staging texture.
+		void EnableLatencyProbe(bool enable_latency_probe = true);
+
 		sigslot::signal1<BufferCapturer*> SignalDestroyed;
 
 	protected:
 		virtual void Initialize(bool headless = false, int width = 0, int height = 0) = 0;
 		virtual void SendFrame(webrtc::VideoFrame video_frame);
 
-		Clock* const clock_;
+		// Returns the time stamp of a frame submitted now, in system clock
+		// nanoseconds.
+		int64_t OnFrameSubmitted();
+
+		// Returns the NTP capture time in milliseconds of a frame submitted at
+		// |time_stamp|. ViEEncoder keeps it and derives the RTP timestamp from
+		// it, so it identifies the frame in FrameTimingRecorder up to the
+		// network.
+		static int64_t GetCaptureNtpTimeMs(int64_t time_stamp);
+
+		// Runs |task| on the capture thread if the pipeline is enabled,
+		// otherwise runs it immediately.
+		void RunCaptureTask(const CapturePipeline::Task& task);
+
+		// Frame buffers are created on the thread running the capture tasks,
+		// the pools are released whenever that thread changes.
+		void ReleaseFrameBufferPools();
+
+		// Returns true if unchanged frames are skipped and this packed 32-bit
+		// frame matches the previous one.
+		bool IsFrameUnchanged(const uint8_t* data, int stride, int width, int height);
+
+		// Returns the previous frame buffer if the keep-alive interval has
+		// elapsed, null if the unchanged frame should be dropped.
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> GetKeepAliveFrameBuffer();
+
+		// Converts a packed 32-bit frame to I420. Bytes are in RGBA order, or BGRA if |bgra| is set.
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> ConvertPackedFrame(
+			const uint8_t* data, int stride, bool bgra, int width, int height);
+
+		// Keeps the converted frame buffer for keep-alive and records the
+		// conversion time.
+		void OnFrameConverted(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer,
+			int64_t conversion_time_us);
+
+		// Returns a copy of |video_frame| stamped with the next latency probe
+		// ID. |buffer| is stamped in place instead if set, it must hold the
+		// frame and belong to the capturer.
+		webrtc::VideoFrame StampLatencyProbe(const webrtc::VideoFrame& video_frame,
+			rtc::scoped_refptr<webrtc::I420Buffer> buffer);
+
 		bool use_software_encoder_;
 		bool running_;
 		rtc::VideoSinkInterface<VideoFrame>* sink_;
 		SinkWantsObserver* sink_wants_observer_;
+		rtc::VideoSinkInterface<VideoFrame>* recording_sink_;
+		FrameBufferPool frame_buffer_pool_;
+		FrameConverter frame_converter_;
+		std::unique_ptr<CapturePipeline> capture_pipeline_;
+		FrameChangeDetector frame_change_detector_;
+		AdaptationController adaptation_controller_;
+		FrameBufferPool scaled_frame_buffer_pool_;
+		bool skip_unchanged_frames_;
+		int keep_alive_interval_ms_;
+		int64_t last_frame_time_ms_;
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> last_frame_buffer_;
+		bool latency_probe_enabled_;
+		uint16_t latency_probe_sequence_number_;
 		rtc::CriticalSection lock_;
 	};
 }
@@ -0,0 +1,93 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace StreamingToolkit
+{
+	// Moves frame conversion and delivery off the render thread. The render
+	// thread pushes capture tasks into a bounded queue and a dedicated capture
+	// thread runs them in order.
+	class CapturePipeline
+	{
+	public:
+		typedef std::function<void()> Task;
+
+		// What to do when a task is pushed into a full queue.
+		enum DropPolicy
+		{
+			// Discards the queued task that has waited the longest.
+			kDropOldest = 0,
+
+			// Discards the task being pushed.
+			kDropNewest
+		};
+
+		struct Stats
+		{
+			// Number of tasks currently waiting in the queue.
+			size_t queue_depth;
+
+			// Number of tasks that completed on the capture thread.
+			uint64_t frames_delivered;
+
+			// Number of tasks discarded because the queue was full.
+			uint64_t frames_dropped;
+
+			// Time between the push and the end of the task, in microseconds.
+			int64_t last_latency_us;
+			int64_t average_latency_us;
+			int64_t max_latency_us;
+		};
+
+		CapturePipeline(size_t max_queue_depth, DropPolicy drop_policy);
+
+		// Discards pending tasks and waits for the running one to complete.
+		~CapturePipeline();
+
+		// Returns false if a task has been dropped to make room.
+		bool Push(const Task& task);
+
+		Stats GetStats() const;
+
+		size_t max_queue_depth() const { return max_queue_depth_; }
+
+		DropPolicy drop_policy() const { return drop_policy_; }
+
+	private:
+		struct Entry
+		{
+			Task task;
+			std::chrono::steady_clock::time_point enqueue_time;
+		};
+
+		void Run();
+
+		const size_t max_queue_depth_;
+		const DropPolicy drop_policy_;
+		std::deque<Entry> queue_;
+		mutable std::mutex mutex_;
+		std::condition_variable task_ready_;
+		bool stopping_;
+		uint64_t frames_delivered_;
+		uint64_t frames_dropped_;
+		int64_t total_latency_us_;
+		int64_t last_latency_us_;
+		int64_t max_latency_us_;
+		std::thread thread_;
+	};
+}
@@ -19,6 +19,8 @@
 
 #include "buffer_capturer.h"
 #include "config_parser.h"
+#include "encoder_backend.h"
+#include "frame_loss_detector.h"
 #include "input_data_channel_observer.h"
 #include "main_window.h"
 #include "peer_connection_client.h"
@@ -26,11 +28,13 @@
 
 #include "webrtc/api/mediastreaminterface.h"
 #include "webrtc/api/peerconnectioninterface.h"
+#include "webrtc/base/messagehandler.h"
 
 class Conductor : public PeerConnectionObserver,
 	public CreateSessionDescriptionObserver,
     public PeerConnectionClientObserver,
-	public MainWindowCallback
+	public MainWindowCallback,
+	public rtc::MessageHandler
 {
 public:
 	enum CallbackID 
@@ -57,6 +61,15 @@ public:
 
 	void SetInputDataHandler(StreamingToolkit::InputDataHandler* handler);
 
+	// Encodes the video stream with |backend| instead of the encoder built
+	// into WebRTC. Takes effect for the next peer connection.
+	void SetEncoderBackend(StreamingToolkit::EncoderBackend backend,
+		size_t null_encoder_frame_size = 0);
+
+	// Hands out encoder sessions from |pool| instead of creating one per
+	// peer connection. Requires SetEncoderBackend().
+	void SetEncoderSessionPool(std::shared_ptr<StreamingToolkit::EncoderSessionPool> pool);
+
 	//-------------------------------------------------------------------------
 	// MainWindowCallback implementation.
 	//-------------------------------------------------------------------------
@@ -139,6 +152,9 @@ protected:
 
 	void UIThreadCallback(int msg_id, void* data) override;
 
+	// rtc::MessageHandler implementation.
+	void OnMessage(rtc::Message* msg) override;
+
 	// CreateSessionDescriptionObserver implementation.
 	void OnSuccess(webrtc::SessionDescriptionInterface* desc) override;
 
@@ -155,6 +171,14 @@ private:
 
 	void StreamRemoved(webrtc::MediaStreamInterface* stream);
 
+	// Requests the send statistics of the peer connection, which
+	// OnFrameLossStats() receives, every FRAME_LOSS_POLL_INTERVAL_MS.
+	void PollFrameLoss();
+
+	// Reports a frame loss to |encoder_factory_| when |frame_loss_detector_|
+	// finds loss the receiver couldn't recover from.
+	void OnFrameLossStats(const webrtc::StatsReports& reports);
+
 	int peer_id_;
 	bool loopback_;
 	bool is_closing_;
@@ -175,6 +199,17 @@ private:
 	std::string server_;
 	std::string turn_username_;
 	std::string turn_password_;
+
+	bool has_encoder_backend_;
+	StreamingToolkit::EncoderBackend encoder_backend_;
+	size_t null_encoder_frame_size_;
+	std::shared_ptr<StreamingToolkit::EncoderSessionPool> encoder_session_pool_;
+
+	// Owned by |peer_connection_factory_|.
+	StreamingToolkit::EncoderBackendFactory* encoder_factory_;
+	StreamingToolkit::FrameLossDetector frame_loss_detector_;
+	std::unique_ptr<rtc::Thread> network_thread_;
+	std::unique_ptr<rtc::Thread> worker_thread_;
 };
 
 #endif // WEBRTC_CONDUCTOR_H_
@@ -11,10 +11,14 @@
 #pragma once
 
 #include <d3d11_4.h>
+#include <memory>
+#include <vector>
 #include <wrl\client.h>
 #include <wrl\wrappers\corewrappers.h>
 
 #include "buffer_capturer.h"
+#include "config_parser.h"
+#include "qp_map_generator.h"
 
 namespace StreamingToolkit
 {
@@ -24,10 +28,14 @@ namespace StreamingToolkit
 	public:
 		explicit DirectXBufferCapturer(ID3D11Device* d3d_device);
 
-		virtual ~DirectXBufferCapturer() {}
+		virtual ~DirectXBufferCapturer();
 
 		void Initialize(bool headless = false, int width = 0, int height = 0) override;
 
+		// Applies the capture, adaptation, foveation and latency probe settings
+		// of the encoder config.
+		void ApplyConfig(const NvEncConfig& config);
+
 		void SendFrame(int64_t prediction_time_stamp = -1);
 
 		void SendFrame(ID3D11Texture2D* frame_buffer, int64_t prediction_time_stamp = -1);
@@ -38,17 +46,35 @@ namespace StreamingToolkit
 
 		ID3D11RenderTargetView* GetRenderTargetView() { return render_texture_rtv_.Get(); }
 
+		// Controls the QP delta maps applied by the NVIDIA encoder, settings
+		// take effect on the next encoded frame.
+		QpMapGenerator* GetQpMapGenerator() { return qp_map_generator_.get(); }
+
 	private:
-		void UpdateStagingBuffer(ID3D11Texture2D* frame_buffer);
+		// Free staging buffers of the current size. Staging buffers held by
+		// frames return here once the encoder is done with them, possibly
+		// after the capturer has been destroyed.
+		struct StagingBufferList
+		{
+			D3D11_TEXTURE2D_DESC desc;
+			std::vector<Microsoft::WRL::ComPtr<ID3D11Texture2D>> buffers;
+			rtc::CriticalSection lock;
+		};
+
+		// Converts and sends the staging frame buffer, runs on the capture
+		// thread when the capture pipeline is enabled.
+		void SendStagingBuffer(std::shared_ptr<ID3D11Texture2D> staging_frame_buffer,
+			int64_t time_stamp, int64_t prediction_time_stamp);
 
-		void UpdateStagingBuffer(ID3D11Texture2D* left_frame_buffer, ID3D11Texture2D* right_frame_buffer);
+		// Takes a staging buffer from the free list, or creates one.
+		std::shared_ptr<ID3D11Texture2D> AcquireStagingBuffer(DXGI_FORMAT format, UINT width, UINT height);
 
 		bool headless_;
 		Microsoft::WRL::ComPtr<ID3D11Device> d3d_device_;
 		Microsoft::WRL::ComPtr<ID3D11DeviceContext> d3d_context_;
-		Microsoft::WRL::ComPtr<ID3D11Texture2D> staging_frame_buffer_;
 		Microsoft::WRL::ComPtr<ID3D11Texture2D> render_texture_;
 		Microsoft::WRL::ComPtr<ID3D11RenderTargetView> render_texture_rtv_;
-		D3D11_TEXTURE2D_DESC staging_frame_buffer_desc_;
+		std::shared_ptr<StagingBufferList> staging_frame_buffers_;
+		std::shared_ptr<QpMapGenerator> qp_map_generator_;
 	};
 }
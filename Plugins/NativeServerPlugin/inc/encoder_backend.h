@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "backend_video_encoder.h"
+#include "config_parser.h"
+#include "encoder_session_pool.h"
+#include "plugindefs.h"
+
+#include "webrtc/base/criticalsection.h"
+#include "webrtc/media/base/codec.h"
+#include "webrtc/media/engine/webrtcvideoencoderfactory.h"
+
+namespace StreamingToolkit
+{
+	enum EncoderBackend
+	{
+		// NVIDIA hardware encoder fed with the staged frame texture.
+		kEncoderBackendNvenc,
+
+		// OpenH264 fed with frames converted on the CPU.
+		kEncoderBackendSoftware,
+
+		// Fixed-size fake NAL units, see NullVideoEncoder.
+		kEncoderBackendNull
+	};
+
+	// External encoder factory handing out H.264 encoders of a single
+	// backend, so that the backend is picked by configuration rather than by
+	// the patched WebRTC encoder. With a session pool, the encoders take
+	// their sessions from the pool, see EncoderSessionPool.
+	class EncoderBackendFactory : public cricket::WebRtcVideoEncoderFactory
+	{
+	public:
+		explicit EncoderBackendFactory(EncoderBackend backend,
+			size_t null_frame_size = NULL_ENCODER_FRAME_SIZE,
+			std::shared_ptr<EncoderSessionPool> session_pool = nullptr);
+
+		// Returns the backend named by |config.encoder_backend|. Falls back to
+		// |config.use_software_encoding| when the name is empty or unknown.
+		static EncoderBackend GetConfiguredBackend(const NvEncConfig& config);
+
+		static const char* GetBackendName(EncoderBackend backend);
+
+		// Returns a pool of |config.encoder_pool_size| sessions per warmed up
+		// resolution, or null when pooling is disabled.
+		static std::shared_ptr<EncoderSessionPool> CreateSessionPool(
+			EncoderBackend backend, const NvEncConfig& config);
+
+		// Codec settings an encoder of the given size is warmed up with.
+		static webrtc::VideoCodec GetCodecSettings(int width, int height, int max_framerate);
+
+		// Creates an encoder of |backend| without going through the pool.
+		static BackendVideoEncoder* CreateBackendEncoder(EncoderBackend backend,
+			const cricket::VideoCodec& codec, size_t null_frame_size);
+
+		EncoderBackend backend() const { return backend_; }
+
+		// Reports to the encoders handed out that the receiver lost the frame
+		// with |rtp_timestamp|, or one sent after it, see
+		// BackendVideoEncoder::ReportFrameLoss(). May be called from any thread.
+		void ReportFrameLoss(uint32_t rtp_timestamp);
+
+		webrtc::VideoEncoder* CreateVideoEncoder(const cricket::VideoCodec& codec) override;
+
+		const std::vector<cricket::VideoCodec>& supported_codecs() const override;
+
+		void DestroyVideoEncoder(webrtc::VideoEncoder* encoder) override;
+
+	private:
+		static cricket::VideoCodec GetH264Codec();
+
+		const EncoderBackend backend_;
+		const size_t null_frame_size_;
+		const std::shared_ptr<EncoderSessionPool> session_pool_;
+		std::vector<cricket::VideoCodec> supported_codecs_;
+
+		// H.264 encoders handed out and not destroyed yet.
+		std::map<webrtc::VideoEncoder*, BackendVideoEncoder*> encoders_;
+		rtc::CriticalSection encoders_lock_;
+	};
+}
@@ -0,0 +1,194 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "backend_video_encoder.h"
+
+#include "webrtc/common_types.h"
+
+namespace StreamingToolkit
+{
+	// Pool of initialized encoders keyed by codec type and resolution.
+	//
+	// Initializing a hardware encoder opens an NVENC session, allocates its
+	// I/O buffers and registers the input textures, which delays the first
+	// frame of every new peer connection. The pool initializes sessions at
+	// startup on a background thread and hands them out on connect. On
+	// disconnect a session goes back to the pool instead of being released.
+	//
+	// A pooled encoder gets InitEncode() again when it's handed out, the
+	// encoder is expected to keep its session when the resolution matches
+	// and only reset its per-stream state. Sessions idle for longer than
+	// the idle timeout are released, except the warmed ones of each key.
+	class EncoderSessionPool
+	{
+	public:
+		typedef std::function<BackendVideoEncoder*()> EncoderFactory;
+
+		// |warm_sessions| sessions are kept per warmed up key.
+		EncoderSessionPool(EncoderFactory create_encoder, size_t warm_sessions,
+			int64_t idle_timeout_ms);
+
+		~EncoderSessionPool();
+
+		// Starts initializing sessions for |codec_settings| in the background.
+		void WarmUp(const webrtc::VideoCodec& codec_settings);
+
+		// Blocks until the background warm up is done.
+		void WaitForWarmUp();
+
+		// Returns an initialized encoder for the key of |codec_settings|, or
+		// null when the pool has none.
+		std::unique_ptr<BackendVideoEncoder> Acquire(
+			const webrtc::VideoCodec& codec_settings);
+
+		// Takes back an encoder initialized with |codec_settings|.
+		void Return(const webrtc::VideoCodec& codec_settings,
+			std::unique_ptr<BackendVideoEncoder> encoder);
+
+		BackendVideoEncoder* CreateEncoder() { return create_encoder_(); }
+
+		// Releases idle sessions past the timeout, also done on every
+		// Acquire() and Return().
+		void EvictIdleSessions(int64_t now_ms);
+
+		// Logs the time from InitEncode() to the first encoded frame.
+		void ReportTimeToFirstFrame(int64_t elapsed_ms, bool pooled);
+
+		// Average time to first frame of pooled and of newly created sessions,
+		// -1 when none was reported.
+		int64_t average_pooled_time_to_first_frame_ms() const;
+		int64_t average_cold_time_to_first_frame_ms() const;
+
+		uint64_t hit_count() const;
+		uint64_t miss_count() const;
+		size_t idle_count() const;
+
+	private:
+		struct SessionKey
+		{
+			webrtc::VideoCodecType codec_type;
+			int width;
+			int height;
+
+			bool operator==(const SessionKey& other) const
+			{
+				return codec_type == other.codec_type &&
+					width == other.width && height == other.height;
+			}
+		};
+
+		struct IdleSession
+		{
+			SessionKey key;
+			std::unique_ptr<BackendVideoEncoder> encoder;
+			int64_t idle_since_ms;
+		};
+
+		static SessionKey GetKey(const webrtc::VideoCodec& codec_settings);
+
+		bool IsWarmKey(const SessionKey& key) const;
+
+		// Moves the sessions to evict into |evicted|, |mutex_| must be held.
+		void CollectIdleSessions(int64_t now_ms, std::list<IdleSession>* evicted);
+
+		// Releases |sessions| outside of the lock.
+		static void ReleaseSessions(std::list<IdleSession>* sessions);
+
+		void WarmUpThread();
+
+		const EncoderFactory create_encoder_;
+		const size_t warm_sessions_;
+		const int64_t idle_timeout_ms_;
+
+		mutable std::mutex mutex_;
+		std::condition_variable warm_up_done_;
+		std::list<IdleSession> idle_sessions_;
+		std::vector<webrtc::VideoCodec> warm_up_requests_;
+		std::vector<SessionKey> warm_keys_;
+		std::thread warm_up_thread_;
+		bool warming_up_;
+		bool stopping_;
+		uint64_t hit_count_;
+		uint64_t miss_count_;
+		int64_t pooled_first_frame_total_ms_;
+		uint64_t pooled_first_frame_count_;
+		int64_t cold_first_frame_total_ms_;
+		uint64_t cold_first_frame_count_;
+	};
+
+	// Encoder handed out by EncoderBackendFactory when pooling is enabled.
+	// Takes an initialized session from the pool in InitEncode(), creating
+	// one only on a miss, and gives it back in Release().
+	class PooledVideoEncoder : public BackendVideoEncoder,
+		public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit PooledVideoEncoder(std::shared_ptr<EncoderSessionPool> pool);
+
+		~PooledVideoEncoder() override;
+
+		int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+			int32_t number_of_cores,
+			size_t max_payload_size) override;
+
+		int32_t RegisterEncodeCompleteCallback(
+			webrtc::EncodedImageCallback* callback) override;
+
+		int32_t Release() override;
+
+		int32_t Encode(const webrtc::VideoFrame& frame,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const std::vector<webrtc::FrameType>* frame_types) override;
+
+		int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override;
+
+		int32_t SetRateAllocation(const webrtc::BitrateAllocation& allocation,
+			uint32_t framerate) override;
+
+		int32_t SetPeriodicKeyFrames(bool enable) override;
+
+		webrtc::VideoEncoder::ScalingSettings GetScalingSettings() const override;
+
+		const char* ImplementationName() const override;
+
+		// Forwarded to the session in use, if any. May be called from any
+		// thread, the session isn't given back meanwhile.
+		void ReportFrameLoss(uint32_t rtp_timestamp) override;
+
+		// webrtc::EncodedImageCallback implementation.
+		webrtc::EncodedImageCallback::Result OnEncodedImage(
+			const webrtc::EncodedImage& encoded_image,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const webrtc::RTPFragmentationHeader* fragmentation) override;
+
+	private:
+		const std::shared_ptr<EncoderSessionPool> pool_;
+		std::unique_ptr<BackendVideoEncoder> encoder_;
+
+		// Only the encoder thread changes |encoder_|, the lock is taken there
+		// when it does and by ReportFrameLoss().
+		std::mutex encoder_mutex_;
+		webrtc::VideoCodec codec_settings_;
+		webrtc::EncodedImageCallback* callback_;
+		bool pooled_;
+		int64_t init_time_ms_;
+		bool first_frame_reported_;
+	};
+}
@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <set>
+
+#include "webrtc/api/video/i420_buffer.h"
+#include "webrtc/base/criticalsection.h"
+#include "webrtc/base/scoped_ref_ptr.h"
+#include "webrtc/common_video/include/i420_buffer_pool.h"
+
+namespace StreamingToolkit
+{
+	// webrtc::I420BufferPool with hit and miss counters. A buffer is free
+	// again once every consumer (e.g. the encoder) has released its
+	// reference, and buffers of a previous frame size are freed by their last
+	// consumer.
+	//
+	// Like webrtc::I420BufferPool, buffers must be created on a single
+	// thread. Release() lets the pool move to another thread.
+	class FrameBufferPool
+	{
+	public:
+		explicit FrameBufferPool(size_t max_number_of_buffers);
+
+		// Returns a free buffer of the requested size, allocating one if the
+		// pool has none. When the pool is full, an unpooled buffer is returned.
+		rtc::scoped_refptr<webrtc::I420Buffer> CreateBuffer(int width, int height);
+
+		// Drops all pooled buffers. Buffers still in use stay valid.
+		void Release();
+
+		// Number of requests served from the pool.
+		uint64_t hit_count() const;
+
+		// Number of requests that required an allocation.
+		uint64_t miss_count() const;
+
+		// Number of buffers currently owned by the pool.
+		size_t size() const;
+
+	private:
+		webrtc::I420BufferPool pool_;
+		int width_;
+		int height_;
+
+		// Buffers allocated by |pool_| for the current size, which it keeps
+		// until the size changes or it is released.
+		std::set<const webrtc::I420Buffer*> pooled_buffers_;
+		uint64_t hit_count_;
+		uint64_t miss_count_;
+		rtc::CriticalSection lock_;
+	};
+}
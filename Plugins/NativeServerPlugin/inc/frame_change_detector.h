@@ -0,0 +1,88 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "webrtc/base/criticalsection.h"
+
+namespace StreamingToolkit
+{
+	// Detects unchanged frames by hashing packed 32-bit frames per tile and
+	// comparing against the hashes of the previous frame. The per-tile dirty
+	// mask of the last frame is kept for later stages.
+	class FrameChangeDetector
+	{
+	public:
+		struct Stats
+		{
+			// Number of frames hashed.
+			uint64_t frames_checked;
+
+			// Number of unchanged frames that were not sent.
+			uint64_t frames_skipped;
+
+			// Number of unchanged frames re-sent as keep-alive.
+			uint64_t frames_resent;
+
+			// Total time spent hashing, in microseconds.
+			int64_t hash_time_us;
+
+			// Estimated conversion time avoided on unchanged frames, based on
+			// the average conversion time, in microseconds.
+			int64_t conversion_time_saved_us;
+		};
+
+		explicit FrameChangeDetector(int tile_size);
+
+		// Hashes the frame and updates the dirty mask. Returns false when no
+		// tile has changed since the previous frame.
+		bool Update(const uint8_t* data, int stride, int width, int height);
+
+		// Forgets the previous frame, the next one is reported as changed.
+		void Reset();
+
+		// Records the time taken to convert a changed frame.
+		void OnFrameConverted(int64_t conversion_time_us);
+
+		// Records an unchanged frame, either skipped or re-sent.
+		void OnFrameUnchanged(bool resent);
+
+		Stats GetStats() const;
+
+		// Returns one entry per tile in row-major order, non-zero for tiles
+		// that changed in the last frame.
+		std::vector<uint8_t> dirty_mask() const;
+
+		int tile_size() const { return tile_size_; }
+
+		int tile_columns() const;
+
+		int tile_rows() const;
+
+	private:
+		const int tile_size_;
+		int width_;
+		int height_;
+		int tile_columns_;
+		int tile_rows_;
+		std::vector<uint32_t> tile_hashes_;
+		std::vector<uint8_t> dirty_mask_;
+		uint64_t frames_checked_;
+		uint64_t frames_skipped_;
+		uint64_t frames_resent_;
+		uint64_t frames_converted_;
+		int64_t hash_time_us_;
+		int64_t conversion_time_us_;
+		rtc::CriticalSection lock_;
+	};
+}
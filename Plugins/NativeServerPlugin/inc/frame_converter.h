@@ -0,0 +1,61 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <memory>
+
+#include "worker_pool.h"
+
+namespace StreamingToolkit
+{
+	// Converts packed 32-bit frames to I420, splitting the frame into
+	// horizontal stripes that are converted in parallel. Stripes start on
+	// even rows so each chroma row is produced by exactly one stripe, which
+	// keeps the output identical to a single libyuv call.
+	class FrameConverter
+	{
+	public:
+		explicit FrameConverter(int thread_count = 1);
+
+		// Recreates the worker pool with |thread_count| threads, including the
+		// calling thread. Values lower than 1 disable threading.
+		void SetThreadCount(int thread_count);
+
+		int thread_count() const;
+
+		// Same contract as libyuv::ABGRToI420 (RGBA byte order).
+		int ABGRToI420(const uint8_t* src_frame, int src_stride_frame,
+			uint8_t* dst_y, int dst_stride_y,
+			uint8_t* dst_u, int dst_stride_u,
+			uint8_t* dst_v, int dst_stride_v,
+			int width, int height);
+
+		// Same contract as libyuv::ARGBToI420 (BGRA byte order).
+		int ARGBToI420(const uint8_t* src_frame, int src_stride_frame,
+			uint8_t* dst_y, int dst_stride_y,
+			uint8_t* dst_u, int dst_stride_u,
+			uint8_t* dst_v, int dst_stride_v,
+			int width, int height);
+
+	private:
+		typedef int (*ConvertToI420Func)(const uint8_t*, int,
+			uint8_t*, int, uint8_t*, int, uint8_t*, int, int, int);
+
+		int ConvertToI420(ConvertToI420Func convert,
+			const uint8_t* src_frame, int src_stride_frame,
+			uint8_t* dst_y, int dst_stride_y,
+			uint8_t* dst_u, int dst_stride_u,
+			uint8_t* dst_v, int dst_stride_v,
+			int width, int height);
+
+		std::unique_ptr<WorkerPool> worker_pool_;
+	};
+}
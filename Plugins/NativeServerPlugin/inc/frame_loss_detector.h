@@ -0,0 +1,51 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+namespace StreamingToolkit
+{
+	// Tells the frame loss the receiver couldn't recover from apart from the
+	// loss that retransmission repairs, from the send statistics polled by
+	// the conductor. NACKs alone don't count, the receiver sends them for
+	// every gap even when the retransmission arrives in time.
+	//
+	// A poll reports a loss when the receiver sent a PLI or FIR, or when its
+	// cumulative packet loss grew by more than |min_lost_packets| on
+	// |min_polls| consecutive polls. The RTCP cumulative loss counts the
+	// packets never received, so retransmitted packets don't add to it.
+	class FrameLossDetector
+	{
+	public:
+		// Cumulative counters of the video send stream.
+		struct Counters
+		{
+			int64_t plis;
+			int64_t firs;
+			int64_t packets_lost;
+		};
+
+		FrameLossDetector(int64_t min_lost_packets, int min_polls);
+
+		// Returns true when the receiver lost frames since the last report.
+		bool Update(const Counters& counters);
+
+		// Counters restart with each peer connection.
+		void Reset();
+
+	private:
+		const int64_t min_lost_packets_;
+		const int min_polls_;
+		Counters last_;
+		int lossy_polls_;
+	};
+}
@@ -0,0 +1,74 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Paces a render loop at a fixed frame rate using absolute deadlines on a
+	// monotonic clock. Waits sleep until shortly before the deadline and spin
+	// for the remainder. When a frame overruns, the missed slots are skipped
+	// rather than rendered back to back. After an idle period, such as a
+	// render loop waiting for a connection, the slots restart from the next
+	// frame instead.
+	class FramePacer
+	{
+	public:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Stats
+		{
+			// Number of frames paced.
+			uint64_t frames;
+
+			// Number of frame slots skipped because of overruns. Idle periods
+			// aren't counted.
+			uint64_t skipped_slots;
+
+			// Percentiles of the recent inter-frame intervals, in milliseconds.
+			double p50_interval_ms;
+			double p99_interval_ms;
+		};
+
+		explicit FramePacer(int fps);
+
+		~FramePacer();
+
+		// Changes the frame rate, restarting the deadlines from the next frame.
+		void SetFrameRate(int fps);
+
+		// Blocks until the next frame slot. Returns immediately if the current
+		// slot has already started.
+		void WaitForNextFrame();
+
+		Stats GetStats() const;
+
+	private:
+		void WaitUntil(Clock::time_point deadline);
+
+		// |resumed| frames end an idle period, the gap isn't an interval.
+		void RecordFrame(Clock::time_point time, bool resumed);
+
+		Clock::duration interval_;
+		Clock::time_point next_deadline_;
+		Clock::time_point last_frame_time_;
+		bool started_;
+		uint64_t frames_;
+		uint64_t skipped_slots_;
+		uint64_t interval_count_;
+		std::vector<int64_t> intervals_us_;
+		size_t next_interval_;
+		mutable std::mutex mutex_;
+	};
+}
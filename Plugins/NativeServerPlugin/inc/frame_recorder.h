@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif // _WIN32
+
+#include "webrtc/api/video/video_frame.h"
+#include "webrtc/media/base/videosinkinterface.h"
+
+namespace StreamingToolkit
+{
+	// Records captured frames to a Y4M file, see
+	// BufferCapturer::SetRecordingSink(). The capture thread only copies each
+	// frame into large aligned chunks, a flush thread writes the full chunks
+	// with unbuffered I/O so that a long recording doesn't evict the page
+	// cache. When the disk falls behind, whole frames are dropped instead of
+	// stalling the capture thread.
+	class FrameRecorder : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		struct Stats
+		{
+			// Number of frames queued for writing.
+			uint64_t frames_recorded;
+
+			// Number of frames dropped because no chunk was free, the frame
+			// size changed or the file couldn't be written.
+			uint64_t frames_dropped;
+
+			// Bytes written to the file so far, Y4M headers included.
+			uint64_t bytes_written;
+		};
+
+		FrameRecorder();
+
+		// Closes the file.
+		~FrameRecorder();
+
+		// Creates |path| and starts the flush thread. The frame size is taken
+		// from the first frame, |frame_rate| is only written to the header.
+		bool Open(const std::string& path, int frame_rate);
+
+		// Writes the pending frames and closes the file.
+		void Close();
+
+		bool is_open() const;
+
+		Stats GetStats() const;
+
+		// Copies |frame| as I420. Native frames are dropped.
+		void OnFrame(const webrtc::VideoFrame& frame) override;
+
+	private:
+		// Reserves room for |size| bytes across the current and free chunks.
+		bool Reserve(size_t size);
+
+		// Copies into the current chunk, queuing it whenever it fills up.
+		void Append(const uint8_t* data, size_t size);
+
+		void AppendPlane(const uint8_t* data, int stride, int width, int height);
+
+		// Flush thread.
+		void Run();
+
+		// Writes |size| bytes, a multiple of the alignment.
+		bool Write(const uint8_t* data, size_t size);
+
+		// Truncates the file to |size| bytes after the padded last write.
+		bool Truncate(uint64_t size);
+
+		void CloseFile();
+
+		std::vector<uint8_t*> chunks_;
+		std::vector<uint8_t*> free_chunks_;
+		std::deque<uint8_t*> full_chunks_;
+		uint8_t* current_chunk_;
+		size_t current_size_;
+		int frame_rate_;
+		int width_;
+		int height_;
+		bool failed_;
+		bool stopping_;
+		uint64_t frames_recorded_;
+		uint64_t frames_dropped_;
+		uint64_t bytes_queued_;
+		uint64_t bytes_written_;
+#ifdef _WIN32
+		HANDLE file_;
+#else
+		int file_;
+#endif // _WIN32
+		std::thread thread_;
+		std::condition_variable chunk_full_;
+
+		// Serializes frames with Open() and Close().
+		std::mutex frame_mutex_;
+
+		// Guards the chunk queues, stats and the flush thread state.
+		mutable std::mutex mutex_;
+	};
+}
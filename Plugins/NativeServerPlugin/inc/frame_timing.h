@@ -0,0 +1,156 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Timing points of a frame on its way from the renderer to the network.
+	enum FrameTimingStage
+	{
+		kFrameRenderSubmitted = 0,
+		kFrameStaged,
+		kFrameConverted,
+		kFrameEncoderIn,
+		kFrameEncoderOut,
+		kFramePacketized,
+		kFrameTimingStageCount
+	};
+
+	// Records per-frame timing points on a monotonic clock. Each recording
+	// thread writes into its own lock-free ring, which Collect() drains into
+	// per-stage latency histograms and a buffer of trace events that can be
+	// exported in the Chrome trace event format (chrome://tracing). While
+	// enabled, a collector thread drains the rings periodically so recording
+	// threads never pay for it.
+	//
+	// Frames are identified by the NTP capture time in milliseconds of their
+	// webrtc::VideoFrame, which ViEEncoder keeps, so stages outside of the
+	// capturer can be recorded from the frame alone.
+	class FrameTimingRecorder
+	{
+	public:
+		// Latency histogram of a stage relative to kFrameRenderSubmitted.
+		struct Histogram
+		{
+			// Upper bound in microseconds of each bucket, the last bucket
+			// being unbounded.
+			std::vector<int64_t> bucket_limits_us;
+			std::vector<uint64_t> counts;
+			uint64_t total_count;
+			int64_t max_us;
+
+			// Estimated from the bucket limits.
+			int64_t Percentile(int percentile) const;
+		};
+
+		static FrameTimingRecorder* Instance();
+
+		~FrameTimingRecorder();
+
+		// Starts or stops recording and the collector thread.
+		void SetEnabled(bool enabled);
+
+		bool enabled() const { return enabled_; }
+
+		// Records |stage| for |frame_id| on the calling thread. Never blocks,
+		// the event is dropped if the thread's ring is full.
+		void Record(int64_t frame_id, FrameTimingStage stage);
+
+		// Drains every thread ring into the histograms and the trace buffer.
+		void Collect();
+
+		// Collects and returns one histogram per stage. Histograms cover the
+		// frames recorded since the previous call with |reset| set.
+		std::vector<Histogram> GetHistograms(bool reset = false);
+
+		// Collects and writes the buffered trace events to |path|.
+		bool WriteChromeTrace(const std::string& path);
+
+		// Number of events dropped because a ring was full.
+		uint64_t dropped_events() const { return dropped_events_; }
+
+		// Number of thread rings. A ring is released by the first Collect()
+		// after its thread exits.
+		size_t GetThreadRingCount();
+
+		static const char* GetStageName(FrameTimingStage stage);
+
+	private:
+		struct Event
+		{
+			int64_t frame_id;
+			int64_t time_ns;
+			int stage;
+			int thread_index;
+		};
+
+		// Single-producer single-consumer ring written by one thread.
+		struct Ring
+		{
+			explicit Ring(int thread_index);
+
+			const int thread_index;
+			std::vector<Event> events;
+			std::atomic<uint64_t> write_index;
+			std::atomic<uint64_t> read_index;
+
+			// Set when the thread exits, after its last event.
+			std::atomic<bool> released;
+		};
+
+		// Marks the ring of a thread as released when the thread exits.
+		struct ThreadRing
+		{
+			~ThreadRing();
+
+			std::shared_ptr<Ring> ring;
+		};
+
+		struct FrameTimes
+		{
+			int64_t time_ns[kFrameTimingStageCount];
+			int thread_index[kFrameTimingStageCount];
+		};
+
+		FrameTimingRecorder();
+
+		Ring* GetThreadRing();
+
+		// Collector thread loop, runs until SetEnabled(false).
+		void RunCollector();
+
+		void AddToHistogram(int stage, int64_t latency_us);
+
+		std::atomic<bool> enabled_;
+		std::atomic<uint64_t> dropped_events_;
+		std::mutex rings_mutex_;
+		std::vector<std::shared_ptr<Ring>> rings_;
+		int next_thread_index_;
+		std::mutex collect_mutex_;
+		std::map<int64_t, FrameTimes> frames_;
+		std::vector<Histogram> histograms_;
+		std::deque<Event> trace_events_;
+		std::mutex collector_mutex_;
+		std::condition_variable collector_stop_;
+		std::thread collector_thread_;
+		bool collector_stopping_;
+	};
+}
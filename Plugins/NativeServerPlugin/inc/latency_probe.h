@@ -0,0 +1,133 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "webrtc/api/video/video_frame.h"
+#include "webrtc/media/base/videosinkinterface.h"
+
+namespace StreamingToolkit
+{
+	// Glass-to-glass latency probe. The capturer stamps a frame sequence
+	// number and the capture time into a block pattern in the top-left
+	// corner of each frame, see BufferCapturer::EnableLatencyProbe(). The
+	// blocks are aligned to H.264 macroblocks and read back by their mean
+	// luma, so the pattern survives lossy encoding.
+	//
+	// The pattern is a grid of LATENCY_PROBE_GRID_SIZE squared cells of
+	// LATENCY_PROBE_CELL_SIZE pixels: four reference cells (white, black,
+	// white, black), the 16-bit sequence number, the low 32 bits of the
+	// capture time in microseconds, an 8-bit CRC, then four more reference
+	// cells (black, white, black, white).
+	class LatencyProbe
+	{
+	public:
+		struct Id
+		{
+			uint16_t sequence_number;
+
+			// Low 32 bits of the system clock in microseconds, see GetTimeUs().
+			uint32_t capture_time_us;
+		};
+
+		// Width and height in pixels of the stamped corner.
+		static int GetPatternSize();
+
+		// Returns false if the frame is smaller than the pattern.
+		static bool StampI420(const Id& id, uint8_t* data_y, int stride_y,
+			uint8_t* data_u, int stride_u, uint8_t* data_v, int stride_v,
+			int width, int height);
+
+		// Reads the pattern from the luma plane. Returns false if there is no
+		// pattern or it doesn't pass the CRC.
+		static bool Detect(const uint8_t* data_y, int stride_y, int width, int height,
+			Id* id);
+
+		// Low 32 bits of the system clock in microseconds. Processes on the
+		// same machine, or on machines with synchronized clocks, share it.
+		static uint32_t GetTimeUs();
+
+		// Time elapsed from the capture of |id| to |time_us|. The 32-bit
+		// clock wraps every 71 minutes, which is harmless for latencies.
+		static int64_t GetLatencyUs(const Id& id, uint32_t time_us);
+
+		// Data channel message sent back by a client for an echoed latency
+		// measurement, {"type":"latency-probe","body":"<sequence>,<capture>"}.
+		static std::string CreateEchoMessage(const Id& id);
+
+		// Parses the body of an echo message.
+		static bool ParseEchoBody(const std::string& body, Id* id);
+	};
+
+	// Collects latency samples of probed frames. As a video sink, typically
+	// on the client after decoding, it detects the pattern of each frame and
+	// measures against the shared clock. On the server, OnEcho() measures
+	// the round trip of the IDs echoed by a client over the data channel,
+	// when the clocks aren't shared.
+	class LatencyProbeDetector : public rtc::VideoSinkInterface<webrtc::VideoFrame>
+	{
+	public:
+		struct Stats
+		{
+			// Number of frames passed to OnFrame().
+			uint64_t frames_received;
+
+			// Number of frames or echoes measured.
+			uint64_t frames_detected;
+
+			// Number of frames carrying the same ID as the previous one,
+			// re-sent unchanged frames for instance. They aren't measured.
+			uint64_t frames_repeated;
+
+			// Number of sequence numbers skipped between detected frames,
+			// frames dropped anywhere between the capturer and the detector.
+			uint64_t frames_missed;
+
+			// Percentiles of the recent latency samples, in milliseconds.
+			double p50_latency_ms;
+			double p90_latency_ms;
+			double p99_latency_ms;
+			double max_latency_ms;
+		};
+
+		LatencyProbeDetector();
+
+		// Detects the pattern of |frame| and measures its latency now.
+		void OnFrame(const webrtc::VideoFrame& frame) override;
+
+		// Measures the latency of an ID received now.
+		void OnEcho(const LatencyProbe::Id& id);
+
+		// Returns the ID of the last detected frame, false if none was.
+		bool GetLastId(LatencyProbe::Id* id) const;
+
+		Stats GetStats() const;
+
+		void Reset();
+
+	private:
+		void AddSample(const LatencyProbe::Id& id, uint32_t time_us);
+
+		uint64_t frames_received_;
+		uint64_t frames_detected_;
+		uint64_t frames_repeated_;
+		uint64_t frames_missed_;
+		bool has_last_id_;
+		LatencyProbe::Id last_id_;
+		std::vector<int64_t> latencies_us_;
+		size_t next_latency_;
+		mutable std::mutex mutex_;
+	};
+}
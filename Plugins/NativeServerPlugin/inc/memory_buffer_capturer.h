@@ -0,0 +1,62 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include "webrtc/base/callback.h"
+
+#include "buffer_capturer.h"
+
+namespace StreamingToolkit
+{
+	// Provides CPU memory implementation of the BufferCapturer class.
+	// Frame data is owned by the caller, which allows the streaming pipeline
+	// to run on hosts without a D3D11 device. Packed and NV12 frames are
+	// converted before SendFrame returns, even with the capture pipeline
+	// enabled, since the caller may reuse its memory afterwards.
+	class MemoryBufferCapturer : public BufferCapturer
+	{
+	public:
+		// Packed pixel formats, named by their byte order in memory.
+		enum PixelFormat
+		{
+			kPixelFormatRGBA = 0,
+			kPixelFormatBGRA
+		};
+
+		MemoryBufferCapturer();
+
+		virtual ~MemoryBufferCapturer() {}
+
+		void Initialize(bool headless = false, int width = 0, int height = 0) override;
+
+		// Sends a packed RGBA or BGRA frame, converting it to I420.
+		void SendFrame(const uint8_t* data, int stride, PixelFormat format,
+			int width, int height, int64_t prediction_time_stamp = -1);
+
+		// Sends an I420 frame without copying. The planes must stay valid until
+		// |no_longer_used| is invoked, which happens once every consumer has
+		// released the frame.
+		void SendFrame(const uint8_t* data_y, int stride_y,
+			const uint8_t* data_u, int stride_u,
+			const uint8_t* data_v, int stride_v,
+			int width, int height, int64_t prediction_time_stamp = -1,
+			const rtc::Callback0<void>& no_longer_used = rtc::Callback0<void>());
+
+		// Sends an NV12 frame, converting it to I420.
+		void SendFrame(const uint8_t* data_y, int stride_y,
+			const uint8_t* data_uv, int stride_uv,
+			int width, int height, int64_t prediction_time_stamp = -1);
+
+	private:
+		void DeliverFrame(rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer,
+			int64_t time_stamp, int64_t prediction_time_stamp);
+	};
+}
@@ -0,0 +1,75 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "backend_video_encoder.h"
+
+#include "webrtc/media/base/codec.h"
+#include "webrtc/modules/include/module_common_types.h"
+
+namespace StreamingToolkit
+{
+	// H.264 encoder stand-in that ignores the frame content and emits NAL
+	// units of a fixed total size per frame. Used to measure transport and
+	// signaling scaling on hosts without a GPU, where neither the conversion
+	// nor the encoding cost should show up. Key frames start with an SPS and
+	// a PPS describing the configured resolution, as receivers expect.
+	class NullVideoEncoder : public BackendVideoEncoder
+	{
+	public:
+		NullVideoEncoder(const cricket::VideoCodec& codec, size_t frame_size);
+
+		~NullVideoEncoder() override;
+
+		int32_t InitEncode(const webrtc::VideoCodec* codec_settings,
+			int32_t number_of_cores,
+			size_t max_payload_size) override;
+
+		int32_t RegisterEncodeCompleteCallback(
+			webrtc::EncodedImageCallback* callback) override;
+
+		int32_t Release() override;
+
+		int32_t Encode(const webrtc::VideoFrame& frame,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const std::vector<webrtc::FrameType>* frame_types) override;
+
+		int32_t SetChannelParameters(uint32_t packet_loss, int64_t rtt) override;
+
+		// Frames are never read, so native frames need no I420 conversion.
+		bool SupportsNativeHandle() const override { return true; }
+
+		const char* ImplementationName() const override;
+
+	private:
+		// Marks the slices in |buffer_| as IDR or non-IDR slices.
+		void WriteNalUnits(bool key_frame);
+
+		const size_t frame_size_;
+		webrtc::H264PacketizationMode packetization_mode_;
+		size_t max_payload_size_;
+		bool initialized_;
+		bool send_key_frame_;
+		webrtc::EncodedImage encoded_image_;
+
+		// The parameter sets followed by the slices. Delta frames start past
+		// the parameter sets.
+		std::unique_ptr<uint8_t[]> buffer_;
+		size_t buffer_size_;
+		size_t parameter_sets_size_;
+		webrtc::RTPFragmentationHeader key_fragmentation_;
+		webrtc::RTPFragmentationHeader fragmentation_;
+		webrtc::EncodedImageCallback* callback_;
+	};
+}
@@ -5,3 +5,63 @@
 
 #define MAX_ENCODE_QUEUE 32
 #define BITSTREAM_BUFFER_SIZE 2 * 1024 * 1024
+
+// Maximum number of recycled frame buffers kept by the capturer
+#define FRAME_BUFFER_POOL_SIZE 8
+
+// Minimum number of rows converted by a single worker thread
+#define MIN_CONVERSION_STRIPE_HEIGHT 16
+
+// Width and height in pixels of the tiles hashed to detect unchanged frames
+#define FRAME_CHANGE_TILE_SIZE 64
+
+// Time before a frame deadline spent spinning instead of sleeping
+#define FRAME_PACER_SPIN_THRESHOLD_US 1500
+
+// Number of inter-frame intervals kept for the frame pacer statistics
+#define FRAME_PACER_HISTORY_SIZE 600
+
+// Gap after a frame deadline treated as an idle render loop, not an overrun
+#define FRAME_PACER_IDLE_THRESHOLD_MS 1000
+
+// Number of events each thread can record before the frame timing is collected
+#define FRAME_TIMING_RING_SIZE 1024
+
+// Interval at which the frame timing recorder drains the thread rings
+#define FRAME_TIMING_COLLECT_INTERVAL_MS 100
+
+// Number of in-flight frames tracked by the frame timing recorder
+#define FRAME_TIMING_MAX_FRAMES 512
+
+// Number of events kept for the frame timing trace export
+#define FRAME_TIMING_TRACE_CAPACITY 65536
+
+// Interval at which the conductor checks the receiver's feedback for lost frames
+#define FRAME_LOSS_POLL_INTERVAL_MS 200
+
+// Packets lost per poll above which a poll counts toward a frame loss
+#define FRAME_LOSS_MIN_LOST_PACKETS 2
+
+// Number of consecutive lossy polls reported as a frame loss
+#define FRAME_LOSS_MIN_POLLS 2
+
+// Bytes per frame sent by the null encoder backend when not configured
+#define NULL_ENCODER_FRAME_SIZE 12000
+
+// Size in bytes of the chunks written by the frame recorder
+#define FRAME_RECORDER_CHUNK_SIZE (4 * 1024 * 1024)
+
+// Number of chunks the frame recorder can fill before dropping frames
+#define FRAME_RECORDER_CHUNK_COUNT 16
+
+// Alignment of unbuffered writes, a multiple of the disk sector size
+#define FRAME_RECORDER_WRITE_ALIGNMENT 4096
+
+// Width and height in pixels of the latency probe cells, a macroblock
+#define LATENCY_PROBE_CELL_SIZE 16
+
+// Number of latency probe cells per row and column
+#define LATENCY_PROBE_GRID_SIZE 8
+
+// Number of latency samples kept for the latency probe statistics
+#define LATENCY_PROBE_HISTORY_SIZE 600
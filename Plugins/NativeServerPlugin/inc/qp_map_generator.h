@@ -0,0 +1,114 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Builds per-macroblock QP delta maps, in the raster order expected by
+	// NV_ENC_PIC_PARAMS::qpDeltaMap. Each eye view has a focus point, the
+	// view center unless a gaze is reported. Macroblocks within the inner
+	// radius of the focus point keep the rate control QP, the delta then
+	// grows linearly up to the maximum at the outer radius. App-supplied
+	// regions override the foveation where they cover a macroblock.
+	//
+	// Maps are cached and only rebuilt when an input changes. Focus points
+	// are compared at macroblock precision, so small gaze jitter doesn't
+	// trigger rebuilds.
+	class QpMapGenerator
+	{
+	public:
+		// Side length of an H.264 macroblock in pixels.
+		static const int kMacroblockSize = 16;
+
+		// Largest QP delta NVENC accepts either way.
+		static const int kMaxQpDelta = 51;
+
+		struct Region
+		{
+			// Rectangle in frame coordinates normalized to [0, 1].
+			double x;
+			double y;
+			double width;
+			double height;
+
+			// QP delta of the covered macroblocks, negative for more quality.
+			int qp_delta;
+		};
+
+		QpMapGenerator();
+
+		// Sets the QP delta at and beyond |outer_radius| from a focus point.
+		// Radii are fractions of the eye view height. A zero |max_qp_delta|
+		// disables foveation.
+		void SetFoveation(int max_qp_delta, double inner_radius, double outer_radius);
+
+		// Stereo frames hold the left and right eye views side by side. The
+		// focus points move back to the view centers when the mode changes.
+		void SetStereo(bool stereo);
+
+		// Sets the focus point of |eye| (0 is left or mono, 1 is right) in
+		// eye view coordinates normalized to [0, 1].
+		void SetFocusPoint(int eye, double x, double y);
+
+		// Parses the body of a "gaze" input message, "<eye>,<x>,<y>" with the
+		// arguments of SetFocusPoint().
+		static bool ParseGazeBody(const std::string& body, int* eye, double* x, double* y);
+
+		// Moves the focus points back to the view centers.
+		void ResetFocusPoints();
+
+		void SetRegions(const std::vector<Region>& regions);
+
+		// Returns the map for a frame of |width| x |height| pixels, one signed
+		// byte per macroblock. Returns null when neither foveation nor regions
+		// are set.
+		std::shared_ptr<const std::vector<int8_t>> GetMap(int width, int height);
+
+		// Number of maps built so far.
+		uint64_t build_count() const;
+
+	private:
+		struct Key
+		{
+			int width;
+			int height;
+			bool stereo;
+			int focus_mb_x[2];
+			int focus_mb_y[2];
+			uint64_t settings_version;
+
+			bool operator==(const Key& other) const;
+		};
+
+		Key GetKey(int width, int height) const;
+
+		std::shared_ptr<std::vector<int8_t>> Build(const Key& key) const;
+
+		int max_qp_delta_;
+		double inner_radius_;
+		double outer_radius_;
+		bool stereo_;
+		double focus_x_[2];
+		double focus_y_[2];
+		std::vector<Region> regions_;
+		uint64_t settings_version_;
+		uint64_t build_count_;
+		Key cached_key_;
+		std::shared_ptr<const std::vector<int8_t>> cached_map_;
+		mutable std::mutex mutex_;
+	};
+}
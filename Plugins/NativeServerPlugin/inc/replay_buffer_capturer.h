@@ -0,0 +1,94 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "memory_buffer_capturer.h"
+
+namespace StreamingToolkit
+{
+	// Plays back a Y4M file, typically recorded with FrameRecorder, through
+	// the capture pipeline so that encoder and transport benchmarks see the
+	// same frames on every run. The file is memory-mapped and frames are sent
+	// from a playback thread without copying, at a fixed frame rate or as
+	// fast as the sink takes them.
+	class ReplayBufferCapturer : public MemoryBufferCapturer
+	{
+	public:
+		ReplayBufferCapturer();
+
+		// Frames reference the mapped file, they must all be released before
+		// the capturer is destroyed.
+		~ReplayBufferCapturer();
+
+		// Maps a 4:2:0 Y4M file. The playback frame rate is reset to the one
+		// of the file.
+		bool Open(const std::string& path);
+
+		// Frames sent per second, 0 sends the next frame as soon as the
+		// previous one has been delivered.
+		void SetFrameRate(int fps);
+
+		// Restarts from the first frame at the end of the file.
+		void SetLoop(bool loop);
+
+		// Starts the playback thread.
+		cricket::CaptureState Start(const cricket::VideoFormat& format) override;
+
+		// Stops the playback thread.
+		void Stop() override;
+
+		// Blocks until the last frame has been sent. Never returns while
+		// looping, unless the capturer is stopped.
+		void WaitForEnd();
+
+		int width() const { return width_; }
+
+		int height() const { return height_; }
+
+		int frame_count() const { return static_cast<int>(frames_.size()); }
+
+		// Frame rate of the file header.
+		int file_frame_rate() const { return file_frame_rate_; }
+
+		uint64_t frames_sent() const { return frames_sent_; }
+
+	private:
+		void StopPlayback();
+
+		void Run();
+
+		void Close();
+
+		int width_;
+		int height_;
+		int file_frame_rate_;
+		int frame_rate_;
+		bool loop_;
+		const uint8_t* data_;
+		size_t size_;
+#ifdef _WIN32
+		void* file_;
+		void* mapping_;
+#else
+		int file_;
+#endif // _WIN32
+		std::vector<const uint8_t*> frames_;
+		std::atomic<bool> stopping_;
+		std::atomic<uint64_t> frames_sent_;
+		std::atomic<int> frames_in_flight_;
+		std::thread thread_;
+	};
+}
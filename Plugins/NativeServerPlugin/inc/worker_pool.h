@@ -0,0 +1,52 @@
+/*
+ *  Copyright (c) 2004 The WebRTC project authors. All Rights Reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license
+ *  that can be found in the LICENSE file in the root of the source
+ *  tree. An additional intellectual property rights grant can be found
+ *  in the file PATENTS.  All contributing project authors may
+ *  be found in the AUTHORS file in the root of the source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Persistent set of worker threads used to split per-frame work into
+	// independent tasks. The calling thread takes part in the work, so a pool
+	// of N threads spawns N - 1 workers.
+	class WorkerPool
+	{
+	public:
+		explicit WorkerPool(int thread_count);
+
+		~WorkerPool();
+
+		int thread_count() const { return static_cast<int>(threads_.size()) + 1; }
+
+		// Runs |task| once for each index in [0, task_count) and returns after
+		// every task has completed.
+		void ParallelFor(int task_count, const std::function<void(int)>& task);
+
+	private:
+		void Run();
+
+		std::vector<std::thread> threads_;
+		std::mutex mutex_;
+		std::condition_variable work_ready_;
+		std::condition_variable work_done_;
+		const std::function<void(int)>* task_;
+		int task_count_;
+		std::atomic<int> next_task_;
+		int active_workers_;
+		uint64_t generation_;
+		bool stopping_;
+	};
+}
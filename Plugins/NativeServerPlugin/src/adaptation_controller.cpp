@@ -0,0 +1,136 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "adaptation_controller.h"
+
+using namespace StreamingToolkit;
+
+AdaptationController::AdaptationController() :
+	hysteresis_ms_(0),
+	max_pixel_count_(std::numeric_limits<int>::max()),
+	target_pixel_count_(0),
+	max_framerate_fps_(std::numeric_limits<int>::max()),
+	current_step_(0),
+	last_step_change_ms_(0),
+	next_frame_time_ms_(0),
+	frames_dropped_(0)
+{
+}
+
+void AdaptationController::SetLadder(const std::vector<double>& ladder, int hysteresis_ms)
+{
+	rtc::CritScope cs(&lock_);
+	ladder_ = ladder;
+	std::sort(ladder_.begin(), ladder_.end(), std::greater<double>());
+	hysteresis_ms_ = hysteresis_ms;
+	current_step_ = 0;
+}
+
+void AdaptationController::OnSinkWants(const rtc::VideoSinkWants& wants)
+{
+	rtc::CritScope cs(&lock_);
+	max_pixel_count_ = wants.max_pixel_count ?
+		*wants.max_pixel_count : std::numeric_limits<int>::max();
+
+	target_pixel_count_ = wants.target_pixel_count ? *wants.target_pixel_count : 0;
+	max_framerate_fps_ = wants.max_framerate_fps;
+}
+
+bool AdaptationController::AdaptFrame(int width, int height, int64_t time_ms,
+	int* out_width, int* out_height)
+{
+	rtc::CritScope cs(&lock_);
+
+	// Drops frames arriving ahead of the requested frame rate.
+	if (max_framerate_fps_ > 0 && max_framerate_fps_ < std::numeric_limits<int>::max())
+	{
+		if (time_ms < next_frame_time_ms_)
+		{
+			frames_dropped_++;
+			return false;
+		}
+
+		int64_t interval_ms = 1000 / max_framerate_fps_;
+		next_frame_time_ms_ += interval_ms;
+		if (next_frame_time_ms_ <= time_ms)
+		{
+			next_frame_time_ms_ = time_ms + interval_ms;
+		}
+	}
+
+	*out_width = width;
+	*out_height = height;
+	if (ladder_.empty())
+	{
+		return true;
+	}
+
+	int wanted_step = GetWantedStep(width, height);
+	if (wanted_step > current_step_)
+	{
+		current_step_ = wanted_step;
+		last_step_change_ms_ = time_ms;
+	}
+	else if (wanted_step < current_step_ &&
+		time_ms - last_step_change_ms_ >= hysteresis_ms_)
+	{
+		current_step_--;
+		last_step_change_ms_ = time_ms;
+	}
+
+	double scale = ladder_[current_step_];
+	if (scale < 1.0)
+	{
+		// I420 needs even dimensions.
+		*out_width = std::max(static_cast<int>(width * scale) & ~1, 2);
+		*out_height = std::max(static_cast<int>(height * scale) & ~1, 2);
+	}
+
+	return true;
+}
+
+int AdaptationController::current_step() const
+{
+	rtc::CritScope cs(&lock_);
+	return current_step_;
+}
+
+uint64_t AdaptationController::frames_dropped() const
+{
+	rtc::CritScope cs(&lock_);
+	return frames_dropped_;
+}
+
+int AdaptationController::GetWantedStep(int width, int height) const
+{
+	int last_step = static_cast<int>(ladder_.size()) - 1;
+	for (int step = 0; step <= last_step; step++)
+	{
+		double scale = ladder_[step];
+		int pixel_count = static_cast<int>(width * scale) * static_cast<int>(height * scale);
+		if (pixel_count > max_pixel_count_)
+		{
+			continue;
+		}
+
+		// Prefers the step closest to the target pixel count when there is one.
+		if (target_pixel_count_ > 0 && step < last_step && pixel_count > target_pixel_count_)
+		{
+			double next_scale = ladder_[step + 1];
+			int next_pixel_count = static_cast<int>(width * next_scale) *
+				static_cast<int>(height * next_scale);
+
+			if (target_pixel_count_ - next_pixel_count < pixel_count - target_pixel_count_)
+			{
+				continue;
+			}
+		}
+
+		return step;
+	}
+
+	return last_step;
+}
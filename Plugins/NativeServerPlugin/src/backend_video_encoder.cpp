@@ -0,0 +1,72 @@
+#include "pch.h"
+
+#include "backend_video_encoder.h"
+
+#include "webrtc/modules/video_coding/codecs/h264/h264_encoder_impl.h"
+
+using namespace StreamingToolkit;
+
+H264BackendEncoder::H264BackendEncoder(const cricket::VideoCodec& codec) :
+	encoder_(new webrtc::H264EncoderImpl(codec))
+{
+}
+
+H264BackendEncoder::~H264BackendEncoder()
+{
+}
+
+int32_t H264BackendEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
+	int32_t number_of_cores,
+	size_t max_payload_size)
+{
+	return encoder_->InitEncode(codec_settings, number_of_cores, max_payload_size);
+}
+
+int32_t H264BackendEncoder::RegisterEncodeCompleteCallback(
+	webrtc::EncodedImageCallback* callback)
+{
+	return encoder_->RegisterEncodeCompleteCallback(callback);
+}
+
+int32_t H264BackendEncoder::Release()
+{
+	return encoder_->Release();
+}
+
+int32_t H264BackendEncoder::Encode(const webrtc::VideoFrame& frame,
+	const webrtc::CodecSpecificInfo* codec_specific_info,
+	const std::vector<webrtc::FrameType>* frame_types)
+{
+	return encoder_->Encode(frame, codec_specific_info, frame_types);
+}
+
+int32_t H264BackendEncoder::SetChannelParameters(uint32_t packet_loss, int64_t rtt)
+{
+	return encoder_->SetChannelParameters(packet_loss, rtt);
+}
+
+int32_t H264BackendEncoder::SetRateAllocation(
+	const webrtc::BitrateAllocation& allocation, uint32_t framerate)
+{
+	return encoder_->SetRateAllocation(allocation, framerate);
+}
+
+int32_t H264BackendEncoder::SetPeriodicKeyFrames(bool enable)
+{
+	return encoder_->SetPeriodicKeyFrames(enable);
+}
+
+webrtc::VideoEncoder::ScalingSettings H264BackendEncoder::GetScalingSettings() const
+{
+	return encoder_->GetScalingSettings();
+}
+
+const char* H264BackendEncoder::ImplementationName() const
+{
+	return encoder_->ImplementationName();
+}
+
+void H264BackendEncoder::ReportFrameLoss(uint32_t rtp_timestamp)
+{
+	encoder_->ReportFrameLoss(rtp_timestamp);
+}
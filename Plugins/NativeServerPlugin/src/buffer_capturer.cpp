@@ -3,15 +3,27 @@
 #include <fstream>
 
 #include "buffer_capturer.h"
+#include "plugindefs.h"
+
+#include "libyuv/planar_functions.h"
+#include "webrtc/base/logging.h"
 
 namespace StreamingToolkit
 {
 	BufferCapturer::BufferCapturer() :
-		clock_(webrtc::Clock::GetRealTimeClock()),
 		running_(false),
 		sink_(nullptr),
 		use_software_encoder_(false),
-		sink_wants_observer_(nullptr)
+		sink_wants_observer_(nullptr),
+		recording_sink_(nullptr),
+		frame_buffer_pool_(FRAME_BUFFER_POOL_SIZE),
+		frame_change_detector_(FRAME_CHANGE_TILE_SIZE),
+		scaled_frame_buffer_pool_(FRAME_BUFFER_POOL_SIZE),
+		skip_unchanged_frames_(false),
+		keep_alive_interval_ms_(0),
+		last_frame_time_ms_(0),
+		latency_probe_enabled_(false),
+		latency_probe_sequence_number_(0)
 	{
 		set_enable_video_adapter(false);
 		SetCaptureFormat(NULL);
@@ -29,6 +41,35 @@ namespace StreamingToolkit
 	{
 		rtc::CritScope cs(&lock_);
 		running_ = false;
+
+		if (skip_unchanged_frames_)
+		{
+			FrameChangeDetector::Stats stats = frame_change_detector_.GetStats();
+			LOG(INFO) << "Unchanged frames skipped: " << stats.frames_skipped
+				<< ", re-sent: " << stats.frames_resent
+				<< ", conversion time saved: " << stats.conversion_time_saved_us / 1000
+				<< " ms, hashing time: " << stats.hash_time_us / 1000 << " ms";
+		}
+
+		FrameTimingRecorder* frame_timing = FrameTimingRecorder::Instance();
+		if (frame_timing->enabled())
+		{
+			std::vector<FrameTimingRecorder::Histogram> histograms =
+				frame_timing->GetHistograms();
+
+			for (int stage = kFrameStaged; stage < kFrameTimingStageCount; stage++)
+			{
+				const FrameTimingRecorder::Histogram& histogram = histograms[stage];
+				if (histogram.total_count > 0)
+				{
+					LOG(INFO) << "Frame latency to "
+						<< FrameTimingRecorder::GetStageName(static_cast<FrameTimingStage>(stage))
+						<< ": p50 " << histogram.Percentile(50)
+						<< " us, p99 " << histogram.Percentile(99)
+						<< " us, max " << histogram.max_us << " us";
+				}
+			}
+		}
 	}
 
 	void BufferCapturer::SetSinkWantsObserver(SinkWantsObserver* observer)
@@ -44,6 +85,7 @@ namespace StreamingToolkit
 	{
 		rtc::CritScope cs(&lock_);
 		sink_ = sink;
+		adaptation_controller_.OnSinkWants(wants);
 		if (sink_wants_observer_)
 		{
 			sink_wants_observer_->OnSinkWantsChanged(sink, wants);
@@ -72,11 +114,209 @@ namespace StreamingToolkit
 		sink_ = nullptr;
 	}
 
+	void BufferCapturer::SetRecordingSink(rtc::VideoSinkInterface<VideoFrame>* sink)
+	{
+		rtc::CritScope cs(&lock_);
+		recording_sink_ = sink;
+	}
+
+	void BufferCapturer::EnableLatencyProbe(bool enable_latency_probe)
+	{
+		latency_probe_enabled_ = enable_latency_probe;
+	}
+
 	void BufferCapturer::EnableSoftwareEncoder(bool use_software_encoder)
 	{
 		use_software_encoder_ = use_software_encoder;
 	}
 
+	void BufferCapturer::SetConversionThreadCount(int thread_count)
+	{
+		frame_converter_.SetThreadCount(thread_count);
+	}
+
+	void BufferCapturer::EnableCapturePipeline(int queue_depth,
+		CapturePipeline::DropPolicy drop_policy)
+	{
+		// Stops the previous capture thread before starting a new one.
+		capture_pipeline_.reset();
+		ReleaseFrameBufferPools();
+		if (queue_depth > 0)
+		{
+			capture_pipeline_.reset(new CapturePipeline(queue_depth, drop_policy));
+		}
+	}
+
+	void BufferCapturer::DisableCapturePipeline()
+	{
+		capture_pipeline_.reset();
+		ReleaseFrameBufferPools();
+	}
+
+	void BufferCapturer::ReleaseFrameBufferPools()
+	{
+		frame_buffer_pool_.Release();
+		scaled_frame_buffer_pool_.Release();
+	}
+
+	CapturePipeline::Stats BufferCapturer::GetCapturePipelineStats() const
+	{
+		CapturePipeline::Stats stats = { 0 };
+		if (capture_pipeline_)
+		{
+			stats = capture_pipeline_->GetStats();
+		}
+
+		return stats;
+	}
+
+	void BufferCapturer::SetAdaptationLadder(const std::vector<double>& ladder, int hysteresis_ms)
+	{
+		adaptation_controller_.SetLadder(ladder, hysteresis_ms);
+	}
+
+	void BufferCapturer::SkipUnchangedFrames(bool skip_unchanged_frames, int keep_alive_interval_ms)
+	{
+		skip_unchanged_frames_ = skip_unchanged_frames;
+		keep_alive_interval_ms_ = keep_alive_interval_ms;
+		frame_change_detector_.Reset();
+	}
+
+	bool BufferCapturer::IsFrameUnchanged(const uint8_t* data, int stride, int width, int height)
+	{
+		return skip_unchanged_frames_ &&
+			!frame_change_detector_.Update(data, stride, width, height);
+	}
+
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> BufferCapturer::GetKeepAliveFrameBuffer()
+	{
+		int64_t now = rtc::TimeMillis();
+		if (keep_alive_interval_ms_ > 0 && last_frame_buffer_ &&
+			now - last_frame_time_ms_ >= keep_alive_interval_ms_)
+		{
+			last_frame_time_ms_ = now;
+			frame_change_detector_.OnFrameUnchanged(true);
+			return last_frame_buffer_;
+		}
+
+		frame_change_detector_.OnFrameUnchanged(false);
+		return nullptr;
+	}
+
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> BufferCapturer::ConvertPackedFrame(
+		const uint8_t* data, int stride, bool bgra, int width, int height)
+	{
+		rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+			frame_buffer_pool_.CreateBuffer(width, height);
+
+		// libyuv names formats by their little-endian word order, so RGBA bytes
+		// are ABGR and BGRA bytes are ARGB.
+		if (bgra)
+		{
+			frame_converter_.ARGBToI420(data, stride,
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				width, height);
+		}
+		else
+		{
+			frame_converter_.ABGRToI420(data, stride,
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				width, height);
+		}
+
+		return buffer;
+	}
+
+	void BufferCapturer::OnFrameConverted(
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer, int64_t conversion_time_us)
+	{
+		frame_change_detector_.OnFrameConverted(conversion_time_us);
+		if (skip_unchanged_frames_)
+		{
+			last_frame_buffer_ = buffer;
+			last_frame_time_ms_ = rtc::TimeMillis();
+		}
+	}
+
+	webrtc::VideoFrame BufferCapturer::StampLatencyProbe(const webrtc::VideoFrame& video_frame,
+		rtc::scoped_refptr<webrtc::I420Buffer> buffer)
+	{
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> source = video_frame.video_frame_buffer();
+		if (source->native_handle())
+		{
+			return video_frame;
+		}
+
+		// Frame time stamps are system clock nanoseconds, see OnFrameSubmitted().
+		LatencyProbe::Id id;
+		id.sequence_number = latency_probe_sequence_number_++;
+		id.capture_time_us = static_cast<uint32_t>(video_frame.timestamp_us() / 1000);
+
+		int width = video_frame.width();
+		int height = video_frame.height();
+
+		// The source may be the caller's memory or the keep-alive frame.
+		if (!buffer)
+		{
+			buffer = scaled_frame_buffer_pool_.CreateBuffer(width, height);
+			libyuv::I420Copy(
+				source->DataY(), source->StrideY(),
+				source->DataU(), source->StrideU(),
+				source->DataV(), source->StrideV(),
+				buffer->MutableDataY(), buffer->StrideY(),
+				buffer->MutableDataU(), buffer->StrideU(),
+				buffer->MutableDataV(), buffer->StrideV(),
+				width, height);
+		}
+
+		LatencyProbe::StampI420(id,
+			buffer->MutableDataY(), buffer->StrideY(),
+			buffer->MutableDataU(), buffer->StrideU(),
+			buffer->MutableDataV(), buffer->StrideV(),
+			width, height);
+
+		webrtc::VideoFrame stamped_frame(buffer, video_frame.rotation(),
+			video_frame.timestamp_us());
+
+		stamped_frame.set_ntp_time_ms(video_frame.ntp_time_ms());
+		stamped_frame.set_prediction_timestamp(video_frame.prediction_timestamp());
+		return stamped_frame;
+	}
+
+	int64_t BufferCapturer::OnFrameSubmitted()
+	{
+		int64_t time_stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count();
+
+		FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp),
+			kFrameRenderSubmitted);
+
+		return time_stamp;
+	}
+
+	int64_t BufferCapturer::GetCaptureNtpTimeMs(int64_t time_stamp)
+	{
+		// The system clock counts from the Unix epoch, NTP from 1900.
+		return time_stamp / rtc::kNumNanosecsPerMillisec +
+			static_cast<int64_t>(webrtc::kNtpJan1970) * rtc::kNumMillisecsPerSec;
+	}
+
+	void BufferCapturer::RunCaptureTask(const CapturePipeline::Task& task)
+	{
+		if (capture_pipeline_)
+		{
+			capture_pipeline_->Push(task);
+		}
+		else
+		{
+			task();
+		}
+	}
+
 	void BufferCapturer::SendFrame(webrtc::VideoFrame video_frame)
 	{
 		// The video capturer hasn't started since there is no active connection.
@@ -85,6 +325,70 @@ namespace StreamingToolkit
 			return;
 		}
 
+		// Records the frames as rendered, whatever the sink requests.
+		{
+			rtc::CritScope cs(&lock_);
+			if (recording_sink_ && use_software_encoder_)
+			{
+				recording_sink_->OnFrame(video_frame);
+			}
+		}
+
+		// Follows the resolution and frame rate requested by the sink.
+		int width = 0;
+		int height = 0;
+		if (!adaptation_controller_.AdaptFrame(video_frame.width(), video_frame.height(),
+			rtc::TimeMillis(), &width, &height))
+		{
+			return;
+		}
+
+		// The hardware encoder reads the staging texture, so only software
+		// frames are scaled.
+		rtc::scoped_refptr<webrtc::I420Buffer> scaled_buffer;
+		if (use_software_encoder_ &&
+			(width != video_frame.width() || height != video_frame.height()))
+		{
+			rtc::scoped_refptr<webrtc::VideoFrameBuffer> source =
+				video_frame.video_frame_buffer();
+
+			rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+				scaled_frame_buffer_pool_.CreateBuffer(width, height);
+
+			libyuv::I420Scale(
+				source->DataY(),
+				source->StrideY(),
+				source->DataU(),
+				source->StrideU(),
+				source->DataV(),
+				source->StrideV(),
+				source->width(),
+				source->height(),
+				buffer->MutableDataY(),
+				buffer->StrideY(),
+				buffer->MutableDataU(),
+				buffer->StrideU(),
+				buffer->MutableDataV(),
+				buffer->StrideV(),
+				width,
+				height,
+				libyuv::kFilterBox);
+
+			webrtc::VideoFrame scaled_frame(buffer, video_frame.rotation(),
+				video_frame.timestamp_us());
+
+			scaled_frame.set_ntp_time_ms(video_frame.ntp_time_ms());
+			scaled_frame.set_prediction_timestamp(video_frame.prediction_timestamp());
+			video_frame = scaled_frame;
+			scaled_buffer = buffer;
+		}
+
+		if (latency_probe_enabled_ && use_software_encoder_)
+		{
+			video_frame = StampLatencyProbe(video_frame, scaled_buffer);
+		}
+
+		FrameTimingRecorder::Instance()->Record(video_frame.ntp_time_ms(), kFrameEncoderIn);
 		if (sink_)
 		{
 			sink_->OnFrame(video_frame);
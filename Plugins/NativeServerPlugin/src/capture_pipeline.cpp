@@ -0,0 +1,102 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "capture_pipeline.h"
+
+using namespace StreamingToolkit;
+
+CapturePipeline::CapturePipeline(size_t max_queue_depth, DropPolicy drop_policy) :
+	max_queue_depth_(std::max(max_queue_depth, (size_t)1)),
+	drop_policy_(drop_policy),
+	stopping_(false),
+	frames_delivered_(0),
+	frames_dropped_(0),
+	total_latency_us_(0),
+	last_latency_us_(0),
+	max_latency_us_(0)
+{
+	thread_ = std::thread(&CapturePipeline::Run, this);
+}
+
+CapturePipeline::~CapturePipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+		queue_.clear();
+	}
+
+	task_ready_.notify_one();
+	thread_.join();
+}
+
+bool CapturePipeline::Push(const Task& task)
+{
+	bool dropped = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (queue_.size() >= max_queue_depth_)
+		{
+			frames_dropped_++;
+			dropped = true;
+			if (drop_policy_ == kDropNewest)
+			{
+				return false;
+			}
+
+			queue_.pop_front();
+		}
+
+		Entry entry = { task, std::chrono::steady_clock::now() };
+		queue_.push_back(std::move(entry));
+	}
+
+	task_ready_.notify_one();
+	return !dropped;
+}
+
+CapturePipeline::Stats CapturePipeline::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats stats;
+	stats.queue_depth = queue_.size();
+	stats.frames_delivered = frames_delivered_;
+	stats.frames_dropped = frames_dropped_;
+	stats.last_latency_us = last_latency_us_;
+	stats.average_latency_us = frames_delivered_ > 0 ?
+		total_latency_us_ / (int64_t)frames_delivered_ : 0;
+
+	stats.max_latency_us = max_latency_us_;
+	return stats;
+}
+
+void CapturePipeline::Run()
+{
+	while (true)
+	{
+		Entry entry;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			task_ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+			if (stopping_)
+			{
+				return;
+			}
+
+			entry = std::move(queue_.front());
+			queue_.pop_front();
+		}
+
+		entry.task();
+
+		int64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now() - entry.enqueue_time).count();
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		frames_delivered_++;
+		total_latency_us_ += latency_us;
+		last_latency_us_ = latency_us;
+		max_latency_us_ = std::max(max_latency_us_, latency_us);
+	}
+}
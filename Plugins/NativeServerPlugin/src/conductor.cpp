@@ -10,6 +10,7 @@
 
 #include "pch.h"
 
+#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -26,6 +27,7 @@
 #include "webrtc/base/logging.h"
 #include "webrtc/media/engine/webrtcvideocapturerfactory.h"
 #include "webrtc/modules/video_capture/video_capture_factory.h"
+#include "webrtc/system_wrappers/include/clock.h"
 
 #include "plugindefs.h"
 #include "buffer_capturer.h"
@@ -48,6 +50,15 @@ const char kInputDataChannelName[] = "inputDataChannel";
 #define DTLS_ON  true
 #define DTLS_OFF false
 
+// Message ids handled by Conductor::OnMessage().
+enum
+{
+	MSG_POLL_FRAME_LOSS = 1
+};
+
+// RTP ticks per millisecond of the video clock.
+const int64_t kVideoRtpTicksPerMs = 90;
+
 class DummySetSessionDescriptionObserver : public webrtc::SetSessionDescriptionObserver
 {
 public:
@@ -71,6 +82,52 @@ protected:
 	~DummySetSessionDescriptionObserver() {}
 };
 
+class FrameLossStatsObserver : public webrtc::StatsObserver
+{
+public:
+	typedef std::function<void(const webrtc::StatsReports& reports)> Callback;
+
+	static FrameLossStatsObserver* Create(const Callback& callback)
+	{
+		return new rtc::RefCountedObject<FrameLossStatsObserver>(callback);
+	}
+
+	void OnComplete(const webrtc::StatsReports& reports) override
+	{
+		callback_(reports);
+	}
+
+protected:
+	explicit FrameLossStatsObserver(const Callback& callback) : callback_(callback) {}
+	~FrameLossStatsObserver() {}
+
+private:
+	Callback callback_;
+};
+
+// Returns the value of an integer statistic, or 0 when it is missing.
+static int64_t GetIntStat(const webrtc::StatsReport* report,
+	webrtc::StatsReport::StatsValueName name)
+{
+	const webrtc::StatsReport::Value* value = report->FindValue(name);
+	if (!value)
+	{
+		return 0;
+	}
+
+	switch (value->type())
+	{
+	case webrtc::StatsReport::Value::kInt:
+		return value->int_val();
+
+	case webrtc::StatsReport::Value::kInt64:
+		return value->int64_val();
+
+	default:
+		return 0;
+	}
+}
+
 Conductor::Conductor(
 	PeerConnectionClient* client,
 	BufferCapturer* buffer_capturer,
@@ -84,7 +141,12 @@ Conductor::Conductor(
 		buffer_capturer_(buffer_capturer),
 		main_window_(main_window),
 		webrtc_config_(webrtc_config),
-		input_data_handler_(nullptr)
+		input_data_handler_(nullptr),
+		has_encoder_backend_(false),
+		encoder_backend_(kEncoderBackendNvenc),
+		null_encoder_frame_size_(0),
+		encoder_factory_(nullptr),
+		frame_loss_detector_(FRAME_LOSS_MIN_LOST_PACKETS, FRAME_LOSS_MIN_POLLS)
 {
 	client_->RegisterObserver(this);
 	if (main_window_->IsWindow())
@@ -134,6 +196,18 @@ void Conductor::SetInputDataHandler(InputDataHandler* handler)
 	input_data_handler_ = handler;
 }
 
+void Conductor::SetEncoderBackend(EncoderBackend backend, size_t null_encoder_frame_size)
+{
+	has_encoder_backend_ = true;
+	encoder_backend_ = backend;
+	null_encoder_frame_size_ = null_encoder_frame_size;
+}
+
+void Conductor::SetEncoderSessionPool(std::shared_ptr<EncoderSessionPool> pool)
+{
+	encoder_session_pool_ = pool;
+}
+
 void Conductor::Close() 
 {
 	is_closing_ = true;
@@ -165,7 +239,36 @@ bool Conductor::InitializePeerConnection()
 	RTC_DCHECK(peer_connection_factory_.get() == NULL);
 	RTC_DCHECK(peer_connection_.get() == NULL);
 
-	peer_connection_factory_  = webrtc::CreatePeerConnectionFactory();
+	if (has_encoder_backend_)
+	{
+		// An external encoder factory can only be passed along with the
+		// threads, these match the ones the default factory creates.
+		if (!network_thread_)
+		{
+			network_thread_ = rtc::Thread::CreateWithSocketServer();
+			network_thread_->Start();
+			worker_thread_ = rtc::Thread::Create();
+			worker_thread_->Start();
+		}
+
+		LOG(INFO) << "Encoder backend: " << EncoderBackendFactory::GetBackendName(encoder_backend_);
+
+		// The peer connection factory takes ownership of the encoder factory.
+		encoder_factory_ = new EncoderBackendFactory(encoder_backend_,
+			null_encoder_frame_size_, encoder_session_pool_);
+
+		peer_connection_factory_ = webrtc::CreatePeerConnectionFactory(
+			network_thread_.get(),
+			worker_thread_.get(),
+			rtc::Thread::Current(),
+			nullptr,
+			encoder_factory_,
+			nullptr);
+	}
+	else
+	{
+		peer_connection_factory_ = webrtc::CreatePeerConnectionFactory();
+	}
 
 	if (!peer_connection_factory_.get())
 	{
@@ -192,6 +295,15 @@ bool Conductor::InitializePeerConnection()
 	}
 
 	AddStreams();
+
+	// Receiver losses let the encoders recover without a key frame.
+	if (encoder_factory_ && peer_connection_.get())
+	{
+		frame_loss_detector_.Reset();
+		rtc::Thread::Current()->PostDelayed(RTC_FROM_HERE,
+			FRAME_LOSS_POLL_INTERVAL_MS, this, MSG_POLL_FRAME_LOSS);
+	}
+
 	return peer_connection_.get() != NULL;
 }
 
@@ -288,6 +400,8 @@ bool Conductor::CreatePeerConnection(bool dtls)
 
 void Conductor::DeletePeerConnection()
 {
+	rtc::Thread::Current()->Clear(this, MSG_POLL_FRAME_LOSS);
+	encoder_factory_ = nullptr;
 	peer_connection_ = NULL;
 	active_streams_.clear();
 
@@ -743,6 +857,78 @@ void Conductor::UIThreadCallback(int msg_id, void* data)
 	}
 }
 
+void Conductor::OnMessage(rtc::Message* msg)
+{
+	switch (msg->message_id)
+	{
+	case MSG_POLL_FRAME_LOSS:
+		PollFrameLoss();
+		break;
+
+	default:
+		RTC_NOTREACHED();
+		break;
+	}
+}
+
+void Conductor::PollFrameLoss()
+{
+	if (!peer_connection_.get() || !encoder_factory_)
+	{
+		return;
+	}
+
+	rtc::scoped_refptr<Conductor> self(this);
+	peer_connection_->GetStats(
+		FrameLossStatsObserver::Create([self](const webrtc::StatsReports& reports)
+		{
+			self->OnFrameLossStats(reports);
+		}),
+		nullptr,
+		webrtc::PeerConnectionInterface::kStatsOutputLevelStandard);
+
+	rtc::Thread::Current()->PostDelayed(RTC_FROM_HERE,
+		FRAME_LOSS_POLL_INTERVAL_MS, this, MSG_POLL_FRAME_LOSS);
+}
+
+void Conductor::OnFrameLossStats(const webrtc::StatsReports& reports)
+{
+	if (!encoder_factory_)
+	{
+		return;
+	}
+
+	for (const webrtc::StatsReport* report : reports)
+	{
+		// Only the video send reports count encoded frames.
+		if (report->type() != webrtc::StatsReport::kStatsReportTypeSsrc ||
+			!report->FindValue(webrtc::StatsReport::kStatsValueNameFramesEncoded))
+		{
+			continue;
+		}
+
+		FrameLossDetector::Counters counters;
+		counters.plis = GetIntStat(report, webrtc::StatsReport::kStatsValueNamePlisReceived);
+		counters.firs = GetIntStat(report, webrtc::StatsReport::kStatsValueNameFirsReceived);
+		counters.packets_lost = GetIntStat(report, webrtc::StatsReport::kStatsValueNamePacketsLost);
+		if (!frame_loss_detector_.Update(counters))
+		{
+			continue;
+		}
+
+		int64_t rtt_ms = GetIntStat(report, webrtc::StatsReport::kStatsValueNameRtt);
+
+		// The lost packets were sent at most the polls that found them and a
+		// round trip ago. ViEEncoder derives the RTP timestamp of a frame from its NTP
+		// capture time, which the capturers set from the real-time clock.
+		int64_t sent_ntp_ms = webrtc::Clock::GetRealTimeClock()->CurrentNtpInMilliseconds() -
+			FRAME_LOSS_MIN_POLLS * FRAME_LOSS_POLL_INTERVAL_MS - rtt_ms;
+
+		encoder_factory_->ReportFrameLoss(
+			static_cast<uint32_t>(kVideoRtpTicksPerMs * sent_ntp_ms));
+	}
+}
+
 void Conductor::OnSuccess(webrtc::SessionDescriptionInterface* desc)
 {
 	peer_connection_->SetLocalDescription(
@@ -1,16 +1,28 @@
 #include "pch.h"
 
 #include "directx_buffer_capturer.h"
+#include "encoder_backend.h"
 #include "plugindefs.h"
 
+#include "webrtc/base/logging.h"
+#include "webrtc/common_video/include/video_frame_buffer.h"
 #include "webrtc/modules/video_coding/codecs/h264/h264_encoder_impl.h"
 
 using namespace Microsoft::WRL;
 using namespace StreamingToolkit;
 
 DirectXBufferCapturer::DirectXBufferCapturer(ID3D11Device* d3d_device) :
-	d3d_device_(d3d_device)
+	d3d_device_(d3d_device),
+	staging_frame_buffers_(std::make_shared<StagingBufferList>()),
+	qp_map_generator_(std::make_shared<QpMapGenerator>())
 {
+	staging_frame_buffers_->desc = { 0 };
+}
+
+DirectXBufferCapturer::~DirectXBufferCapturer()
+{
+	// Pending capture tasks call back into this capturer.
+	DisableCapturePipeline();
 }
 
 void DirectXBufferCapturer::Initialize(bool headless, int width, int height)
@@ -30,6 +42,22 @@ void DirectXBufferCapturer::Initialize(bool headless, int width, int height)
 	webrtc::H264EncoderImpl::SetDevice(d3d_device_.Get());
 	webrtc::H264EncoderImpl::SetContext(d3d_context_.Get());
 
+	// The encoder may outlive the capturer, the callback shares ownership
+	// of the generator.
+	std::shared_ptr<QpMapGenerator> qp_map_generator = qp_map_generator_;
+	webrtc::H264EncoderImpl::SetQpDeltaMapCallback([qp_map_generator](int width, int height)
+	{
+		return qp_map_generator->GetMap(width, height);
+	});
+
+	webrtc::H264EncoderImpl::SetFrameTimingCallback([](int64_t frame_ntp_time_ms,
+		webrtc::H264EncoderImpl::FrameTimingEvent event)
+	{
+		FrameTimingRecorder::Instance()->Record(frame_ntp_time_ms,
+			event == webrtc::H264EncoderImpl::kFrameTimingEncoded ?
+			kFrameEncoderOut : kFramePacketized);
+	});
+
 	// Headless mode initialization.
 	headless_ = headless;
 	if (headless_)
@@ -38,6 +66,46 @@ void DirectXBufferCapturer::Initialize(bool headless, int width, int height)
 	}
 }
 
+void DirectXBufferCapturer::ApplyConfig(const NvEncConfig& config)
+{
+	EnableSoftwareEncoder(
+		EncoderBackendFactory::GetConfiguredBackend(config) == kEncoderBackendSoftware);
+
+	SetConversionThreadCount(config.capture_conversion_threads);
+
+	if (config.capture_pipeline_depth > 0)
+	{
+		EnableCapturePipeline(config.capture_pipeline_depth,
+			config.capture_pipeline_drop_policy == "dropNewest" ?
+			CapturePipeline::kDropNewest : CapturePipeline::kDropOldest);
+	}
+	else
+	{
+		DisableCapturePipeline();
+	}
+
+	SkipUnchangedFrames(config.skip_unchanged_frames, config.unchanged_frame_keep_alive_ms);
+
+	// NVENC encodes the staging texture at its full size, so the ladder only
+	// applies to software encoding. Hardware frames follow the frame rate
+	// requested by the sink, not its resolution.
+	SetAdaptationLadder(use_software_encoder_ ? config.adaptation_ladder : std::vector<double>(),
+		config.adaptation_hysteresis_ms);
+
+	// Frames converted on the CPU feed the software encoder, which only reads
+	// I420.
+	if (!config.capture_output_format.empty() && config.capture_output_format != "i420")
+	{
+		LOG(LS_WARNING) << "Unsupported capture output format: "
+			<< config.capture_output_format << ", using i420";
+	}
+
+	qp_map_generator_->SetFoveation(config.qp_map_max_delta,
+		config.qp_map_inner_radius, config.qp_map_outer_radius);
+
+	EnableLatencyProbe(config.latency_probe);
+}
+
 void DirectXBufferCapturer::SendFrame(int64_t prediction_time_stamp)
 {
 	if (!headless_)
@@ -63,56 +131,21 @@ void DirectXBufferCapturer::SendFrame(ID3D11Texture2D* frame_buffer, int64_t pre
 		return;
 	}
 
-	// Updates staging frame buffer.
-	UpdateStagingBuffer(frame_buffer);
+	int64_t time_stamp = OnFrameSubmitted();
 
-	// Creates webrtc frame buffer.
+	// Copies the frame buffer to a staging one.
 	D3D11_TEXTURE2D_DESC desc;
-	staging_frame_buffer_->GetDesc(&desc);
-	rtc::scoped_refptr<webrtc::I420Buffer> buffer = 
-		webrtc::I420Buffer::Create(desc.Width, desc.Height);
-
-	// For software encoder, converting to supported video format.
-	if (use_software_encoder_)
-	{
-		D3D11_MAPPED_SUBRESOURCE mapped;
-		if (SUCCEEDED(d3d_context_.Get()->Map(
-			staging_frame_buffer_.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
-		{
-			libyuv::ABGRToI420(
-				(uint8_t*)mapped.pData,
-				desc.Width * 4,
-				buffer.get()->MutableDataY(),
-				buffer.get()->StrideY(),
-				buffer.get()->MutableDataU(),
-				buffer.get()->StrideU(),
-				buffer.get()->MutableDataV(),
-				buffer.get()->StrideV(),
-				desc.Width,
-				desc.Height);
-
-			d3d_context_->Unmap(staging_frame_buffer_.Get(), 0);
-		}
-	}
-
-	// Updates time stamp.
-	auto time_stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-		std::chrono::system_clock::now().time_since_epoch()).count();
+	frame_buffer->GetDesc(&desc);
+	std::shared_ptr<ID3D11Texture2D> staging_frame_buffer =
+		AcquireStagingBuffer(desc.Format, desc.Width, desc.Height);
 
-	// Creates video frame buffer.
-	auto frame = webrtc::VideoFrame(buffer, kVideoRotation_0, time_stamp);
-	frame.set_ntp_time_ms(clock_->CurrentNtpInMilliseconds());
-	frame.set_rotation(VideoRotation::kVideoRotation_0);
-	frame.set_prediction_timestamp(prediction_time_stamp);
+	d3d_context_->CopyResource(staging_frame_buffer.get(), frame_buffer);
+	FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp), kFrameStaged);
 
-	// For hardware encoder, setting the video frame texture.
-	if (!use_software_encoder_)
+	RunCaptureTask([this, staging_frame_buffer, time_stamp, prediction_time_stamp]()
 	{
-		frame.set_staging_frame_buffer(staging_frame_buffer_.Get());
-	}
-
-	// Sending video frame.
-	BufferCapturer::SendFrame(frame);
+		SendStagingBuffer(staging_frame_buffer, time_stamp, prediction_time_stamp);
+	});
 }
 
 void DirectXBufferCapturer::SendFrame(ID3D11Texture2D* left_frame_buffer, ID3D11Texture2D* right_frame_buffer, int64_t prediction_time_stamp)
@@ -123,132 +156,185 @@ void DirectXBufferCapturer::SendFrame(ID3D11Texture2D* left_frame_buffer, ID3D11
 		return;
 	}
 
-	// Updates staging frame buffer.
-	UpdateStagingBuffer(left_frame_buffer, right_frame_buffer);
+	int64_t time_stamp = OnFrameSubmitted();
+
+	// Copies the left and right frame buffers side by side to a staging one.
+	D3D11_TEXTURE2D_DESC desc;
+	left_frame_buffer->GetDesc(&desc);
+	std::shared_ptr<ID3D11Texture2D> staging_frame_buffer =
+		AcquireStagingBuffer(desc.Format, desc.Width * 2, desc.Height);
+
+	d3d_context_->CopySubresourceRegion(staging_frame_buffer.get(), 0, 0, 0, 0,
+		left_frame_buffer, 0, 0);
+
+	d3d_context_->CopySubresourceRegion(staging_frame_buffer.get(), 0, desc.Width, 0, 0,
+		right_frame_buffer, 0, 0);
+
+	FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp), kFrameStaged);
 
-	// Creates webrtc frame buffer.
+	RunCaptureTask([this, staging_frame_buffer, time_stamp, prediction_time_stamp]()
+	{
+		SendStagingBuffer(staging_frame_buffer, time_stamp, prediction_time_stamp);
+	});
+}
+
+void DirectXBufferCapturer::SendStagingBuffer(std::shared_ptr<ID3D11Texture2D> staging_frame_buffer,
+	int64_t time_stamp, int64_t prediction_time_stamp)
+{
 	D3D11_TEXTURE2D_DESC desc;
-	staging_frame_buffer_->GetDesc(&desc);
-	rtc::scoped_refptr<webrtc::I420Buffer> buffer =
-		webrtc::I420Buffer::Create(desc.Width, desc.Height);
+	staging_frame_buffer->GetDesc(&desc);
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer;
 
-	// For software encoder, converting to supported video format.
+	// For software encoder, converting to supported video format. Mapping from
+	// the capture thread relies on the multithread protected device context.
 	if (use_software_encoder_)
 	{
 		D3D11_MAPPED_SUBRESOURCE mapped;
 		if (SUCCEEDED(d3d_context_.Get()->Map(
-			staging_frame_buffer_.Get(), 0, D3D11_MAP_READ, 0, &mapped)))
+			staging_frame_buffer.get(), 0, D3D11_MAP_READ, 0, &mapped)))
 		{
-			libyuv::ABGRToI420(
-				(uint8_t*)mapped.pData,
-				desc.Width * 4,
-				buffer.get()->MutableDataY(),
-				buffer.get()->StrideY(),
-				buffer.get()->MutableDataU(),
-				buffer.get()->StrideU(),
-				buffer.get()->MutableDataV(),
-				buffer.get()->StrideV(),
-				desc.Width,
-				desc.Height);
-
-			d3d_context_->Unmap(staging_frame_buffer_.Get(), 0);
+			bool unchanged = IsFrameUnchanged(
+				(uint8_t*)mapped.pData, desc.Width * 4, desc.Width, desc.Height);
+
+			if (!unchanged)
+			{
+				auto start = std::chrono::steady_clock::now();
+				buffer = ConvertPackedFrame((uint8_t*)mapped.pData, desc.Width * 4,
+					false, desc.Width, desc.Height);
+
+				OnFrameConverted(buffer,
+					std::chrono::duration_cast<std::chrono::microseconds>(
+						std::chrono::steady_clock::now() - start).count());
+
+				FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp),
+					kFrameConverted);
+			}
+
+			d3d_context_->Unmap(staging_frame_buffer.get(), 0);
+
+			// Unchanged frames skip conversion and are only sent as keep-alive.
+			if (unchanged)
+			{
+				buffer = GetKeepAliveFrameBuffer();
+				if (!buffer)
+				{
+					return;
+				}
+			}
 		}
 	}
 
-	// Updates time stamp.
-	auto time_stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
-		std::chrono::system_clock::now().time_since_epoch()).count();
+	// Creates webrtc frame buffer. For hardware encoder, the frame buffer
+	// holds the staging texture set on the frame until the encoder has read
+	// it and released the frame.
+	if (!buffer)
+	{
+		rtc::scoped_refptr<webrtc::I420Buffer> pooled_buffer =
+			frame_buffer_pool_.CreateBuffer(desc.Width, desc.Height);
+
+		buffer = new rtc::RefCountedObject<webrtc::WrappedI420Buffer>(
+			pooled_buffer->width(),
+			pooled_buffer->height(),
+			pooled_buffer->DataY(),
+			pooled_buffer->StrideY(),
+			pooled_buffer->DataU(),
+			pooled_buffer->StrideU(),
+			pooled_buffer->DataV(),
+			pooled_buffer->StrideV(),
+			rtc::Callback0<void>([pooled_buffer, staging_frame_buffer]() {}));
+	}
 
-	// Creates video frame buffer.
+	// Creates video frame buffer, time stamped at submission.
 	auto frame = webrtc::VideoFrame(buffer, kVideoRotation_0, time_stamp);
-	frame.set_ntp_time_ms(clock_->CurrentNtpInMilliseconds());
+	frame.set_ntp_time_ms(GetCaptureNtpTimeMs(time_stamp));
 	frame.set_rotation(VideoRotation::kVideoRotation_0);
 	frame.set_prediction_timestamp(prediction_time_stamp);
 
 	// For hardware encoder, setting the video frame texture.
 	if (!use_software_encoder_)
 	{
-		frame.set_staging_frame_buffer(staging_frame_buffer_.Get());
+		frame.set_staging_frame_buffer(staging_frame_buffer.get());
 	}
 
 	// Sending video frame.
 	BufferCapturer::SendFrame(frame);
 }
 
-void DirectXBufferCapturer::UpdateStagingBuffer(ID3D11Texture2D* frame_buffer)
+std::shared_ptr<ID3D11Texture2D> DirectXBufferCapturer::AcquireStagingBuffer(
+	DXGI_FORMAT format, UINT width, UINT height)
 {
-	D3D11_TEXTURE2D_DESC desc;
-	frame_buffer->GetDesc(&desc);
-
-	// Lazily initializes the staging frame buffer.
-	if (!staging_frame_buffer_)
-	{
-		staging_frame_buffer_desc_ = { 0 };
-		staging_frame_buffer_desc_.ArraySize = 1;
-		staging_frame_buffer_desc_.Format = desc.Format;
-		staging_frame_buffer_desc_.Width = desc.Width;
-		staging_frame_buffer_desc_.Height = desc.Height;
-		staging_frame_buffer_desc_.MipLevels = 1;
-		staging_frame_buffer_desc_.SampleDesc.Count = 1;
-		staging_frame_buffer_desc_.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-		staging_frame_buffer_desc_.Usage = D3D11_USAGE_STAGING;
-		d3d_device_->CreateTexture2D(
-			&staging_frame_buffer_desc_, nullptr, &staging_frame_buffer_);
-	}
-	// Resizes if needed.
-	else if (staging_frame_buffer_desc_.Width != desc.Width || 
-		staging_frame_buffer_desc_.Height != desc.Height)
+	StagingBufferList* staging_frame_buffers = staging_frame_buffers_.get();
+	ComPtr<ID3D11Texture2D> staging_frame_buffer;
+	D3D11_TEXTURE2D_DESC staging_frame_buffer_desc;
 	{
-		staging_frame_buffer_desc_.Width = desc.Width;
-		staging_frame_buffer_desc_.Height = desc.Height;
-		d3d_device_->CreateTexture2D(&staging_frame_buffer_desc_, nullptr,
-			&staging_frame_buffer_);
-	}
+		rtc::CritScope cs(&staging_frame_buffers->lock);
 
-	// Copies the frame buffer to the staging one.		
-	d3d_context_->CopyResource(staging_frame_buffer_.Get(), frame_buffer);
-}
+		// Staging buffers of the previous size are no longer needed.
+		D3D11_TEXTURE2D_DESC& desc = staging_frame_buffers->desc;
+		if (desc.Format != format || desc.Width != width || desc.Height != height)
+		{
+			staging_frame_buffers->buffers.clear();
+			desc = { 0 };
+			desc.ArraySize = 1;
+			desc.Format = format;
+			desc.Width = width;
+			desc.Height = height;
+			desc.MipLevels = 1;
+			desc.SampleDesc.Count = 1;
+			desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+			desc.Usage = D3D11_USAGE_STAGING;
+		}
 
-void DirectXBufferCapturer::UpdateStagingBuffer(ID3D11Texture2D* left_frame_buffer, ID3D11Texture2D* right_frame_buffer)
-{
-	D3D11_TEXTURE2D_DESC desc;
-	left_frame_buffer->GetDesc(&desc);
+		if (!staging_frame_buffers->buffers.empty())
+		{
+			staging_frame_buffer = staging_frame_buffers->buffers.back();
+			staging_frame_buffers->buffers.pop_back();
+		}
 
-	// Lazily initializes the staging frame buffer.
-	if (!staging_frame_buffer_)
-	{
-		staging_frame_buffer_desc_ = { 0 };
-		staging_frame_buffer_desc_.ArraySize = 1;
-		staging_frame_buffer_desc_.Format = desc.Format;
-		staging_frame_buffer_desc_.Width = desc.Width * 2;
-		staging_frame_buffer_desc_.Height = desc.Height;
-		staging_frame_buffer_desc_.MipLevels = 1;
-		staging_frame_buffer_desc_.SampleDesc.Count = 1;
-		staging_frame_buffer_desc_.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
-		staging_frame_buffer_desc_.Usage = D3D11_USAGE_STAGING;
-		d3d_device_->CreateTexture2D(
-			&staging_frame_buffer_desc_, nullptr, &staging_frame_buffer_);
+		staging_frame_buffer_desc = desc;
 	}
-	// Resizes if needed.
-	else if ((staging_frame_buffer_desc_.Width / 2) != desc.Width ||
-		staging_frame_buffer_desc_.Height != desc.Height)
+
+	// Lazily creates a staging buffer, more than one is only needed while
+	// frames are waiting in the capture pipeline or in the encoder.
+	if (!staging_frame_buffer)
 	{
-		staging_frame_buffer_desc_.Width = desc.Width * 2;
-		staging_frame_buffer_desc_.Height = desc.Height;
-		d3d_device_->CreateTexture2D(&staging_frame_buffer_desc_, nullptr,
-			&staging_frame_buffer_);
+		d3d_device_->CreateTexture2D(
+			&staging_frame_buffer_desc, nullptr, &staging_frame_buffer);
 	}
 
-	// Copies the left and right frame buffers to the staging one.		
-	d3d_context_->CopySubresourceRegion(staging_frame_buffer_.Get(), 0, 0, 0, 0, 
-		left_frame_buffer, 0, 0);
-
-	d3d_context_->CopySubresourceRegion(staging_frame_buffer_.Get(), 0, desc.Width, 0, 0,
-		right_frame_buffer, 0, 0);
+	// The buffer goes back to the free list once the capture task and the
+	// frame holding it have been released.
+	std::weak_ptr<StagingBufferList> free_list = staging_frame_buffers_;
+	return std::shared_ptr<ID3D11Texture2D>(staging_frame_buffer.Detach(),
+		[free_list](ID3D11Texture2D* texture)
+		{
+			ComPtr<ID3D11Texture2D> staging_frame_buffer;
+			staging_frame_buffer.Attach(texture);
+
+			std::shared_ptr<StagingBufferList> staging_frame_buffers = free_list.lock();
+			if (!staging_frame_buffers)
+			{
+				return;
+			}
+
+			D3D11_TEXTURE2D_DESC desc;
+			texture->GetDesc(&desc);
+
+			rtc::CritScope cs(&staging_frame_buffers->lock);
+			if (desc.Format == staging_frame_buffers->desc.Format &&
+				desc.Width == staging_frame_buffers->desc.Width &&
+				desc.Height == staging_frame_buffers->desc.Height)
+			{
+				staging_frame_buffers->buffers.push_back(staging_frame_buffer);
+			}
+		});
 }
 
 void DirectXBufferCapturer::ResizeRenderTexture(int width, int height)
 {
+	// Frame buffers of the previous size are no longer needed.
+	frame_buffer_pool_.Release();
+
 	D3D11_TEXTURE2D_DESC desc = { 0 };
 	desc.ArraySize = 1;
 	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
@@ -0,0 +1,165 @@
+#include "pch.h"
+
+#include "encoder_backend.h"
+#include "null_video_encoder.h"
+
+#include "webrtc/base/logging.h"
+#include "webrtc/media/base/mediaconstants.h"
+#include "webrtc/modules/video_coding/codecs/h264/include/h264.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const char* const kBackendNames[] = { "nvenc", "software", "null" };
+
+	// Rates a warmed up session starts with, InitEncode() is called again
+	// with the negotiated ones when the session is handed out.
+	const int kWarmUpStartBitrateKbps = 300;
+	const int kWarmUpMaxBitrateKbps = 20000;
+	const int kWarmUpMaxFramerate = 60;
+}
+
+EncoderBackendFactory::EncoderBackendFactory(EncoderBackend backend, size_t null_frame_size,
+	std::shared_ptr<EncoderSessionPool> session_pool) :
+	backend_(backend),
+	null_frame_size_(null_frame_size > 0 ? null_frame_size : NULL_ENCODER_FRAME_SIZE),
+	session_pool_(session_pool)
+{
+	// Without OpenH264 the software backend has nothing to offer, WebRTC then
+	// falls back to its internal encoders.
+	if (backend_ == kEncoderBackendSoftware && !webrtc::H264Encoder::IsSupported())
+	{
+		LOG(LS_ERROR) << "Software encoder backend requires OpenH264.";
+		return;
+	}
+
+	supported_codecs_.push_back(GetH264Codec());
+}
+
+EncoderBackend EncoderBackendFactory::GetConfiguredBackend(const NvEncConfig& config)
+{
+	for (size_t i = 0; i < sizeof(kBackendNames) / sizeof(kBackendNames[0]); i++)
+	{
+		if (config.encoder_backend == kBackendNames[i])
+		{
+			return static_cast<EncoderBackend>(i);
+		}
+	}
+
+	if (!config.encoder_backend.empty())
+	{
+		LOG(LS_WARNING) << "Unknown encoder backend: " << config.encoder_backend;
+	}
+
+	return config.use_software_encoding ? kEncoderBackendSoftware : kEncoderBackendNvenc;
+}
+
+const char* EncoderBackendFactory::GetBackendName(EncoderBackend backend)
+{
+	return kBackendNames[backend];
+}
+
+std::shared_ptr<EncoderSessionPool> EncoderBackendFactory::CreateSessionPool(
+	EncoderBackend backend, const NvEncConfig& config)
+{
+	if (config.encoder_pool_size == 0)
+	{
+		return nullptr;
+	}
+
+	size_t null_frame_size = config.null_encoder_frame_size > 0 ?
+		config.null_encoder_frame_size : NULL_ENCODER_FRAME_SIZE;
+
+	return std::make_shared<EncoderSessionPool>(
+		[backend, null_frame_size]()
+		{
+			return CreateBackendEncoder(backend, GetH264Codec(), null_frame_size);
+		},
+		config.encoder_pool_size,
+		config.encoder_pool_idle_timeout_ms);
+}
+
+webrtc::VideoCodec EncoderBackendFactory::GetCodecSettings(int width, int height, int max_framerate)
+{
+	webrtc::VideoCodec codec_settings;
+	codec_settings.codecType = webrtc::kVideoCodecH264;
+	codec_settings.width = width;
+	codec_settings.height = height;
+	codec_settings.maxFramerate = max_framerate > 0 ? max_framerate : kWarmUpMaxFramerate;
+	codec_settings.startBitrate = kWarmUpStartBitrateKbps;
+	codec_settings.targetBitrate = kWarmUpStartBitrateKbps;
+	codec_settings.maxBitrate = kWarmUpMaxBitrateKbps;
+	*codec_settings.H264() = webrtc::VideoEncoder::GetDefaultH264Settings();
+	return codec_settings;
+}
+
+BackendVideoEncoder* EncoderBackendFactory::CreateBackendEncoder(EncoderBackend backend,
+	const cricket::VideoCodec& codec, size_t null_frame_size)
+{
+	if (backend == kEncoderBackendNull)
+	{
+		return new NullVideoEncoder(codec, null_frame_size);
+	}
+
+	// An explicit hardware flag overrides useSoftwareEncoding in the patched
+	// H264EncoderImpl.
+	cricket::VideoCodec encoder_codec(codec);
+	encoder_codec.SetParam(cricket::kH264UseHWNvencode,
+		backend == kEncoderBackendNvenc ? 1 : 0);
+
+	return new H264BackendEncoder(encoder_codec);
+}
+
+webrtc::VideoEncoder* EncoderBackendFactory::CreateVideoEncoder(
+	const cricket::VideoCodec& codec)
+{
+	if (!cricket::CodecNamesEq(codec.name, cricket::kH264CodecName))
+	{
+		return nullptr;
+	}
+
+	BackendVideoEncoder* encoder = session_pool_ ?
+		new PooledVideoEncoder(session_pool_) :
+		CreateBackendEncoder(backend_, codec, null_frame_size_);
+
+	rtc::CritScope cs(&encoders_lock_);
+	encoders_[encoder] = encoder;
+	return encoder;
+}
+
+const std::vector<cricket::VideoCodec>& EncoderBackendFactory::supported_codecs() const
+{
+	return supported_codecs_;
+}
+
+void EncoderBackendFactory::DestroyVideoEncoder(webrtc::VideoEncoder* encoder)
+{
+	{
+		rtc::CritScope cs(&encoders_lock_);
+		encoders_.erase(encoder);
+	}
+
+	delete encoder;
+}
+
+void EncoderBackendFactory::ReportFrameLoss(uint32_t rtp_timestamp)
+{
+	rtc::CritScope cs(&encoders_lock_);
+	for (const auto& encoder : encoders_)
+	{
+		encoder.second->ReportFrameLoss(rtp_timestamp);
+	}
+}
+
+cricket::VideoCodec EncoderBackendFactory::GetH264Codec()
+{
+	// Same H.264 parameters as the internal encoder factory.
+	cricket::VideoCodec codec(cricket::kH264CodecName);
+	codec.SetParam(cricket::kH264FmtpProfileLevelId,
+		cricket::kH264ProfileLevelConstrainedBaseline);
+
+	codec.SetParam(cricket::kH264FmtpLevelAsymmetryAllowed, "1");
+	codec.SetParam(cricket::kH264FmtpPacketizationMode, "1");
+	return codec;
+}
@@ -0,0 +1,464 @@
+#include "pch.h"
+
+#include "encoder_session_pool.h"
+
+#include "webrtc/base/logging.h"
+#include "webrtc/base/timeutils.h"
+#include "webrtc/modules/video_coding/include/video_error_codes.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	// Warmed sessions are initialized again with the actual payload size when
+	// they're handed out.
+	const size_t kWarmUpMaxPayloadSize = 1200;
+}
+
+EncoderSessionPool::EncoderSessionPool(EncoderFactory create_encoder,
+	size_t warm_sessions, int64_t idle_timeout_ms) :
+	create_encoder_(create_encoder),
+	warm_sessions_(warm_sessions),
+	idle_timeout_ms_(idle_timeout_ms),
+	warming_up_(false),
+	stopping_(false),
+	hit_count_(0),
+	miss_count_(0),
+	pooled_first_frame_total_ms_(0),
+	pooled_first_frame_count_(0),
+	cold_first_frame_total_ms_(0),
+	cold_first_frame_count_(0)
+{
+}
+
+EncoderSessionPool::~EncoderSessionPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+
+	if (warm_up_thread_.joinable())
+	{
+		warm_up_thread_.join();
+	}
+
+	ReleaseSessions(&idle_sessions_);
+}
+
+void EncoderSessionPool::WarmUp(const webrtc::VideoCodec& codec_settings)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	SessionKey key = GetKey(codec_settings);
+	if (!IsWarmKey(key))
+	{
+		warm_keys_.push_back(key);
+	}
+
+	warm_up_requests_.push_back(codec_settings);
+	if (!warming_up_)
+	{
+		// A previous warm up thread has already returned.
+		if (warm_up_thread_.joinable())
+		{
+			warm_up_thread_.join();
+		}
+
+		warming_up_ = true;
+		warm_up_thread_ = std::thread(&EncoderSessionPool::WarmUpThread, this);
+	}
+}
+
+void EncoderSessionPool::WaitForWarmUp()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	warm_up_done_.wait(lock, [this] { return !warming_up_; });
+}
+
+std::unique_ptr<BackendVideoEncoder> EncoderSessionPool::Acquire(
+	const webrtc::VideoCodec& codec_settings)
+{
+	std::unique_ptr<BackendVideoEncoder> encoder;
+	std::list<IdleSession> evicted;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		SessionKey key = GetKey(codec_settings);
+
+		// Hands out the most recently returned session.
+		for (auto it = idle_sessions_.rbegin(); it != idle_sessions_.rend(); ++it)
+		{
+			if (it->key == key)
+			{
+				encoder = std::move(it->encoder);
+				idle_sessions_.erase(std::next(it).base());
+				break;
+			}
+		}
+
+		if (encoder)
+		{
+			hit_count_++;
+		}
+		else
+		{
+			miss_count_++;
+		}
+
+		CollectIdleSessions(rtc::TimeMillis(), &evicted);
+	}
+
+	ReleaseSessions(&evicted);
+	return encoder;
+}
+
+void EncoderSessionPool::Return(const webrtc::VideoCodec& codec_settings,
+	std::unique_ptr<BackendVideoEncoder> encoder)
+{
+	if (!encoder)
+	{
+		return;
+	}
+
+	std::list<IdleSession> evicted;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		IdleSession session = { GetKey(codec_settings), std::move(encoder), rtc::TimeMillis() };
+		(stopping_ ? evicted : idle_sessions_).push_back(std::move(session));
+		CollectIdleSessions(rtc::TimeMillis(), &evicted);
+	}
+
+	ReleaseSessions(&evicted);
+}
+
+void EncoderSessionPool::EvictIdleSessions(int64_t now_ms)
+{
+	std::list<IdleSession> evicted;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		CollectIdleSessions(now_ms, &evicted);
+	}
+
+	ReleaseSessions(&evicted);
+}
+
+void EncoderSessionPool::ReportTimeToFirstFrame(int64_t elapsed_ms, bool pooled)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (pooled)
+		{
+			pooled_first_frame_total_ms_ += elapsed_ms;
+			pooled_first_frame_count_++;
+		}
+		else
+		{
+			cold_first_frame_total_ms_ += elapsed_ms;
+			cold_first_frame_count_++;
+		}
+	}
+
+	LOG(INFO) << "Time to first encoded frame: " << elapsed_ms << "ms ("
+		<< (pooled ? "pooled" : "new") << " encoder session)";
+}
+
+int64_t EncoderSessionPool::average_pooled_time_to_first_frame_ms() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pooled_first_frame_count_ > 0 ?
+		pooled_first_frame_total_ms_ / static_cast<int64_t>(pooled_first_frame_count_) : -1;
+}
+
+int64_t EncoderSessionPool::average_cold_time_to_first_frame_ms() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return cold_first_frame_count_ > 0 ?
+		cold_first_frame_total_ms_ / static_cast<int64_t>(cold_first_frame_count_) : -1;
+}
+
+uint64_t EncoderSessionPool::hit_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hit_count_;
+}
+
+uint64_t EncoderSessionPool::miss_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return miss_count_;
+}
+
+size_t EncoderSessionPool::idle_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return idle_sessions_.size();
+}
+
+EncoderSessionPool::SessionKey EncoderSessionPool::GetKey(
+	const webrtc::VideoCodec& codec_settings)
+{
+	SessionKey key = { codec_settings.codecType, codec_settings.width, codec_settings.height };
+	return key;
+}
+
+bool EncoderSessionPool::IsWarmKey(const SessionKey& key) const
+{
+	for (const auto& warm_key : warm_keys_)
+	{
+		if (warm_key == key)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void EncoderSessionPool::CollectIdleSessions(int64_t now_ms, std::list<IdleSession>* evicted)
+{
+	// Walks from the most recently returned session, the first
+	// |warm_sessions_| ones of a warmed key are kept regardless of age.
+	std::vector<SessionKey> kept_keys;
+	auto it = idle_sessions_.end();
+	while (it != idle_sessions_.begin())
+	{
+		--it;
+		size_t kept = 0;
+		for (const auto& kept_key : kept_keys)
+		{
+			kept += kept_key == it->key ? 1 : 0;
+		}
+
+		bool warm = IsWarmKey(it->key) && kept < warm_sessions_;
+		if (!warm && now_ms - it->idle_since_ms < idle_timeout_ms_)
+		{
+			continue;
+		}
+
+		if (warm)
+		{
+			kept_keys.push_back(it->key);
+			continue;
+		}
+
+		auto evicted_it = it++;
+		evicted->splice(evicted->end(), idle_sessions_, evicted_it);
+	}
+}
+
+void EncoderSessionPool::ReleaseSessions(std::list<IdleSession>* sessions)
+{
+	for (auto& session : *sessions)
+	{
+		session.encoder->Release();
+	}
+
+	sessions->clear();
+}
+
+void EncoderSessionPool::WarmUpThread()
+{
+	while (true)
+	{
+		webrtc::VideoCodec codec_settings;
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stopping_ || warm_up_requests_.empty())
+			{
+				warm_up_requests_.clear();
+				warming_up_ = false;
+				warm_up_done_.notify_all();
+				return;
+			}
+
+			codec_settings = warm_up_requests_.front();
+			warm_up_requests_.erase(warm_up_requests_.begin());
+		}
+
+		SessionKey key = GetKey(codec_settings);
+		while (true)
+		{
+			{
+				// Sessions returned meanwhile count as warm.
+				std::lock_guard<std::mutex> lock(mutex_);
+				size_t idle = 0;
+				for (const auto& session : idle_sessions_)
+				{
+					idle += session.key == key ? 1 : 0;
+				}
+
+				if (stopping_ || idle >= warm_sessions_)
+				{
+					break;
+				}
+			}
+
+			int64_t start_ms = rtc::TimeMillis();
+			std::unique_ptr<BackendVideoEncoder> encoder(create_encoder_());
+			if (!encoder || encoder->InitEncode(&codec_settings, 1,
+				kWarmUpMaxPayloadSize) != WEBRTC_VIDEO_CODEC_OK)
+			{
+				LOG(LS_WARNING) << "Failed to warm up an encoder session for "
+					<< codec_settings.width << "x" << codec_settings.height;
+
+				break;
+			}
+
+			LOG(INFO) << "Warmed up an encoder session for " << codec_settings.width
+				<< "x" << codec_settings.height << " in " << rtc::TimeMillis() - start_ms << "ms";
+
+			Return(codec_settings, std::move(encoder));
+		}
+	}
+}
+
+PooledVideoEncoder::PooledVideoEncoder(std::shared_ptr<EncoderSessionPool> pool) :
+	pool_(pool),
+	callback_(nullptr),
+	pooled_(false),
+	init_time_ms_(0),
+	first_frame_reported_(true)
+{
+}
+
+PooledVideoEncoder::~PooledVideoEncoder()
+{
+	Release();
+}
+
+int32_t PooledVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
+	int32_t number_of_cores,
+	size_t max_payload_size)
+{
+	if (!codec_settings)
+	{
+		return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+	}
+
+	// Gives back the session of a previous resolution.
+	Release();
+
+	init_time_ms_ = rtc::TimeMillis();
+	std::unique_ptr<BackendVideoEncoder> encoder = pool_->Acquire(*codec_settings);
+	pooled_ = encoder != nullptr;
+	if (!encoder)
+	{
+		encoder.reset(pool_->CreateEncoder());
+		if (!encoder)
+		{
+			return WEBRTC_VIDEO_CODEC_ERROR;
+		}
+	}
+
+	encoder->RegisterEncodeCompleteCallback(this);
+	int32_t result = encoder->InitEncode(codec_settings, number_of_cores, max_payload_size);
+	if (result != WEBRTC_VIDEO_CODEC_OK)
+	{
+		encoder->Release();
+		return result;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(encoder_mutex_);
+		encoder_ = std::move(encoder);
+	}
+
+	codec_settings_ = *codec_settings;
+	first_frame_reported_ = false;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PooledVideoEncoder::RegisterEncodeCompleteCallback(
+	webrtc::EncodedImageCallback* callback)
+{
+	callback_ = callback;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PooledVideoEncoder::Release()
+{
+	std::unique_ptr<BackendVideoEncoder> encoder;
+	{
+		std::lock_guard<std::mutex> lock(encoder_mutex_);
+		encoder = std::move(encoder_);
+	}
+
+	if (encoder)
+	{
+		// The session outlives this encoder.
+		encoder->RegisterEncodeCompleteCallback(nullptr);
+		pool_->Return(codec_settings_, std::move(encoder));
+	}
+
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PooledVideoEncoder::Encode(const webrtc::VideoFrame& frame,
+	const webrtc::CodecSpecificInfo* codec_specific_info,
+	const std::vector<webrtc::FrameType>* frame_types)
+{
+	if (!encoder_)
+	{
+		return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+	}
+
+	return encoder_->Encode(frame, codec_specific_info, frame_types);
+}
+
+int32_t PooledVideoEncoder::SetChannelParameters(uint32_t packet_loss, int64_t rtt)
+{
+	return encoder_ ? encoder_->SetChannelParameters(packet_loss, rtt) :
+		WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PooledVideoEncoder::SetRateAllocation(
+	const webrtc::BitrateAllocation& allocation, uint32_t framerate)
+{
+	return encoder_ ? encoder_->SetRateAllocation(allocation, framerate) :
+		WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t PooledVideoEncoder::SetPeriodicKeyFrames(bool enable)
+{
+	return encoder_ ? encoder_->SetPeriodicKeyFrames(enable) :
+		WEBRTC_VIDEO_CODEC_OK;
+}
+
+webrtc::VideoEncoder::ScalingSettings PooledVideoEncoder::GetScalingSettings() const
+{
+	return encoder_ ? encoder_->GetScalingSettings() :
+		webrtc::VideoEncoder::ScalingSettings(false);
+}
+
+const char* PooledVideoEncoder::ImplementationName() const
+{
+	return encoder_ ? encoder_->ImplementationName() : "PooledEncoder";
+}
+
+void PooledVideoEncoder::ReportFrameLoss(uint32_t rtp_timestamp)
+{
+	std::lock_guard<std::mutex> lock(encoder_mutex_);
+	if (encoder_)
+	{
+		encoder_->ReportFrameLoss(rtp_timestamp);
+	}
+}
+
+webrtc::EncodedImageCallback::Result PooledVideoEncoder::OnEncodedImage(
+	const webrtc::EncodedImage& encoded_image,
+	const webrtc::CodecSpecificInfo* codec_specific_info,
+	const webrtc::RTPFragmentationHeader* fragmentation)
+{
+	if (!first_frame_reported_)
+	{
+		first_frame_reported_ = true;
+		pool_->ReportTimeToFirstFrame(rtc::TimeMillis() - init_time_ms_, pooled_);
+	}
+
+	if (!callback_)
+	{
+		return webrtc::EncodedImageCallback::Result(
+			webrtc::EncodedImageCallback::Result::ERROR_SEND_FAILED);
+	}
+
+	return callback_->OnEncodedImage(encoded_image, codec_specific_info, fragmentation);
+}
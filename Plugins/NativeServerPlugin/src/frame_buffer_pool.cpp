@@ -0,0 +1,73 @@
+#include "pch.h"
+
+#include "frame_buffer_pool.h"
+
+using namespace StreamingToolkit;
+
+FrameBufferPool::FrameBufferPool(size_t max_number_of_buffers) :
+	pool_(false, max_number_of_buffers),
+	width_(0),
+	height_(0),
+	hit_count_(0),
+	miss_count_(0)
+{
+}
+
+rtc::scoped_refptr<webrtc::I420Buffer> FrameBufferPool::CreateBuffer(int width, int height)
+{
+	rtc::CritScope cs(&lock_);
+
+	// The pool drops buffers of the previous frame size.
+	if (width != width_ || height != height_)
+	{
+		pooled_buffers_.clear();
+		width_ = width;
+		height_ = height;
+	}
+
+	// The pool is full and every buffer is in use.
+	rtc::scoped_refptr<webrtc::I420Buffer> buffer = pool_.CreateBuffer(width, height);
+	if (!buffer)
+	{
+		miss_count_++;
+		return webrtc::I420Buffer::Create(width, height);
+	}
+
+	if (pooled_buffers_.insert(buffer.get()).second)
+	{
+		miss_count_++;
+	}
+	else
+	{
+		hit_count_++;
+	}
+
+	return buffer;
+}
+
+void FrameBufferPool::Release()
+{
+	rtc::CritScope cs(&lock_);
+	pool_.Release();
+	pooled_buffers_.clear();
+	width_ = 0;
+	height_ = 0;
+}
+
+uint64_t FrameBufferPool::hit_count() const
+{
+	rtc::CritScope cs(&lock_);
+	return hit_count_;
+}
+
+uint64_t FrameBufferPool::miss_count() const
+{
+	rtc::CritScope cs(&lock_);
+	return miss_count_;
+}
+
+size_t FrameBufferPool::size() const
+{
+	rtc::CritScope cs(&lock_);
+	return pooled_buffers_.size();
+}
@@ -0,0 +1,141 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "frame_change_detector.h"
+
+#include "libyuv/compare.h"
+
+using namespace StreamingToolkit;
+
+FrameChangeDetector::FrameChangeDetector(int tile_size) :
+	tile_size_(std::max(tile_size, 1)),
+	width_(0),
+	height_(0),
+	tile_columns_(0),
+	tile_rows_(0),
+	frames_checked_(0),
+	frames_skipped_(0),
+	frames_resent_(0),
+	frames_converted_(0),
+	hash_time_us_(0),
+	conversion_time_us_(0)
+{
+}
+
+bool FrameChangeDetector::Update(const uint8_t* data, int stride, int width, int height)
+{
+	auto start = std::chrono::steady_clock::now();
+	rtc::CritScope cs(&lock_);
+
+	// A new frame size invalidates every tile.
+	bool size_changed = width != width_ || height != height_;
+	if (size_changed)
+	{
+		width_ = width;
+		height_ = height;
+		tile_columns_ = (width + tile_size_ - 1) / tile_size_;
+		tile_rows_ = (height + tile_size_ - 1) / tile_size_;
+		tile_hashes_.assign(tile_columns_ * tile_rows_, 0);
+		dirty_mask_.assign(tile_columns_ * tile_rows_, 1);
+	}
+
+	bool changed = size_changed;
+	for (int tile_row = 0; tile_row < tile_rows_; tile_row++)
+	{
+		int top = tile_row * tile_size_;
+		int rows = std::min(tile_size_, height - top);
+		for (int tile_column = 0; tile_column < tile_columns_; tile_column++)
+		{
+			int left = tile_column * tile_size_;
+			int columns = std::min(tile_size_, width - left);
+
+			// Chains the tile rows through the seed, libyuv picks the SIMD
+			// implementation supported by the CPU.
+			uint32_t hash = 5381;
+			const uint8_t* row = data + top * stride + left * 4;
+			for (int y = 0; y < rows; y++)
+			{
+				hash = libyuv::HashDjb2(row, columns * 4, hash);
+				row += stride;
+			}
+
+			int tile = tile_row * tile_columns_ + tile_column;
+			bool tile_changed = size_changed || hash != tile_hashes_[tile];
+			tile_hashes_[tile] = hash;
+			dirty_mask_[tile] = tile_changed ? 1 : 0;
+			changed |= tile_changed;
+		}
+	}
+
+	frames_checked_++;
+	hash_time_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count();
+
+	return changed;
+}
+
+void FrameChangeDetector::Reset()
+{
+	rtc::CritScope cs(&lock_);
+	width_ = 0;
+	height_ = 0;
+	tile_columns_ = 0;
+	tile_rows_ = 0;
+	tile_hashes_.clear();
+	dirty_mask_.clear();
+}
+
+void FrameChangeDetector::OnFrameConverted(int64_t conversion_time_us)
+{
+	rtc::CritScope cs(&lock_);
+	frames_converted_++;
+	conversion_time_us_ += conversion_time_us;
+}
+
+void FrameChangeDetector::OnFrameUnchanged(bool resent)
+{
+	rtc::CritScope cs(&lock_);
+	if (resent)
+	{
+		frames_resent_++;
+	}
+	else
+	{
+		frames_skipped_++;
+	}
+}
+
+FrameChangeDetector::Stats FrameChangeDetector::GetStats() const
+{
+	rtc::CritScope cs(&lock_);
+	Stats stats;
+	stats.frames_checked = frames_checked_;
+	stats.frames_skipped = frames_skipped_;
+	stats.frames_resent = frames_resent_;
+	stats.hash_time_us = hash_time_us_;
+	stats.conversion_time_saved_us = frames_converted_ > 0 ?
+		conversion_time_us_ / (int64_t)frames_converted_ *
+		(int64_t)(frames_skipped_ + frames_resent_) : 0;
+
+	return stats;
+}
+
+std::vector<uint8_t> FrameChangeDetector::dirty_mask() const
+{
+	rtc::CritScope cs(&lock_);
+	return dirty_mask_;
+}
+
+int FrameChangeDetector::tile_columns() const
+{
+	rtc::CritScope cs(&lock_);
+	return tile_columns_;
+}
+
+int FrameChangeDetector::tile_rows() const
+{
+	rtc::CritScope cs(&lock_);
+	return tile_rows_;
+}
@@ -0,0 +1,98 @@
+#include "pch.h"
+
+#include <algorithm>
+
+#include "frame_converter.h"
+#include "plugindefs.h"
+
+#include "libyuv/convert.h"
+
+using namespace StreamingToolkit;
+
+FrameConverter::FrameConverter(int thread_count)
+{
+	SetThreadCount(thread_count);
+}
+
+void FrameConverter::SetThreadCount(int thread_count)
+{
+	worker_pool_.reset(new WorkerPool(std::max(thread_count, 1)));
+}
+
+int FrameConverter::thread_count() const
+{
+	return worker_pool_->thread_count();
+}
+
+int FrameConverter::ABGRToI420(const uint8_t* src_frame, int src_stride_frame,
+	uint8_t* dst_y, int dst_stride_y,
+	uint8_t* dst_u, int dst_stride_u,
+	uint8_t* dst_v, int dst_stride_v,
+	int width, int height)
+{
+	return ConvertToI420(libyuv::ABGRToI420, src_frame, src_stride_frame,
+		dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v,
+		width, height);
+}
+
+int FrameConverter::ARGBToI420(const uint8_t* src_frame, int src_stride_frame,
+	uint8_t* dst_y, int dst_stride_y,
+	uint8_t* dst_u, int dst_stride_u,
+	uint8_t* dst_v, int dst_stride_v,
+	int width, int height)
+{
+	return ConvertToI420(libyuv::ARGBToI420, src_frame, src_stride_frame,
+		dst_y, dst_stride_y, dst_u, dst_stride_u, dst_v, dst_stride_v,
+		width, height);
+}
+
+int FrameConverter::ConvertToI420(ConvertToI420Func convert,
+	const uint8_t* src_frame, int src_stride_frame,
+	uint8_t* dst_y, int dst_stride_y,
+	uint8_t* dst_u, int dst_stride_u,
+	uint8_t* dst_v, int dst_stride_v,
+	int width, int height)
+{
+	// Flipped (negative height) frames are left to libyuv.
+	int stripe_count = std::min(worker_pool_->thread_count(),
+		(height + MIN_CONVERSION_STRIPE_HEIGHT - 1) / MIN_CONVERSION_STRIPE_HEIGHT);
+
+	if (stripe_count <= 1)
+	{
+		return convert(src_frame, src_stride_frame, dst_y, dst_stride_y,
+			dst_u, dst_stride_u, dst_v, dst_stride_v, width, height);
+	}
+
+	// Rounds the stripe height up to an even number of rows.
+	int stripe_height = (height + stripe_count - 1) / stripe_count;
+	stripe_height = (stripe_height + 1) & ~1;
+
+	std::atomic<int> result(0);
+	worker_pool_->ParallelFor(stripe_count, [&](int stripe)
+	{
+		int top = stripe * stripe_height;
+		int rows = std::min(stripe_height, height - top);
+		if (rows <= 0)
+		{
+			return;
+		}
+
+		int chroma_top = top / 2;
+		if (convert(
+			src_frame + top * src_stride_frame,
+			src_stride_frame,
+			dst_y + top * dst_stride_y,
+			dst_stride_y,
+			dst_u + chroma_top * dst_stride_u,
+			dst_stride_u,
+			dst_v + chroma_top * dst_stride_v,
+			dst_stride_v,
+			width,
+			rows) != 0)
+		{
+			result = -1;
+		}
+	});
+
+	return result;
+}
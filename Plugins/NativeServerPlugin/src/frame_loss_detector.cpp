@@ -0,0 +1,37 @@
+#include "pch.h"
+
+#include "frame_loss_detector.h"
+
+using namespace StreamingToolkit;
+
+FrameLossDetector::FrameLossDetector(int64_t min_lost_packets, int min_polls) :
+	min_lost_packets_(min_lost_packets),
+	min_polls_(min_polls)
+{
+	Reset();
+}
+
+bool FrameLossDetector::Update(const Counters& counters)
+{
+	bool key_frame_requested = counters.plis > last_.plis || counters.firs > last_.firs;
+
+	// Late retransmissions and duplicates can lower the cumulative loss.
+	int64_t lost_packets = counters.packets_lost - last_.packets_lost;
+	last_ = counters;
+	lossy_polls_ = lost_packets > min_lost_packets_ ? lossy_polls_ + 1 : 0;
+	if (key_frame_requested || lossy_polls_ >= min_polls_)
+	{
+		lossy_polls_ = 0;
+		return true;
+	}
+
+	return false;
+}
+
+void FrameLossDetector::Reset()
+{
+	last_.plis = 0;
+	last_.firs = 0;
+	last_.packets_lost = 0;
+	lossy_polls_ = 0;
+}
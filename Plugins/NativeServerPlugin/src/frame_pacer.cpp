@@ -0,0 +1,141 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "frame_pacer.h"
+#include "plugindefs.h"
+
+#ifdef _WIN32
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif // _WIN32
+
+using namespace StreamingToolkit;
+
+FramePacer::FramePacer(int fps) :
+	started_(false),
+	frames_(0),
+	skipped_slots_(0),
+	interval_count_(0),
+	intervals_us_(FRAME_PACER_HISTORY_SIZE, 0),
+	next_interval_(0)
+{
+#ifdef _WIN32
+	// Raises the system timer resolution so that sleeping close to the
+	// deadline doesn't overshoot by a full scheduler tick.
+	timeBeginPeriod(1);
+#endif // _WIN32
+
+	SetFrameRate(fps);
+}
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	timeEndPeriod(1);
+#endif // _WIN32
+}
+
+void FramePacer::SetFrameRate(int fps)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	interval_ = std::chrono::duration_cast<Clock::duration>(
+		std::chrono::duration<double>(1.0 / std::max(fps, 1)));
+
+	started_ = false;
+}
+
+void FramePacer::WaitForNextFrame()
+{
+	const auto idle_threshold = std::chrono::milliseconds(FRAME_PACER_IDLE_THRESHOLD_MS);
+	Clock::time_point now = Clock::now();
+	Clock::time_point deadline;
+	bool resumed = false;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!started_)
+		{
+			// The first frame sets the start of the slot grid.
+			next_deadline_ = now;
+			started_ = true;
+		}
+		else if (now - next_deadline_ >= idle_threshold)
+		{
+			// No frame was due while the render loop was idle, the grid
+			// restarts from this frame.
+			next_deadline_ = now;
+			resumed = true;
+		}
+		else if (now >= next_deadline_ + interval_)
+		{
+			// Skips the slots that went by during an overrun, the frame then
+			// starts late in the current slot instead of catching up.
+			int64_t missed_slots = (now - next_deadline_) / interval_;
+			next_deadline_ += missed_slots * interval_;
+			skipped_slots_ += missed_slots;
+		}
+
+		deadline = next_deadline_;
+		next_deadline_ += interval_;
+	}
+
+	WaitUntil(deadline);
+	RecordFrame(Clock::now(), resumed);
+}
+
+FramePacer::Stats FramePacer::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats stats = { 0 };
+	stats.frames = frames_;
+	stats.skipped_slots = skipped_slots_;
+
+	size_t count = static_cast<size_t>(std::min<uint64_t>(
+		interval_count_, intervals_us_.size()));
+
+	if (count > 0)
+	{
+		std::vector<int64_t> intervals(intervals_us_.begin(), intervals_us_.begin() + count);
+		std::sort(intervals.begin(), intervals.end());
+		stats.p50_interval_ms = intervals[(count - 1) * 50 / 100] / 1000.0;
+		stats.p99_interval_ms = intervals[(count - 1) * 99 / 100] / 1000.0;
+	}
+
+	return stats;
+}
+
+void FramePacer::WaitUntil(Clock::time_point deadline)
+{
+	// Sleeps while the deadline is far enough for the timer resolution, then
+	// spins for the remainder.
+	const auto spin_threshold = std::chrono::microseconds(FRAME_PACER_SPIN_THRESHOLD_US);
+	Clock::time_point now = Clock::now();
+	if (deadline - now > spin_threshold)
+	{
+		std::this_thread::sleep_until(deadline - spin_threshold);
+	}
+
+	while (Clock::now() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::RecordFrame(Clock::time_point time, bool resumed)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	// The first frame has no interval.
+	if (frames_ > 0 && !resumed)
+	{
+		intervals_us_[next_interval_] = std::chrono::duration_cast<std::chrono::microseconds>(
+			time - last_frame_time_).count();
+
+		next_interval_ = (next_interval_ + 1) % intervals_us_.size();
+		interval_count_++;
+	}
+
+	last_frame_time_ = time;
+	frames_++;
+}
@@ -0,0 +1,363 @@
+#include "pch.h"
+
+#include <string.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
+#include "frame_recorder.h"
+#include "plugindefs.h"
+
+#include "webrtc/base/logging.h"
+#include "webrtc/system_wrappers/include/aligned_malloc.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const char kFrameHeader[] = "FRAME\n";
+	const size_t kFrameHeaderSize = sizeof(kFrameHeader) - 1;
+
+#ifdef _WIN32
+	const HANDLE kInvalidFile = INVALID_HANDLE_VALUE;
+#else
+	const int kInvalidFile = -1;
+#endif // _WIN32
+}
+
+FrameRecorder::FrameRecorder() :
+	current_chunk_(nullptr),
+	current_size_(0),
+	frame_rate_(0),
+	width_(0),
+	height_(0),
+	failed_(false),
+	stopping_(false),
+	frames_recorded_(0),
+	frames_dropped_(0),
+	bytes_queued_(0),
+	bytes_written_(0),
+	file_(kInvalidFile)
+{
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	Close();
+}
+
+bool FrameRecorder::Open(const std::string& path, int frame_rate)
+{
+	std::lock_guard<std::mutex> frame_lock(frame_mutex_);
+	if (file_ != kInvalidFile)
+	{
+		return false;
+	}
+
+#ifdef _WIN32
+	// Unbuffered writes must be sector aligned in size and address.
+	file_ = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, nullptr);
+#else
+#ifdef O_DIRECT
+	file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+
+	// Some file systems, tmpfs for instance, don't support direct I/O.
+	if (file_ == kInvalidFile && errno == EINVAL)
+#endif // O_DIRECT
+	{
+		file_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	}
+#endif // _WIN32
+
+	if (file_ == kInvalidFile)
+	{
+		LOG(LS_ERROR) << "Failed to create the frame recording " << path;
+		return false;
+	}
+
+	for (int i = 0; i < FRAME_RECORDER_CHUNK_COUNT; i++)
+	{
+		uint8_t* chunk = static_cast<uint8_t*>(webrtc::AlignedMalloc(
+			FRAME_RECORDER_CHUNK_SIZE, FRAME_RECORDER_WRITE_ALIGNMENT));
+
+		chunks_.push_back(chunk);
+		free_chunks_.push_back(chunk);
+	}
+
+	frame_rate_ = std::max(frame_rate, 1);
+	width_ = 0;
+	height_ = 0;
+	failed_ = false;
+	stopping_ = false;
+	frames_recorded_ = 0;
+	frames_dropped_ = 0;
+	bytes_queued_ = 0;
+	bytes_written_ = 0;
+	thread_ = std::thread(&FrameRecorder::Run, this);
+	return true;
+}
+
+void FrameRecorder::Close()
+{
+	std::lock_guard<std::mutex> frame_lock(frame_mutex_);
+	if (file_ == kInvalidFile)
+	{
+		return;
+	}
+
+	// The flush thread writes the full chunks before exiting.
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+
+	chunk_full_.notify_one();
+	thread_.join();
+
+	// Pads the last chunk to the write alignment, then cuts the padding off.
+	if (current_chunk_ && current_size_ > 0 && !failed_)
+	{
+		size_t aligned_size = (current_size_ + FRAME_RECORDER_WRITE_ALIGNMENT - 1) /
+			FRAME_RECORDER_WRITE_ALIGNMENT * FRAME_RECORDER_WRITE_ALIGNMENT;
+
+		memset(current_chunk_ + current_size_, 0, aligned_size - current_size_);
+		if (Write(current_chunk_, aligned_size) && Truncate(bytes_queued_))
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			bytes_written_ += current_size_;
+		}
+		else
+		{
+			failed_ = true;
+		}
+	}
+
+	if (failed_)
+	{
+		LOG(LS_ERROR) << "Frame recording is incomplete, the file couldn't be written.";
+	}
+
+	LOG(INFO) << "Frames recorded: " << frames_recorded_ << ", dropped: " << frames_dropped_;
+
+	CloseFile();
+	for (uint8_t* chunk : chunks_)
+	{
+		webrtc::AlignedFree(chunk);
+	}
+
+	chunks_.clear();
+	free_chunks_.clear();
+	full_chunks_.clear();
+	current_chunk_ = nullptr;
+	current_size_ = 0;
+}
+
+bool FrameRecorder::is_open() const
+{
+	return file_ != kInvalidFile;
+}
+
+FrameRecorder::Stats FrameRecorder::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats stats;
+	stats.frames_recorded = frames_recorded_;
+	stats.frames_dropped = frames_dropped_;
+	stats.bytes_written = bytes_written_;
+	return stats;
+}
+
+void FrameRecorder::OnFrame(const webrtc::VideoFrame& frame)
+{
+	std::lock_guard<std::mutex> frame_lock(frame_mutex_);
+	if (file_ == kInvalidFile)
+	{
+		return;
+	}
+
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = frame.video_frame_buffer();
+
+	// Y4M can't change the frame size, the first frame sets it.
+	int width = width_ ? width_ : buffer->width();
+	int height = height_ ? height_ : buffer->height();
+	int chroma_width = (width + 1) / 2;
+	int chroma_height = (height + 1) / 2;
+	size_t frame_size = kFrameHeaderSize + static_cast<size_t>(width) * height +
+		2 * static_cast<size_t>(chroma_width) * chroma_height;
+
+	std::string header;
+	if (width_ == 0)
+	{
+		char stream_header[128];
+		snprintf(stream_header, sizeof(stream_header),
+			"YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg\n", width, height, frame_rate_);
+
+		header = stream_header;
+	}
+
+	if (buffer->native_handle() ||
+		buffer->width() != width || buffer->height() != height ||
+		!Reserve(header.size() + frame_size))
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		frames_dropped_++;
+		return;
+	}
+
+	width_ = width;
+	height_ = height;
+	Append(reinterpret_cast<const uint8_t*>(header.data()), header.size());
+	Append(reinterpret_cast<const uint8_t*>(kFrameHeader), kFrameHeaderSize);
+	AppendPlane(buffer->DataY(), buffer->StrideY(), width_, height_);
+	AppendPlane(buffer->DataU(), buffer->StrideU(), chroma_width, chroma_height);
+	AppendPlane(buffer->DataV(), buffer->StrideV(), chroma_width, chroma_height);
+
+	bytes_queued_ += header.size() + frame_size;
+	std::lock_guard<std::mutex> lock(mutex_);
+	frames_recorded_++;
+}
+
+bool FrameRecorder::Reserve(size_t size)
+{
+	size_t available = current_chunk_ ? FRAME_RECORDER_CHUNK_SIZE - current_size_ : 0;
+	std::lock_guard<std::mutex> lock(mutex_);
+	return !failed_ &&
+		available + free_chunks_.size() * FRAME_RECORDER_CHUNK_SIZE >= size;
+}
+
+void FrameRecorder::Append(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		if (!current_chunk_)
+		{
+			// Reserve() made sure that there are enough free chunks.
+			std::lock_guard<std::mutex> lock(mutex_);
+			current_chunk_ = free_chunks_.back();
+			free_chunks_.pop_back();
+			current_size_ = 0;
+		}
+
+		size_t copy_size = std::min(size,
+			static_cast<size_t>(FRAME_RECORDER_CHUNK_SIZE) - current_size_);
+
+		memcpy(current_chunk_ + current_size_, data, copy_size);
+		current_size_ += copy_size;
+		data += copy_size;
+		size -= copy_size;
+		if (current_size_ == FRAME_RECORDER_CHUNK_SIZE)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				full_chunks_.push_back(current_chunk_);
+			}
+
+			chunk_full_.notify_one();
+			current_chunk_ = nullptr;
+		}
+	}
+}
+
+void FrameRecorder::AppendPlane(const uint8_t* data, int stride, int width, int height)
+{
+	for (int y = 0; y < height; y++)
+	{
+		Append(data + y * stride, width);
+	}
+}
+
+void FrameRecorder::Run()
+{
+	while (true)
+	{
+		uint8_t* chunk = nullptr;
+		bool failed = false;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			chunk_full_.wait(lock, [this]
+			{
+				return stopping_ || !full_chunks_.empty();
+			});
+
+			if (full_chunks_.empty())
+			{
+				return;
+			}
+
+			chunk = full_chunks_.front();
+			full_chunks_.pop_front();
+			failed = failed_;
+		}
+
+		// Once a write has failed the remaining chunks are discarded.
+		bool written = !failed && Write(chunk, FRAME_RECORDER_CHUNK_SIZE);
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (written)
+		{
+			bytes_written_ += FRAME_RECORDER_CHUNK_SIZE;
+		}
+		else
+		{
+			failed_ = true;
+		}
+
+		free_chunks_.push_back(chunk);
+	}
+}
+
+bool FrameRecorder::Write(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+#ifdef _WIN32
+		DWORD written = 0;
+		if (!WriteFile(file_, data, static_cast<DWORD>(size), &written, nullptr))
+		{
+			return false;
+		}
+#else
+		ssize_t written = write(file_, data, size);
+		if (written < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (written <= 0)
+		{
+			return false;
+		}
+#endif // _WIN32
+
+		data += written;
+		size -= written;
+	}
+
+	return true;
+}
+
+bool FrameRecorder::Truncate(uint64_t size)
+{
+#ifdef _WIN32
+	LARGE_INTEGER position;
+	position.QuadPart = static_cast<LONGLONG>(size);
+	return SetFilePointerEx(file_, position, nullptr, FILE_BEGIN) && SetEndOfFile(file_);
+#else
+	return ftruncate(file_, static_cast<off_t>(size)) == 0;
+#endif // _WIN32
+}
+
+void FrameRecorder::CloseFile()
+{
+#ifdef _WIN32
+	CloseHandle(file_);
+#else
+	close(file_);
+#endif // _WIN32
+
+	file_ = kInvalidFile;
+}
@@ -0,0 +1,349 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+
+#include "frame_timing.h"
+#include "plugindefs.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	// Upper bounds of the histogram buckets, in microseconds.
+	const int64_t kBucketLimitsUs[] =
+	{
+		250, 500, 1000, 2000, 4000, 8000, 16000, 33000, 66000, 133000, 266000, INT64_MAX
+	};
+
+	const int kBucketCount = sizeof(kBucketLimitsUs) / sizeof(kBucketLimitsUs[0]);
+
+	const char* kStageNames[] =
+	{
+		"render_submitted",
+		"staged",
+		"converted",
+		"encoder_in",
+		"encoder_out",
+		"packetized"
+	};
+
+	int64_t GetMonotonicTimeNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+int64_t FrameTimingRecorder::Histogram::Percentile(int percentile) const
+{
+	if (total_count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t rank = (total_count * percentile + 99) / 100;
+	uint64_t count = 0;
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		count += counts[i];
+		if (count >= std::max<uint64_t>(rank, 1))
+		{
+			return std::min(bucket_limits_us[i], max_us);
+		}
+	}
+
+	return max_us;
+}
+
+FrameTimingRecorder::Ring::Ring(int thread_index) :
+	thread_index(thread_index),
+	events(FRAME_TIMING_RING_SIZE),
+	write_index(0),
+	read_index(0),
+	released(false)
+{
+}
+
+FrameTimingRecorder::ThreadRing::~ThreadRing()
+{
+	if (ring)
+	{
+		ring->released.store(true, std::memory_order_release);
+	}
+}
+
+FrameTimingRecorder* FrameTimingRecorder::Instance()
+{
+	static FrameTimingRecorder instance;
+	return &instance;
+}
+
+FrameTimingRecorder::FrameTimingRecorder() :
+	enabled_(false),
+	dropped_events_(0),
+	next_thread_index_(0),
+	collector_stopping_(false)
+{
+	GetHistograms(true);
+}
+
+FrameTimingRecorder::~FrameTimingRecorder()
+{
+	SetEnabled(false);
+}
+
+void FrameTimingRecorder::SetEnabled(bool enabled)
+{
+	std::unique_lock<std::mutex> lock(collector_mutex_);
+	enabled_ = enabled;
+	if (enabled && !collector_thread_.joinable())
+	{
+		collector_stopping_ = false;
+		collector_thread_ = std::thread(&FrameTimingRecorder::RunCollector, this);
+	}
+	else if (!enabled && collector_thread_.joinable())
+	{
+		collector_stopping_ = true;
+		collector_stop_.notify_one();
+		lock.unlock();
+		collector_thread_.join();
+	}
+}
+
+void FrameTimingRecorder::Record(int64_t frame_id, FrameTimingStage stage)
+{
+	if (!enabled_)
+	{
+		return;
+	}
+
+	Ring* ring = GetThreadRing();
+
+	// Only this thread writes the ring, the collector only moves the read index.
+	uint64_t write_index = ring->write_index.load(std::memory_order_relaxed);
+	uint64_t read_index = ring->read_index.load(std::memory_order_acquire);
+	if (write_index - read_index >= ring->events.size())
+	{
+		dropped_events_++;
+		return;
+	}
+
+	Event& event = ring->events[write_index % ring->events.size()];
+	event.frame_id = frame_id;
+	event.time_ns = GetMonotonicTimeNs();
+	event.stage = stage;
+	event.thread_index = ring->thread_index;
+	ring->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+void FrameTimingRecorder::Collect()
+{
+	std::lock_guard<std::mutex> lock(collect_mutex_);
+	std::vector<Event> events;
+	{
+		std::lock_guard<std::mutex> rings_lock(rings_mutex_);
+		for (auto it = rings_.begin(); it != rings_.end();)
+		{
+			// Read first, a released ring then has no events left to come.
+			Ring* ring = it->get();
+			bool released = ring->released.load(std::memory_order_acquire);
+			uint64_t read_index = ring->read_index.load(std::memory_order_relaxed);
+			uint64_t write_index = ring->write_index.load(std::memory_order_acquire);
+			for (uint64_t i = read_index; i < write_index; i++)
+			{
+				events.push_back(ring->events[i % ring->events.size()]);
+			}
+
+			ring->read_index.store(write_index, std::memory_order_release);
+			it = released ? rings_.erase(it) : it + 1;
+		}
+	}
+
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+	{
+		return a.time_ns < b.time_ns;
+	});
+
+	for (const Event& event : events)
+	{
+		trace_events_.push_back(event);
+		if (trace_events_.size() > FRAME_TIMING_TRACE_CAPACITY)
+		{
+			trace_events_.pop_front();
+		}
+
+		auto it = frames_.find(event.frame_id);
+		if (it == frames_.end())
+		{
+			// Frame ids are time stamps, so the first entry is the oldest
+			// frame. Late events of a frame already evicted are only traced.
+			if (frames_.size() >= FRAME_TIMING_MAX_FRAMES)
+			{
+				if (event.frame_id < frames_.begin()->first)
+				{
+					continue;
+				}
+
+				frames_.erase(frames_.begin());
+			}
+
+			FrameTimes times;
+			std::fill(std::begin(times.time_ns), std::end(times.time_ns), -1);
+			std::fill(std::begin(times.thread_index), std::end(times.thread_index), -1);
+			it = frames_.emplace(event.frame_id, times).first;
+		}
+
+		FrameTimes& times = it->second;
+		times.time_ns[event.stage] = event.time_ns;
+		times.thread_index[event.stage] = event.thread_index;
+
+		// Latencies are relative to the render submission, which may be
+		// collected after the stages recorded on other threads.
+		int64_t submitted_ns = times.time_ns[kFrameRenderSubmitted];
+		if (event.stage == kFrameRenderSubmitted)
+		{
+			for (int stage = kFrameRenderSubmitted + 1; stage < kFrameTimingStageCount; stage++)
+			{
+				if (times.time_ns[stage] >= 0)
+				{
+					AddToHistogram(stage, (times.time_ns[stage] - submitted_ns) / 1000);
+				}
+			}
+		}
+		else if (submitted_ns >= 0)
+		{
+			AddToHistogram(event.stage, (event.time_ns - submitted_ns) / 1000);
+		}
+	}
+}
+
+std::vector<FrameTimingRecorder::Histogram> FrameTimingRecorder::GetHistograms(bool reset)
+{
+	Collect();
+
+	std::lock_guard<std::mutex> lock(collect_mutex_);
+	std::vector<Histogram> histograms = histograms_;
+	if (reset || histograms_.empty())
+	{
+		Histogram empty;
+		empty.bucket_limits_us.assign(kBucketLimitsUs, kBucketLimitsUs + kBucketCount);
+		empty.counts.assign(kBucketCount, 0);
+		empty.total_count = 0;
+		empty.max_us = 0;
+		histograms_.assign(kFrameTimingStageCount, empty);
+	}
+
+	return histograms;
+}
+
+bool FrameTimingRecorder::WriteChromeTrace(const std::string& path)
+{
+	Collect();
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(collect_mutex_);
+	std::map<int64_t, std::vector<Event>> frames;
+	for (const Event& event : trace_events_)
+	{
+		frames[event.frame_id].push_back(event);
+	}
+
+	int64_t origin_ns = trace_events_.empty() ? 0 : trace_events_.front().time_ns;
+	bool first = true;
+	file << "{\"traceEvents\":[";
+
+	// Each stage is a complete event spanning from the previous stage of the
+	// same frame, drawn on the thread which recorded it.
+	for (auto& frame : frames)
+	{
+		std::vector<Event>& events = frame.second;
+		std::sort(events.begin(), events.end(), [](const Event& a, const Event& b)
+		{
+			return a.stage < b.stage;
+		});
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			const Event& event = events[i];
+			int64_t start_ns = i > 0 ? events[i - 1].time_ns : event.time_ns;
+			file << (first ? "" : ",") << "\n{\"name\":\"" << kStageNames[event.stage] <<
+				"\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_index <<
+				",\"ts\":" << (start_ns - origin_ns) / 1000.0 <<
+				",\"dur\":" << std::max<int64_t>(event.time_ns - start_ns, 0) / 1000.0 <<
+				",\"args\":{\"frame_id\":" << frame.first << "}}";
+
+			first = false;
+		}
+	}
+
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	return file.good();
+}
+
+const char* FrameTimingRecorder::GetStageName(FrameTimingStage stage)
+{
+	return stage < kFrameTimingStageCount ? kStageNames[stage] : "unknown";
+}
+
+size_t FrameTimingRecorder::GetThreadRingCount()
+{
+	std::lock_guard<std::mutex> lock(rings_mutex_);
+	return rings_.size();
+}
+
+FrameTimingRecorder::Ring* FrameTimingRecorder::GetThreadRing()
+{
+	// Rings outlive their thread until collected, so that late events are
+	// still counted.
+	thread_local ThreadRing thread_ring;
+	if (!thread_ring.ring)
+	{
+		std::lock_guard<std::mutex> lock(rings_mutex_);
+		thread_ring.ring = std::make_shared<Ring>(next_thread_index_++);
+		rings_.push_back(thread_ring.ring);
+	}
+
+	return thread_ring.ring.get();
+}
+
+void FrameTimingRecorder::RunCollector()
+{
+	std::unique_lock<std::mutex> lock(collector_mutex_);
+	while (!collector_stop_.wait_for(lock,
+		std::chrono::milliseconds(FRAME_TIMING_COLLECT_INTERVAL_MS),
+		[this] { return collector_stopping_; }))
+	{
+		lock.unlock();
+		Collect();
+		lock.lock();
+	}
+
+	// Drains the events recorded before recording was disabled.
+	lock.unlock();
+	Collect();
+}
+
+void FrameTimingRecorder::AddToHistogram(int stage, int64_t latency_us)
+{
+	Histogram& histogram = histograms_[stage];
+	latency_us = std::max<int64_t>(latency_us, 0);
+	for (int i = 0; i < kBucketCount; i++)
+	{
+		if (latency_us <= kBucketLimitsUs[i])
+		{
+			histogram.counts[i]++;
+			break;
+		}
+	}
+
+	histogram.total_count++;
+	histogram.max_us = std::max(histogram.max_us, latency_us);
+}
@@ -0,0 +1,348 @@
+#include "pch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+
+#include "latency_probe.h"
+#include "plugindefs.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const uint8_t kWhite = 235;
+	const uint8_t kBlack = 16;
+	const uint8_t kNeutralChroma = 128;
+	const int kReferenceCells = 4;
+	const int kPayloadBytes = 7;
+	const int kCellCount = LATENCY_PROBE_GRID_SIZE * LATENCY_PROBE_GRID_SIZE;
+
+	// Reference cells and the white and black levels need at least this much
+	// contrast to be told apart from picture content.
+	const int kMinContrast = 64;
+
+	static_assert(2 * kReferenceCells + kPayloadBytes * 8 == kCellCount,
+		"The latency probe payload must fill the grid.");
+
+	// CRC-8, polynomial x^8 + x^2 + x + 1.
+	uint8_t ComputeCrc8(const uint8_t* data, int size)
+	{
+		uint8_t crc = 0;
+		for (int i = 0; i < size; i++)
+		{
+			crc ^= data[i];
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) :
+					static_cast<uint8_t>(crc << 1);
+			}
+		}
+
+		return crc;
+	}
+
+	// Returns the level of every cell of the grid, reference cells included.
+	void EncodeCells(const LatencyProbe::Id& id, uint8_t cells[kCellCount])
+	{
+		uint8_t payload[kPayloadBytes];
+		payload[0] = static_cast<uint8_t>(id.sequence_number >> 8);
+		payload[1] = static_cast<uint8_t>(id.sequence_number);
+		payload[2] = static_cast<uint8_t>(id.capture_time_us >> 24);
+		payload[3] = static_cast<uint8_t>(id.capture_time_us >> 16);
+		payload[4] = static_cast<uint8_t>(id.capture_time_us >> 8);
+		payload[5] = static_cast<uint8_t>(id.capture_time_us);
+		payload[6] = ComputeCrc8(payload, kPayloadBytes - 1);
+
+		for (int i = 0; i < kReferenceCells; i++)
+		{
+			cells[i] = i % 2 ? kBlack : kWhite;
+			cells[kCellCount - kReferenceCells + i] = i % 2 ? kWhite : kBlack;
+		}
+
+		for (int bit = 0; bit < kPayloadBytes * 8; bit++)
+		{
+			bool set = (payload[bit / 8] >> (7 - bit % 8)) & 1;
+			cells[kReferenceCells + bit] = set ? kWhite : kBlack;
+		}
+	}
+
+	void StampLuma(const LatencyProbe::Id& id, uint8_t* data_y, int stride_y)
+	{
+		uint8_t cells[kCellCount];
+		EncodeCells(id, cells);
+		int size = LatencyProbe::GetPatternSize();
+		for (int y = 0; y < size; y++)
+		{
+			uint8_t* row = data_y + y * stride_y;
+			const uint8_t* cell_row = cells + (y / LATENCY_PROBE_CELL_SIZE) * LATENCY_PROBE_GRID_SIZE;
+			for (int column = 0; column < LATENCY_PROBE_GRID_SIZE; column++)
+			{
+				memset(row + column * LATENCY_PROBE_CELL_SIZE, cell_row[column],
+					LATENCY_PROBE_CELL_SIZE);
+			}
+		}
+	}
+
+	// Mean luma of the center of a cell, away from the ringing and
+	// deblocking at the cell edges.
+	int GetCellLevel(const uint8_t* data_y, int stride_y, int cell)
+	{
+		const int margin = LATENCY_PROBE_CELL_SIZE / 4;
+		const int size = LATENCY_PROBE_CELL_SIZE - 2 * margin;
+		const uint8_t* origin = data_y +
+			((cell / LATENCY_PROBE_GRID_SIZE) * LATENCY_PROBE_CELL_SIZE + margin) * stride_y +
+			(cell % LATENCY_PROBE_GRID_SIZE) * LATENCY_PROBE_CELL_SIZE + margin;
+
+		int sum = 0;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				sum += origin[y * stride_y + x];
+			}
+		}
+
+		return sum / (size * size);
+	}
+}
+
+int LatencyProbe::GetPatternSize()
+{
+	return LATENCY_PROBE_GRID_SIZE * LATENCY_PROBE_CELL_SIZE;
+}
+
+bool LatencyProbe::StampI420(const Id& id, uint8_t* data_y, int stride_y,
+	uint8_t* data_u, int stride_u, uint8_t* data_v, int stride_v, int width, int height)
+{
+	int size = GetPatternSize();
+	if (width < size || height < size)
+	{
+		return false;
+	}
+
+	StampLuma(id, data_y, stride_y);
+	for (int y = 0; y < size / 2; y++)
+	{
+		memset(data_u + y * stride_u, kNeutralChroma, size / 2);
+		memset(data_v + y * stride_v, kNeutralChroma, size / 2);
+	}
+
+	return true;
+}
+
+bool LatencyProbe::Detect(const uint8_t* data_y, int stride_y, int width, int height, Id* id)
+{
+	int size = GetPatternSize();
+	if (width < size || height < size)
+	{
+		return false;
+	}
+
+	int levels[kCellCount];
+	for (int cell = 0; cell < kCellCount; cell++)
+	{
+		levels[cell] = GetCellLevel(data_y, stride_y, cell);
+	}
+
+	// The reference cells set the threshold between white and black.
+	int white = 0;
+	int black = 0;
+	for (int i = 0; i < kReferenceCells; i++)
+	{
+		int tail = levels[kCellCount - kReferenceCells + i];
+		white += i % 2 ? tail : levels[i];
+		black += i % 2 ? levels[i] : tail;
+	}
+
+	white /= kReferenceCells;
+	black /= kReferenceCells;
+	if (white - black < kMinContrast)
+	{
+		return false;
+	}
+
+	int threshold = (white + black) / 2;
+	for (int i = 0; i < kReferenceCells; i++)
+	{
+		bool head_white = levels[i] > threshold;
+		bool tail_white = levels[kCellCount - kReferenceCells + i] > threshold;
+		if (head_white == (i % 2 == 1) || tail_white == (i % 2 == 0))
+		{
+			return false;
+		}
+	}
+
+	uint8_t payload[kPayloadBytes] = { 0 };
+	for (int bit = 0; bit < kPayloadBytes * 8; bit++)
+	{
+		if (levels[kReferenceCells + bit] > threshold)
+		{
+			payload[bit / 8] |= 1 << (7 - bit % 8);
+		}
+	}
+
+	if (ComputeCrc8(payload, kPayloadBytes - 1) != payload[kPayloadBytes - 1])
+	{
+		return false;
+	}
+
+	id->sequence_number = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+	id->capture_time_us = (static_cast<uint32_t>(payload[2]) << 24) |
+		(static_cast<uint32_t>(payload[3]) << 16) |
+		(static_cast<uint32_t>(payload[4]) << 8) | payload[5];
+
+	return true;
+}
+
+uint32_t LatencyProbe::GetTimeUs()
+{
+	return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+int64_t LatencyProbe::GetLatencyUs(const Id& id, uint32_t time_us)
+{
+	// Negative when the clocks aren't synchronized.
+	return static_cast<int32_t>(time_us - id.capture_time_us);
+}
+
+std::string LatencyProbe::CreateEchoMessage(const Id& id)
+{
+	return "{\"type\":\"latency-probe\",\"body\":\"" +
+		std::to_string(id.sequence_number) + "," +
+		std::to_string(id.capture_time_us) + "\"}";
+}
+
+bool LatencyProbe::ParseEchoBody(const std::string& body, Id* id)
+{
+	const char* start = body.c_str();
+	char* end = nullptr;
+	unsigned long sequence_number = strtoul(start, &end, 10);
+	if (end == start || *end != ',' || sequence_number > 0xFFFF)
+	{
+		return false;
+	}
+
+	start = end + 1;
+	unsigned long long capture_time_us = strtoull(start, &end, 10);
+	if (end == start || *end != '\0' || capture_time_us > 0xFFFFFFFF)
+	{
+		return false;
+	}
+
+	id->sequence_number = static_cast<uint16_t>(sequence_number);
+	id->capture_time_us = static_cast<uint32_t>(capture_time_us);
+	return true;
+}
+
+LatencyProbeDetector::LatencyProbeDetector() :
+	latencies_us_(LATENCY_PROBE_HISTORY_SIZE)
+{
+	Reset();
+}
+
+void LatencyProbeDetector::OnFrame(const webrtc::VideoFrame& frame)
+{
+	// Time stamped before the pattern is read, which takes a few microseconds.
+	uint32_t time_us = LatencyProbe::GetTimeUs();
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = frame.video_frame_buffer();
+	LatencyProbe::Id id;
+	bool detected = !buffer->native_handle() &&
+		LatencyProbe::Detect(buffer->DataY(), buffer->StrideY(),
+		buffer->width(), buffer->height(), &id);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		frames_received_++;
+	}
+
+	if (detected)
+	{
+		AddSample(id, time_us);
+	}
+}
+
+void LatencyProbeDetector::OnEcho(const LatencyProbe::Id& id)
+{
+	AddSample(id, LatencyProbe::GetTimeUs());
+}
+
+bool LatencyProbeDetector::GetLastId(LatencyProbe::Id* id) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	*id = last_id_;
+	return has_last_id_;
+}
+
+LatencyProbeDetector::Stats LatencyProbeDetector::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats stats = { 0 };
+	stats.frames_received = frames_received_;
+	stats.frames_detected = frames_detected_;
+	stats.frames_repeated = frames_repeated_;
+	stats.frames_missed = frames_missed_;
+
+	size_t count = static_cast<size_t>(std::min<uint64_t>(
+		frames_detected_, latencies_us_.size()));
+
+	if (count > 0)
+	{
+		std::vector<int64_t> latencies(latencies_us_.begin(), latencies_us_.begin() + count);
+		std::sort(latencies.begin(), latencies.end());
+		stats.p50_latency_ms = latencies[(count - 1) * 50 / 100] / 1000.0;
+		stats.p90_latency_ms = latencies[(count - 1) * 90 / 100] / 1000.0;
+		stats.p99_latency_ms = latencies[(count - 1) * 99 / 100] / 1000.0;
+		stats.max_latency_ms = latencies[count - 1] / 1000.0;
+	}
+
+	return stats;
+}
+
+void LatencyProbeDetector::Reset()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	frames_received_ = 0;
+	frames_detected_ = 0;
+	frames_repeated_ = 0;
+	frames_missed_ = 0;
+	has_last_id_ = false;
+	last_id_.sequence_number = 0;
+	last_id_.capture_time_us = 0;
+	next_latency_ = 0;
+}
+
+void LatencyProbeDetector::AddSample(const LatencyProbe::Id& id, uint32_t time_us)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	bool newer = true;
+	if (has_last_id_)
+	{
+		uint16_t distance = static_cast<uint16_t>(id.sequence_number - last_id_.sequence_number);
+		if (distance == 0 && id.capture_time_us == last_id_.capture_time_us)
+		{
+			frames_repeated_++;
+			return;
+		}
+
+		// Older frames arriving out of order are measured but don't move the
+		// sequence forward.
+		newer = distance > 0 && distance < 0x8000;
+		if (newer)
+		{
+			frames_missed_ += distance - 1;
+		}
+	}
+
+	if (newer)
+	{
+		has_last_id_ = true;
+		last_id_ = id;
+	}
+
+	latencies_us_[next_latency_] = LatencyProbe::GetLatencyUs(id, time_us);
+	next_latency_ = (next_latency_ + 1) % latencies_us_.size();
+	frames_detected_++;
+}
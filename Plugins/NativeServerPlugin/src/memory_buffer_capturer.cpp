@@ -0,0 +1,144 @@
+#include "pch.h"
+
+#include "memory_buffer_capturer.h"
+
+#include "webrtc/common_video/include/video_frame_buffer.h"
+
+using namespace StreamingToolkit;
+
+MemoryBufferCapturer::MemoryBufferCapturer()
+{
+	// Memory frames are always converted on the CPU.
+	use_software_encoder_ = true;
+}
+
+void MemoryBufferCapturer::Initialize(bool headless, int width, int height)
+{
+	// No device resources to initialize, frame size is taken from each frame.
+}
+
+void MemoryBufferCapturer::SendFrame(const uint8_t* data, int stride,
+	PixelFormat format, int width, int height, int64_t prediction_time_stamp)
+{
+	// The video capturer hasn't started since there is no active connection.
+	if (!running_)
+	{
+		return;
+	}
+
+	int64_t time_stamp = OnFrameSubmitted();
+
+	// Unchanged frames skip conversion and are only sent as keep-alive.
+	if (IsFrameUnchanged(data, stride, width, height))
+	{
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> keep_alive_buffer =
+			GetKeepAliveFrameBuffer();
+
+		if (keep_alive_buffer)
+		{
+			DeliverFrame(keep_alive_buffer, time_stamp, prediction_time_stamp);
+		}
+
+		return;
+	}
+
+	if (format != kPixelFormatRGBA && format != kPixelFormatBGRA)
+	{
+		RTC_NOTREACHED();
+		return;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer = ConvertPackedFrame(
+		data, stride, format == kPixelFormatBGRA, width, height);
+
+	OnFrameConverted(buffer, std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now() - start).count());
+
+	FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp), kFrameConverted);
+	DeliverFrame(buffer, time_stamp, prediction_time_stamp);
+}
+
+void MemoryBufferCapturer::SendFrame(const uint8_t* data_y, int stride_y,
+	const uint8_t* data_u, int stride_u,
+	const uint8_t* data_v, int stride_v,
+	int width, int height, int64_t prediction_time_stamp,
+	const rtc::Callback0<void>& no_longer_used)
+{
+	// The video capturer hasn't started since there is no active connection.
+	// The caller's planes are released since no frame will reference them.
+	if (!running_)
+	{
+		rtc::Callback0<void> release(no_longer_used);
+		release();
+		return;
+	}
+
+	int64_t time_stamp = OnFrameSubmitted();
+
+	// Wraps the caller's planes, no copy is made.
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer(
+		new rtc::RefCountedObject<webrtc::WrappedI420Buffer>(
+			width,
+			height,
+			data_y,
+			stride_y,
+			data_u,
+			stride_u,
+			data_v,
+			stride_v,
+			no_longer_used));
+
+	DeliverFrame(buffer, time_stamp, prediction_time_stamp);
+}
+
+void MemoryBufferCapturer::SendFrame(const uint8_t* data_y, int stride_y,
+	const uint8_t* data_uv, int stride_uv,
+	int width, int height, int64_t prediction_time_stamp)
+{
+	// The video capturer hasn't started since there is no active connection.
+	if (!running_)
+	{
+		return;
+	}
+
+	int64_t time_stamp = OnFrameSubmitted();
+
+	rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+		frame_buffer_pool_.CreateBuffer(width, height);
+
+	libyuv::NV12ToI420(
+		data_y,
+		stride_y,
+		data_uv,
+		stride_uv,
+		buffer->MutableDataY(),
+		buffer->StrideY(),
+		buffer->MutableDataU(),
+		buffer->StrideU(),
+		buffer->MutableDataV(),
+		buffer->StrideV(),
+		width,
+		height);
+
+	FrameTimingRecorder::Instance()->Record(GetCaptureNtpTimeMs(time_stamp), kFrameConverted);
+	DeliverFrame(buffer, time_stamp, prediction_time_stamp);
+}
+
+void MemoryBufferCapturer::DeliverFrame(
+	rtc::scoped_refptr<webrtc::VideoFrameBuffer> buffer,
+	int64_t time_stamp, int64_t prediction_time_stamp)
+{
+	// Creates video frame buffer, time stamped at submission.
+	auto frame = webrtc::VideoFrame(buffer, kVideoRotation_0, time_stamp);
+	frame.set_ntp_time_ms(GetCaptureNtpTimeMs(time_stamp));
+	frame.set_rotation(VideoRotation::kVideoRotation_0);
+	frame.set_prediction_timestamp(prediction_time_stamp);
+
+	// Frame data is already copied or referenced by the frame buffer, only
+	// delivery goes through the capture pipeline.
+	RunCaptureTask([this, frame]()
+	{
+		BufferCapturer::SendFrame(frame);
+	});
+}
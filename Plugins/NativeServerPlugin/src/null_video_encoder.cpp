@@ -0,0 +1,320 @@
+#include "pch.h"
+
+#include <algorithm>
+#include <string.h>
+
+#include "null_video_encoder.h"
+
+#include "webrtc/base/bitbuffer.h"
+#include "webrtc/base/buffer.h"
+#include "webrtc/base/checks.h"
+#include "webrtc/common_video/h264/h264_common.h"
+#include "webrtc/media/base/mediaconstants.h"
+#include "webrtc/modules/video_coding/include/video_error_codes.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const uint8_t kStartCode[] = { 0, 0, 0, 1 };
+
+	// NAL unit headers of an IDR slice, of a non-IDR reference slice and of
+	// the parameter sets.
+	const uint8_t kIdrNalHeader = 0x65;
+	const uint8_t kSliceNalHeader = 0x41;
+	const uint8_t kSpsNalHeader = 0x67;
+	const uint8_t kPpsNalHeader = 0x68;
+
+	// Constrained baseline level 3.1, as in the offered profile-level-id.
+	const uint8_t kProfileIdc = 66;
+	const uint8_t kConstraintFlags = 0xe0;
+	const uint8_t kLevelIdc = 31;
+
+	// Larger than the RBSP of either parameter set.
+	const size_t kMaxParameterSetSize = 64;
+
+	// Filler that can't form a start code or an emulation prevention byte.
+	const uint8_t kFillerByte = 0xAA;
+
+	// Smallest NAL unit written, the header and one byte of payload. The
+	// last NAL unit of a frame may be shorter.
+	const size_t kMinNalSize = 2;
+
+	// Ends |rbsp| with the RBSP trailing bits and appends it to |nal_unit|
+	// behind |nal_header|, adding emulation prevention bytes.
+	void AppendNalUnit(uint8_t nal_header, const uint8_t* rbsp,
+		rtc::BitBufferWriter* writer, rtc::Buffer* nal_unit)
+	{
+		writer->WriteBits(1, 1);
+		size_t byte_offset = 0;
+		size_t bit_offset = 0;
+		writer->GetCurrentOffset(&byte_offset, &bit_offset);
+
+		nal_unit->AppendData(&nal_header, 1);
+		webrtc::H264::WriteRbsp(rbsp, byte_offset + (bit_offset > 0 ? 1 : 0), nal_unit);
+	}
+
+	// SPS of a |width| x |height| stream of single slice frames that only
+	// reference the previous one.
+	void WriteSps(int width, int height, rtc::Buffer* sps)
+	{
+		uint8_t rbsp[kMaxParameterSetSize] = {};
+		rtc::BitBufferWriter writer(rbsp, sizeof(rbsp));
+		writer.WriteUInt8(kProfileIdc);
+		writer.WriteUInt8(kConstraintFlags);
+		writer.WriteUInt8(kLevelIdc);
+
+		// seq_parameter_set_id, log2_max_frame_num_minus4, pic_order_cnt_type
+		// and max_num_ref_frames, then no gaps in frame_num.
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(2);
+		writer.WriteExponentialGolomb(1);
+		writer.WriteBits(0, 1);
+
+		uint32_t width_in_mbs = std::max((width + 15) / 16, 1);
+		uint32_t height_in_mbs = std::max((height + 15) / 16, 1);
+		writer.WriteExponentialGolomb(width_in_mbs - 1);
+		writer.WriteExponentialGolomb(height_in_mbs - 1);
+
+		// frame_mbs_only_flag and direct_8x8_inference_flag.
+		writer.WriteBits(1, 1);
+		writer.WriteBits(1, 1);
+
+		// Crops the macroblock padding, in units of two luma samples.
+		uint32_t crop_right = (width_in_mbs * 16 - std::max(width, 0)) / 2;
+		uint32_t crop_bottom = (height_in_mbs * 16 - std::max(height, 0)) / 2;
+		bool cropped = crop_right > 0 || crop_bottom > 0;
+		writer.WriteBits(cropped ? 1 : 0, 1);
+		if (cropped)
+		{
+			writer.WriteExponentialGolomb(0);
+			writer.WriteExponentialGolomb(crop_right);
+			writer.WriteExponentialGolomb(0);
+			writer.WriteExponentialGolomb(crop_bottom);
+		}
+
+		// No VUI.
+		writer.WriteBits(0, 1);
+		AppendNalUnit(kSpsNalHeader, rbsp, &writer, sps);
+	}
+
+	// PPS of CAVLC coded slices with the default QP.
+	void WritePps(rtc::Buffer* pps)
+	{
+		uint8_t rbsp[kMaxParameterSetSize] = {};
+		rtc::BitBufferWriter writer(rbsp, sizeof(rbsp));
+
+		// pic_parameter_set_id and seq_parameter_set_id, then CAVLC without
+		// bottom field POC.
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+		writer.WriteBits(0, 2);
+
+		// num_slice_groups_minus1 and num_ref_idx_l0/l1_default_active_minus1,
+		// then no weighted prediction.
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+		writer.WriteBits(0, 3);
+
+		// pic_init_qp_minus26, pic_init_qs_minus26 and chroma_qp_index_offset,
+		// all zero, which is the same code signed or not.
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+		writer.WriteExponentialGolomb(0);
+
+		// deblocking_filter_control_present_flag, then neither constrained
+		// intra prediction nor redundant pictures.
+		writer.WriteBits(1, 1);
+		writer.WriteBits(0, 2);
+		AppendNalUnit(kPpsNalHeader, rbsp, &writer, pps);
+	}
+
+	void SetFragment(webrtc::RTPFragmentationHeader* fragmentation, size_t index,
+		size_t offset, size_t length)
+	{
+		fragmentation->fragmentationOffset[index] = offset;
+		fragmentation->fragmentationLength[index] = length;
+		fragmentation->fragmentationPlType[index] = 0;
+		fragmentation->fragmentationTimeDiff[index] = 0;
+	}
+}
+
+NullVideoEncoder::NullVideoEncoder(const cricket::VideoCodec& codec, size_t frame_size) :
+	frame_size_(std::max(frame_size, kMinNalSize)),
+	packetization_mode_(webrtc::H264PacketizationMode::SingleNalUnit),
+	max_payload_size_(0),
+	initialized_(false),
+	send_key_frame_(true),
+	buffer_size_(0),
+	parameter_sets_size_(0),
+	callback_(nullptr)
+{
+	std::string packetization_mode;
+	if (codec.GetParam(cricket::kH264FmtpPacketizationMode, &packetization_mode) &&
+		packetization_mode == "1")
+	{
+		packetization_mode_ = webrtc::H264PacketizationMode::NonInterleaved;
+	}
+}
+
+NullVideoEncoder::~NullVideoEncoder()
+{
+	Release();
+}
+
+int32_t NullVideoEncoder::InitEncode(const webrtc::VideoCodec* codec_settings,
+	int32_t number_of_cores,
+	size_t max_payload_size)
+{
+	if (!codec_settings || codec_settings->codecType != webrtc::kVideoCodecH264)
+	{
+		return WEBRTC_VIDEO_CODEC_ERR_PARAMETER;
+	}
+
+	Release();
+
+	// Single NAL unit mode needs every NAL unit to fit in one RTP packet,
+	// non-interleaved mode lets the packetizer fragment a single one.
+	max_payload_size_ = max_payload_size;
+	size_t nal_size = frame_size_;
+	if (packetization_mode_ == webrtc::H264PacketizationMode::SingleNalUnit &&
+		max_payload_size_ > 0)
+	{
+		nal_size = std::max(std::min(nal_size, max_payload_size_), kMinNalSize);
+	}
+
+	rtc::Buffer sps;
+	rtc::Buffer pps;
+	WriteSps(codec_settings->width, codec_settings->height, &sps);
+	WritePps(&pps);
+	const rtc::Buffer* parameter_sets[] = { &sps, &pps };
+	const size_t parameter_set_count = sizeof(parameter_sets) / sizeof(parameter_sets[0]);
+	parameter_sets_size_ = sps.size() + pps.size() + parameter_set_count * sizeof(kStartCode);
+
+	size_t nal_count = (frame_size_ + nal_size - 1) / nal_size;
+	buffer_size_ = parameter_sets_size_ + frame_size_ + nal_count * sizeof(kStartCode);
+	buffer_.reset(new uint8_t[buffer_size_]);
+	encoded_image_._completeFrame = true;
+
+	// Key frames start with the parameter sets, delta frames right after
+	// them. The payload never changes, only the slice types are rewritten
+	// per frame.
+	key_fragmentation_.VerifyAndAllocateFragmentationHeader(parameter_set_count + nal_count);
+	fragmentation_.VerifyAndAllocateFragmentationHeader(nal_count);
+	uint8_t* data = buffer_.get();
+	for (size_t i = 0; i < parameter_set_count; i++)
+	{
+		size_t size = parameter_sets[i]->size();
+		memcpy(data, kStartCode, sizeof(kStartCode));
+		data += sizeof(kStartCode);
+		memcpy(data, parameter_sets[i]->data(), size);
+
+		SetFragment(&key_fragmentation_, i, data - buffer_.get(), size);
+		data += size;
+	}
+
+	size_t remaining = frame_size_;
+	for (size_t i = 0; i < nal_count; i++)
+	{
+		size_t size = std::min(nal_size, remaining);
+		memcpy(data, kStartCode, sizeof(kStartCode));
+		data += sizeof(kStartCode);
+		memset(data, kFillerByte, size);
+
+		size_t offset = data - buffer_.get();
+		SetFragment(&key_fragmentation_, parameter_set_count + i, offset, size);
+		SetFragment(&fragmentation_, i, offset - parameter_sets_size_, size);
+
+		data += size;
+		remaining -= size;
+	}
+
+	RTC_DCHECK_EQ(static_cast<size_t>(data - buffer_.get()), buffer_size_);
+
+	initialized_ = true;
+	send_key_frame_ = true;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t NullVideoEncoder::RegisterEncodeCompleteCallback(
+	webrtc::EncodedImageCallback* callback)
+{
+	callback_ = callback;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t NullVideoEncoder::Release()
+{
+	initialized_ = false;
+	buffer_.reset();
+	buffer_size_ = 0;
+	parameter_sets_size_ = 0;
+	encoded_image_._buffer = nullptr;
+	encoded_image_._size = 0;
+	encoded_image_._length = 0;
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t NullVideoEncoder::Encode(const webrtc::VideoFrame& frame,
+	const webrtc::CodecSpecificInfo* codec_specific_info,
+	const std::vector<webrtc::FrameType>* frame_types)
+{
+	if (!initialized_ || !callback_)
+	{
+		return WEBRTC_VIDEO_CODEC_UNINITIALIZED;
+	}
+
+	bool key_frame = send_key_frame_;
+	if (frame_types)
+	{
+		for (auto frame_type : *frame_types)
+		{
+			key_frame |= frame_type == webrtc::kVideoFrameKey;
+		}
+	}
+
+	send_key_frame_ = false;
+	WriteNalUnits(key_frame);
+
+	size_t offset = key_frame ? 0 : parameter_sets_size_;
+	encoded_image_._buffer = buffer_.get() + offset;
+	encoded_image_._size = buffer_size_ - offset;
+	encoded_image_._length = encoded_image_._size;
+
+	encoded_image_._encodedWidth = frame.width();
+	encoded_image_._encodedHeight = frame.height();
+	encoded_image_._timeStamp = frame.timestamp();
+	encoded_image_.ntp_time_ms_ = frame.ntp_time_ms();
+	encoded_image_.capture_time_ms_ = frame.render_time_ms();
+	encoded_image_.rotation_ = frame.rotation();
+	encoded_image_.prediction_timestamp_ = frame.prediction_timestamp();
+	encoded_image_._frameType = key_frame ? webrtc::kVideoFrameKey : webrtc::kVideoFrameDelta;
+
+	webrtc::CodecSpecificInfo codec_specific;
+	codec_specific.codecType = webrtc::kVideoCodecH264;
+	codec_specific.codecSpecific.H264.packetization_mode = packetization_mode_;
+	callback_->OnEncodedImage(encoded_image_, &codec_specific,
+		key_frame ? &key_fragmentation_ : &fragmentation_);
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+int32_t NullVideoEncoder::SetChannelParameters(uint32_t packet_loss, int64_t rtt)
+{
+	return WEBRTC_VIDEO_CODEC_OK;
+}
+
+const char* NullVideoEncoder::ImplementationName() const
+{
+	return "NullEncoder";
+}
+
+void NullVideoEncoder::WriteNalUnits(bool key_frame)
+{
+	uint8_t header = key_frame ? kIdrNalHeader : kSliceNalHeader;
+	for (size_t i = 0; i < fragmentation_.fragmentationVectorSize; i++)
+	{
+		buffer_[parameter_sets_size_ + fragmentation_.fragmentationOffset[i]] = header;
+	}
+}
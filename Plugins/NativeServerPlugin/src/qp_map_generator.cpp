@@ -0,0 +1,239 @@
+#include "pch.h"
+
+#include <stdlib.h>
+#include <algorithm>
+#include <cmath>
+
+#include "qp_map_generator.h"
+
+using namespace StreamingToolkit;
+
+const int QpMapGenerator::kMacroblockSize;
+const int QpMapGenerator::kMaxQpDelta;
+
+namespace
+{
+	int GetMacroblockCount(int pixels)
+	{
+		return (pixels + QpMapGenerator::kMacroblockSize - 1) / QpMapGenerator::kMacroblockSize;
+	}
+}
+
+bool QpMapGenerator::Key::operator==(const Key& other) const
+{
+	return width == other.width &&
+		height == other.height &&
+		stereo == other.stereo &&
+		focus_mb_x[0] == other.focus_mb_x[0] &&
+		focus_mb_y[0] == other.focus_mb_y[0] &&
+		focus_mb_x[1] == other.focus_mb_x[1] &&
+		focus_mb_y[1] == other.focus_mb_y[1] &&
+		settings_version == other.settings_version;
+}
+
+QpMapGenerator::QpMapGenerator() :
+	max_qp_delta_(0),
+	inner_radius_(0),
+	outer_radius_(0),
+	stereo_(false),
+	settings_version_(0),
+	build_count_(0),
+	cached_key_()
+{
+	ResetFocusPoints();
+}
+
+void QpMapGenerator::SetFoveation(int max_qp_delta, double inner_radius, double outer_radius)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	max_qp_delta_ = std::max(-kMaxQpDelta, std::min(max_qp_delta, kMaxQpDelta));
+	inner_radius_ = std::max(inner_radius, 0.0);
+	outer_radius_ = std::max(outer_radius, inner_radius_);
+	settings_version_++;
+}
+
+void QpMapGenerator::SetStereo(bool stereo)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (stereo == stereo_)
+	{
+		return;
+	}
+
+	// A gaze reported for the previous layout points elsewhere in the new one.
+	stereo_ = stereo;
+	for (int eye = 0; eye < 2; eye++)
+	{
+		focus_x_[eye] = 0.5;
+		focus_y_[eye] = 0.5;
+	}
+}
+
+void QpMapGenerator::SetFocusPoint(int eye, double x, double y)
+{
+	if (eye < 0 || eye > 1)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	focus_x_[eye] = std::max(0.0, std::min(x, 1.0));
+	focus_y_[eye] = std::max(0.0, std::min(y, 1.0));
+}
+
+bool QpMapGenerator::ParseGazeBody(const std::string& body, int* eye, double* x, double* y)
+{
+	const char* start = body.c_str();
+	char* end = nullptr;
+	long eye_index = strtol(start, &end, 10);
+	if (end == start || *end != ',')
+	{
+		return false;
+	}
+
+	start = end + 1;
+	double gaze_x = strtod(start, &end);
+	if (end == start || *end != ',')
+	{
+		return false;
+	}
+
+	start = end + 1;
+	double gaze_y = strtod(start, &end);
+	if (end == start || *end != '\0')
+	{
+		return false;
+	}
+
+	*eye = static_cast<int>(eye_index);
+	*x = gaze_x;
+	*y = gaze_y;
+	return true;
+}
+
+void QpMapGenerator::ResetFocusPoints()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (int eye = 0; eye < 2; eye++)
+	{
+		focus_x_[eye] = 0.5;
+		focus_y_[eye] = 0.5;
+	}
+}
+
+void QpMapGenerator::SetRegions(const std::vector<Region>& regions)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	regions_ = regions;
+	settings_version_++;
+}
+
+std::shared_ptr<const std::vector<int8_t>> QpMapGenerator::GetMap(int width, int height)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (width <= 0 || height <= 0 || (max_qp_delta_ == 0 && regions_.empty()))
+	{
+		return nullptr;
+	}
+
+	Key key = GetKey(width, height);
+	if (!cached_map_ || !(key == cached_key_))
+	{
+		// Frames still being encoded keep their own reference to the old map.
+		cached_map_ = Build(key);
+		cached_key_ = key;
+		build_count_++;
+	}
+
+	return cached_map_;
+}
+
+uint64_t QpMapGenerator::build_count() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return build_count_;
+}
+
+QpMapGenerator::Key QpMapGenerator::GetKey(int width, int height) const
+{
+	Key key = {};
+	key.width = width;
+	key.height = height;
+	key.stereo = stereo_;
+	key.settings_version = settings_version_;
+
+	// Focus points only matter with foveation, gaze updates are otherwise
+	// free.
+	if (max_qp_delta_ != 0)
+	{
+		int eye_count = stereo_ ? 2 : 1;
+		double eye_width = static_cast<double>(width) / eye_count;
+		for (int eye = 0; eye < eye_count; eye++)
+		{
+			double x = eye * eye_width + focus_x_[eye] * eye_width;
+			double y = focus_y_[eye] * height;
+			key.focus_mb_x[eye] = std::min(static_cast<int>(x) / kMacroblockSize,
+				GetMacroblockCount(width) - 1);
+
+			key.focus_mb_y[eye] = std::min(static_cast<int>(y) / kMacroblockSize,
+				GetMacroblockCount(height) - 1);
+		}
+	}
+
+	return key;
+}
+
+std::shared_ptr<std::vector<int8_t>> QpMapGenerator::Build(const Key& key) const
+{
+	int mb_width = GetMacroblockCount(key.width);
+	int mb_height = GetMacroblockCount(key.height);
+	auto map = std::make_shared<std::vector<int8_t>>(mb_width * mb_height, 0);
+
+	int eye_count = key.stereo ? 2 : 1;
+	int eye_width = key.width / eye_count;
+	for (int mb_y = 0; mb_y < mb_height; mb_y++)
+	{
+		double y = (mb_y + 0.5) * kMacroblockSize;
+		for (int mb_x = 0; mb_x < mb_width; mb_x++)
+		{
+			double x = (mb_x + 0.5) * kMacroblockSize;
+			int qp_delta = 0;
+
+			// Distances are measured between macroblock centers, relative to
+			// the eye view height.
+			if (max_qp_delta_ != 0)
+			{
+				int eye = std::min(static_cast<int>(x) / std::max(eye_width, 1), eye_count - 1);
+				double focus_x = (key.focus_mb_x[eye] + 0.5) * kMacroblockSize;
+				double focus_y = (key.focus_mb_y[eye] + 0.5) * kMacroblockSize;
+				double distance = std::hypot(x - focus_x, y - focus_y) / key.height;
+				if (distance >= outer_radius_)
+				{
+					qp_delta = max_qp_delta_;
+				}
+				else if (distance > inner_radius_)
+				{
+					qp_delta = static_cast<int>(std::lround(max_qp_delta_ *
+						(distance - inner_radius_) / (outer_radius_ - inner_radius_)));
+				}
+			}
+
+			// Later regions win where regions overlap.
+			for (const auto& region : regions_)
+			{
+				if (x >= region.x * key.width &&
+					x < (region.x + region.width) * key.width &&
+					y >= region.y * key.height &&
+					y < (region.y + region.height) * key.height)
+				{
+					qp_delta = region.qp_delta;
+				}
+			}
+
+			(*map)[mb_y * mb_width + mb_x] = static_cast<int8_t>(
+				std::max(-kMaxQpDelta, std::min(qp_delta, kMaxQpDelta)));
+		}
+	}
+
+	return map;
+}
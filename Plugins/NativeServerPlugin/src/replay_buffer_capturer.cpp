@@ -0,0 +1,328 @@
+#include "pch.h"
+
+#include <ctype.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <memory>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
+#include "frame_pacer.h"
+#include "replay_buffer_capturer.h"
+
+#include "webrtc/base/logging.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const char kStreamMagic[] = "YUV4MPEG2";
+	const char kFrameMagic[] = "FRAME";
+
+	// Returns the line starting at |offset| without its terminator, and moves
+	// |offset| past it. Returns false if the line isn't terminated.
+	bool ReadLine(const uint8_t* data, size_t size, size_t* offset, std::string* line)
+	{
+		const uint8_t* start = data + *offset;
+		const uint8_t* end = static_cast<const uint8_t*>(
+			memchr(start, '\n', size - *offset));
+
+		if (!end)
+		{
+			return false;
+		}
+
+		line->assign(reinterpret_cast<const char*>(start), end - start);
+		*offset += end - start + 1;
+		return true;
+	}
+}
+
+ReplayBufferCapturer::ReplayBufferCapturer() :
+	width_(0),
+	height_(0),
+	file_frame_rate_(0),
+	frame_rate_(0),
+	loop_(false),
+	data_(nullptr),
+	size_(0),
+#ifdef _WIN32
+	file_(INVALID_HANDLE_VALUE),
+	mapping_(nullptr),
+#else
+	file_(-1),
+#endif // _WIN32
+	stopping_(false),
+	frames_sent_(0),
+	frames_in_flight_(0)
+{
+}
+
+ReplayBufferCapturer::~ReplayBufferCapturer()
+{
+	StopPlayback();
+	Close();
+}
+
+bool ReplayBufferCapturer::Open(const std::string& path)
+{
+	StopPlayback();
+	Close();
+
+#ifdef _WIN32
+	file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	LARGE_INTEGER file_size = { 0 };
+	if (file_ == INVALID_HANDLE_VALUE || !GetFileSizeEx(file_, &file_size) ||
+		file_size.QuadPart == 0)
+	{
+		LOG(LS_ERROR) << "Failed to open the frame recording " << path;
+		Close();
+		return false;
+	}
+
+	size_ = static_cast<size_t>(file_size.QuadPart);
+	mapping_ = CreateFileMapping(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	data_ = mapping_ ? static_cast<const uint8_t*>(
+		MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+#else
+	file_ = open(path.c_str(), O_RDONLY);
+	struct stat file_stat;
+	if (file_ < 0 || fstat(file_, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		LOG(LS_ERROR) << "Failed to open the frame recording " << path;
+		Close();
+		return false;
+	}
+
+	size_ = static_cast<size_t>(file_stat.st_size);
+	void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, file_, 0);
+	if (data != MAP_FAILED)
+	{
+		// Playback reads every frame once, in order.
+		madvise(data, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const uint8_t*>(data);
+	}
+#endif // _WIN32
+
+	if (!data_)
+	{
+		LOG(LS_ERROR) << "Failed to map the frame recording " << path;
+		Close();
+		return false;
+	}
+
+	// Stream header: YUV4MPEG2 W<width> H<height> F<num>:<den> [C420...]
+	size_t offset = 0;
+	std::string line;
+	if (!ReadLine(data_, size_, &offset, &line) || line.compare(0, 9, kStreamMagic) != 0)
+	{
+		LOG(LS_ERROR) << path << " is not a Y4M file.";
+		Close();
+		return false;
+	}
+
+	file_frame_rate_ = 0;
+	size_t start = 0;
+	while ((start = line.find(' ', start)) != std::string::npos)
+	{
+		start++;
+		std::string token = line.substr(start, line.find(' ', start) - start);
+		if (token.empty())
+		{
+			continue;
+		}
+
+		if (token[0] == 'W')
+		{
+			width_ = atoi(token.c_str() + 1);
+		}
+		else if (token[0] == 'H')
+		{
+			height_ = atoi(token.c_str() + 1);
+		}
+		else if (token[0] == 'F')
+		{
+			int numerator = 0;
+			int denominator = 0;
+			if (sscanf(token.c_str() + 1, "%d:%d", &numerator, &denominator) == 2 &&
+				denominator > 0)
+			{
+				file_frame_rate_ = static_cast<int>(lround(
+					static_cast<double>(numerator) / denominator));
+			}
+		}
+		else if (token[0] == 'C' && (token.compare(0, 4, "C420") != 0 ||
+			(token.size() > 5 && token[4] == 'p' && isdigit(token[5]))))
+		{
+			// 8-bit only, high bit depth is C420p10 and the like.
+			LOG(LS_ERROR) << path << " is not 4:2:0, " << token;
+			Close();
+			return false;
+		}
+	}
+
+	if (width_ <= 0 || height_ <= 0)
+	{
+		LOG(LS_ERROR) << path << " has no frame size.";
+		Close();
+		return false;
+	}
+
+	// Frame headers may carry parameters, each one is looked up.
+	size_t frame_size = static_cast<size_t>(width_) * height_ +
+		2 * static_cast<size_t>((width_ + 1) / 2) * ((height_ + 1) / 2);
+
+	while (offset < size_ && ReadLine(data_, size_, &offset, &line) &&
+		line.compare(0, 5, kFrameMagic) == 0 && size_ - offset >= frame_size)
+	{
+		frames_.push_back(data_ + offset);
+		offset += frame_size;
+	}
+
+	if (frames_.empty())
+	{
+		LOG(LS_ERROR) << path << " has no complete frame.";
+		Close();
+		return false;
+	}
+
+	frame_rate_ = file_frame_rate_;
+	return true;
+}
+
+void ReplayBufferCapturer::SetFrameRate(int fps)
+{
+	frame_rate_ = fps;
+}
+
+void ReplayBufferCapturer::SetLoop(bool loop)
+{
+	loop_ = loop;
+}
+
+cricket::CaptureState ReplayBufferCapturer::Start(const cricket::VideoFormat& format)
+{
+	cricket::CaptureState state = MemoryBufferCapturer::Start(format);
+	if (!frames_.empty() && !thread_.joinable())
+	{
+		stopping_ = false;
+		frames_sent_ = 0;
+		thread_ = std::thread(&ReplayBufferCapturer::Run, this);
+	}
+
+	return state;
+}
+
+void ReplayBufferCapturer::Stop()
+{
+	StopPlayback();
+	MemoryBufferCapturer::Stop();
+}
+
+void ReplayBufferCapturer::WaitForEnd()
+{
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+}
+
+void ReplayBufferCapturer::StopPlayback()
+{
+	stopping_ = true;
+	if (thread_.joinable())
+	{
+		thread_.join();
+	}
+}
+
+void ReplayBufferCapturer::Run()
+{
+	std::unique_ptr<FramePacer> pacer;
+	if (frame_rate_ > 0)
+	{
+		pacer.reset(new FramePacer(frame_rate_));
+	}
+
+	int chroma_width = (width_ + 1) / 2;
+	size_t chroma_size = static_cast<size_t>(chroma_width) * ((height_ + 1) / 2);
+	size_t index = 0;
+	while (!stopping_)
+	{
+		if (index == frames_.size())
+		{
+			if (!loop_)
+			{
+				break;
+			}
+
+			index = 0;
+		}
+
+		if (pacer)
+		{
+			pacer->WaitForNextFrame();
+		}
+
+		const uint8_t* data_y = frames_[index++];
+		const uint8_t* data_u = data_y + static_cast<size_t>(width_) * height_;
+		const uint8_t* data_v = data_u + chroma_size;
+		frames_in_flight_++;
+		SendFrame(data_y, width_, data_u, chroma_width, data_v, chroma_width,
+			width_, height_, -1, rtc::Callback0<void>([this]()
+			{
+				frames_in_flight_--;
+			}));
+
+		frames_sent_++;
+	}
+}
+
+void ReplayBufferCapturer::Close()
+{
+	RTC_DCHECK_EQ(frames_in_flight_.load(), 0);
+	frames_.clear();
+#ifdef _WIN32
+	if (data_)
+	{
+		UnmapViewOfFile(data_);
+	}
+
+	if (mapping_)
+	{
+		CloseHandle(mapping_);
+	}
+
+	if (file_ != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(file_);
+	}
+
+	mapping_ = nullptr;
+	file_ = INVALID_HANDLE_VALUE;
+#else
+	if (data_)
+	{
+		munmap(const_cast<uint8_t*>(data_), size_);
+	}
+
+	if (file_ >= 0)
+	{
+		close(file_);
+	}
+
+	file_ = -1;
+#endif // _WIN32
+
+	data_ = nullptr;
+	size_ = 0;
+	width_ = 0;
+	height_ = 0;
+}
@@ -0,0 +1,108 @@
+#include "pch.h"
+
+#include "worker_pool.h"
+
+using namespace StreamingToolkit;
+
+WorkerPool::WorkerPool(int thread_count) :
+	task_(nullptr),
+	task_count_(0),
+	next_task_(0),
+	active_workers_(0),
+	generation_(0),
+	stopping_(false)
+{
+	for (int i = 1; i < thread_count; i++)
+	{
+		threads_.push_back(std::thread(&WorkerPool::Run, this));
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+
+	work_ready_.notify_all();
+	for (auto& thread : threads_)
+	{
+		thread.join();
+	}
+}
+
+void WorkerPool::ParallelFor(int task_count, const std::function<void(int)>& task)
+{
+	// Nothing to share, runs inline.
+	if (threads_.empty() || task_count <= 1)
+	{
+		for (int i = 0; i < task_count; i++)
+		{
+			task(i);
+		}
+
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		task_ = &task;
+		task_count_ = task_count;
+		next_task_ = 0;
+		generation_++;
+	}
+
+	work_ready_.notify_all();
+
+	// The calling thread picks up tasks as well.
+	int index;
+	while ((index = next_task_.fetch_add(1)) < task_count)
+	{
+		task(index);
+	}
+
+	// Every task has been claimed, waits for the workers still running one.
+	std::unique_lock<std::mutex> lock(mutex_);
+	work_done_.wait(lock, [this] { return active_workers_ == 0; });
+	task_ = nullptr;
+	task_count_ = 0;
+}
+
+void WorkerPool::Run()
+{
+	uint64_t generation = 0;
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		work_ready_.wait(lock, [&] { return stopping_ || generation_ != generation; });
+		if (stopping_)
+		{
+			return;
+		}
+
+		// Workers waking up after the batch has completed have nothing to do.
+		generation = generation_;
+		const std::function<void(int)>* task = task_;
+		int task_count = task_count_;
+		if (!task || task_count == 0)
+		{
+			continue;
+		}
+
+		active_workers_++;
+		lock.unlock();
+
+		int index;
+		while ((index = next_task_.fetch_add(1)) < task_count)
+		{
+			(*task)(index);
+		}
+
+		lock.lock();
+		if (--active_workers_ == 0)
+		{
+			work_done_.notify_all();
+		}
+	}
+}
@@ -301,6 +301,15 @@ void InitWebRTC()
 		webrtcConfig.get(),
 		&s_clientObserver);
 
+	auto nvEncConfig = GlobalObject<NvEncConfig>::Get();
+	auto encoderBackend = EncoderBackendFactory::GetConfiguredBackend(*nvEncConfig);
+	s_conductor->SetEncoderBackend(encoderBackend, nvEncConfig->null_encoder_frame_size);
+
+	// The render texture size isn't known yet, sessions are pooled once the
+	// first client disconnects.
+	s_conductor->SetEncoderSessionPool(
+		EncoderBackendFactory::CreateSessionPool(encoderBackend, *nvEncConfig));
+
 	client.RegisterObserver(&s_clientObserver);
 
 	InputDataHandler inputHandler([&](const std::string& message)
@@ -514,16 +523,14 @@ extern "C" __declspec(dllexport) void InitializeBufferCapturer(void* leftRT, voi
 		new DirectXBufferCapturer(s_Device.Get()));
 
 	s_bufferCapturer->Initialize();
-	if (nvEncConfig->use_software_encoding)
-	{
-		s_bufferCapturer->EnableSoftwareEncoder();
-	}
+	s_bufferCapturer->ApplyConfig(*nvEncConfig);
 
 	s_messageThread = new std::thread(InitWebRTC);
 }
 
 extern "C" __declspec(dllexport) void SendFrame(bool isStereo, int64_t predictionTimestamp)
 {
+	s_bufferCapturer->GetQpMapGenerator()->SetStereo(isStereo);
 	if (!isStereo)
 	{
 		s_bufferCapturer->SendFrame(s_leftFrameBuffer, predictionTimestamp);
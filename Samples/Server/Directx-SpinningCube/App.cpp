@@ -18,6 +18,10 @@
 #include "webrtc.h"
 #include "config_parser.h"
 #include "directx_buffer_capturer.h"
+#include "frame_pacer.h"
+#include "frame_recorder.h"
+#include "frame_timing.h"
+#include "latency_probe.h"
 #include "service/render_service.h"
 #endif // TEST_RUNNER
 
@@ -118,15 +122,40 @@ bool AppMain(BOOL stopping)
 	bufferCapturer->Initialize(serverConfig->server_config.system_service,
 		serverConfig->server_config.width, serverConfig->server_config.height);
 
-	if (nvEncConfig->use_software_encoding)
+	bufferCapturer->ApplyConfig(*nvEncConfig);
+	EncoderBackend encoderBackend = EncoderBackendFactory::GetConfiguredBackend(*nvEncConfig);
+
+	FrameTimingRecorder::Instance()->SetEnabled(
+		!nvEncConfig->frame_timing_trace_file.empty());
+
+	// Records the captured frames for replay with ReplayBufferCapturer.
+	FrameRecorder frameRecorder;
+	if (!nvEncConfig->capture_record_file.empty() &&
+		frameRecorder.Open(nvEncConfig->capture_record_file, nvEncConfig->capture_fps))
 	{
-		bufferCapturer->EnableSoftwareEncoder();
+		bufferCapturer->SetRecordingSink(&frameRecorder);
 	}
 
+	// Detects the frame IDs that clients echo back on decode.
+	LatencyProbeDetector latencyProbeEchoes;
+
 	// Initializes the conductor.
 	rtc::scoped_refptr<Conductor> conductor(new rtc::RefCountedObject<Conductor>(
 		&client, bufferCapturer.get(), &wnd, webrtcConfig.get()));
 
+	conductor->SetEncoderBackend(encoderBackend, nvEncConfig->null_encoder_frame_size);
+
+	// Opens the encoder sessions before the first client connects.
+	auto encoderSessionPool = EncoderBackendFactory::CreateSessionPool(encoderBackend, *nvEncConfig);
+	if (encoderSessionPool)
+	{
+		encoderSessionPool->WarmUp(EncoderBackendFactory::GetCodecSettings(
+			serverConfig->server_config.width, serverConfig->server_config.height,
+			nvEncConfig->capture_fps));
+
+		conductor->SetEncoderSessionPool(encoderSessionPool);
+	}
+
 	// Gets the frame buffer from the swap chain.
 	ComPtr<ID3D11Texture2D> frameBuffer;
 	if (!serverConfig->server_config.system_service)
@@ -166,6 +195,7 @@ bool AppMain(BOOL stopping)
 					// Resizes the swap chain.
 					frameBuffer.Reset();
 					g_deviceResources->SetStereo(isStereo);
+					bufferCapturer->GetQpMapGenerator()->SetStereo(isStereo);
 					if (!serverConfig->server_config.system_service)
 					{
 						HRESULT hr = g_deviceResources->GetSwapChain()->GetBuffer(
@@ -196,6 +226,17 @@ bool AppMain(BOOL stopping)
 					}
 				}
 			}
+			else if (strcmp(type, "gaze") == 0)
+			{
+				// Eye index, then the gaze point normalized to the eye view.
+				int eye;
+				double x;
+				double y;
+				if (QpMapGenerator::ParseGazeBody(body, &eye, &x, &y))
+				{
+					bufferCapturer->GetQpMapGenerator()->SetFocusPoint(eye, x, y);
+				}
+			}
 			else if (strcmp(type, "camera-transform-lookat") == 0)
 			{
 				// Eye point.
@@ -290,6 +331,15 @@ bool AppMain(BOOL stopping)
 					g_hasNewInputData = true;
 				}
 			}
+			else if (strcmp(type, "latency-probe") == 0)
+			{
+				// Frame ID read by the client from a decoded frame.
+				LatencyProbe::Id id;
+				if (LatencyProbe::ParseEchoBody(body, &id))
+				{
+					latencyProbeEchoes.OnEcho(id);
+				}
+			}
 		}
 	});
 
@@ -389,6 +439,9 @@ bool AppMain(BOOL stopping)
 		conductor->StartLogin(webrtcConfig->server, webrtcConfig->port);
 	}
 
+	// Paces the rendered frames at the capture frame rate.
+	FramePacer framePacer(nvEncConfig->capture_fps);
+
 	// Main loop.
 	while (!stopping)
 	{
@@ -412,7 +465,6 @@ bool AppMain(BOOL stopping)
 
 			if (conductor->connection_active() || client.is_connected())
 			{
-				ULONGLONG tick = GetTickCount64();
 				if (!g_deviceResources->IsStereo())
 				{
 					if (g_hasNewInputData)
@@ -439,15 +491,7 @@ bool AppMain(BOOL stopping)
 					}
 
 					// FPS limiter.
-					const int interval = 1000 / nvEncConfig->capture_fps;
-					ULONGLONG timeElapsed = GetTickCount64() - tick;
-					DWORD sleepAmount = 0;
-					if (timeElapsed < interval)
-					{
-						sleepAmount = interval - timeElapsed;
-					}
-
-					Sleep(sleepAmount);
+					framePacer.WaitForNextFrame();
 				}
 				// In stereo rendering mode, we only update frame whenever
 				// receiving any input data.
@@ -475,6 +519,33 @@ bool AppMain(BOOL stopping)
 		}
 	}
 
+	bufferCapturer->SetRecordingSink(nullptr);
+	frameRecorder.Close();
+
+	FramePacer::Stats pacerStats = framePacer.GetStats();
+	LOG(INFO) << "Frames paced: " << pacerStats.frames
+		<< ", skipped slots: " << pacerStats.skipped_slots
+		<< ", frame interval p50 " << pacerStats.p50_interval_ms
+		<< " ms, p99 " << pacerStats.p99_interval_ms << " ms";
+
+	if (nvEncConfig->latency_probe)
+	{
+		// Includes the return trip of the echo.
+		LatencyProbeDetector::Stats stats = latencyProbeEchoes.GetStats();
+		LOG(INFO) << "Capture to echo latency: p50 " << stats.p50_latency_ms
+			<< " ms, p99 " << stats.p99_latency_ms << " ms, max " << stats.max_latency_ms
+			<< " ms, frames measured: " << stats.frames_detected
+			<< ", missed: " << stats.frames_missed;
+	}
+
+	// Stops the collector thread, draining the last events.
+	FrameTimingRecorder::Instance()->SetEnabled(false);
+	if (!nvEncConfig->frame_timing_trace_file.empty())
+	{
+		FrameTimingRecorder::Instance()->WriteChromeTrace(
+			nvEncConfig->frame_timing_trace_file);
+	}
+
 	rtc::CleanupSSL();
 
 	// Cleanup.
@@ -0,0 +1,860 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#include <sys/resource.h>
+#endif // _WIN32
+
+#include "frame_converter.h"
+#include "latency_probe.h"
+#include "memory_buffer_capturer.h"
+#include "replay_buffer_capturer.h"
+#include "SyntheticFrameSource.h"
+
+#include "libyuv/convert.h"
+#include "third_party/jsoncpp/source/include/json/json.h"
+#include "webrtc/api/video/i420_buffer.h"
+#include "webrtc/media/base/codec.h"
+#include "webrtc/media/base/mediaconstants.h"
+#include "webrtc/modules/video_coding/codecs/h264/include/h264.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "webrtc.lib")
+#endif // _WIN32
+
+using namespace StreamingToolkit;
+
+// Counts C++ heap allocations so that per-frame allocations show up in the
+// capture results. Buffers allocated through malloc (libyuv, aligned frame
+// planes) are not counted.
+static std::atomic<uint64_t> s_allocations(0);
+
+void* operator new(size_t size)
+{
+	s_allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+namespace
+{
+	struct Resolution
+	{
+		const char* name;
+		int width;
+		int height;
+	};
+
+	const Resolution kResolutions[] =
+	{
+		{ "720p", 1280, 720 },
+		{ "1080p", 1920, 1080 },
+		{ "1440p", 2560, 1440 },
+		{ "4K", 3840, 2160 }
+	};
+
+	// The capture suite skips 1440p to keep the run time down.
+	const Resolution kCaptureResolutions[] =
+	{
+		{ "720p", 1280, 720 },
+		{ "1080p", 1920, 1080 },
+		{ "4K", 3840, 2160 }
+	};
+
+	const int kWarmupFrames = 10;
+	const int kConversionFrames = 100;
+	const int kDefaultCaptureFrames = 120;
+	const int kEncoderFrameRate = 60;
+
+	// Distinct frames the encoder suite cycles through.
+	const int kEncoderInputFrames = 30;
+
+	struct Options
+	{
+		std::string suite;
+		int max_threads;
+		int capture_frames;
+		std::string output_path;
+		std::string input_path;
+	};
+
+	struct I420Frame
+	{
+		I420Frame(int width, int height) :
+			stride_y(width),
+			stride_uv((width + 1) / 2),
+			y(stride_y * height),
+			u(stride_uv * ((height + 1) / 2)),
+			v(stride_uv * ((height + 1) / 2))
+		{
+		}
+
+		bool operator==(const I420Frame& other) const
+		{
+			return y == other.y && u == other.u && v == other.v;
+		}
+
+		int stride_y;
+		int stride_uv;
+		std::vector<uint8_t> y;
+		std::vector<uint8_t> u;
+		std::vector<uint8_t> v;
+	};
+
+	struct MemoryUsage
+	{
+		uint64_t rss_bytes;
+		uint64_t peak_rss_bytes;
+	};
+
+	MemoryUsage GetMemoryUsage()
+	{
+		MemoryUsage usage = { 0 };
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			usage.rss_bytes = counters.WorkingSetSize;
+			usage.peak_rss_bytes = counters.PeakWorkingSetSize;
+		}
+#else
+		long pages = 0;
+		long resident_pages = 0;
+		FILE* statm = fopen("/proc/self/statm", "r");
+		if (statm)
+		{
+			if (fscanf(statm, "%ld %ld", &pages, &resident_pages) == 2)
+			{
+				usage.rss_bytes = static_cast<uint64_t>(resident_pages) * sysconf(_SC_PAGESIZE);
+			}
+
+			fclose(statm);
+		}
+
+		struct rusage resources;
+		if (getrusage(RUSAGE_SELF, &resources) == 0)
+		{
+			usage.peak_rss_bytes = static_cast<uint64_t>(resources.ru_maxrss) * 1024;
+		}
+#endif // _WIN32
+
+		return usage;
+	}
+
+	Json::Value GetPercentiles(std::vector<double> values_ms)
+	{
+		Json::Value percentiles;
+		if (values_ms.empty())
+		{
+			return percentiles;
+		}
+
+		std::sort(values_ms.begin(), values_ms.end());
+		size_t last = values_ms.size() - 1;
+		percentiles["p50"] = values_ms[last * 50 / 100];
+		percentiles["p90"] = values_ms[last * 90 / 100];
+		percentiles["p99"] = values_ms[last * 99 / 100];
+		percentiles["max"] = values_ms[last];
+		return percentiles;
+	}
+
+	// Counts delivered frames and optionally feeds them to an encoder, all on
+	// the capturer's thread.
+	class BenchmarkSink :
+		public rtc::VideoSinkInterface<webrtc::VideoFrame>,
+		public webrtc::EncodedImageCallback
+	{
+	public:
+		explicit BenchmarkSink(webrtc::VideoEncoder* encoder) :
+			encoder_(encoder),
+			frames_(0),
+			encoded_frames_(0),
+			encoded_bytes_(0),
+			slices_(0)
+		{
+			if (encoder_)
+			{
+				encoder_->RegisterEncodeCompleteCallback(this);
+			}
+		}
+
+		void OnFrame(const webrtc::VideoFrame& frame) override
+		{
+			delivered_time_ = std::chrono::steady_clock::now();
+			frames_++;
+			if (encoder_)
+			{
+				std::vector<webrtc::FrameType> frame_types(1,
+					encoded_frames_ == 0 ? webrtc::kVideoFrameKey : webrtc::kVideoFrameDelta);
+
+				encoder_->Encode(frame, nullptr, &frame_types);
+			}
+		}
+
+		Result OnEncodedImage(const webrtc::EncodedImage& encoded_image,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const webrtc::RTPFragmentationHeader* fragmentation) override
+		{
+			encoded_time_ = std::chrono::steady_clock::now();
+			encoded_frames_++;
+			encoded_bytes_ += encoded_image._length;
+
+			// Counts the coded slice NAL units, parameter sets excluded.
+			if (fragmentation)
+			{
+				slices_ = 0;
+				for (size_t i = 0; i < fragmentation->fragmentationVectorSize; i++)
+				{
+					uint8_t nal_type = encoded_image._buffer[
+						fragmentation->fragmentationOffset[i]] & 0x1F;
+
+					slices_ += nal_type == 1 || nal_type == 5 ? 1 : 0;
+				}
+			}
+
+			return Result(Result::OK);
+		}
+
+		std::chrono::steady_clock::time_point delivered_time() const { return delivered_time_; }
+
+		std::chrono::steady_clock::time_point encoded_time() const { return encoded_time_; }
+
+		uint64_t frames() const { return frames_; }
+
+		uint64_t encoded_frames() const { return encoded_frames_; }
+
+		uint64_t encoded_bytes() const { return encoded_bytes_; }
+
+		// Slices of the last encoded frame.
+		int slices() const { return slices_; }
+
+	private:
+		webrtc::VideoEncoder* encoder_;
+		std::chrono::steady_clock::time_point delivered_time_;
+		std::chrono::steady_clock::time_point encoded_time_;
+		uint64_t frames_;
+		uint64_t encoded_frames_;
+		uint64_t encoded_bytes_;
+		int slices_;
+	};
+
+	// Encodes the delivered frames and decodes them back on the capturer's
+	// thread, reading the latency probe of each decoded frame.
+	class LoopbackSink :
+		public rtc::VideoSinkInterface<webrtc::VideoFrame>,
+		public webrtc::EncodedImageCallback,
+		public webrtc::DecodedImageCallback
+	{
+	public:
+		LoopbackSink(webrtc::VideoEncoder* encoder, webrtc::VideoDecoder* decoder) :
+			encoder_(encoder),
+			decoder_(decoder),
+			encoded_frames_(0)
+		{
+			encoder_->RegisterEncodeCompleteCallback(this);
+			decoder_->RegisterDecodeCompleteCallback(this);
+		}
+
+		void OnFrame(const webrtc::VideoFrame& frame) override
+		{
+			std::vector<webrtc::FrameType> frame_types(1,
+				encoded_frames_ == 0 ? webrtc::kVideoFrameKey : webrtc::kVideoFrameDelta);
+
+			encoder_->Encode(frame, nullptr, &frame_types);
+		}
+
+		Result OnEncodedImage(const webrtc::EncodedImage& encoded_image,
+			const webrtc::CodecSpecificInfo* codec_specific_info,
+			const webrtc::RTPFragmentationHeader* fragmentation) override
+		{
+			encoded_frames_++;
+			decoder_->Decode(encoded_image, false, fragmentation);
+			return Result(Result::OK);
+		}
+
+		int32_t Decoded(webrtc::VideoFrame& decoded_image) override
+		{
+			detector_.OnFrame(decoded_image);
+			return 0;
+		}
+
+		const LatencyProbeDetector& detector() const { return detector_; }
+
+	private:
+		webrtc::VideoEncoder* encoder_;
+		webrtc::VideoDecoder* decoder_;
+		LatencyProbeDetector detector_;
+		uint64_t encoded_frames_;
+	};
+
+	// Forces OpenH264 regardless of nvEncConfig.json, with the packetization
+	// mode negotiated with clients so that a frame can be split into slices
+	// encoded by |threads| threads.
+	std::unique_ptr<webrtc::VideoEncoder> CreateSoftwareEncoder(int width, int height,
+		int threads)
+	{
+		if (!webrtc::H264Encoder::IsSupported())
+		{
+			return nullptr;
+		}
+
+		cricket::VideoCodec codec(cricket::kH264CodecName);
+		codec.SetParam(cricket::kH264FmtpPacketizationMode, "1");
+		codec.SetParam(cricket::kH264UseHWNvencode, 0);
+		std::unique_ptr<webrtc::VideoEncoder> encoder(webrtc::H264Encoder::Create(codec));
+
+		webrtc::VideoCodec codec_settings;
+		codec_settings.codecType = webrtc::kVideoCodecH264;
+		codec_settings.width = width;
+		codec_settings.height = height;
+		codec_settings.maxFramerate = kEncoderFrameRate;
+
+		// Roughly 0.1 bits per pixel.
+		codec_settings.startBitrate = width * height * kEncoderFrameRate / 10000;
+		codec_settings.targetBitrate = codec_settings.startBitrate;
+		codec_settings.maxBitrate = codec_settings.startBitrate * 2;
+		codec_settings.mode = webrtc::kRealtimeVideo;
+		if (encoder->InitEncode(&codec_settings, threads, 1200) != WEBRTC_VIDEO_CODEC_OK)
+		{
+			return nullptr;
+		}
+
+		return encoder;
+	}
+
+	// Reports the RGBA to I420 conversion time per frame for each resolution
+	// using 1 to N conversion threads.
+	Json::Value RunConversionSuite(const Options& options)
+	{
+		Json::Value results(Json::arrayValue);
+		for (const Resolution& resolution : kResolutions)
+		{
+			int width = resolution.width;
+			int height = resolution.height;
+			SyntheticFrameSource source(SyntheticFrameSource::kPatternNoise, width, height);
+			const uint8_t* rgba = source.Render(0);
+
+			// Reference output from a single libyuv call.
+			I420Frame reference(width, height);
+			libyuv::ABGRToI420(rgba, source.stride(),
+				reference.y.data(), reference.stride_y,
+				reference.u.data(), reference.stride_uv,
+				reference.v.data(), reference.stride_uv,
+				width, height);
+
+			double single_thread_ms = 0;
+			for (int threads = 1; threads <= options.max_threads; threads++)
+			{
+				FrameConverter converter(threads);
+				I420Frame output(width, height);
+				auto convert = [&]()
+				{
+					converter.ABGRToI420(rgba, source.stride(),
+						output.y.data(), output.stride_y,
+						output.u.data(), output.stride_uv,
+						output.v.data(), output.stride_uv,
+						width, height);
+				};
+
+				for (int i = 0; i < kWarmupFrames; i++)
+				{
+					convert();
+				}
+
+				auto start = std::chrono::steady_clock::now();
+				for (int i = 0; i < kConversionFrames; i++)
+				{
+					convert();
+				}
+
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				double ms = std::chrono::duration<double, std::milli>(elapsed).count() /
+					kConversionFrames;
+
+				if (threads == 1)
+				{
+					single_thread_ms = ms;
+				}
+
+				Json::Value result;
+				result["resolution"] = resolution.name;
+				result["width"] = width;
+				result["height"] = height;
+				result["threads"] = threads;
+				result["ms_per_frame"] = ms;
+				result["speedup"] = single_thread_ms / ms;
+				result["identical"] = output == reference;
+				results.append(result);
+			}
+		}
+
+		return results;
+	}
+
+	// Pushes synthetic frames through MemoryBufferCapturer into a counting
+	// sink and into a software H.264 encoder, one configuration at a time.
+	Json::Value RunCaptureSuite(const Options& options)
+	{
+		Json::Value results(Json::arrayValue);
+		for (const Resolution& resolution : kCaptureResolutions)
+		{
+			for (int pattern = 0; pattern < SyntheticFrameSource::kPatternCount; pattern++)
+			{
+				for (int encode = 0; encode <= 1; encode++)
+				{
+					int width = resolution.width;
+					int height = resolution.height;
+					SyntheticFrameSource source(
+						static_cast<SyntheticFrameSource::Pattern>(pattern), width, height);
+
+					std::unique_ptr<webrtc::VideoEncoder> encoder;
+					if (encode)
+					{
+						encoder = CreateSoftwareEncoder(width, height, 1);
+						if (!encoder)
+						{
+							fprintf(stderr, "Software H.264 encoder unavailable, skipping.\n");
+							continue;
+						}
+					}
+
+					BenchmarkSink sink(encoder.get());
+					MemoryBufferCapturer capturer;
+					capturer.SetConversionThreadCount(options.max_threads);
+					capturer.Start(cricket::VideoFormat(width, height,
+						cricket::VideoFormat::FpsToInterval(kEncoderFrameRate),
+						cricket::FOURCC_I420));
+
+					capturer.AddOrUpdateSink(&sink, rtc::VideoSinkWants());
+
+					std::vector<double> capture_ms;
+					std::vector<double> total_ms;
+					double busy_ms = 0;
+					uint64_t allocations = 0;
+					int total_frames = kWarmupFrames + options.capture_frames;
+					for (int i = 0; i < total_frames; i++)
+					{
+						// Rendering is not part of the measurement.
+						const uint8_t* rgba = source.Render(i);
+						uint64_t frame_allocations = s_allocations;
+						auto start = std::chrono::steady_clock::now();
+						capturer.SendFrame(rgba, source.stride(),
+							MemoryBufferCapturer::kPixelFormatRGBA, width, height);
+
+						auto end = std::chrono::steady_clock::now();
+						if (i < kWarmupFrames)
+						{
+							continue;
+						}
+
+						allocations += s_allocations - frame_allocations;
+						busy_ms += std::chrono::duration<double, std::milli>(end - start).count();
+						capture_ms.push_back(std::chrono::duration<double, std::milli>(
+							sink.delivered_time() - start).count());
+
+						if (encoder)
+						{
+							total_ms.push_back(std::chrono::duration<double, std::milli>(
+								sink.encoded_time() - start).count());
+						}
+					}
+
+					capturer.Stop();
+					if (encoder)
+					{
+						encoder->Release();
+					}
+
+					MemoryUsage memory = GetMemoryUsage();
+					Json::Value result;
+					result["pattern"] = SyntheticFrameSource::GetPatternName(
+						static_cast<SyntheticFrameSource::Pattern>(pattern));
+
+					result["resolution"] = resolution.name;
+					result["width"] = width;
+					result["height"] = height;
+					result["sink"] = encoder ? "h264" : "counting";
+					result["threads"] = options.max_threads;
+					result["frames"] = options.capture_frames;
+					result["frames_delivered"] = static_cast<Json::UInt64>(sink.frames());
+					result["fps"] = busy_ms > 0 ? options.capture_frames * 1000.0 / busy_ms : 0.0;
+					result["capture_latency_ms"] = GetPercentiles(capture_ms);
+					result["allocations_per_frame"] =
+						static_cast<double>(allocations) / options.capture_frames;
+
+					if (encoder)
+					{
+						result["encode_latency_ms"] = GetPercentiles(total_ms);
+						result["encoded_frames"] = static_cast<Json::UInt64>(sink.encoded_frames());
+						result["encoded_bytes_per_frame"] = sink.encoded_frames() > 0 ?
+							static_cast<double>(sink.encoded_bytes()) / sink.encoded_frames() : 0.0;
+					}
+
+					result["rss_bytes"] = static_cast<Json::UInt64>(memory.rss_bytes);
+					result["peak_rss_bytes"] = static_cast<Json::UInt64>(memory.peak_rss_bytes);
+					results.append(result);
+				}
+			}
+		}
+
+		return results;
+	}
+
+	// Reports the software H.264 encoding rate for each resolution using 1 to
+	// N encoder threads. Frames are converted up front, so only encoding is
+	// measured. A softwareEncoderThreads entry in nvEncConfig.json next to the
+	// executable overrides the thread count.
+	Json::Value RunEncoderSuite(const Options& options)
+	{
+		Json::Value results(Json::arrayValue);
+		for (const Resolution& resolution : kResolutions)
+		{
+			int width = resolution.width;
+			int height = resolution.height;
+			SyntheticFrameSource source(SyntheticFrameSource::kPatternScrollingText, width, height);
+			std::vector<rtc::scoped_refptr<webrtc::I420Buffer>> frames;
+			for (int i = 0; i < kEncoderInputFrames; i++)
+			{
+				const uint8_t* rgba = source.Render(i);
+				rtc::scoped_refptr<webrtc::I420Buffer> buffer =
+					webrtc::I420Buffer::Create(width, height);
+
+				libyuv::ABGRToI420(rgba, source.stride(),
+					buffer->MutableDataY(), buffer->StrideY(),
+					buffer->MutableDataU(), buffer->StrideU(),
+					buffer->MutableDataV(), buffer->StrideV(),
+					width, height);
+
+				frames.push_back(buffer);
+			}
+
+			double single_thread_fps = 0;
+			for (int threads = 1; threads <= options.max_threads; threads++)
+			{
+				std::unique_ptr<webrtc::VideoEncoder> encoder =
+					CreateSoftwareEncoder(width, height, threads);
+
+				if (!encoder)
+				{
+					fprintf(stderr, "Software H.264 encoder unavailable, skipping.\n");
+					return results;
+				}
+
+				BenchmarkSink sink(encoder.get());
+				std::chrono::steady_clock::time_point start;
+				int total_frames = kWarmupFrames + options.capture_frames;
+				for (int i = 0; i < total_frames; i++)
+				{
+					if (i == kWarmupFrames)
+					{
+						start = std::chrono::steady_clock::now();
+					}
+
+					sink.OnFrame(webrtc::VideoFrame(frames[i % frames.size()],
+						static_cast<uint32_t>(i * 90000 / kEncoderFrameRate), 0,
+						webrtc::kVideoRotation_0));
+				}
+
+				auto elapsed = std::chrono::steady_clock::now() - start;
+				double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+				double fps = ms > 0 ? options.capture_frames * 1000.0 / ms : 0.0;
+				encoder->Release();
+				if (threads == 1)
+				{
+					single_thread_fps = fps;
+				}
+
+				Json::Value result;
+				result["resolution"] = resolution.name;
+				result["width"] = width;
+				result["height"] = height;
+				result["threads"] = threads;
+				result["slices"] = sink.slices();
+				result["frames"] = options.capture_frames;
+				result["fps"] = fps;
+				result["ms_per_frame"] = fps > 0 ? 1000.0 / fps : 0.0;
+				result["speedup"] = single_thread_fps > 0 ? fps / single_thread_fps : 0.0;
+				result["encoded_bytes_per_frame"] = sink.encoded_frames() > 0 ?
+					static_cast<double>(sink.encoded_bytes()) / sink.encoded_frames() : 0.0;
+
+				results.append(result);
+			}
+		}
+
+		return results;
+	}
+
+	// Replays a recorded Y4M file through ReplayBufferCapturer into a
+	// counting sink and into a software H.264 encoder, as fast as they take
+	// the frames, so that runs on the same recording are comparable.
+	Json::Value RunReplaySuite(const Options& options)
+	{
+		Json::Value results(Json::arrayValue);
+		for (int encode = 0; encode <= 1; encode++)
+		{
+			ReplayBufferCapturer capturer;
+			if (!capturer.Open(options.input_path))
+			{
+				fprintf(stderr, "Failed to open %s, skipping.\n", options.input_path.c_str());
+				return results;
+			}
+
+			int width = capturer.width();
+			int height = capturer.height();
+			std::unique_ptr<webrtc::VideoEncoder> encoder;
+			if (encode)
+			{
+				encoder = CreateSoftwareEncoder(width, height, options.max_threads);
+				if (!encoder)
+				{
+					fprintf(stderr, "Software H.264 encoder unavailable, skipping.\n");
+					continue;
+				}
+			}
+
+			BenchmarkSink sink(encoder.get());
+			capturer.SetFrameRate(0);
+			capturer.AddOrUpdateSink(&sink, rtc::VideoSinkWants());
+			auto start = std::chrono::steady_clock::now();
+			capturer.Start(cricket::VideoFormat(width, height,
+				cricket::VideoFormat::FpsToInterval(kEncoderFrameRate),
+				cricket::FOURCC_I420));
+
+			capturer.WaitForEnd();
+			auto elapsed = std::chrono::steady_clock::now() - start;
+			capturer.Stop();
+			if (encoder)
+			{
+				encoder->Release();
+			}
+
+			double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+			Json::Value result;
+			result["input"] = options.input_path;
+			result["width"] = width;
+			result["height"] = height;
+			result["sink"] = encoder ? "h264" : "counting";
+			result["threads"] = options.max_threads;
+			result["frames"] = capturer.frame_count();
+			result["frames_delivered"] = static_cast<Json::UInt64>(sink.frames());
+			result["fps"] = ms > 0 ? sink.frames() * 1000.0 / ms : 0.0;
+			if (encoder)
+			{
+				result["encoded_frames"] = static_cast<Json::UInt64>(sink.encoded_frames());
+				result["encoded_bytes_per_frame"] = sink.encoded_frames() > 0 ?
+					static_cast<double>(sink.encoded_bytes()) / sink.encoded_frames() : 0.0;
+			}
+
+			results.append(result);
+		}
+
+		return results;
+	}
+
+	// Runs synthetic frames through the capturer with the latency probe
+	// enabled, a software H.264 encoder and decoder, and reports the capture
+	// to decode latency read from the decoded frames.
+	Json::Value RunLatencySuite(const Options& options)
+	{
+		Json::Value results(Json::arrayValue);
+		if (!webrtc::H264Decoder::IsSupported())
+		{
+			fprintf(stderr, "Software H.264 decoder unavailable, skipping.\n");
+			return results;
+		}
+
+		for (const Resolution& resolution : kCaptureResolutions)
+		{
+			int width = resolution.width;
+			int height = resolution.height;
+			std::unique_ptr<webrtc::VideoEncoder> encoder =
+				CreateSoftwareEncoder(width, height, options.max_threads);
+
+			if (!encoder)
+			{
+				fprintf(stderr, "Software H.264 encoder unavailable, skipping.\n");
+				return results;
+			}
+
+			std::unique_ptr<webrtc::VideoDecoder> decoder(webrtc::H264Decoder::Create());
+			webrtc::VideoCodec codec_settings;
+			codec_settings.codecType = webrtc::kVideoCodecH264;
+			codec_settings.width = width;
+			codec_settings.height = height;
+			if (decoder->InitDecode(&codec_settings, options.max_threads) != WEBRTC_VIDEO_CODEC_OK)
+			{
+				fprintf(stderr, "Software H.264 decoder unavailable, skipping.\n");
+				return results;
+			}
+
+			SyntheticFrameSource source(SyntheticFrameSource::kPatternScrollingText, width, height);
+			LoopbackSink sink(encoder.get(), decoder.get());
+			MemoryBufferCapturer capturer;
+			capturer.SetConversionThreadCount(options.max_threads);
+			capturer.EnableSoftwareEncoder();
+			capturer.EnableLatencyProbe();
+			capturer.Start(cricket::VideoFormat(width, height,
+				cricket::VideoFormat::FpsToInterval(kEncoderFrameRate),
+				cricket::FOURCC_I420));
+
+			capturer.AddOrUpdateSink(&sink, rtc::VideoSinkWants());
+			for (int i = 0; i < options.capture_frames; i++)
+			{
+				const uint8_t* rgba = source.Render(i);
+				capturer.SendFrame(rgba, source.stride(),
+					MemoryBufferCapturer::kPixelFormatRGBA, width, height);
+			}
+
+			capturer.Stop();
+			encoder->Release();
+			decoder->Release();
+
+			LatencyProbeDetector::Stats stats = sink.detector().GetStats();
+			Json::Value latency;
+			latency["p50"] = stats.p50_latency_ms;
+			latency["p90"] = stats.p90_latency_ms;
+			latency["p99"] = stats.p99_latency_ms;
+			latency["max"] = stats.max_latency_ms;
+
+			Json::Value result;
+			result["resolution"] = resolution.name;
+			result["width"] = width;
+			result["height"] = height;
+			result["threads"] = options.max_threads;
+			result["frames"] = options.capture_frames;
+			result["frames_decoded"] = static_cast<Json::UInt64>(stats.frames_received);
+			result["frames_detected"] = static_cast<Json::UInt64>(stats.frames_detected);
+			result["frames_missed"] = static_cast<Json::UInt64>(stats.frames_missed);
+			result["capture_to_decode_latency_ms"] = latency;
+			results.append(result);
+		}
+
+		return results;
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: CaptureBenchmark [--suite all|conversion|capture|encoder|replay|latency]\n"
+			"                        [--threads N] [--frames N] [--input recording.y4m]\n"
+			"                        [--output results.json]\n");
+	}
+}
+
+// Runs the capture benchmarks and writes the results as JSON to stdout or to
+// the output file. Thread count defaults to the number of hardware threads.
+int main(int argc, char** argv)
+{
+	Options options;
+	options.suite = "all";
+	options.max_threads = static_cast<int>(std::thread::hardware_concurrency());
+	options.capture_frames = kDefaultCaptureFrames;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--suite" && has_value)
+		{
+			options.suite = argv[++i];
+		}
+		else if (arg == "--threads" && has_value)
+		{
+			options.max_threads = atoi(argv[++i]);
+		}
+		else if (arg == "--frames" && has_value)
+		{
+			options.capture_frames = atoi(argv[++i]);
+		}
+		else if (arg == "--output" && has_value)
+		{
+			options.output_path = argv[++i];
+		}
+		else if (arg == "--input" && has_value)
+		{
+			options.input_path = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	options.max_threads = std::max(options.max_threads, 1);
+	options.capture_frames = std::max(options.capture_frames, 1);
+
+	Json::Value root;
+	root["benchmark"] = "CaptureBenchmark";
+	root["hardware_threads"] = static_cast<int>(std::thread::hardware_concurrency());
+	if (options.suite == "all" || options.suite == "conversion")
+	{
+		root["conversion"] = RunConversionSuite(options);
+	}
+
+	if (options.suite == "all" || options.suite == "capture")
+	{
+		root["capture"] = RunCaptureSuite(options);
+	}
+
+	if (options.suite == "all" || options.suite == "encoder")
+	{
+		root["encoder"] = RunEncoderSuite(options);
+	}
+
+	if (options.suite == "all" || options.suite == "latency")
+	{
+		root["latency"] = RunLatencySuite(options);
+	}
+
+	// Only runs with a recording, see FrameRecorder.
+	if ((options.suite == "all" || options.suite == "replay") && !options.input_path.empty())
+	{
+		root["replay"] = RunReplaySuite(options);
+	}
+
+	std::string json = Json::StyledWriter().write(root);
+	if (options.output_path.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream output(options.output_path);
+		output << json;
+		if (!output)
+		{
+			fprintf(stderr, "Failed to write %s\n", options.output_path.c_str());
+			return 1;
+		}
+	}
+
+	return 0;
+}
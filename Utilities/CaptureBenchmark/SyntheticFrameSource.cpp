@@ -0,0 +1,194 @@
+#include <algorithm>
+
+#include "SyntheticFrameSource.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	const char* kPatternNames[] =
+	{
+		"gradient",
+		"noise",
+		"moving-box",
+		"scrolling-text"
+	};
+
+	// Glyphs are 8x12 pixel cells on a 10x16 pixel grid.
+	const int kGlyphWidth = 8;
+	const int kGlyphHeight = 12;
+	const int kCellWidth = 10;
+	const int kCellHeight = 16;
+	const int kScrollSpeed = 2;
+
+	inline void SetPixel(uint8_t* pixel, uint8_t r, uint8_t g, uint8_t b)
+	{
+		pixel[0] = r;
+		pixel[1] = g;
+		pixel[2] = b;
+		pixel[3] = 0xFF;
+	}
+
+	inline uint32_t Hash(uint32_t value)
+	{
+		value ^= value >> 16;
+		value *= 0x7FEB352D;
+		value ^= value >> 15;
+		value *= 0x846CA68B;
+		value ^= value >> 16;
+		return value;
+	}
+}
+
+SyntheticFrameSource::SyntheticFrameSource(Pattern pattern, int width, int height) :
+	pattern_(pattern),
+	width_(width),
+	height_(height),
+	pixels_(width * height * 4),
+	last_index_(-1)
+{
+}
+
+const uint8_t* SyntheticFrameSource::Render(int index)
+{
+	if (index == last_index_)
+	{
+		return pixels_.data();
+	}
+
+	switch (pattern_)
+	{
+		case kPatternGradient:
+			// Static content only needs to be rendered once.
+			if (last_index_ < 0)
+			{
+				RenderGradient();
+			}
+
+			break;
+
+		case kPatternNoise:
+			RenderNoise(index);
+			break;
+
+		case kPatternMovingBox:
+			RenderMovingBox(index);
+			break;
+
+		case kPatternScrollingText:
+			RenderScrollingText(index);
+			break;
+
+		default:
+			break;
+	}
+
+	last_index_ = index;
+	return pixels_.data();
+}
+
+const char* SyntheticFrameSource::GetPatternName(Pattern pattern)
+{
+	return pattern < kPatternCount ? kPatternNames[pattern] : "unknown";
+}
+
+void SyntheticFrameSource::RenderGradient()
+{
+	for (int row = 0; row < height_; row++)
+	{
+		uint8_t* pixel = &pixels_[row * stride()];
+		for (int col = 0; col < width_; col++)
+		{
+			SetPixel(pixel,
+				static_cast<uint8_t>(col * 255 / width_),
+				static_cast<uint8_t>(row * 255 / height_),
+				static_cast<uint8_t>((col + row) * 255 / (width_ + height_)));
+
+			pixel += 4;
+		}
+	}
+}
+
+void SyntheticFrameSource::RenderNoise(int index)
+{
+	uint32_t seed = Hash(static_cast<uint32_t>(index) + 1);
+	uint32_t* pixel = reinterpret_cast<uint32_t*>(pixels_.data());
+	for (size_t i = 0; i < pixels_.size() / 4; i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		pixel[i] = seed | 0xFF000000;
+	}
+}
+
+void SyntheticFrameSource::RenderMovingBox(int index)
+{
+	int box_width = std::max(width_ / 8, 1);
+	int box_height = std::max(height_ / 8, 1);
+
+	// Bounces at 4 pixels per frame on each axis.
+	int range_x = std::max(width_ - box_width, 1);
+	int range_y = std::max(height_ - box_height, 1);
+	int x = (index * 4) % (range_x * 2);
+	int y = (index * 4) % (range_y * 2);
+	x = x < range_x ? x : range_x * 2 - x;
+	y = y < range_y ? y : range_y * 2 - y;
+
+	for (int row = 0; row < height_; row++)
+	{
+		uint8_t* pixel = &pixels_[row * stride()];
+		bool box_row = row >= y && row < y + box_height;
+		for (int col = 0; col < width_; col++)
+		{
+			if (box_row && col >= x && col < x + box_width)
+			{
+				SetPixel(pixel, 0xE0, 0x40, 0x20);
+			}
+			else
+			{
+				SetPixel(pixel, 0x30, 0x30, 0x38);
+			}
+
+			pixel += 4;
+		}
+	}
+}
+
+void SyntheticFrameSource::RenderScrollingText(int index)
+{
+	int scroll = index * kScrollSpeed;
+	for (int row = 0; row < height_; row++)
+	{
+		uint8_t* pixel = &pixels_[row * stride()];
+		int content_row = row + scroll;
+		int line = content_row / kCellHeight;
+		int glyph_row = content_row % kCellHeight;
+		uint32_t line_hash = Hash(static_cast<uint32_t>(line));
+
+		// Lines have a varying length, the rest is blank.
+		int line_length = static_cast<int>(line_hash % (width_ / kCellWidth + 1));
+		for (int col = 0; col < width_; col++)
+		{
+			int cell = col / kCellWidth;
+			int glyph_col = col % kCellWidth;
+			bool ink = false;
+			if (cell < line_length && glyph_row < kGlyphHeight && glyph_col < kGlyphWidth)
+			{
+				// Each glyph is a 4x6 grid of 2x2 pixel blocks.
+				uint32_t glyph = Hash(line_hash ^ static_cast<uint32_t>(cell));
+				int bit = (glyph_row / 2) * 4 + glyph_col / 2;
+				ink = ((glyph >> (bit % 32)) & 1) != 0;
+			}
+
+			if (ink)
+			{
+				SetPixel(pixel, 0xF0, 0xF0, 0xF0);
+			}
+			else
+			{
+				SetPixel(pixel, 0x10, 0x10, 0x20);
+			}
+
+			pixel += 4;
+		}
+	}
+}
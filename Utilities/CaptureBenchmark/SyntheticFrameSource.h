@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Renders deterministic RGBA frames for benchmarking the capture path
+	// without a GPU or a live renderer.
+	class SyntheticFrameSource
+	{
+	public:
+		enum Pattern
+		{
+			// Static diagonal gradient, every frame is identical.
+			kPatternGradient = 0,
+
+			// Per-pixel noise, nothing can be predicted between frames.
+			kPatternNoise,
+
+			// Box bouncing over a flat background, small moving region.
+			kPatternMovingBox,
+
+			// Lines of block glyphs scrolling upwards, sharp edges everywhere.
+			kPatternScrollingText,
+
+			kPatternCount
+		};
+
+		SyntheticFrameSource(Pattern pattern, int width, int height);
+
+		// Renders frame |index| and returns its pixels, valid until the next
+		// call.
+		const uint8_t* Render(int index);
+
+		int width() const { return width_; }
+
+		int height() const { return height_; }
+
+		int stride() const { return width_ * 4; }
+
+		static const char* GetPatternName(Pattern pattern);
+
+	private:
+		void RenderGradient();
+
+		void RenderNoise(int index);
+
+		void RenderMovingBox(int index);
+
+		void RenderScrollingText(int index);
+
+		Pattern pattern_;
+		int width_;
+		int height_;
+		std::vector<uint8_t> pixels_;
+		int last_index_;
+	};
+}
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SweepMatrix.h"
+#include "SweepRunner.h"
+#include "VideoFileReader.h"
+
+#include "webrtc/modules/video_coding/codecs/h264/include/h264.h"
+
+#ifdef _WIN32
+#pragma comment(lib, "webrtc.lib")
+#endif // _WIN32
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	// Raw input doesn't carry its frame rate.
+	const double kDefaultFrameRate = 60.0;
+
+	struct Options
+	{
+		std::string matrix_path;
+		std::string input_path;
+		std::string output_path;
+		std::string bitstream_folder;
+		int threads;
+	};
+
+	struct RunOutcome
+	{
+		bool succeeded;
+		std::string error;
+		SweepResult result;
+	};
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: EncoderSweep --matrix sweep.json [--input lossless.y4m]\n"
+			"                    [--threads N] [--output sweep.csv]\n"
+			"                    [--bitstreams folder]\n");
+	}
+}
+
+// Encodes a recorded input with every configuration of a sweep matrix and
+// writes bitrate, encode time and quality per configuration as one CSV.
+// Configurations run in parallel, each on one thread. Thread count
+// defaults to the number of hardware threads.
+int main(int argc, char** argv)
+{
+	Options options;
+	options.output_path = "sweep.csv";
+	options.threads = static_cast<int>(std::thread::hardware_concurrency());
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--matrix" && has_value)
+		{
+			options.matrix_path = argv[++i];
+		}
+		else if (arg == "--input" && has_value)
+		{
+			options.input_path = argv[++i];
+		}
+		else if (arg == "--threads" && has_value)
+		{
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--output" && has_value)
+		{
+			options.output_path = argv[++i];
+		}
+		else if (arg == "--bitstreams" && has_value)
+		{
+			options.bitstream_folder = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	if (options.matrix_path.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	options.threads = std::max(options.threads, 1);
+
+	std::string error;
+	SweepMatrix matrix;
+	if (!LoadSweepMatrix(options.matrix_path, &matrix, &error))
+	{
+		fprintf(stderr, "Invalid sweep matrix: %s\n", error.c_str());
+		return 1;
+	}
+
+	for (const SweepConfiguration& configuration : matrix.configurations)
+	{
+		if (!SweepRunner::IsSupported(configuration, &error))
+		{
+			fprintf(stderr, "Invalid sweep matrix: %s\n", error.c_str());
+			return 1;
+		}
+	}
+
+	if (!webrtc::H264Decoder::IsSupported())
+	{
+		fprintf(stderr, "WebRTC was built without H.264 support.\n");
+		return 1;
+	}
+
+	std::string input_path = options.input_path.empty() ?
+		matrix.input_path : options.input_path;
+
+	VideoFileReader input;
+	if (!input.Open(input_path, matrix.width, matrix.height, &error))
+	{
+		fprintf(stderr, "Failed to open %s: %s\n", input_path.c_str(), error.c_str());
+		return 1;
+	}
+
+	double frame_rate = matrix.frame_rate > 0 ? matrix.frame_rate :
+		(input.frame_rate() > 0 ? input.frame_rate() : kDefaultFrameRate);
+
+	int frames = input.frame_count();
+	if (matrix.frames > 0)
+	{
+		frames = std::min(frames, matrix.frames);
+	}
+
+	fprintf(stderr, "%d configurations, %dx%d, %d frames at %.2f fps, %d threads\n",
+		static_cast<int>(matrix.configurations.size()), input.width(), input.height(),
+		frames, frame_rate, options.threads);
+
+	// Every configuration reads the same mapped input, the frames stay in
+	// the page cache once the first run touched them.
+	SweepRunner runner(input, frame_rate, frames);
+	std::vector<RunOutcome> outcomes(matrix.configurations.size());
+	std::atomic<size_t> next_configuration(0);
+	auto worker = [&]()
+	{
+		size_t index;
+		while ((index = next_configuration++) < matrix.configurations.size())
+		{
+			const SweepConfiguration& configuration = matrix.configurations[index];
+			std::string bitstream_path;
+			if (!options.bitstream_folder.empty())
+			{
+				bitstream_path = options.bitstream_folder + "/" +
+					configuration.GetName() + ".h264";
+			}
+
+			RunOutcome& outcome = outcomes[index];
+			outcome.succeeded = runner.Run(configuration, bitstream_path,
+				&outcome.result, &outcome.error);
+
+			fprintf(stderr, "%s: %s\n", configuration.GetName().c_str(),
+				outcome.succeeded ? "done" : outcome.error.c_str());
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int i = 1; i < options.threads; i++)
+	{
+		threads.push_back(std::thread(worker));
+	}
+
+	worker();
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	fprintf(stderr, "Sweep took %.1f s\n", std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - start).count());
+
+	std::ofstream csv(options.output_path);
+	csv << "name,bitrate_kbps,preset,rc_mode,gop_length,aq,frames,encoded_kbps,"
+		"encode_ms,encode_ms_per_frame,encode_fps,psnr,ssim,msssim\n";
+
+	int result = 0;
+	char values[256];
+	for (size_t i = 0; i < matrix.configurations.size(); i++)
+	{
+		const SweepConfiguration& configuration = matrix.configurations[i];
+		const RunOutcome& outcome = outcomes[i];
+		if (!outcome.succeeded)
+		{
+			result = 1;
+			continue;
+		}
+
+		const SweepResult& sweep_result = outcome.result;
+		double ms_per_frame = sweep_result.frames > 0 ?
+			sweep_result.encode_ms / sweep_result.frames : 0;
+
+		snprintf(values, sizeof(values), "%d,%.2f,%.2f,%.3f,%.2f,%.6f,%.6f,%.6f",
+			sweep_result.frames, sweep_result.encoded_kbps, sweep_result.encode_ms,
+			ms_per_frame, ms_per_frame > 0 ? 1000.0 / ms_per_frame : 0.0,
+			sweep_result.psnr, sweep_result.ssim, sweep_result.ms_ssim);
+
+		csv << configuration.GetName() << "," << configuration.bitrate_kbps << "," <<
+			configuration.preset << "," << configuration.rc_mode << "," <<
+			configuration.gop_length << "," << (configuration.adaptive_quantization ? 1 : 0) <<
+			"," << values << "\n";
+	}
+
+	if (!csv)
+	{
+		fprintf(stderr, "Failed to write %s\n", options.output_path.c_str());
+		return 1;
+	}
+
+	return result;
+}
@@ -0,0 +1,158 @@
+#include "SweepMatrix.h"
+
+#include <fstream>
+
+#include "third_party/jsoncpp/source/include/json/json.h"
+
+namespace
+{
+	bool IsAbsolutePath(const std::string& path)
+	{
+		return (!path.empty() && (path[0] == '/' || path[0] == '\\')) ||
+			(path.size() > 1 && path[1] == ':');
+	}
+
+	std::string GetFolder(const std::string& path)
+	{
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? "" : path.substr(0, separator + 1);
+	}
+
+	// Reads a list of values, a single value is a list of one.
+	template <typename T>
+	bool ReadList(const Json::Value& root, const char* key, std::vector<T>* values,
+		T (*convert)(const Json::Value&), bool (*is_valid)(const Json::Value&),
+		std::string* error)
+	{
+		const Json::Value& value = root[key];
+		if (value.isNull())
+		{
+			*error = std::string("missing ") + key;
+			return false;
+		}
+
+		if (!value.isArray())
+		{
+			if (!is_valid(value))
+			{
+				*error = std::string("invalid ") + key;
+				return false;
+			}
+
+			values->push_back(convert(value));
+			return true;
+		}
+
+		for (const Json::Value& item : value)
+		{
+			if (!is_valid(item))
+			{
+				*error = std::string("invalid ") + key;
+				return false;
+			}
+
+			values->push_back(convert(item));
+		}
+
+		if (values->empty())
+		{
+			*error = std::string("empty ") + key;
+			return false;
+		}
+
+		return true;
+	}
+
+	int ToInt(const Json::Value& value) { return value.asInt(); }
+
+	bool IsInt(const Json::Value& value) { return value.isInt() && value.asInt() >= 0; }
+
+	std::string ToString(const Json::Value& value) { return value.asString(); }
+
+	bool IsString(const Json::Value& value) { return value.isString(); }
+
+	bool ToBool(const Json::Value& value) { return value.asBool(); }
+
+	bool IsBool(const Json::Value& value) { return value.isBool(); }
+}
+
+namespace StreamingToolkit
+{
+	std::string SweepConfiguration::GetName() const
+	{
+		return std::to_string(bitrate_kbps) + "kbps-AQ" +
+			(adaptive_quantization ? "1" : "0") + "-" + preset + "-" + rc_mode +
+			"-GOP" + std::to_string(gop_length);
+	}
+
+	bool LoadSweepMatrix(const std::string& path, SweepMatrix* matrix,
+		std::string* error)
+	{
+		std::ifstream file(path);
+		Json::Value root;
+		Json::Reader reader;
+		if (!file || !reader.parse(file, root) || !root.isObject())
+		{
+			*error = "cannot parse " + path;
+			return false;
+		}
+
+		matrix->input_path = root.get("input", "").asString();
+		if (matrix->input_path.empty())
+		{
+			*error = "missing input";
+			return false;
+		}
+
+		if (!IsAbsolutePath(matrix->input_path))
+		{
+			matrix->input_path = GetFolder(path) + matrix->input_path;
+		}
+
+		matrix->width = root.get("width", 0).asInt();
+		matrix->height = root.get("height", 0).asInt();
+		matrix->frame_rate = root.get("frameRate", 0).asDouble();
+		matrix->frames = root.get("frames", 0).asInt();
+
+		std::vector<int> bitrates;
+		std::vector<std::string> presets;
+		std::vector<std::string> rc_modes;
+		std::vector<int> gop_lengths;
+		std::vector<bool> adaptive_quantization;
+		if (!ReadList(root, "bitrates", &bitrates, ToInt, IsInt, error) ||
+			!ReadList(root, "presets", &presets, ToString, IsString, error) ||
+			!ReadList(root, "rcModes", &rc_modes, ToString, IsString, error) ||
+			!ReadList(root, "gopLengths", &gop_lengths, ToInt, IsInt, error) ||
+			!ReadList(root, "adaptiveQuantization", &adaptive_quantization, ToBool,
+				IsBool, error))
+		{
+			return false;
+		}
+
+		matrix->configurations.clear();
+		for (const std::string& rc_mode : rc_modes)
+		{
+			for (const std::string& preset : presets)
+			{
+				for (bool aq : adaptive_quantization)
+				{
+					for (int gop_length : gop_lengths)
+					{
+						for (int bitrate : bitrates)
+						{
+							SweepConfiguration configuration;
+							configuration.bitrate_kbps = bitrate;
+							configuration.preset = preset;
+							configuration.rc_mode = rc_mode;
+							configuration.gop_length = gop_length;
+							configuration.adaptive_quantization = aq;
+							matrix->configurations.push_back(configuration);
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+}
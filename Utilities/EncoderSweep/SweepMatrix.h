@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// One software encoder configuration of a sweep.
+	struct SweepConfiguration
+	{
+		int bitrate_kbps;
+
+		// OpenH264 complexity: low, medium or high.
+		std::string preset;
+
+		// OpenH264 rate control: bitrate, quality, buffer, timestamp or off.
+		std::string rc_mode;
+
+		// Frames between IDR frames, 0 for the first frame only.
+		int gop_length;
+
+		bool adaptive_quantization;
+
+		// Follows the naming convention of runAnalysis.ps1, for instance
+		// 5000kbps-AQ1-medium-bitrate-GOP60.
+		std::string GetName() const;
+	};
+
+	// Declarative sweep, every combination of the listed settings is one
+	// configuration. Loaded from JSON:
+	//
+	// {
+	//   "input": "lossless.y4m",
+	//   "width": 1280, "height": 720,   (raw .yuv input only)
+	//   "frameRate": 60,
+	//   "frames": 300,
+	//   "bitrates": [ 2500, 5000, 10000 ],
+	//   "presets": [ "low", "medium" ],
+	//   "rcModes": [ "bitrate", "quality" ],
+	//   "gopLengths": [ 0, 60 ],
+	//   "adaptiveQuantization": [ false, true ]
+	// }
+	struct SweepMatrix
+	{
+		// Relative paths are resolved against the folder of the matrix file.
+		std::string input_path;
+		int width;
+		int height;
+
+		// 0 takes the rate from the Y4M header, 60 for raw input.
+		double frame_rate;
+
+		// 0 encodes every frame of the input.
+		int frames;
+
+		// Ordered by rate control, preset, adaptive quantization, GOP length
+		// and bitrate, so that each rate-distortion curve is contiguous.
+		std::vector<SweepConfiguration> configurations;
+	};
+
+	// Returns false and sets |error| if the file can't be read or a setting
+	// isn't supported.
+	bool LoadSweepMatrix(const std::string& path, SweepMatrix* matrix,
+		std::string* error);
+}
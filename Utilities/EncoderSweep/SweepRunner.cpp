@@ -0,0 +1,356 @@
+#include "SweepRunner.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "QualityMetrics.h"
+
+#include "third_party/openh264/src/codec/api/svc/codec_api.h"
+#include "third_party/openh264/src/codec/api/svc/codec_app_def.h"
+#include "third_party/openh264/src/codec/api/svc/codec_def.h"
+#include "webrtc/modules/video_coding/codecs/h264/include/h264.h"
+#include "webrtc/modules/video_coding/include/video_error_codes.h"
+#include "webrtc/video_decoder.h"
+#include "webrtc/video_frame.h"
+
+namespace
+{
+	struct NamedValue
+	{
+		const char* name;
+		int value;
+	};
+
+	const NamedValue kPresets[] =
+	{
+		{ "low", LOW_COMPLEXITY },
+		{ "medium", MEDIUM_COMPLEXITY },
+		{ "high", HIGH_COMPLEXITY }
+	};
+
+	const NamedValue kRcModes[] =
+	{
+		{ "bitrate", RC_BITRATE_MODE },
+		{ "quality", RC_QUALITY_MODE },
+		{ "buffer", RC_BUFFERBASED_MODE },
+		{ "timestamp", RC_TIMESTAMP_MODE },
+		{ "off", RC_OFF_MODE }
+	};
+
+	template <size_t N>
+	bool FindValue(const NamedValue (&values)[N], const std::string& name, int* value)
+	{
+		for (const NamedValue& named_value : values)
+		{
+			if (name == named_value.name)
+			{
+				*value = named_value.value;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// The one time FFmpeg initialization of the H.264 decoder isn't thread
+	// safe, decoders are initialized one at a time.
+	std::mutex s_decoder_init_lock;
+
+	// Keeps the last decoded frame and measures it against the source
+	// frame it's displayed for. Frames the rate control skips are measured
+	// against the previous frame, as a receiver would show it.
+	class QualitySink : public webrtc::DecodedImageCallback
+	{
+	public:
+		explicit QualitySink(const StreamingToolkit::VideoFileReader& input) :
+			input_(input),
+			measured_frames_(0),
+			psnr_(0),
+			ssim_(0),
+			ms_ssim_(0)
+		{
+		}
+
+		int32_t Decoded(webrtc::VideoFrame& frame) override
+		{
+			last_frame_ = frame.video_frame_buffer();
+			return WEBRTC_VIDEO_CODEC_OK;
+		}
+
+		bool Measure(int source_frame)
+		{
+			if (!last_frame_ || last_frame_->width() != input_.width() ||
+				last_frame_->height() != input_.height())
+			{
+				return false;
+			}
+
+			int width = input_.width();
+			int height = input_.height();
+			const uint8_t* source = input_.GetFrame(source_frame);
+			double ssim = 0;
+			psnr_ += StreamingToolkit::QualityMetrics::Psnr(source, width,
+				last_frame_->DataY(), last_frame_->StrideY(), width, height);
+
+			ms_ssim_ += metrics_.MsSsim(source, width, last_frame_->DataY(),
+				last_frame_->StrideY(), width, height, &ssim);
+
+			ssim_ += ssim;
+			measured_frames_++;
+			return true;
+		}
+
+		double psnr() const { return measured_frames_ ? psnr_ / measured_frames_ : 0; }
+
+		double ssim() const { return measured_frames_ ? ssim_ / measured_frames_ : 0; }
+
+		double ms_ssim() const { return measured_frames_ ? ms_ssim_ / measured_frames_ : 0; }
+
+	private:
+		const StreamingToolkit::VideoFileReader& input_;
+		StreamingToolkit::QualityMetrics metrics_;
+		rtc::scoped_refptr<webrtc::VideoFrameBuffer> last_frame_;
+		int measured_frames_;
+		double psnr_;
+		double ssim_;
+		double ms_ssim_;
+	};
+
+	struct EncoderDeleter
+	{
+		void operator()(ISVCEncoder* encoder) const
+		{
+			encoder->Uninitialize();
+			WelsDestroySVCEncoder(encoder);
+		}
+	};
+
+	struct FileCloser
+	{
+		void operator()(FILE* file) const
+		{
+			fclose(file);
+		}
+	};
+}
+
+namespace StreamingToolkit
+{
+	SweepRunner::SweepRunner(const VideoFileReader& input, double frame_rate,
+		int frames) :
+		input_(input),
+		frame_rate_(frame_rate),
+		frames_(frames)
+	{
+	}
+
+	bool SweepRunner::IsSupported(const SweepConfiguration& configuration,
+		std::string* error)
+	{
+		int value = 0;
+		if (!FindValue(kPresets, configuration.preset, &value))
+		{
+			*error = "unknown preset " + configuration.preset;
+			return false;
+		}
+
+		if (!FindValue(kRcModes, configuration.rc_mode, &value))
+		{
+			*error = "unknown rate control mode " + configuration.rc_mode;
+			return false;
+		}
+
+		if (configuration.bitrate_kbps <= 0 && configuration.rc_mode != "off")
+		{
+			*error = "missing bitrate for " + configuration.rc_mode;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool SweepRunner::Run(const SweepConfiguration& configuration,
+		const std::string& bitstream_path, SweepResult* result,
+		std::string* error) const
+	{
+		if (!IsSupported(configuration, error))
+		{
+			return false;
+		}
+
+		int width = input_.width();
+		int height = input_.height();
+
+		ISVCEncoder* raw_encoder = nullptr;
+		if (WelsCreateSVCEncoder(&raw_encoder) != 0 || !raw_encoder)
+		{
+			*error = "cannot create the OpenH264 encoder";
+			return false;
+		}
+
+		std::unique_ptr<ISVCEncoder, EncoderDeleter> encoder(raw_encoder);
+
+		// Same base settings as H264EncoderImpl::CreateEncoderParams().
+		SEncParamExt params;
+		encoder->GetDefaultParams(&params);
+		params.iUsageType = CAMERA_VIDEO_REAL_TIME;
+		params.iPicWidth = width;
+		params.iPicHeight = height;
+		params.iTargetBitrate = configuration.bitrate_kbps * 1000;
+		params.iMaxBitrate = params.iTargetBitrate * 2;
+		params.fMaxFrameRate = static_cast<float>(frame_rate_);
+		int rc_mode = 0;
+		int complexity = 0;
+		FindValue(kRcModes, configuration.rc_mode, &rc_mode);
+		FindValue(kPresets, configuration.preset, &complexity);
+		params.iRCMode = static_cast<RC_MODES>(rc_mode);
+		params.iComplexityMode = static_cast<ECOMPLEXITY_MODE>(complexity);
+		params.uiIntraPeriod = configuration.gop_length;
+		params.bEnableAdaptiveQuant = configuration.adaptive_quantization;
+
+		// Every frame is measured, so none may be dropped.
+		params.bEnableFrameSkip = false;
+		params.uiMaxNalSize = 0;
+		params.iMultipleThreadIdc = 1;
+		params.sSpatialLayers[0].iVideoWidth = width;
+		params.sSpatialLayers[0].iVideoHeight = height;
+		params.sSpatialLayers[0].fFrameRate = params.fMaxFrameRate;
+		params.sSpatialLayers[0].iSpatialBitrate = params.iTargetBitrate;
+		params.sSpatialLayers[0].iMaxSpatialBitrate = params.iMaxBitrate;
+		params.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
+		if (encoder->InitializeExt(&params) != cmResultSuccess)
+		{
+			*error = "cannot initialize the OpenH264 encoder";
+			return false;
+		}
+
+		int video_format = videoFormatI420;
+		encoder->SetOption(ENCODER_OPTION_DATAFORMAT, &video_format);
+
+		QualitySink sink(input_);
+		std::unique_ptr<webrtc::H264Decoder> decoder(webrtc::H264Decoder::Create());
+		{
+			webrtc::VideoCodec codec_settings;
+			codec_settings.codecType = webrtc::kVideoCodecH264;
+			codec_settings.width = width;
+			codec_settings.height = height;
+
+			std::lock_guard<std::mutex> lock(s_decoder_init_lock);
+			if (decoder->InitDecode(&codec_settings, 1) != WEBRTC_VIDEO_CODEC_OK)
+			{
+				*error = "cannot initialize the H.264 decoder";
+				return false;
+			}
+		}
+
+		decoder->RegisterDecodeCompleteCallback(&sink);
+
+		std::unique_ptr<FILE, FileCloser> bitstream_file;
+		if (!bitstream_path.empty())
+		{
+			bitstream_file.reset(fopen(bitstream_path.c_str(), "wb"));
+			if (!bitstream_file)
+			{
+				*error = "cannot create " + bitstream_path;
+				return false;
+			}
+		}
+
+		size_t padding = webrtc::EncodedImage::GetBufferPaddingBytes(webrtc::kVideoCodecH264);
+		std::vector<uint8_t> bitstream;
+		memset(result, 0, sizeof(*result));
+		double encode_ms = 0;
+		for (int i = 0; i < frames_; i++)
+		{
+			uint8_t* frame = const_cast<uint8_t*>(input_.GetFrame(i));
+			SSourcePicture picture;
+			memset(&picture, 0, sizeof(picture));
+			picture.iPicWidth = width;
+			picture.iPicHeight = height;
+			picture.iColorFormat = videoFormatI420;
+			picture.iStride[0] = width;
+			picture.iStride[1] = input_.chroma_width();
+			picture.iStride[2] = input_.chroma_width();
+			picture.pData[0] = frame;
+			picture.pData[1] = frame + static_cast<size_t>(width) * height;
+			picture.pData[2] = picture.pData[1] +
+				static_cast<size_t>(input_.chroma_width()) * input_.chroma_height();
+			picture.uiTimeStamp = llround(i * 1000.0 / frame_rate_);
+
+			SFrameBSInfo info;
+			memset(&info, 0, sizeof(info));
+			auto start = std::chrono::steady_clock::now();
+			int status = encoder->EncodeFrame(&picture, &info);
+			encode_ms += std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+
+			if (status != cmResultSuccess)
+			{
+				*error = "encoding failed at frame " + std::to_string(i);
+				return false;
+			}
+
+			if (info.eFrameType != videoFrameTypeSkip)
+			{
+				// The NAL units of a layer are contiguous and start codes are
+				// included, which makes the frame an Annex B access unit.
+				bitstream.clear();
+				for (int layer = 0; layer < info.iLayerNum; layer++)
+				{
+					const SLayerBSInfo& layer_info = info.sLayerInfo[layer];
+					size_t layer_size = 0;
+					for (int nal = 0; nal < layer_info.iNalCount; nal++)
+					{
+						layer_size += layer_info.pNalLengthInByte[nal];
+					}
+
+					bitstream.insert(bitstream.end(), layer_info.pBsBuf,
+						layer_info.pBsBuf + layer_size);
+				}
+
+				size_t size = bitstream.size();
+				result->encoded_bytes += size;
+				if (bitstream_file)
+				{
+					fwrite(bitstream.data(), 1, size, bitstream_file.get());
+				}
+
+				// FFmpeg reads past the end of the input.
+				bitstream.resize(size + padding, 0);
+				webrtc::EncodedImage encoded_image(bitstream.data(), size, bitstream.size());
+				encoded_image._encodedWidth = width;
+				encoded_image._encodedHeight = height;
+				encoded_image._frameType = info.eFrameType == videoFrameTypeIDR ?
+					webrtc::kVideoFrameKey : webrtc::kVideoFrameDelta;
+				encoded_image._completeFrame = true;
+				if (decoder->Decode(encoded_image, false, nullptr) != WEBRTC_VIDEO_CODEC_OK)
+				{
+					*error = "decoding failed at frame " + std::to_string(i);
+					return false;
+				}
+			}
+
+			if (!sink.Measure(i))
+			{
+				*error = "no decoded frame for frame " + std::to_string(i);
+				return false;
+			}
+		}
+
+		decoder->Release();
+
+		result->frames = frames_;
+		result->encode_ms = encode_ms;
+		result->encoded_kbps = frames_ > 0 ?
+			result->encoded_bytes * 8.0 * frame_rate_ / frames_ / 1000.0 : 0;
+		result->psnr = sink.psnr();
+		result->ssim = sink.ssim();
+		result->ms_ssim = sink.ms_ssim();
+		return true;
+	}
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#include "SweepMatrix.h"
+#include "VideoFileReader.h"
+
+namespace StreamingToolkit
+{
+	struct SweepResult
+	{
+		int frames;
+		uint64_t encoded_bytes;
+		double encoded_kbps;
+
+		// Time spent in the encoder only, decoding and metrics excluded.
+		double encode_ms;
+
+		// Luma averages over all frames, as VQMT reports them.
+		double psnr;
+		double ssim;
+		double ms_ssim;
+	};
+
+	// Encodes the input with one configuration of the OpenH264 software
+	// backend, decodes every frame right away and compares it with its
+	// source. Each run encodes on a single thread, a sweep runs several
+	// configurations in parallel instead.
+	class SweepRunner
+	{
+	public:
+		// |input| is shared between runs and must outlive them.
+		SweepRunner(const VideoFileReader& input, double frame_rate, int frames);
+
+		// Returns false and sets |error| if |configuration| names a preset or
+		// rate control mode OpenH264 doesn't have.
+		static bool IsSupported(const SweepConfiguration& configuration,
+			std::string* error);
+
+		// Writes the Annex B bitstream to |bitstream_path| unless empty.
+		bool Run(const SweepConfiguration& configuration,
+			const std::string& bitstream_path, SweepResult* result,
+			std::string* error) const;
+
+	private:
+		const VideoFileReader& input_;
+		const double frame_rate_;
+		const int frames_;
+	};
+}
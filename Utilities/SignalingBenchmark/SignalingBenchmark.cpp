@@ -0,0 +1,814 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "http_response_parser.h"
+#include "peer_connection_client.h"
+#include "StandInServer.h"
+
+#include "webrtc/base/thread.h"
+
+#include "third_party/jsoncpp/source/include/json/json.h"
+
+#ifdef _WIN32
+#include "webrtc/base/win32socketinit.h"
+#include "webrtc/base/win32socketserver.h"
+
+#pragma comment(lib, "secur32.lib")
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "webrtc.lib")
+#pragma comment(lib, "boringssl_asm.lib")
+#endif // _WIN32
+
+using namespace StreamingToolkit;
+
+// Counts C++ heap allocations so that per-response allocations show up in
+// the results.
+static std::atomic<uint64_t> s_allocations(0);
+
+void* operator new(size_t size)
+{
+	s_allocations++;
+	void* p = malloc(size ? size : 1);
+	if (!p)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+namespace
+{
+	const int kWarmupIterations = 10;
+	const int kDefaultIterations = 1000;
+
+	// TCP maximum segment size on Ethernet, the usual size of a read.
+	const int kDefaultSegmentSize = 1460;
+
+	// Peer list sizes of the sign_in responses.
+	const int kPeerCounts[] = { 1, 10, 100, 1000 };
+
+	// Size of the SDP offer relayed by a wait response.
+	const size_t kOfferSize = 4096;
+
+	const int kMyId = 7;
+
+	const int kDefaultCalls = 20;
+
+	// Round trip time emulated by the stand-in server, in milliseconds.
+	const int kDefaultRoundTripMs = 20;
+
+	// ICE candidates sent by each side of a call.
+	const int kDefaultCandidates = 10;
+
+	// Time allowed for a call setup before it counts as failed.
+	const int kCallTimeoutMs = 10000;
+
+	struct Options
+	{
+		std::string suite;
+		int iterations;
+		int segment_size;
+		int calls;
+		int round_trip_ms;
+		int candidates;
+		bool tls;
+		std::string output_path;
+	};
+
+	// What the client takes out of a response, compared across readers.
+	struct Result
+	{
+		int status;
+		size_t peer_id;
+		std::vector<std::string> names;
+		std::vector<int> ids;
+		std::string message;
+	};
+
+	bool operator==(const Result& a, const Result& b)
+	{
+		return a.status == b.status && a.peer_id == b.peer_id && a.names == b.names &&
+			a.ids == b.ids && a.message == b.message;
+	}
+
+	// Headers sent by the signaling server with every response.
+	std::string CreateResponse(const char* status_line, int peer_id, const std::string& body)
+	{
+		return std::string(status_line) + "\r\n"
+			"Server: PeerConnectionTestServer/0.1\r\n"
+			"Cache-Control: no-cache\r\n"
+			"Connection: close\r\n"
+			"Content-Type: text/plain\r\n"
+			"Content-Length: " + std::to_string(body.size()) + "\r\n"
+			"Pragma: " + std::to_string(peer_id) + "\r\n"
+			"Access-Control-Allow-Origin: *\r\n"
+			"Access-Control-Allow-Credentials: true\r\n"
+			"Access-Control-Allow-Methods: POST, GET, OPTIONS\r\n"
+			"Access-Control-Allow-Headers: Content-Type, Content-Length, Connection, Cache-Control\r\n"
+			"Access-Control-Expose-Headers: Content-Length\r\n"
+			"\r\n" + body;
+	}
+
+	std::string CreateSignInResponse(int peers)
+	{
+		std::string body = "renderer_" + std::to_string(kMyId) + "," + std::to_string(kMyId) + ",1\n";
+		for (int i = 0; i < peers; i++)
+		{
+			int id = kMyId + 1 + i;
+			body += "client_" + std::to_string(id) + "@host-" + std::to_string(id) + "," +
+				std::to_string(id) + ",1\n";
+		}
+
+		return CreateResponse("HTTP/1.1 200 Added", kMyId, body);
+	}
+
+	std::string CreateOfferResponse()
+	{
+		std::string body = "{\"type\":\"offer\",\"sdp\":\"v=0\\r\\no=- 0 2 IN IP4 127.0.0.1\\r\\n";
+		while (body.size() < kOfferSize)
+		{
+			body += "a=candidate:1 1 udp 2122260223 192.168.1.10 50000 typ host generation 0\\r\\n";
+		}
+
+		body += "\"}";
+		return CreateResponse("HTTP/1.1 200 OK", kMyId + 1, body);
+	}
+
+	std::string CreateNotificationResponse()
+	{
+		return CreateResponse("HTTP/1.1 200 OK", kMyId, "client_8@host-8,8,0");
+	}
+
+	std::string CreateOffer()
+	{
+		std::string offer = "{\"type\":\"offer\",\"sdp\":\"v=0\\r\\no=- 0 2 IN IP4 127.0.0.1\\r\\n";
+		while (offer.size() < kOfferSize)
+		{
+			offer += "a=candidate:1 1 udp 2122260223 192.168.1.10 50000 typ host generation 0\\r\\n";
+		}
+
+		return offer + "\"}";
+	}
+
+	std::string CreateCandidate(int index)
+	{
+		return "{\"candidate\":\"candidate:" + std::to_string(index) +
+			" 1 udp 2122260223 192.168.1.10 " + std::to_string(50000 + index) +
+			" typ host generation 0 ufrag 2Zqq network-id 1\",\"sdpMid\":\"video\",\"sdpMLineIndex\":0}";
+	}
+
+	// The reader PeerConnectionClient used before HttpResponseParser. Each
+	// read is appended to a string, and the headers are searched from the
+	// start of the string until the whole response is in.
+	namespace Legacy
+	{
+		bool GetHeaderValue(const std::string& data, size_t eoh,
+			const char* header_pattern, size_t* value)
+		{
+			size_t found = data.find(header_pattern);
+			if (found != std::string::npos && found < eoh)
+			{
+				*value = atoi(&data[found + strlen(header_pattern)]);
+				return true;
+			}
+
+			return false;
+		}
+
+		bool GetHeaderValue(const std::string& data, size_t eoh,
+			const char* header_pattern, std::string* value)
+		{
+			size_t found = data.find(header_pattern);
+			if (found != std::string::npos && found < eoh)
+			{
+				size_t begin = found + strlen(header_pattern);
+				size_t end = data.find("\r\n", begin);
+				if (end == std::string::npos)
+				{
+					end = eoh;
+				}
+
+				value->assign(data.substr(begin, end - begin));
+				return true;
+			}
+
+			return false;
+		}
+
+		bool OnRead(const char* segment, size_t segment_size, std::string* data,
+			size_t* content_length)
+		{
+			char buffer[0xffff];
+			memcpy(buffer, segment, segment_size);
+			data->append(buffer, segment_size);
+
+			size_t i = data->find("\r\n\r\n");
+			if (i != std::string::npos &&
+				GetHeaderValue(*data, i, "\r\nContent-Length: ", content_length) &&
+				data->length() >= (i + 4) + *content_length)
+			{
+				std::string should_close;
+				GetHeaderValue(*data, i, "\r\nConnection: ", &should_close);
+				return true;
+			}
+
+			return false;
+		}
+
+		bool ParseEntry(const std::string& entry, std::string* name, int* id)
+		{
+			size_t separator = entry.find(',');
+			if (separator != std::string::npos)
+			{
+				*id = atoi(&entry[separator + 1]);
+				name->assign(entry.substr(0, separator));
+			}
+
+			return !name->empty();
+		}
+
+		void Read(const std::string& response, size_t segment_size, bool sign_in,
+			Result* result)
+		{
+			std::string data;
+			size_t content_length = 0;
+			for (size_t offset = 0; offset < response.size(); offset += segment_size)
+			{
+				if (OnRead(response.data() + offset,
+					std::min(segment_size, response.size() - offset), &data, &content_length))
+				{
+					break;
+				}
+			}
+
+			size_t pos = data.find(' ');
+			result->status = pos != std::string::npos ? atoi(&data[pos + 1]) : -1;
+			size_t eoh = data.find("\r\n\r\n");
+			result->peer_id = -1;
+			GetHeaderValue(data, eoh, "\r\nPragma: ", &result->peer_id);
+
+			pos = eoh + 4;
+			if (!sign_in)
+			{
+				result->message = data.substr(pos);
+				return;
+			}
+
+			while (pos < data.size())
+			{
+				size_t eol = data.find('\n', pos);
+				if (eol == std::string::npos)
+				{
+					break;
+				}
+
+				int id = 0;
+				std::string name;
+				if (ParseEntry(data.substr(pos, eol - pos), &name, &id))
+				{
+					result->names.push_back(name);
+					result->ids.push_back(id);
+				}
+
+				pos = eol + 1;
+			}
+		}
+	}
+
+	// Reads as PeerConnectionClient does now, straight into the parser's
+	// buffer, with the entries parsed in place.
+	void ReadIncremental(HttpResponseParser* parser, const std::string& response,
+		size_t segment_size, bool sign_in, Result* result)
+	{
+		parser->Reset();
+		for (size_t offset = 0; offset < response.size() && !parser->is_complete();
+			offset += segment_size)
+		{
+			size_t size = std::min(segment_size, response.size() - offset);
+			memcpy(parser->GetWriteBuffer(size), response.data() + offset, size);
+			parser->OnDataWritten(size);
+		}
+
+		result->status = parser->status();
+		result->peer_id = -1;
+		parser->GetHeader("Pragma", &result->peer_id);
+		if (!sign_in)
+		{
+			result->message.assign(parser->body(), parser->body_size());
+			return;
+		}
+
+		size_t pos = 0;
+		const char* entry = nullptr;
+		size_t entry_size = 0;
+		while (parser->GetBodyLine(&pos, &entry, &entry_size))
+		{
+			const char* end = entry + entry_size;
+			const char* separator = std::find(entry, end, ',');
+			if (entry_size > 0 && separator != end && separator != entry)
+			{
+				int id = 0;
+				for (const char* digit = separator + 1; digit < end && *digit >= '0' && *digit <= '9'; digit++)
+				{
+					id = id * 10 + (*digit - '0');
+				}
+
+				result->names.push_back(std::string(entry, separator));
+				result->ids.push_back(id);
+			}
+		}
+	}
+
+	Json::Value GetPercentiles(std::vector<double> values_us)
+	{
+		Json::Value percentiles;
+		if (values_us.empty())
+		{
+			return percentiles;
+		}
+
+		std::sort(values_us.begin(), values_us.end());
+		size_t last = values_us.size() - 1;
+		percentiles["p50"] = values_us[last * 50 / 100];
+		percentiles["p90"] = values_us[last * 90 / 100];
+		percentiles["p99"] = values_us[last * 99 / 100];
+		percentiles["max"] = values_us[last];
+		return percentiles;
+	}
+
+	// Times |read| over |iterations| runs, after a warm-up.
+	template <typename Read>
+	Json::Value Measure(const Options& options, size_t response_size, Read read)
+	{
+		for (int i = 0; i < kWarmupIterations; i++)
+		{
+			read();
+		}
+
+		std::vector<double> times_us;
+		times_us.reserve(options.iterations);
+		uint64_t allocations = s_allocations;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < options.iterations; i++)
+		{
+			auto begin = std::chrono::steady_clock::now();
+			read();
+			times_us.push_back(std::chrono::duration<double, std::micro>(
+				std::chrono::steady_clock::now() - begin).count());
+		}
+
+		double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+		Json::Value result;
+		result["time_us"] = GetPercentiles(times_us);
+		result["throughput_mb_per_s"] = seconds > 0 ?
+			response_size * static_cast<double>(options.iterations) / seconds / 1e6 : 0.0;
+		result["allocations_per_response"] = static_cast<double>(s_allocations - allocations) /
+			options.iterations;
+		return result;
+	}
+
+	Json::Value RunParserSuite(const Options& options)
+	{
+		struct Case
+		{
+			std::string name;
+			std::string response;
+			bool sign_in;
+		};
+
+		std::vector<Case> cases;
+		for (int peers : kPeerCounts)
+		{
+			cases.push_back({ "sign_in_" + std::to_string(peers) + "_peers",
+				CreateSignInResponse(peers), true });
+		}
+
+		cases.push_back({ "wait_offer", CreateOfferResponse(), false });
+		cases.push_back({ "wait_peer_notification", CreateNotificationResponse(), false });
+
+		Json::Value results(Json::arrayValue);
+		HttpResponseParser parser;
+		size_t segment_size = static_cast<size_t>(options.segment_size);
+		for (const Case& test_case : cases)
+		{
+			Result legacy_result;
+			Legacy::Read(test_case.response, segment_size, test_case.sign_in, &legacy_result);
+			Result incremental_result;
+			ReadIncremental(&parser, test_case.response, segment_size, test_case.sign_in,
+				&incremental_result);
+
+			Json::Value result;
+			result["response"] = test_case.name;
+			result["response_bytes"] = static_cast<Json::UInt64>(test_case.response.size());
+			result["segment_bytes"] = options.segment_size;
+			result["reads"] = static_cast<Json::UInt64>(
+				(test_case.response.size() + segment_size - 1) / segment_size);
+			result["results_match"] = legacy_result == incremental_result;
+			result["legacy"] = Measure(options, test_case.response.size(), [&]()
+			{
+				Result read_result;
+				Legacy::Read(test_case.response, segment_size, test_case.sign_in, &read_result);
+			});
+
+			result["incremental"] = Measure(options, test_case.response.size(), [&]()
+			{
+				Result read_result;
+				ReadIncremental(&parser, test_case.response, segment_size, test_case.sign_in,
+					&read_result);
+			});
+
+			double legacy_us = result["legacy"]["time_us"]["p50"].asDouble();
+			double incremental_us = result["incremental"]["time_us"]["p50"].asDouble();
+			result["speedup"] = incremental_us > 0 ? legacy_us / incremental_us : 0.0;
+			results.append(result);
+		}
+
+		return results;
+	}
+
+	// One side of a call, sending its messages one at a time like the
+	// samples' conductors: the next message goes out once the client is
+	// done sending the previous one.
+	class BenchmarkPeer : public PeerConnectionClientObserver
+	{
+	public:
+		BenchmarkPeer() :
+			signed_in(false),
+			disconnected(false),
+			failed(false),
+			messages_received(0),
+			first_message_peer_id(-1)
+		{
+			client_.RegisterObserver(this);
+		}
+
+		PeerConnectionClient* client() { return &client_; }
+
+		void Send(int peer_id, const std::string& message)
+		{
+			messages_.push_back(std::make_pair(peer_id, message));
+			SendNext();
+		}
+
+		bool has_pending_messages() const { return !messages_.empty(); }
+
+		void OnSignedIn() override { signed_in = true; }
+
+		void OnDisconnected() override { disconnected = true; }
+
+		void OnPeerConnected(int id, const std::string& name) override {}
+
+		void OnPeerDisconnected(int peer_id) override {}
+
+		void OnMessageFromPeer(int peer_id, const std::string& message) override
+		{
+			if (messages_received++ == 0)
+			{
+				first_message_peer_id = peer_id;
+			}
+		}
+
+		void OnMessageSent(int err) override { SendNext(); }
+
+		void OnServerConnectionFailure() override { failed = true; }
+
+		bool signed_in;
+		bool disconnected;
+		bool failed;
+		int messages_received;
+		int first_message_peer_id;
+
+	private:
+		void SendNext()
+		{
+			while (!messages_.empty() && !client_.IsSendingMessage())
+			{
+				if (!client_.SendToPeer(messages_.front().first, messages_.front().second))
+				{
+					return;
+				}
+
+				messages_.pop_front();
+			}
+		}
+
+		PeerConnectionClient client_;
+		std::deque<std::pair<int, std::string>> messages_;
+	};
+
+	// Processes socket events and delayed tasks until |done| or the call
+	// timeout. Returns false on timeout.
+	template <typename Done>
+	bool Pump(Done done)
+	{
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kCallTimeoutMs);
+		while (!done())
+		{
+			if (std::chrono::steady_clock::now() > deadline)
+			{
+				return false;
+			}
+
+			rtc::Thread::Current()->ProcessMessages(1);
+		}
+
+		return true;
+	}
+
+	double GetElapsedMs(std::chrono::steady_clock::time_point begin)
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - begin).count();
+	}
+
+	// Sets up |options.calls| calls through a stand-in server, measuring the
+	// client's sign in and the offer, answer and candidates exchange. The
+	// peers signal over HTTP, or over WebSocket if |websocket|.
+	Json::Value RunCalls(const Options& options, bool keep_alive, bool websocket)
+	{
+		StandInServer::Options server_options;
+		server_options.keep_alive = keep_alive;
+		server_options.round_trip_ms = options.round_trip_ms;
+		server_options.handshake_round_trips = options.tls ? 3 : 1;
+		StandInServer server(server_options);
+		Json::Value result;
+		if (!server.Start())
+		{
+			result["error"] = "Failed to start the stand-in server.";
+			return result;
+		}
+
+		std::string offer = CreateOffer();
+		std::vector<std::string> candidates;
+		for (int i = 0; i < options.candidates; i++)
+		{
+			candidates.push_back(CreateCandidate(i));
+		}
+
+		std::string server_address = websocket ? "ws://127.0.0.1" : "127.0.0.1";
+		int expected_messages = 1 + options.candidates;
+		std::vector<double> sign_in_ms;
+		std::vector<double> exchange_ms;
+		std::vector<double> total_ms;
+		int failed_calls = 0;
+		int connections = 0;
+		int requests = 0;
+		for (int call = 0; call < options.calls; call++)
+		{
+			// The renderer waits for calls, only the client's sign in counts.
+			BenchmarkPeer renderer;
+			BenchmarkPeer client;
+			renderer.client()->Connect(server_address, server.port(), "renderer");
+			if (!Pump([&]() { return renderer.signed_in || renderer.failed; }) || renderer.failed)
+			{
+				failed_calls++;
+				continue;
+			}
+
+			int first_connection = server.connections();
+			int first_request = server.requests();
+			auto begin = std::chrono::steady_clock::now();
+			client.client()->Connect(server_address, server.port(), "client");
+			bool signed_in = Pump([&]()
+			{
+				return (client.signed_in && !client.client()->peers().empty()) || client.failed;
+			}) && !client.failed;
+
+			double client_sign_in_ms = GetElapsedMs(begin);
+			bool answered = false;
+			bool exchanged = signed_in;
+			if (signed_in)
+			{
+				auto exchange_begin = std::chrono::steady_clock::now();
+				int renderer_id = client.client()->peers().begin()->first;
+				client.Send(renderer_id, offer);
+				for (const std::string& candidate : candidates)
+				{
+					client.Send(renderer_id, candidate);
+				}
+
+				// The renderer answers once the offer is in.
+				exchanged = Pump([&]()
+				{
+					if (!answered && renderer.messages_received > 0)
+					{
+						answered = true;
+						renderer.Send(renderer.first_message_peer_id, "{\"type\":\"answer\",\"sdp\":\"" +
+							offer.substr(0, offer.size() / 2) + "\"}");
+
+						for (const std::string& candidate : candidates)
+						{
+							renderer.Send(renderer.first_message_peer_id, candidate);
+						}
+					}
+
+					return (renderer.messages_received >= expected_messages &&
+						client.messages_received >= expected_messages) ||
+						renderer.disconnected || client.disconnected;
+				}) && !renderer.disconnected && !client.disconnected;
+
+				if (exchanged)
+				{
+					sign_in_ms.push_back(client_sign_in_ms);
+					exchange_ms.push_back(GetElapsedMs(exchange_begin));
+					total_ms.push_back(GetElapsedMs(begin));
+					connections += server.connections() - first_connection;
+					requests += server.requests() - first_request;
+				}
+			}
+
+			if (!exchanged)
+			{
+				failed_calls++;
+			}
+
+			// Signs both sides out before the next call.
+			for (BenchmarkPeer* peer : { &client, &renderer })
+			{
+				if (peer->client()->is_connected() && !peer->disconnected)
+				{
+					Pump([&]() { return !peer->has_pending_messages() && !peer->client()->IsSendingMessage(); });
+					peer->client()->SignOut();
+					Pump([&]() { return peer->disconnected; });
+				}
+
+				peer->client()->Shutdown();
+			}
+		}
+
+		int completed_calls = options.calls - failed_calls;
+		result["transport"] = websocket ? "websocket" : "http";
+		result["keep_alive"] = keep_alive;
+		result["completed_calls"] = completed_calls;
+		result["failed_calls"] = failed_calls;
+		result["sign_in_ms"] = GetPercentiles(sign_in_ms);
+		result["exchange_ms"] = GetPercentiles(exchange_ms);
+		result["setup_ms"] = GetPercentiles(total_ms);
+		result["connections_per_call"] = completed_calls > 0 ?
+			static_cast<double>(connections) / completed_calls : 0.0;
+
+		result["requests_per_call"] = completed_calls > 0 ?
+			static_cast<double>(requests) / completed_calls : 0.0;
+
+		return result;
+	}
+
+	// Compares call setup with a connection per request, as with
+	// peerconnection_server, against kept-alive, pipelined connections and
+	// a WebSocket connection.
+	Json::Value RunSetupSuite(const Options& options)
+	{
+		Json::Value results;
+		results["round_trip_ms"] = options.round_trip_ms;
+		results["handshake_round_trips"] = options.tls ? 3 : 1;
+		results["candidates"] = options.candidates;
+		results["messages_per_call"] = 2 * (1 + options.candidates);
+		results["connection_per_request"] = RunCalls(options, false, false);
+		results["keep_alive"] = RunCalls(options, true, false);
+		results["websocket"] = RunCalls(options, true, true);
+
+		double close_ms = results["connection_per_request"]["setup_ms"]["p50"].asDouble();
+		double keep_alive_ms = results["keep_alive"]["setup_ms"]["p50"].asDouble();
+		double websocket_ms = results["websocket"]["setup_ms"]["p50"].asDouble();
+		results["setup_time_reduction_percent"] = close_ms > 0 ?
+			(close_ms - keep_alive_ms) * 100.0 / close_ms : 0.0;
+
+		results["websocket_setup_time_reduction_percent"] = close_ms > 0 ?
+			(close_ms - websocket_ms) * 100.0 / close_ms : 0.0;
+
+		return results;
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: SignalingBenchmark [--suite all|parser|setup] [--iterations N]\n"
+			"                          [--segment BYTES] [--calls N] [--rtt MS]\n"
+			"                          [--candidates N] [--tls] [--output results.json]\n");
+	}
+}
+
+// Runs the signaling benchmarks and writes the results as JSON to stdout or
+// to the output file.
+int main(int argc, char** argv)
+{
+	Options options;
+	options.suite = "all";
+	options.iterations = kDefaultIterations;
+	options.segment_size = kDefaultSegmentSize;
+	options.calls = kDefaultCalls;
+	options.round_trip_ms = kDefaultRoundTripMs;
+	options.candidates = kDefaultCandidates;
+	options.tls = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--suite" && has_value)
+		{
+			options.suite = argv[++i];
+		}
+		else if (arg == "--iterations" && has_value)
+		{
+			options.iterations = atoi(argv[++i]);
+		}
+		else if (arg == "--segment" && has_value)
+		{
+			options.segment_size = atoi(argv[++i]);
+		}
+		else if (arg == "--calls" && has_value)
+		{
+			options.calls = atoi(argv[++i]);
+		}
+		else if (arg == "--rtt" && has_value)
+		{
+			options.round_trip_ms = atoi(argv[++i]);
+		}
+		else if (arg == "--candidates" && has_value)
+		{
+			options.candidates = atoi(argv[++i]);
+		}
+		else if (arg == "--tls")
+		{
+			options.tls = true;
+		}
+		else if (arg == "--output" && has_value)
+		{
+			options.output_path = argv[++i];
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	options.iterations = std::max(options.iterations, 1);
+	options.segment_size = std::min(std::max(options.segment_size, 1), 0xffff);
+	options.calls = std::max(options.calls, 1);
+	options.round_trip_ms = std::max(options.round_trip_ms, 0);
+	options.candidates = std::max(options.candidates, 0);
+
+	Json::Value root;
+	root["benchmark"] = "SignalingBenchmark";
+	if (options.suite == "all" || options.suite == "parser")
+	{
+		root["parser"] = RunParserSuite(options);
+	}
+
+	if (options.suite == "all" || options.suite == "setup")
+	{
+#ifdef _WIN32
+		rtc::EnsureWinsockInit();
+		rtc::Win32Thread w32_thread;
+		rtc::ThreadManager::Instance()->SetCurrentThread(&w32_thread);
+#else
+		rtc::AutoThread auto_thread;
+#endif // _WIN32
+
+		root["setup"] = RunSetupSuite(options);
+
+#ifdef _WIN32
+		rtc::ThreadManager::Instance()->SetCurrentThread(nullptr);
+#endif // _WIN32
+	}
+
+	std::string json = Json::StyledWriter().write(root);
+	if (options.output_path.empty())
+	{
+		std::cout << json;
+	}
+	else
+	{
+		std::ofstream output(options.output_path);
+		output << json;
+		if (!output)
+		{
+			fprintf(stderr, "Failed to write %s\n", options.output_path.c_str());
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,600 @@
+#include "StandInServer.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "webrtc/base/base64.h"
+#include "webrtc/base/messagedigest.h"
+#include "webrtc/base/socketaddress.h"
+#include "webrtc/base/thread.h"
+#include "webrtc/base/timeutils.h"
+
+#include "third_party/jsoncpp/source/include/json/json.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	struct Task : public rtc::MessageData
+	{
+		explicit Task(std::function<void()> task) :
+			run(task)
+		{
+		}
+
+		std::function<void()> run;
+	};
+
+	std::string ToLower(std::string value)
+	{
+		std::transform(value.begin(), value.end(), value.begin(), [](char c)
+		{
+			return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+		});
+
+		return value;
+	}
+
+	int GetQueryValue(const std::map<std::string, std::string>& query, const char* name)
+	{
+		auto it = query.find(name);
+		return it == query.end() ? -1 : atoi(it->second.c_str());
+	}
+
+	// Returns the trimmed value of |name| in lower case |headers|, from the
+	// original |request|.
+	std::string GetHeaderValue(const std::string& headers, const std::string& request,
+		const char* name)
+	{
+		size_t found = headers.find(std::string("\r\n") + name + ":");
+		if (found == std::string::npos)
+		{
+			return std::string();
+		}
+
+		size_t begin = request.find_first_not_of(" \t", found + strlen(name) + 3);
+		size_t end = request.find("\r\n", begin);
+		return request.substr(begin, end - begin);
+	}
+
+	const int kTextFrame = 0x1;
+	const int kCloseFrame = 0x8;
+	const int kPingFrame = 0x9;
+	const int kPongFrame = 0xa;
+}
+
+StandInServer::StandInServer(const Options& options) :
+	options_(options),
+	port_(0),
+	connections_(0),
+	requests_(0),
+	next_connection_id_(1),
+	next_peer_id_(1)
+{
+}
+
+StandInServer::~StandInServer()
+{
+	// Drops the pending tasks.
+	rtc::Thread::Current()->Clear(this);
+}
+
+bool StandInServer::Start()
+{
+	listen_socket_.reset(rtc::Thread::Current()->socketserver()->CreateAsyncSocket(
+		AF_INET, SOCK_STREAM));
+
+	if (!listen_socket_ ||
+		listen_socket_->Bind(rtc::SocketAddress("127.0.0.1", 0)) != 0 ||
+		listen_socket_->Listen(16) != 0)
+	{
+		return false;
+	}
+
+	listen_socket_->SignalReadEvent.connect(this, &StandInServer::OnAccept);
+	port_ = listen_socket_->GetLocalAddress().port();
+	return true;
+}
+
+void StandInServer::OnMessage(rtc::Message* msg)
+{
+	Task* task = static_cast<Task*>(msg->pdata);
+	task->run();
+	delete task;
+}
+
+void StandInServer::OnAccept(rtc::AsyncSocket* socket)
+{
+	rtc::AsyncSocket* accepted = socket->Accept(nullptr);
+	if (!accepted)
+	{
+		return;
+	}
+
+	closed_connections_.clear();
+	connections_++;
+	std::unique_ptr<Connection> connection(new Connection());
+	connection->socket.reset(accepted);
+	connection->ready_time_ms = rtc::TimeMillis() +
+		options_.handshake_round_trips * options_.round_trip_ms;
+
+	connection->last_request_time_ms = 0;
+	connection->websocket = false;
+	accepted->SignalReadEvent.connect(this, &StandInServer::OnRead);
+	accepted->SignalCloseEvent.connect(this, &StandInServer::OnClose);
+	connections_by_id_[next_connection_id_++] = std::move(connection);
+}
+
+void StandInServer::OnRead(rtc::AsyncSocket* socket)
+{
+	auto it = std::find_if(connections_by_id_.begin(), connections_by_id_.end(),
+		[socket](const std::pair<const int, std::unique_ptr<Connection>>& entry)
+	{
+		return entry.second->socket.get() == socket;
+	});
+
+	if (it == connections_by_id_.end())
+	{
+		return;
+	}
+
+	int connection_id = it->first;
+	Connection* connection = it->second.get();
+	char buffer[0xffff];
+	int bytes = 0;
+	while ((bytes = socket->Recv(buffer, sizeof(buffer), nullptr)) > 0)
+	{
+		connection->buffer.append(buffer, bytes);
+	}
+
+	// Each request reaches the server half a round trip after it was sent,
+	// once the handshake of its connection is over.
+	while (true)
+	{
+		int64_t now = rtc::TimeMillis();
+		int64_t request_time = std::max(std::max(now, connection->ready_time_ms) +
+			options_.round_trip_ms / 2, connection->last_request_time_ms);
+
+		Request request;
+		int opcode = 0;
+		std::string payload;
+		if (connection->websocket && ParseFrame(&connection->buffer, &opcode, &payload))
+		{
+			PostTask(request_time - now, [this, connection_id, opcode, payload]()
+			{
+				HandleFrame(connection_id, opcode, payload);
+			});
+		}
+		else if (!connection->websocket && ParseRequest(&connection->buffer, &request))
+		{
+			// Frames can only follow the opening handshake.
+			connection->websocket = !request.websocket_key.empty();
+			PostTask(request_time - now, [this, connection_id, request]()
+			{
+				HandleRequest(connection_id, request);
+			});
+		}
+		else
+		{
+			break;
+		}
+
+		connection->last_request_time_ms = request_time;
+	}
+}
+
+void StandInServer::OnClose(rtc::AsyncSocket* socket, int err)
+{
+	for (auto it = connections_by_id_.begin(); it != connections_by_id_.end(); ++it)
+	{
+		if (it->second->socket.get() == socket)
+		{
+			// A WebSocket peer is signed in for as long as its connection.
+			for (auto websocket = websocket_connections_.begin(); websocket != websocket_connections_.end(); ++websocket)
+			{
+				if (websocket->second == it->first)
+				{
+					int peer_id = websocket->first;
+					websocket_connections_.erase(websocket);
+					SignOut(peer_id);
+					break;
+				}
+			}
+
+			for (auto waiting = waiting_connections_.begin(); waiting != waiting_connections_.end(); ++waiting)
+			{
+				if (waiting->second == it->first)
+				{
+					waiting_connections_.erase(waiting);
+					break;
+				}
+			}
+
+			// The socket may still be signaling, it is deleted later.
+			closed_connections_.push_back(std::move(it->second));
+			connections_by_id_.erase(it);
+			return;
+		}
+	}
+}
+
+bool StandInServer::ParseRequest(std::string* buffer, Request* request)
+{
+	size_t end_of_headers = buffer->find("\r\n\r\n");
+	if (end_of_headers == std::string::npos)
+	{
+		return false;
+	}
+
+	std::string headers = ToLower(buffer->substr(0, end_of_headers + 2));
+	size_t content_length = 0;
+	size_t found = headers.find("\r\ncontent-length:");
+	if (found != std::string::npos)
+	{
+		content_length = atoi(headers.c_str() + found + 17);
+	}
+
+	size_t size = end_of_headers + 4 + content_length;
+	if (buffer->size() < size)
+	{
+		return false;
+	}
+
+	// <method> <path>?<query> HTTP/1.x
+	size_t method_end = buffer->find(' ');
+	size_t path_end = buffer->find(' ', method_end + 1);
+	std::string target = buffer->substr(method_end + 1, path_end - method_end - 1);
+	size_t query_begin = target.find('?');
+	request->method = buffer->substr(0, method_end);
+	request->path = target.substr(0, query_begin);
+	request->query.clear();
+	while (query_begin != std::string::npos)
+	{
+		size_t next = target.find('&', query_begin + 1);
+		std::string parameter = target.substr(query_begin + 1,
+			next == std::string::npos ? std::string::npos : next - query_begin - 1);
+
+		size_t equals = parameter.find('=');
+		if (equals != std::string::npos)
+		{
+			request->query[parameter.substr(0, equals)] = parameter.substr(equals + 1);
+		}
+
+		query_begin = next;
+	}
+
+	request->body = buffer->substr(end_of_headers + 4, content_length);
+	request->websocket_key = ToLower(GetHeaderValue(headers, *buffer, "upgrade")) == "websocket" ?
+		GetHeaderValue(headers, *buffer, "sec-websocket-key") : std::string();
+
+	buffer->erase(0, size);
+	return true;
+}
+
+bool StandInServer::ParseFrame(std::string* buffer, int* opcode, std::string* payload)
+{
+	// Client frames are masked, and not fragmented by the transport.
+	const unsigned char* frame = reinterpret_cast<const unsigned char*>(buffer->data());
+	size_t available = buffer->size();
+	if (available < 2)
+	{
+		return false;
+	}
+
+	uint64_t payload_size = frame[1] & 0x7f;
+	size_t header_size = 2;
+	if (payload_size == 126)
+	{
+		header_size = 4;
+		payload_size = available < header_size ? 0 : (frame[2] << 8) | frame[3];
+	}
+	else if (payload_size == 127)
+	{
+		header_size = 10;
+		payload_size = 0;
+		for (size_t i = 2; i < header_size && i < available; i++)
+		{
+			payload_size = (payload_size << 8) | frame[i];
+		}
+	}
+
+	size_t mask_offset = header_size;
+	header_size += (frame[1] & 0x80) ? 4 : 0;
+	if (available < header_size || available - header_size < payload_size)
+	{
+		return false;
+	}
+
+	*opcode = frame[0] & 0x0f;
+	payload->assign(buffer->data() + header_size, static_cast<size_t>(payload_size));
+	for (size_t i = 0; header_size > mask_offset && i < payload->size(); i++)
+	{
+		(*payload)[i] ^= (*buffer)[mask_offset + i % 4];
+	}
+
+	buffer->erase(0, header_size + payload->size());
+	return true;
+}
+
+void StandInServer::HandleRequest(int connection_id, const Request& request)
+{
+	requests_++;
+	int peer_id = GetQueryValue(request.query, "peer_id");
+	if (request.path == "/signaling" && !request.websocket_key.empty())
+	{
+		AcceptWebSocket(connection_id, request);
+	}
+	else if (request.path == "/sign_in")
+	{
+		auto name = request.query.find("peer_name");
+		peer_id = SignIn(name == request.query.end() ? "peer" : name->second);
+
+		// The new peer first, followed by the peers already signed in.
+		std::string body = peers_[peer_id] + "," + std::to_string(peer_id) + ",1\n";
+		for (const auto& peer : peers_)
+		{
+			if (peer.first != peer_id)
+			{
+				body += peer.second + "," + std::to_string(peer.first) + ",1\n";
+			}
+		}
+
+		Respond(connection_id, 200, peer_id, body);
+	}
+	else if (peers_.find(peer_id) == peers_.end())
+	{
+		Respond(connection_id, 404, peer_id, "");
+	}
+	else if (request.path == "/sign_out")
+	{
+		SignOut(peer_id);
+		Respond(connection_id, 200, peer_id, "");
+	}
+	else if (request.path == "/wait")
+	{
+		waiting_connections_[peer_id] = connection_id;
+		DeliverMessage(peer_id);
+	}
+	else if (request.path == "/message")
+	{
+		int to = GetQueryValue(request.query, "to");
+		if (peers_.find(to) == peers_.end())
+		{
+			Respond(connection_id, 404, peer_id, "");
+			return;
+		}
+
+		SendToPeer(to, peer_id, request.body);
+		Respond(connection_id, 200, peer_id, "");
+	}
+	else
+	{
+		// heartbeat
+		Respond(connection_id, 200, peer_id, "");
+	}
+}
+
+void StandInServer::HandleFrame(int connection_id, int opcode, const std::string& payload)
+{
+	requests_++;
+	auto connection = std::find_if(websocket_connections_.begin(), websocket_connections_.end(),
+		[connection_id](const std::pair<const int, int>& entry)
+	{
+		return entry.second == connection_id;
+	});
+
+	if (connection == websocket_connections_.end())
+	{
+		return;
+	}
+
+	int peer_id = connection->first;
+	Json::Reader reader;
+	Json::Value root;
+	if (opcode == kPingFrame)
+	{
+		SendFrame(connection_id, kPongFrame, payload);
+	}
+	else if (opcode == kCloseFrame)
+	{
+		websocket_connections_.erase(connection);
+		SignOut(peer_id);
+		SendFrame(connection_id, kCloseFrame, payload.substr(0, 2));
+	}
+	else if (opcode == kTextFrame && reader.parse(payload, root) && root.isObject())
+	{
+		std::string type = root.get("type", "").asString();
+		if (type == "message" && peers_.count(root.get("to", -1).asInt()))
+		{
+			SendToPeer(root.get("to", -1).asInt(), peer_id, root.get("data", "").asString());
+		}
+		else if (type == "sign_out")
+		{
+			// The connection closes once the peer has signed out.
+			websocket_connections_.erase(connection);
+			SignOut(peer_id);
+			SendFrame(connection_id, kCloseFrame, std::string("\x03\xe8", 2));
+		}
+	}
+}
+
+void StandInServer::AcceptWebSocket(int connection_id, const Request& request)
+{
+	std::string accept = request.websocket_key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	char digest[20];
+	rtc::ComputeDigest(rtc::DIGEST_SHA_1, accept.data(), accept.size(), digest, sizeof(digest));
+	Send(connection_id, "HTTP/1.1 101 Switching Protocols\r\n"
+		"Upgrade: websocket\r\n"
+		"Connection: Upgrade\r\n"
+		"Sec-WebSocket-Accept: " + rtc::Base64::Encode(std::string(digest, sizeof(digest))) + "\r\n"
+		"\r\n", false);
+
+	auto name = request.query.find("peer_name");
+	int peer_id = SignIn(name == request.query.end() ? "peer" : name->second);
+	websocket_connections_[peer_id] = connection_id;
+
+	Json::Value signed_in;
+	signed_in["type"] = "signed_in";
+	signed_in["id"] = peer_id;
+	signed_in["peers"] = Json::Value(Json::arrayValue);
+	for (const auto& peer : peers_)
+	{
+		Json::Value entry;
+		entry["id"] = peer.first;
+		entry["name"] = peer.second;
+		signed_in["peers"].append(entry);
+	}
+
+	SendFrame(connection_id, kTextFrame, Json::FastWriter().write(signed_in));
+}
+
+int StandInServer::SignIn(const std::string& name)
+{
+	int peer_id = next_peer_id_++;
+	for (const auto& peer : peers_)
+	{
+		NotifyPeer(peer.first, peer_id, name, true);
+	}
+
+	peers_[peer_id] = name;
+	return peer_id;
+}
+
+void StandInServer::SignOut(int peer_id)
+{
+	if (peers_.find(peer_id) == peers_.end())
+	{
+		return;
+	}
+
+	std::string name = peers_[peer_id];
+	peers_.erase(peer_id);
+	messages_.erase(peer_id);
+	waiting_connections_.erase(peer_id);
+	for (const auto& peer : peers_)
+	{
+		NotifyPeer(peer.first, peer_id, name, false);
+	}
+}
+
+void StandInServer::NotifyPeer(int peer_id, int other_peer_id, const std::string& name,
+	bool connected)
+{
+	auto websocket = websocket_connections_.find(peer_id);
+	if (websocket == websocket_connections_.end())
+	{
+		// A message from the peer itself.
+		QueueMessage(peer_id, peer_id, name + "," + std::to_string(other_peer_id) + "," +
+			(connected ? "1" : "0"));
+
+		return;
+	}
+
+	Json::Value notification;
+	notification["type"] = "peer";
+	notification["id"] = other_peer_id;
+	notification["name"] = name;
+	notification["connected"] = connected;
+	SendFrame(websocket->second, kTextFrame, Json::FastWriter().write(notification));
+}
+
+void StandInServer::SendToPeer(int peer_id, int from_peer_id, const std::string& message)
+{
+	auto websocket = websocket_connections_.find(peer_id);
+	if (websocket == websocket_connections_.end())
+	{
+		QueueMessage(peer_id, from_peer_id, message);
+		return;
+	}
+
+	Json::Value relayed;
+	relayed["type"] = "message";
+	relayed["from"] = from_peer_id;
+	relayed["data"] = message;
+	SendFrame(websocket->second, kTextFrame, Json::FastWriter().write(relayed));
+}
+
+void StandInServer::QueueMessage(int peer_id, int from_peer_id, const std::string& message)
+{
+	messages_[peer_id].push_back(std::make_pair(from_peer_id, message));
+	DeliverMessage(peer_id);
+}
+
+void StandInServer::DeliverMessage(int peer_id)
+{
+	auto waiting = waiting_connections_.find(peer_id);
+	auto messages = messages_.find(peer_id);
+	if (waiting == waiting_connections_.end() || messages == messages_.end() ||
+		messages->second.empty())
+	{
+		return;
+	}
+
+	std::pair<int, std::string> message = messages->second.front();
+	messages->second.pop_front();
+	Respond(waiting->second, 200, message.first, message.second);
+	waiting_connections_.erase(waiting);
+}
+
+void StandInServer::Respond(int connection_id, int status, int peer_id, const std::string& body)
+{
+	std::string response = std::string(status == 200 ? "HTTP/1.1 200 OK" :
+		"HTTP/1.1 404 Not Found") + "\r\n"
+		"Server: PeerConnectionTestServer/0.1\r\n"
+		"Cache-Control: no-cache\r\n" +
+		(options_.keep_alive ? "" : "Connection: close\r\n") +
+		"Content-Type: text/plain\r\n"
+		"Content-Length: " + std::to_string(body.size()) + "\r\n"
+		"Pragma: " + std::to_string(peer_id) + "\r\n"
+		"\r\n" + body;
+
+	Send(connection_id, response, !options_.keep_alive);
+}
+
+void StandInServer::SendFrame(int connection_id, int opcode, const std::string& payload)
+{
+	// Server frames aren't masked.
+	std::string frame(1, static_cast<char>(0x80 | opcode));
+	if (payload.size() < 126)
+	{
+		frame += static_cast<char>(payload.size());
+	}
+	else
+	{
+		frame += static_cast<char>(127);
+		for (int i = 7; i >= 0; i--)
+		{
+			frame += static_cast<char>(static_cast<uint64_t>(payload.size()) >> (8 * i));
+		}
+	}
+
+	Send(connection_id, frame + payload, opcode == kCloseFrame);
+}
+
+void StandInServer::Send(int connection_id, const std::string& data, bool close)
+{
+	// The data reaches the client half a round trip later.
+	PostTask(options_.round_trip_ms / 2, [this, connection_id, data, close]()
+	{
+		auto it = connections_by_id_.find(connection_id);
+		if (it == connections_by_id_.end())
+		{
+			return;
+		}
+
+		it->second->socket->Send(data.data(), data.size());
+		if (close)
+		{
+			it->second->socket->Close();
+			OnClose(it->second->socket.get(), 0);
+		}
+	});
+}
+
+void StandInServer::PostTask(int64_t delay_ms, std::function<void()> task)
+{
+	rtc::Thread::Current()->PostDelayed(RTC_FROM_HERE, static_cast<int>(delay_ms), this, 0,
+		new Task(task));
+}
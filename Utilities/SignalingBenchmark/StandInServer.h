@@ -0,0 +1,155 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "webrtc/base/asyncsocket.h"
+#include "webrtc/base/messagehandler.h"
+#include "webrtc/base/sigslot.h"
+
+namespace StreamingToolkit
+{
+	// Local stand-in for the signaling server, running on the current thread.
+	// It speaks the protocols PeerConnectionClient expects, the HTTP requests
+	// (sign_in, sign_out, wait, message and heartbeat) and the WebSocket
+	// protocol of WebSocketSignalingTransport, and emulates the network on
+	// loopback: requests and frames are processed half a round trip after
+	// they were sent and their responses sent half a round trip later. The
+	// first request on a connection also waits for the connection handshake.
+	class StandInServer : public sigslot::has_slots<>, public rtc::MessageHandler
+	{
+	public:
+		struct Options
+		{
+			// Keeps HTTP/1.1 connections open. Otherwise every response closes
+			// its connection, like peerconnection_server.
+			bool keep_alive;
+
+			int round_trip_ms;
+
+			// Round trips before the first request of a connection, 1 for TCP
+			// and 3 for TCP and a full TLS 1.2 handshake.
+			int handshake_round_trips;
+		};
+
+		explicit StandInServer(const Options& options);
+
+		~StandInServer();
+
+		// Listens on a loopback port. Returns false on failure.
+		bool Start();
+
+		int port() const { return port_; }
+
+		// Number of connections accepted so far.
+		int connections() const { return connections_; }
+
+		// Number of requests processed so far.
+		int requests() const { return requests_; }
+
+		// Runs the delayed request and response tasks.
+		void OnMessage(rtc::Message* msg) override;
+
+	private:
+		struct Connection
+		{
+			std::unique_ptr<rtc::AsyncSocket> socket;
+			std::string buffer;
+
+			// When the emulated handshake completes.
+			int64_t ready_time_ms;
+
+			// When the last request received is processed, requests on a
+			// connection are processed in order.
+			int64_t last_request_time_ms;
+
+			// Set once the connection is upgraded to WebSocket.
+			bool websocket;
+		};
+
+		struct Request
+		{
+			std::string method;
+			std::string path;
+			std::map<std::string, std::string> query;
+			std::string body;
+
+			// Sec-WebSocket-Key of an opening handshake.
+			std::string websocket_key;
+		};
+
+		void OnAccept(rtc::AsyncSocket* socket);
+
+		void OnRead(rtc::AsyncSocket* socket);
+
+		void OnClose(rtc::AsyncSocket* socket, int err);
+
+		// Removes the first request from |buffer| once it is complete.
+		static bool ParseRequest(std::string* buffer, Request* request);
+
+		// Removes the first frame from |buffer| once it is complete, unmasked.
+		static bool ParseFrame(std::string* buffer, int* opcode, std::string* payload);
+
+		void HandleRequest(int connection_id, const Request& request);
+
+		void HandleFrame(int connection_id, int opcode, const std::string& payload);
+
+		// Upgrades the connection and signs the peer in.
+		void AcceptWebSocket(int connection_id, const Request& request);
+
+		// Adds a peer and notifies the others. Returns its ID.
+		int SignIn(const std::string& name);
+
+		// Removes a peer and notifies the others.
+		void SignOut(int peer_id);
+
+		// Tells |peer_id| about a peer signing in or out.
+		void NotifyPeer(int peer_id, int other_peer_id, const std::string& name, bool connected);
+
+		// Relays a message to |peer_id|, as a frame or through its wait request.
+		void SendToPeer(int peer_id, int from_peer_id, const std::string& message);
+
+		// Delivers the next message queued for |peer_id| if it is waiting.
+		void DeliverMessage(int peer_id);
+
+		// Queues |message| for the wait request of |peer_id|. A message from
+		// the peer itself notifies it of a peer signing in or out.
+		void QueueMessage(int peer_id, int from_peer_id, const std::string& message);
+
+		void Respond(int connection_id, int status, int peer_id, const std::string& body);
+
+		void SendFrame(int connection_id, int opcode, const std::string& payload);
+
+		// Sends |data| half a round trip later, then closes the connection
+		// if |close|.
+		void Send(int connection_id, const std::string& data, bool close);
+
+		void PostTask(int64_t delay_ms, std::function<void()> task);
+
+		Options options_;
+		std::unique_ptr<rtc::AsyncSocket> listen_socket_;
+		int port_;
+		int connections_;
+		int requests_;
+		int next_connection_id_;
+		int next_peer_id_;
+		std::map<int, std::unique_ptr<Connection>> connections_by_id_;
+		std::vector<std::unique_ptr<Connection>> closed_connections_;
+		std::map<int, std::string> peers_;
+
+		// Messages waiting for their recipient, with the sender's ID.
+		std::map<int, std::deque<std::pair<int, std::string>>> messages_;
+
+		// Connections holding a wait request, by peer ID.
+		std::map<int, int> waiting_connections_;
+
+		// WebSocket connections, by peer ID.
+		std::map<int, int> websocket_connections_;
+	};
+}
@@ -0,0 +1,535 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
+#include "QualityMetrics.h"
+#include "VideoFileReader.h"
+
+using namespace StreamingToolkit;
+
+namespace
+{
+	enum Metric
+	{
+		// Same order as the results_<metric>.csv files VQMT writes, which
+		// runAnalysis.ps1 merges alphabetically.
+		kMetricMsSsim = 0,
+		kMetricPsnr,
+		kMetricSsim,
+		kMetricCount
+	};
+
+	const char* const kMetricNames[kMetricCount] = { "msssim", "psnr", "ssim" };
+
+	// Luma keeps the VQMT test names, chroma gets a suffix.
+	const int kPlaneCount = 3;
+	const char* const kPlaneSuffixes[kPlaneCount] = { "", "_u", "_v" };
+
+	const char* const kReferenceNames[] = { "lossless.y4m", "lossless.yuv" };
+
+	struct Options
+	{
+		std::vector<std::string> inputs;
+		std::string reference_path;
+		std::string output_folder;
+		std::string csv_file_name;
+		int width;
+		int height;
+		int max_frames;
+		int threads;
+		bool metrics[kMetricCount];
+		bool luma_only;
+	};
+
+	// Fields of the file name convention of runAnalysis.ps1, for instance
+	// 10000kbps-AQ1-lowLatencyHQ-CBR-LL-HQ.y4m. Missing fields are empty.
+	struct VideoInfo
+	{
+		std::string path;
+		std::string kbps;
+		std::string aq;
+		std::string type;
+	};
+
+	std::string GetFileName(const std::string& path)
+	{
+		size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? path : path.substr(separator + 1);
+	}
+
+	bool HasVideoExtension(const std::string& name)
+	{
+		size_t dot = name.find_last_of('.');
+		if (dot == std::string::npos)
+		{
+			return false;
+		}
+
+		std::string extension = name.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return extension == ".yuv" || extension == ".y4m";
+	}
+
+	VideoInfo GetVideoInfo(const std::string& path)
+	{
+		std::string name = GetFileName(path);
+		name = name.substr(0, name.find('.'));
+
+		std::vector<std::string> metadata;
+		size_t position = 0;
+		while (true)
+		{
+			size_t dash = name.find('-', position);
+			metadata.push_back(name.substr(position, dash - position));
+			if (dash == std::string::npos)
+			{
+				break;
+			}
+
+			position = dash + 1;
+		}
+
+		VideoInfo info;
+		info.path = path;
+		info.kbps = metadata[0].substr(0, metadata[0].find('k'));
+		info.aq = metadata.size() > 1 ? metadata[1] : "";
+		info.type = metadata.size() > 3 ? metadata[3] : "";
+		return info;
+	}
+
+	bool IsDirectory(const std::string& path)
+	{
+#ifdef _WIN32
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES &&
+			(attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif // _WIN32
+	}
+
+	bool FileExists(const std::string& path)
+	{
+#ifdef _WIN32
+		DWORD attributes = GetFileAttributesA(path.c_str());
+		return attributes != INVALID_FILE_ATTRIBUTES &&
+			(attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+#else
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 && S_ISREG(info.st_mode);
+#endif // _WIN32
+	}
+
+	bool CreateFolder(const std::string& path)
+	{
+#ifdef _WIN32
+		return _mkdir(path.c_str()) == 0 || IsDirectory(path);
+#else
+		return mkdir(path.c_str(), 0755) == 0 || IsDirectory(path);
+#endif // _WIN32
+	}
+
+	// Returns the video files of |folder|, not recursively, sorted by name.
+	std::vector<std::string> ListVideos(const std::string& folder)
+	{
+		std::vector<std::string> names;
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((folder + "\\*").c_str(), &data);
+		if (find != INVALID_HANDLE_VALUE)
+		{
+			do
+			{
+				if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+				{
+					names.push_back(data.cFileName);
+				}
+			} while (FindNextFileA(find, &data));
+
+			FindClose(find);
+		}
+#else
+		DIR* directory = opendir(folder.c_str());
+		if (directory)
+		{
+			while (dirent* entry = readdir(directory))
+			{
+				if (FileExists(folder + "/" + entry->d_name))
+				{
+					names.push_back(entry->d_name);
+				}
+			}
+
+			closedir(directory);
+		}
+#endif // _WIN32
+
+		std::sort(names.begin(), names.end());
+
+		std::vector<std::string> paths;
+		for (const std::string& name : names)
+		{
+			if (HasVideoExtension(name))
+			{
+				paths.push_back(folder + "/" + name);
+			}
+		}
+
+		return paths;
+	}
+
+	bool IsReference(const std::string& path, const Options& options)
+	{
+		if (path == options.reference_path)
+		{
+			return true;
+		}
+
+		for (const char* name : kReferenceNames)
+		{
+			if (GetFileName(path) == name)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// Computes the enabled metrics of every frame on |options.threads|
+	// threads. Frames are handed out in order and released once analyzed,
+	// so only the frames in flight are resident. |results| is indexed by
+	// frame, metric and plane.
+	void AnalyzeVideo(const VideoFileReader& reference, const VideoFileReader& distorted,
+		int frame_count, const Options& options, std::vector<double>* results)
+	{
+		const int values_per_frame = kMetricCount * kPlaneCount;
+		results->assign(static_cast<size_t>(frame_count) * values_per_frame, 0.0);
+
+		int plane_count = options.luma_only ? 1 : kPlaneCount;
+		size_t luma_size = static_cast<size_t>(reference.width()) * reference.height();
+		size_t chroma_size = static_cast<size_t>(reference.chroma_width()) *
+			reference.chroma_height();
+
+		std::atomic<int> next_frame(0);
+		auto worker = [&]()
+		{
+			QualityMetrics metrics;
+			int frame;
+			while ((frame = next_frame++) < frame_count)
+			{
+				const uint8_t* reference_frame = reference.GetFrame(frame);
+				const uint8_t* distorted_frame = distorted.GetFrame(frame);
+				double* values = results->data() + static_cast<size_t>(frame) * values_per_frame;
+				for (int plane = 0; plane < plane_count; plane++)
+				{
+					size_t offset = plane == 0 ? 0 : luma_size + (plane - 1) * chroma_size;
+					int width = plane == 0 ? reference.width() : reference.chroma_width();
+					int height = plane == 0 ? reference.height() : reference.chroma_height();
+					const uint8_t* a = reference_frame + offset;
+					const uint8_t* b = distorted_frame + offset;
+					if (options.metrics[kMetricPsnr])
+					{
+						values[kMetricPsnr * kPlaneCount + plane] =
+							QualityMetrics::Psnr(a, width, b, width, width, height);
+					}
+
+					if (options.metrics[kMetricMsSsim])
+					{
+						values[kMetricMsSsim * kPlaneCount + plane] =
+							metrics.MsSsim(a, width, b, width, width, height,
+								&values[kMetricSsim * kPlaneCount + plane]);
+					}
+					else if (options.metrics[kMetricSsim])
+					{
+						values[kMetricSsim * kPlaneCount + plane] =
+							metrics.Ssim(a, width, b, width, width, height);
+					}
+				}
+
+				reference.ReleaseFrame(frame);
+				distorted.ReleaseFrame(frame);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (int i = 1; i < options.threads; i++)
+		{
+			threads.push_back(std::thread(worker));
+		}
+
+		worker();
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+	}
+
+	std::string Quote(const std::string& value)
+	{
+		return "\"" + value + "\"";
+	}
+
+	// Appends the rows of one video in the layout of the merged CSV of
+	// runAnalysis.ps1: Test, Kbps, AQ, Type, frame, value.
+	void WriteRows(std::ofstream& csv, const VideoInfo& info, int frame_count,
+		const Options& options, const std::vector<double>& results)
+	{
+		int plane_count = options.luma_only ? 1 : kPlaneCount;
+		char value[64];
+		for (int metric = 0; metric < kMetricCount; metric++)
+		{
+			if (!options.metrics[metric])
+			{
+				continue;
+			}
+
+			for (int plane = 0; plane < plane_count; plane++)
+			{
+				std::string test = std::string(kMetricNames[metric]) + kPlaneSuffixes[plane];
+				double total = 0;
+				for (int frame = 0; frame < frame_count; frame++)
+				{
+					double result = results[(static_cast<size_t>(frame) * kMetricCount + metric) *
+						kPlaneCount + plane];
+					total += result;
+					snprintf(value, sizeof(value), "%.6f", result);
+					csv << Quote(test) << "," << Quote(info.kbps) << "," << Quote(info.aq) <<
+						"," << Quote(info.type) << "," << Quote(std::to_string(frame)) << "," <<
+						Quote(value) << "\n";
+				}
+
+				printf("%s %s average %.6f\n", GetFileName(info.path).c_str(), test.c_str(),
+					frame_count > 0 ? total / frame_count : 0.0);
+			}
+		}
+	}
+
+	bool ParseMetrics(const std::string& list, bool* metrics)
+	{
+		std::fill(metrics, metrics + kMetricCount, false);
+		size_t position = 0;
+		while (position <= list.size())
+		{
+			size_t comma = std::min(list.find(',', position), list.size());
+			std::string name = list.substr(position, comma - position);
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			const char* const* found = std::find_if(kMetricNames, kMetricNames + kMetricCount,
+				[&name](const char* metric) { return name == metric; });
+			if (found == kMetricNames + kMetricCount)
+			{
+				return false;
+			}
+
+			metrics[found - kMetricNames] = true;
+			position = comma + 1;
+		}
+
+		return true;
+	}
+
+	void PrintUsage()
+	{
+		fprintf(stderr,
+			"Usage: QualityAnalyzer [--reference lossless.y4m] [--width W --height H]\n"
+			"                       [--frames N] [--threads N] [--metrics psnr,ssim,msssim]\n"
+			"                       [--luma-only] [--output out] [--csv fullDataSet.csv]\n"
+			"                       <video or folder>...\n");
+	}
+}
+
+// Compares raw I420 or Y4M videos against a lossless reference and writes
+// one merged CSV, like runAnalysis.ps1 did with VQMT. Folders are searched
+// for .yuv and .y4m files, the reference defaults to the lossless video of
+// the first folder. Thread count defaults to the number of hardware threads.
+int main(int argc, char** argv)
+{
+	Options options;
+	options.output_folder = "out";
+	options.csv_file_name = "fullDataSet.csv";
+	options.width = 0;
+	options.height = 0;
+	options.max_frames = 0;
+	options.threads = static_cast<int>(std::thread::hardware_concurrency());
+	std::fill(options.metrics, options.metrics + kMetricCount, true);
+	options.luma_only = false;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = i + 1 < argc;
+		if (arg == "--reference" && has_value)
+		{
+			options.reference_path = argv[++i];
+		}
+		else if (arg == "--width" && has_value)
+		{
+			options.width = atoi(argv[++i]);
+		}
+		else if (arg == "--height" && has_value)
+		{
+			options.height = atoi(argv[++i]);
+		}
+		else if (arg == "--frames" && has_value)
+		{
+			options.max_frames = atoi(argv[++i]);
+		}
+		else if (arg == "--threads" && has_value)
+		{
+			options.threads = atoi(argv[++i]);
+		}
+		else if (arg == "--metrics" && has_value)
+		{
+			if (!ParseMetrics(argv[++i], options.metrics))
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else if (arg == "--luma-only")
+		{
+			options.luma_only = true;
+		}
+		else if (arg == "--output" && has_value)
+		{
+			options.output_folder = argv[++i];
+		}
+		else if (arg == "--csv" && has_value)
+		{
+			options.csv_file_name = argv[++i];
+		}
+		else if (!arg.empty() && arg[0] != '-')
+		{
+			options.inputs.push_back(arg);
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+	}
+
+	options.threads = std::max(options.threads, 1);
+	if (options.inputs.empty())
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	std::vector<VideoInfo> videos;
+	for (const std::string& input : options.inputs)
+	{
+		if (!IsDirectory(input))
+		{
+			videos.push_back(GetVideoInfo(input));
+			continue;
+		}
+
+		if (options.reference_path.empty())
+		{
+			for (const char* name : kReferenceNames)
+			{
+				std::string path = input + "/" + name;
+				if (FileExists(path))
+				{
+					options.reference_path = path;
+					break;
+				}
+			}
+		}
+
+		for (const std::string& path : ListVideos(input))
+		{
+			if (!IsReference(path, options))
+			{
+				videos.push_back(GetVideoInfo(path));
+			}
+		}
+	}
+
+	if (options.reference_path.empty())
+	{
+		fprintf(stderr, "No reference video, pass --reference.\n");
+		return 1;
+	}
+
+	std::string error;
+	VideoFileReader reference;
+	if (!reference.Open(options.reference_path, options.width, options.height, &error))
+	{
+		fprintf(stderr, "Failed to open %s: %s\n", options.reference_path.c_str(),
+			error.c_str());
+		return 1;
+	}
+
+	if (!CreateFolder(options.output_folder))
+	{
+		fprintf(stderr, "Failed to create %s\n", options.output_folder.c_str());
+		return 1;
+	}
+
+	std::string csv_path = options.output_folder + "/" + options.csv_file_name;
+	std::ofstream csv(csv_path);
+	csv << "\"Test\",\"Kbps\",\"AQ\",\"Type\",\"frame\",\"value\"\n";
+
+	int result = 0;
+	std::vector<double> results;
+	for (const VideoInfo& video : videos)
+	{
+		VideoFileReader distorted;
+		if (!distorted.Open(video.path, options.width, options.height, &error))
+		{
+			fprintf(stderr, "Failed to open %s: %s\n", video.path.c_str(), error.c_str());
+			result = 1;
+			continue;
+		}
+
+		if (distorted.width() != reference.width() || distorted.height() != reference.height())
+		{
+			fprintf(stderr, "Skipping %s, %dx%d doesn't match the %dx%d reference.\n",
+				video.path.c_str(), distorted.width(), distorted.height(),
+				reference.width(), reference.height());
+			result = 1;
+			continue;
+		}
+
+		int frame_count = std::min(reference.frame_count(), distorted.frame_count());
+		if (options.max_frames > 0)
+		{
+			frame_count = std::min(frame_count, options.max_frames);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		AnalyzeVideo(reference, distorted, frame_count, options, &results);
+		double seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+		WriteRows(csv, video, frame_count, options, results);
+		fprintf(stderr, "%s: %d frames in %.2f s (%.1f fps)\n", video.path.c_str(),
+			frame_count, seconds, seconds > 0 ? frame_count / seconds : 0.0);
+	}
+
+	if (!csv)
+	{
+		fprintf(stderr, "Failed to write %s\n", csv_path.c_str());
+		return 1;
+	}
+
+	return result;
+}
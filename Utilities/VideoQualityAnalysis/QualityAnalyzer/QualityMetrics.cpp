@@ -0,0 +1,389 @@
+#include "QualityMetrics.h"
+
+#include <math.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define QUALITY_METRICS_SSE2
+#endif
+
+namespace
+{
+	const int kWindowSize = 11;
+	const int kWindowRadius = kWindowSize / 2;
+
+	// Gaussian with sigma 1.5, normalized.
+	const float kWindow[kWindowSize] =
+	{
+		0.0010283801f, 0.0075987581f, 0.0360007721f, 0.1093606895f,
+		0.2130055377f, 0.2660117249f, 0.2130055377f, 0.1093606895f,
+		0.0360007721f, 0.0075987581f, 0.0010283801f
+	};
+
+	const float kC1 = (0.01f * 255) * (0.01f * 255);
+	const float kC2 = (0.03f * 255) * (0.03f * 255);
+
+	// Mean, mean of squares and mean of the product of both planes.
+	const int kMomentCount = 5;
+
+	const int kScaleCount = 5;
+	const double kScaleWeights[kScaleCount] =
+	{
+		0.0448, 0.2856, 0.3001, 0.2363, 0.1333
+	};
+
+	// Mirrors |index| at the edges without repeating them, like OpenCV's
+	// default border so that results match VQMT.
+	int Reflect(int index, int size)
+	{
+		if (size == 1)
+		{
+			return 0;
+		}
+
+		while (index < 0 || index >= size)
+		{
+			index = index < 0 ? -index : 2 * size - 2 - index;
+		}
+
+		return index;
+	}
+
+	// destination[i] += source[i] * weight
+	void AddScaled(float* destination, const float* source, float weight, int count)
+	{
+		int i = 0;
+#ifdef QUALITY_METRICS_SSE2
+		__m128 weights = _mm_set1_ps(weight);
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 value = _mm_mul_ps(_mm_loadu_ps(source + i), weights);
+			_mm_storeu_ps(destination + i, _mm_add_ps(_mm_loadu_ps(destination + i), value));
+		}
+#endif // QUALITY_METRICS_SSE2
+
+		for (; i < count; i++)
+		{
+			destination[i] += source[i] * weight;
+		}
+	}
+
+	void Scale(float* destination, const float* source, float weight, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			destination[i] = source[i] * weight;
+		}
+	}
+
+	void Multiply(float* destination, const float* a, const float* b, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			destination[i] = a[i] * b[i];
+		}
+	}
+
+	// Adds the SSIM and contrast-structure terms of one row of moments.
+	void AccumulateSsimRow(const float* moments, int width, double* ssim_sum,
+		double* contrast_structure_sum)
+	{
+		const float* mean_a = moments;
+		const float* mean_b = moments + width;
+		const float* square_a = moments + 2 * width;
+		const float* square_b = moments + 3 * width;
+		const float* product = moments + 4 * width;
+		int x = 0;
+		double ssim = 0;
+		double contrast_structure = 0;
+
+#ifdef QUALITY_METRICS_SSE2
+		__m128 c1 = _mm_set1_ps(kC1);
+		__m128 c2 = _mm_set1_ps(kC2);
+		__m128 two = _mm_set1_ps(2.0f);
+		__m128 ssim_lanes = _mm_setzero_ps();
+		__m128 contrast_structure_lanes = _mm_setzero_ps();
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 mu_a = _mm_loadu_ps(mean_a + x);
+			__m128 mu_b = _mm_loadu_ps(mean_b + x);
+			__m128 mu_ab = _mm_mul_ps(mu_a, mu_b);
+			__m128 mu_aa = _mm_mul_ps(mu_a, mu_a);
+			__m128 mu_bb = _mm_mul_ps(mu_b, mu_b);
+			__m128 sigma_aa = _mm_sub_ps(_mm_loadu_ps(square_a + x), mu_aa);
+			__m128 sigma_bb = _mm_sub_ps(_mm_loadu_ps(square_b + x), mu_bb);
+			__m128 sigma_ab = _mm_sub_ps(_mm_loadu_ps(product + x), mu_ab);
+			__m128 cs = _mm_div_ps(
+				_mm_add_ps(_mm_mul_ps(two, sigma_ab), c2),
+				_mm_add_ps(_mm_add_ps(sigma_aa, sigma_bb), c2));
+			__m128 luminance = _mm_div_ps(
+				_mm_add_ps(_mm_mul_ps(two, mu_ab), c1),
+				_mm_add_ps(_mm_add_ps(mu_aa, mu_bb), c1));
+			contrast_structure_lanes = _mm_add_ps(contrast_structure_lanes, cs);
+			ssim_lanes = _mm_add_ps(ssim_lanes, _mm_mul_ps(luminance, cs));
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, ssim_lanes);
+		ssim += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, contrast_structure_lanes);
+		contrast_structure += static_cast<double>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif // QUALITY_METRICS_SSE2
+
+		for (; x < width; x++)
+		{
+			float mu_ab = mean_a[x] * mean_b[x];
+			float mu_aa = mean_a[x] * mean_a[x];
+			float mu_bb = mean_b[x] * mean_b[x];
+			float sigma_aa = square_a[x] - mu_aa;
+			float sigma_bb = square_b[x] - mu_bb;
+			float sigma_ab = product[x] - mu_ab;
+			float cs = (2 * sigma_ab + kC2) / (sigma_aa + sigma_bb + kC2);
+			float luminance = (2 * mu_ab + kC1) / (mu_aa + mu_bb + kC1);
+			contrast_structure += cs;
+			ssim += luminance * cs;
+		}
+
+		*ssim_sum += ssim;
+		*contrast_structure_sum += contrast_structure;
+	}
+}
+
+namespace StreamingToolkit
+{
+	const double QualityMetrics::kMaxPsnr = 100.0;
+
+	QualityMetrics::QualityMetrics() :
+		ring_width_(0)
+	{
+	}
+
+	double QualityMetrics::Psnr(const uint8_t* reference, int reference_stride,
+		const uint8_t* distorted, int distorted_stride, int width, int height)
+	{
+		uint64_t sse = 0;
+		for (int y = 0; y < height; y++)
+		{
+			const uint8_t* a = reference + static_cast<size_t>(y) * reference_stride;
+			const uint8_t* b = distorted + static_cast<size_t>(y) * distorted_stride;
+			int x = 0;
+
+#ifdef QUALITY_METRICS_SSE2
+			// 32 bit lanes are flushed every row, wide enough for 100K pixels.
+			__m128i zero = _mm_setzero_si128();
+			__m128i sums = _mm_setzero_si128();
+			for (; x + 16 <= width; x += 16)
+			{
+				__m128i pixels_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+				__m128i pixels_b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+				__m128i low = _mm_sub_epi16(_mm_unpacklo_epi8(pixels_a, zero),
+					_mm_unpacklo_epi8(pixels_b, zero));
+				__m128i high = _mm_sub_epi16(_mm_unpackhi_epi8(pixels_a, zero),
+					_mm_unpackhi_epi8(pixels_b, zero));
+				sums = _mm_add_epi32(sums, _mm_madd_epi16(low, low));
+				sums = _mm_add_epi32(sums, _mm_madd_epi16(high, high));
+			}
+
+			uint32_t lanes[4];
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), sums);
+			sse += static_cast<uint64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif // QUALITY_METRICS_SSE2
+
+			for (; x < width; x++)
+			{
+				int difference = a[x] - b[x];
+				sse += difference * difference;
+			}
+		}
+
+		if (sse == 0)
+		{
+			return kMaxPsnr;
+		}
+
+		double mse = static_cast<double>(sse) / (static_cast<double>(width) * height);
+		return std::min(kMaxPsnr, 10.0 * log10(255.0 * 255.0 / mse));
+	}
+
+	double QualityMetrics::Ssim(const uint8_t* reference, int reference_stride,
+		const uint8_t* distorted, int distorted_stride, int width, int height)
+	{
+		double ssim = 0;
+		double contrast_structure = 0;
+		ComputeSsim(reference, reference_stride, distorted, distorted_stride, width,
+			height, &ssim, &contrast_structure);
+
+		return ssim;
+	}
+
+	double QualityMetrics::MsSsim(const uint8_t* reference, int reference_stride,
+		const uint8_t* distorted, int distorted_stride, int width, int height,
+		double* full_scale_ssim)
+	{
+		double ssim = 0;
+		double contrast_structure = 0;
+		ComputeSsim(reference, reference_stride, distorted, distorted_stride, width,
+			height, &ssim, &contrast_structure);
+		if (full_scale_ssim)
+		{
+			*full_scale_ssim = ssim;
+		}
+
+		// The coarsest scale would be empty.
+		if (width < (1 << (kScaleCount - 1)) || height < (1 << (kScaleCount - 1)))
+		{
+			return ssim;
+		}
+
+		double result = pow(std::max(contrast_structure, 0.0), kScaleWeights[0]);
+
+		// Scales alternate between the two buffer pairs.
+		Downscale(reference, width, height, reference_stride, &scales_[1][0]);
+		Downscale(distorted, width, height, distorted_stride, &scales_[1][1]);
+		for (int scale = 1; scale < kScaleCount; scale++)
+		{
+			width /= 2;
+			height /= 2;
+			std::vector<float>* current = scales_[scale % 2];
+			ComputeSsim(current[0].data(), width, current[1].data(), width, width,
+				height, &ssim, &contrast_structure);
+
+			if (scale + 1 < kScaleCount)
+			{
+				result *= pow(std::max(contrast_structure, 0.0), kScaleWeights[scale]);
+
+				std::vector<float>* next = scales_[(scale + 1) % 2];
+				Downscale(current[0].data(), width, height, width, &next[0]);
+				Downscale(current[1].data(), width, height, width, &next[1]);
+			}
+			else
+			{
+				result *= pow(std::max(ssim, 0.0), kScaleWeights[scale]);
+			}
+		}
+
+		return result;
+	}
+
+	template <typename T>
+	void QualityMetrics::ComputeSsim(const T* reference, int reference_stride,
+		const T* distorted, int distorted_stride, int width, int height,
+		double* ssim, double* contrast_structure)
+	{
+		int padded_width = width + 2 * kWindowRadius;
+		padded_reference_.resize(padded_width);
+		padded_distorted_.resize(padded_width);
+		padded_products_.resize(3 * padded_width);
+		moments_.resize(kMomentCount * width);
+
+		// Every row the window of the current output row reaches is in the
+		// ring, short planes keep all of their rows.
+		int slots = std::min(height, kWindowSize);
+		ring_width_ = width;
+		ring_.resize(static_cast<size_t>(slots) * kMomentCount * width);
+
+		double ssim_sum = 0;
+		double contrast_structure_sum = 0;
+		int next_row = 0;
+		for (int y = 0; y < height; y++)
+		{
+			for (int last_row = std::min(y + kWindowRadius, height - 1);
+				next_row <= last_row; next_row++)
+			{
+				FilterRow(reference, reference_stride, distorted, distorted_stride, width,
+					next_row, next_row % slots);
+			}
+
+			for (int moment = 0; moment < kMomentCount; moment++)
+			{
+				float* output = moments_.data() + moment * width;
+				for (int k = 0; k < kWindowSize; k++)
+				{
+					int slot = Reflect(y + k - kWindowRadius, height) % slots;
+					const float* input = ring_.data() +
+						(static_cast<size_t>(slot) * kMomentCount + moment) * width;
+					if (k == 0)
+					{
+						Scale(output, input, kWindow[k], width);
+					}
+					else
+					{
+						AddScaled(output, input, kWindow[k], width);
+					}
+				}
+			}
+
+			AccumulateSsimRow(moments_.data(), width, &ssim_sum, &contrast_structure_sum);
+		}
+
+		double pixel_count = static_cast<double>(width) * height;
+		*ssim = ssim_sum / pixel_count;
+		*contrast_structure = contrast_structure_sum / pixel_count;
+	}
+
+	template <typename T>
+	void QualityMetrics::FilterRow(const T* reference, int reference_stride,
+		const T* distorted, int distorted_stride, int width, int row, int slot)
+	{
+		const T* a = reference + static_cast<size_t>(row) * reference_stride;
+		const T* b = distorted + static_cast<size_t>(row) * distorted_stride;
+		int padded_width = width + 2 * kWindowRadius;
+		float* padded_a = padded_reference_.data();
+		float* padded_b = padded_distorted_.data();
+		for (int x = 0; x < width; x++)
+		{
+			padded_a[x + kWindowRadius] = static_cast<float>(a[x]);
+			padded_b[x + kWindowRadius] = static_cast<float>(b[x]);
+		}
+
+		for (int x = 0; x < kWindowRadius; x++)
+		{
+			int left = Reflect(x - kWindowRadius, width);
+			int right = Reflect(width + x, width);
+			padded_a[x] = static_cast<float>(a[left]);
+			padded_b[x] = static_cast<float>(b[left]);
+			padded_a[width + kWindowRadius + x] = static_cast<float>(a[right]);
+			padded_b[width + kWindowRadius + x] = static_cast<float>(b[right]);
+		}
+
+		float* square_a = padded_products_.data();
+		float* square_b = square_a + padded_width;
+		float* product = square_b + padded_width;
+		Multiply(square_a, padded_a, padded_a, padded_width);
+		Multiply(square_b, padded_b, padded_b, padded_width);
+		Multiply(product, padded_a, padded_b, padded_width);
+
+		const float* inputs[kMomentCount] = { padded_a, padded_b, square_a, square_b, product };
+		for (int moment = 0; moment < kMomentCount; moment++)
+		{
+			float* output = ring_.data() +
+				(static_cast<size_t>(slot) * kMomentCount + moment) * ring_width_;
+			Scale(output, inputs[moment], kWindow[0], width);
+			for (int k = 1; k < kWindowSize; k++)
+			{
+				AddScaled(output, inputs[moment] + k, kWindow[k], width);
+			}
+		}
+	}
+
+	template <typename T>
+	void QualityMetrics::Downscale(const T* source, int width, int height, int stride,
+		std::vector<float>* destination)
+	{
+		int scaled_width = width / 2;
+		int scaled_height = height / 2;
+		destination->resize(static_cast<size_t>(scaled_width) * scaled_height);
+		for (int y = 0; y < scaled_height; y++)
+		{
+			const T* top = source + static_cast<size_t>(2 * y) * stride;
+			const T* bottom = top + stride;
+			float* output = destination->data() + static_cast<size_t>(y) * scaled_width;
+			for (int x = 0; x < scaled_width; x++)
+			{
+				output[x] = 0.25f * (static_cast<float>(top[2 * x]) + top[2 * x + 1] +
+					bottom[2 * x] + bottom[2 * x + 1]);
+			}
+		}
+	}
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Full reference metrics of 8 bit planes, computed the way VQMT does:
+	// SSIM over an 11x11 Gaussian window with sigma 1.5, MS-SSIM over five
+	// scales with the weights of Wang et al. 2003.
+	//
+	// The Gaussian window is applied as two passes over a ring of 11 rows,
+	// so SSIM needs a few rows of scratch memory rather than a float copy of
+	// the plane. Only MS-SSIM keeps its downscaled planes. An instance isn't
+	// thread safe, use one per thread.
+	class QualityMetrics
+	{
+	public:
+		QualityMetrics();
+
+		// Identical planes report kMaxPsnr instead of infinity.
+		static double Psnr(const uint8_t* reference, int reference_stride,
+			const uint8_t* distorted, int distorted_stride, int width, int height);
+
+		double Ssim(const uint8_t* reference, int reference_stride,
+			const uint8_t* distorted, int distorted_stride, int width, int height);
+
+		// The full scale SSIM comes for free and is stored in
+		// |full_scale_ssim| if set.
+		double MsSsim(const uint8_t* reference, int reference_stride,
+			const uint8_t* distorted, int distorted_stride, int width, int height,
+			double* full_scale_ssim = nullptr);
+
+		static const double kMaxPsnr;
+
+	private:
+		// Mean SSIM and mean contrast-structure term of a plane.
+		template <typename T>
+		void ComputeSsim(const T* reference, int reference_stride,
+			const T* distorted, int distorted_stride, int width, int height,
+			double* ssim, double* contrast_structure);
+
+		// Fills ring slot |slot| with the horizontally filtered moments of
+		// source row |row|.
+		template <typename T>
+		void FilterRow(const T* reference, int reference_stride,
+			const T* distorted, int distorted_stride, int width, int row, int slot);
+
+		// Averages 2x2 blocks into |destination|, odd edges are dropped.
+		template <typename T>
+		static void Downscale(const T* source, int width, int height, int stride,
+			std::vector<float>* destination);
+
+		// Padded input rows and their products.
+		std::vector<float> padded_reference_;
+		std::vector<float> padded_distorted_;
+		std::vector<float> padded_products_;
+
+		// Ring of horizontally filtered rows, five moments per row.
+		std::vector<float> ring_;
+		int ring_width_;
+
+		// Vertically filtered moments of the current output row.
+		std::vector<float> moments_;
+
+		// MS-SSIM scales, reference then distorted.
+		std::vector<float> scales_[2][2];
+	};
+}
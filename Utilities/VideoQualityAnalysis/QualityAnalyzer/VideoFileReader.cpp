@@ -0,0 +1,362 @@
+#include "VideoFileReader.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif // _WIN32
+
+namespace
+{
+	const char kY4mSignature[] = "YUV4MPEG2 ";
+	const char kY4mFrameSignature[] = "FRAME";
+
+	// Frame headers may carry parameters, none of which matter here.
+	const size_t kMaxY4mFrameHeaderSize = 256;
+
+	bool EndsWith(const std::string& value, const std::string& suffix)
+	{
+		if (value.size() < suffix.size())
+		{
+			return false;
+		}
+
+		return std::equal(suffix.rbegin(), suffix.rend(), value.rbegin(),
+			[](char a, char b) { return tolower(a) == tolower(b); });
+	}
+
+#ifndef _WIN32
+	size_t GetPageSize()
+	{
+		static const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		return page_size;
+	}
+#endif // _WIN32
+}
+
+namespace StreamingToolkit
+{
+	VideoFileReader::VideoFileReader() :
+		data_(nullptr),
+		size_(0),
+#ifdef _WIN32
+		file_(INVALID_HANDLE_VALUE),
+		mapping_(nullptr),
+#else
+		file_(-1),
+#endif // _WIN32
+		width_(0),
+		height_(0),
+		frame_size_(0),
+		frame_rate_(0)
+	{
+	}
+
+	VideoFileReader::~VideoFileReader()
+	{
+		Close();
+	}
+
+	bool VideoFileReader::Open(const std::string& path, int width, int height,
+		std::string* error)
+	{
+		Close();
+		if (!Map(path, error))
+		{
+			Close();
+			return false;
+		}
+
+		bool y4m = EndsWith(path, ".y4m");
+		if (y4m)
+		{
+			if (!ParseY4mHeader(error))
+			{
+				Close();
+				return false;
+			}
+		}
+		else
+		{
+			if (width <= 0 || height <= 0)
+			{
+				*error = "width and height are required for raw YUV files";
+				Close();
+				return false;
+			}
+
+			width_ = width;
+			height_ = height;
+			frame_size_ = static_cast<size_t>(width_) * height_ +
+				2 * static_cast<size_t>(chroma_width()) * chroma_height();
+
+			// A trailing partial frame is ignored.
+			for (uint64_t offset = 0; offset + frame_size_ <= size_; offset += frame_size_)
+			{
+				frame_offsets_.push_back(offset);
+			}
+		}
+
+#ifndef _WIN32
+		// Frames are analyzed roughly in order, read ahead and drop behind.
+		madvise(const_cast<uint8_t*>(data_), static_cast<size_t>(size_), MADV_SEQUENTIAL);
+#endif // _WIN32
+
+		return true;
+	}
+
+	void VideoFileReader::Close()
+	{
+#ifdef _WIN32
+		if (data_)
+		{
+			UnmapViewOfFile(data_);
+		}
+
+		if (mapping_)
+		{
+			CloseHandle(mapping_);
+			mapping_ = nullptr;
+		}
+
+		if (file_ != INVALID_HANDLE_VALUE)
+		{
+			CloseHandle(file_);
+			file_ = INVALID_HANDLE_VALUE;
+		}
+#else
+		if (data_)
+		{
+			munmap(const_cast<uint8_t*>(data_), static_cast<size_t>(size_));
+		}
+
+		if (file_ >= 0)
+		{
+			close(file_);
+			file_ = -1;
+		}
+#endif // _WIN32
+
+		data_ = nullptr;
+		size_ = 0;
+		width_ = 0;
+		height_ = 0;
+		frame_size_ = 0;
+		frame_rate_ = 0;
+		frame_offsets_.clear();
+	}
+
+	const uint8_t* VideoFileReader::GetFrame(int index) const
+	{
+		return data_ + frame_offsets_[index];
+	}
+
+	void VideoFileReader::ReleaseFrame(int index) const
+	{
+#ifdef _WIN32
+		// Unlocking pages that aren't locked removes them from the working
+		// set, the call is expected to fail with ERROR_NOT_LOCKED.
+		VirtualUnlock(const_cast<uint8_t*>(GetFrame(index)), frame_size_);
+#else
+		// Only whole pages inside the frame, the neighbours may still be in use.
+		size_t page_size = GetPageSize();
+		uintptr_t begin = reinterpret_cast<uintptr_t>(GetFrame(index));
+		uintptr_t end = begin + frame_size_;
+		begin = (begin + page_size - 1) / page_size * page_size;
+		end = end / page_size * page_size;
+		if (end > begin)
+		{
+			madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+		}
+#endif // _WIN32
+	}
+
+	bool VideoFileReader::ParseY4mHeader(std::string* error)
+	{
+		size_t signature_size = sizeof(kY4mSignature) - 1;
+		if (size_ < signature_size || memcmp(data_, kY4mSignature, signature_size) != 0)
+		{
+			*error = "missing YUV4MPEG2 signature";
+			return false;
+		}
+
+		const uint8_t* header_end = static_cast<const uint8_t*>(
+			memchr(data_, '\n', static_cast<size_t>(size_)));
+		if (!header_end)
+		{
+			*error = "unterminated Y4M header";
+			return false;
+		}
+
+		std::string header(reinterpret_cast<const char*>(data_) + signature_size,
+			reinterpret_cast<const char*>(header_end));
+		size_t position = 0;
+		while (position < header.size())
+		{
+			size_t token_end = header.find(' ', position);
+			if (token_end == std::string::npos)
+			{
+				token_end = header.size();
+			}
+
+			std::string token = header.substr(position, token_end - position);
+			position = token_end + 1;
+			if (token.empty())
+			{
+				continue;
+			}
+
+			switch (token[0])
+			{
+			case 'W':
+				width_ = atoi(token.c_str() + 1);
+				break;
+
+			case 'H':
+				height_ = atoi(token.c_str() + 1);
+				break;
+
+			case 'F':
+			{
+				int numerator = 0;
+				int denominator = 0;
+				if (sscanf(token.c_str() + 1, "%d:%d", &numerator, &denominator) == 2 &&
+					numerator > 0 && denominator > 0)
+				{
+					frame_rate_ = static_cast<double>(numerator) / denominator;
+				}
+
+				break;
+			}
+
+			case 'C':
+				// 4:2:0 with any chroma siting, samples are 8 bit.
+				if (token.compare(0, 4, "C420") != 0 || token == "C420p10" ||
+					token == "C420p12")
+				{
+					*error = "unsupported Y4M colorspace " + token;
+					return false;
+				}
+
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		if (width_ <= 0 || height_ <= 0)
+		{
+			*error = "missing Y4M frame size";
+			return false;
+		}
+
+		frame_size_ = static_cast<size_t>(width_) * height_ +
+			2 * static_cast<size_t>(chroma_width()) * chroma_height();
+
+		// Frame headers have a variable length, so every frame is located
+		// once up front. Only the headers are touched.
+		size_t frame_signature_size = sizeof(kY4mFrameSignature) - 1;
+		uint64_t offset = static_cast<uint64_t>(header_end - data_) + 1;
+		while (offset + frame_signature_size <= size_)
+		{
+			if (memcmp(data_ + offset, kY4mFrameSignature, frame_signature_size) != 0)
+			{
+				*error = "corrupt Y4M frame header";
+				return false;
+			}
+
+			size_t search_size = static_cast<size_t>(
+				std::min<uint64_t>(size_ - offset, kMaxY4mFrameHeaderSize));
+			const uint8_t* frame_header_end = static_cast<const uint8_t*>(
+				memchr(data_ + offset, '\n', search_size));
+			if (!frame_header_end)
+			{
+				*error = "corrupt Y4M frame header";
+				return false;
+			}
+
+			uint64_t frame_offset = static_cast<uint64_t>(frame_header_end - data_) + 1;
+			if (frame_offset + frame_size_ > size_)
+			{
+				// Truncated last frame.
+				break;
+			}
+
+			frame_offsets_.push_back(frame_offset);
+			offset = frame_offset + frame_size_;
+		}
+
+		return true;
+	}
+
+	bool VideoFileReader::Map(const std::string& path, std::string* error)
+	{
+#ifdef _WIN32
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE)
+		{
+			*error = "cannot open file";
+			return false;
+		}
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0)
+		{
+			*error = "empty file";
+			return false;
+		}
+
+		size_ = static_cast<uint64_t>(size.QuadPart);
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_)
+		{
+			*error = "cannot map file";
+			return false;
+		}
+
+		// The whole file is one view, 32 bit builds are limited by their
+		// address space.
+		data_ = static_cast<const uint8_t*>(
+			MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+		file_ = open(path.c_str(), O_RDONLY);
+		if (file_ < 0)
+		{
+			*error = "cannot open file";
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(file_, &info) != 0 || info.st_size == 0)
+		{
+			*error = "empty file";
+			return false;
+		}
+
+		size_ = static_cast<uint64_t>(info.st_size);
+		void* data = mmap(nullptr, static_cast<size_t>(size_), PROT_READ,
+			MAP_PRIVATE, file_, 0);
+		data_ = data == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(data);
+#endif // _WIN32
+
+		if (!data_)
+		{
+			*error = "cannot map file";
+			return false;
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace StreamingToolkit
+{
+	// Memory maps a raw I420 (.yuv) or Y4M (.y4m) file and hands out frames
+	// as pointers into the mapping, nothing is copied. Frames can be released
+	// once analyzed so that long files never stay resident.
+	class VideoFileReader
+	{
+	public:
+		VideoFileReader();
+
+		~VideoFileReader();
+
+		// Raw files need |width| and |height|, Y4M files read them from their
+		// header and ignore both. Returns false and sets |error| on failure.
+		bool Open(const std::string& path, int width, int height,
+			std::string* error);
+
+		void Close();
+
+		// Returns the Y plane of frame |index|, U and V follow it.
+		const uint8_t* GetFrame(int index) const;
+
+		// Drops the pages of frame |index| from memory, they are read again
+		// from the file if the frame is used later.
+		void ReleaseFrame(int index) const;
+
+		int frame_count() const { return static_cast<int>(frame_offsets_.size()); }
+
+		int width() const { return width_; }
+
+		int height() const { return height_; }
+
+		int chroma_width() const { return (width_ + 1) / 2; }
+
+		int chroma_height() const { return (height_ + 1) / 2; }
+
+		size_t frame_size() const { return frame_size_; }
+
+		// Frames per second from the Y4M header, 0 for raw files.
+		double frame_rate() const { return frame_rate_; }
+
+	private:
+		bool ParseY4mHeader(std::string* error);
+
+		bool Map(const std::string& path, std::string* error);
+
+		const uint8_t* data_;
+		uint64_t size_;
+#ifdef _WIN32
+		void* file_;
+		void* mapping_;
+#else
+		int file_;
+#endif // _WIN32
+		int width_;
+		int height_;
+		size_t frame_size_;
+		double frame_rate_;
+		std::vector<uint64_t> frame_offsets_;
+	};
+}
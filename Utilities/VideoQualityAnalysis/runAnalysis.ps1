@@ -6,6 +6,9 @@
    This script automates the conversion, analysis and merger of video files with VQMT.  It is currently configured to operate
    on h264 inputs, but will also work on any video format supported by ffmpeg.
 
+   QualityAnalyzer\ computes PSNR, SSIM and MS-SSIM natively from .yuv or .y4m files and writes the same merged
+   CSV, without VQMT. It also builds on Linux, see QualityAnalyzer\CMakeLists.txt.
+
    It requires the following naming convention on encoded videos to be processed:
 
    Input videos: 10000kbps-AQ1-lowLatencyHQ-CBR-LL-HQ.h264
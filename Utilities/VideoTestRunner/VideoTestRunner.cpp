@@ -16,7 +16,8 @@ VideoTestRunner::VideoTestRunner(ID3D11Device* device, ID3D11DeviceContext* cont
 	m_d3dDevice(device),
 	m_d3dContext(context),
 	m_initialized(false),
-	m_encoderCreated(false)
+	m_encoderCreated(false),
+	m_pOutputQueue(NULL)
 {
 	if (!m_initialized) 
 	{
@@ -56,7 +57,13 @@ VideoTestRunner::~VideoTestRunner()
 NVENCSTATUS VideoTestRunner::Deinitialize()
 {
 	NVENCSTATUS nvStatus = NV_ENC_SUCCESS;
-	FlushEncoder();
+	if (m_pOutputQueue)
+	{
+		FlushEncoder();
+		delete m_pOutputQueue;
+		m_pOutputQueue = NULL;
+	}
+
 	ReleaseIOBuffers();
 	nvStatus = m_pNvHWEncoder->NvEncDestroyEncoder();
 	return nvStatus;
@@ -137,6 +144,17 @@ NVENCSTATUS VideoTestRunner::InitializeEncoder()
 
 	AllocateIOBuffers();
 
+	// Bitstreams are written on the output queue threads, so file I/O
+	// doesn't stall the capture.
+	FILE* fOutput = m_encodeConfig.fOutput;
+	m_pOutputQueue = new CNvEncoderOutputQueue(m_pNvHWEncoder, [fOutput](const NvEncOutputPacket& packet)
+	{
+		if (fOutput)
+		{
+			fwrite(packet.data.data(), 1, packet.data.size(), fOutput);
+		}
+	});
+
 	return NV_ENC_SUCCESS;
 }
 
@@ -196,8 +214,8 @@ void VideoTestRunner::GetDefaultEncodeConfig()
 	m_encodeConfig.enableTemporalAQ = false;
 
 	//Need this to be able to recover from stream drops
-	//Client needs to send back a last good timestamp, and we call
-	//NvEncInvalidateRefFrames(encoder,timestamp) to reissue I frame
+	//CNvEncoderLossRecovery turns loss reports into NvEncInvalidateRefFrames
+	//calls, so the next frame only references frames the client has received
 	m_encodeConfig.invalidateRefFramesEnableFlag = true;
 }
 
@@ -206,23 +224,18 @@ void VideoTestRunner::Capture()
 {
 	// Try to process the pending input buffers.
 	NVENCSTATUS nvStatus = NV_ENC_SUCCESS;
-	EncodeBuffer* pEncodeBuffer = m_EncodeBufferQueue.GetAvailable();
-
-	if (!pEncodeBuffer)
+	EncodeBuffer* pEncodeBuffer = NULL;
+	if (!m_freeEncodeBuffers.TryPop(&pEncodeBuffer))
 	{
-		pEncodeBuffer = m_EncodeBufferQueue.GetPending();
-		m_pNvHWEncoder->ProcessOutput(pEncodeBuffer);
-
-		// UnMap the input buffer after frame done
-		if (pEncodeBuffer->stInputBfr.hInputSurface)
-		{
-			nvStatus = m_pNvHWEncoder->NvEncUnmapInputResource(pEncodeBuffer->stInputBfr.hInputSurface);
-			pEncodeBuffer->stInputBfr.hInputSurface = NULL;
-		}
-
-		pEncodeBuffer = m_EncodeBufferQueue.GetAvailable();
+		// Recycles the oldest buffer in flight.
+		m_pendingEncodeBuffers.TryPop(&pEncodeBuffer);
+		ReleaseEncodeBuffer(pEncodeBuffer);
 	}
 
+	// Nothing to wait for unless the frame reaches the encoder.
+	m_uOutputSequence[pEncodeBuffer - m_stEncodeBuffer] = UINT64_MAX;
+	m_pendingEncodeBuffers.TryPush(pEncodeBuffer);
+
 	ID3D11Texture2D* frameBuffer = nullptr;
 	HRESULT hr = m_swapChain->GetBuffer(0,
 		__uuidof(ID3D11Texture2D),
@@ -247,6 +260,28 @@ void VideoTestRunner::Capture()
 			return;
 		}
 	}
+
+	// Hands the bitstream to the output queue, the buffer is only waited
+	// on once it's needed again.
+	m_uOutputSequence[pEncodeBuffer - m_stEncodeBuffer] = m_pOutputQueue->Submit(
+		pEncodeBuffer->stOutputBfr.hBitstreamBuffer,
+		pEncodeBuffer->stOutputBfr.bWaitOnEvent ? pEncodeBuffer->stOutputBfr.hOutputEvent : NULL);
+}
+
+// Waits for the output of a pending buffer, then unmaps its input.
+void VideoTestRunner::ReleaseEncodeBuffer(EncodeBuffer* pEncodeBuffer)
+{
+	uint64_t sequence = m_uOutputSequence[pEncodeBuffer - m_stEncodeBuffer];
+	if (sequence != UINT64_MAX)
+	{
+		m_pOutputQueue->WaitForOutput(sequence);
+	}
+
+	if (pEncodeBuffer->stInputBfr.hInputSurface)
+	{
+		m_pNvHWEncoder->NvEncUnmapInputResource(pEncodeBuffer->stInputBfr.hInputSurface);
+		pEncodeBuffer->stInputBfr.hInputSurface = NULL;
+	}
 }
 
 NVENCSTATUS VideoTestRunner::AllocateIOBuffers()
@@ -257,8 +292,13 @@ NVENCSTATUS VideoTestRunner::AllocateIOBuffers()
 	DXGI_SWAP_CHAIN_DESC swapChainDesc;
 	m_swapChain->GetDesc(&swapChainDesc);
 
-	// Initializes the encode buffer queue.
-	m_EncodeBufferQueue.Initialize(m_stEncodeBuffer, m_uEncodeBufferCount);
+	// Initializes the encode buffer rings.
+	m_freeEncodeBuffers.Initialize(m_uEncodeBufferCount);
+	m_pendingEncodeBuffers.Initialize(m_uEncodeBufferCount);
+	for (uint32_t i = 0; i < m_uEncodeBufferCount; i++)
+	{
+		m_freeEncodeBuffers.TryPush(&m_stEncodeBuffer[i]);
+	}
 
 	// Finds the suitable format for buffer.
 	DXGI_FORMAT format = swapChainDesc.BufferDesc.Format;
@@ -396,20 +436,15 @@ NVENCSTATUS VideoTestRunner::FlushEncoder()
 		return nvStatus;
 	}
 
-	EncodeBuffer *pEncodeBuffer = m_EncodeBufferQueue.GetPending();
-	while (pEncodeBuffer)
+	EncodeBuffer *pEncodeBuffer = NULL;
+	while (m_pendingEncodeBuffers.TryPop(&pEncodeBuffer))
 	{
-		m_pNvHWEncoder->ProcessOutput(pEncodeBuffer);
-		pEncodeBuffer = m_EncodeBufferQueue.GetPending();
-
-		// UnMap the input buffer after frame is done.
-		if (pEncodeBuffer && pEncodeBuffer->stInputBfr.hInputSurface)
-		{
-			nvStatus = m_pNvHWEncoder->NvEncUnmapInputResource(pEncodeBuffer->stInputBfr.hInputSurface);
-			pEncodeBuffer->stInputBfr.hInputSurface = NULL;
-		}
+		ReleaseEncodeBuffer(pEncodeBuffer);
+		m_freeEncodeBuffers.TryPush(pEncodeBuffer);
 	}
 
+	m_pOutputQueue->Flush();
+
 	if (WaitForSingleObject(m_stEOSOutputBfr.hOutputEvent, 500) != WAIT_OBJECT_0)
 	{
 		assert(0);
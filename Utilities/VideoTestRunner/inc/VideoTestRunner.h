@@ -5,76 +5,11 @@
 #include "nvEncodeAPI.h"
 #include "nvCPUOPSys.h"
 #include "NvHWEncoder.h"
+#include "NvEncoderOutputQueue.h"
+#include "NvSpscRing.h"
 
 namespace StreamingToolkit
 {
-	template<class T>
-	class CNvQueue
-	{
-		T** m_pBuffer;
-		unsigned int m_uSize;
-		unsigned int m_uPendingCount;
-		unsigned int m_uAvailableIdx;
-		unsigned int m_uPendingndex;
-
-	public:
-		CNvQueue() :
-			m_uSize(0),
-			m_uPendingCount(0),
-			m_uAvailableIdx(0),
-			m_uPendingndex(0),
-			m_pBuffer(NULL)
-		{
-		}
-
-		~CNvQueue()
-		{
-			delete[] m_pBuffer;
-		}
-
-		bool Initialize(T* pItems, unsigned int uSize)
-		{
-			m_uSize = uSize;
-			m_uPendingCount = 0;
-			m_uAvailableIdx = 0;
-			m_uPendingndex = 0;
-			m_pBuffer = new T*[m_uSize];
-			for (unsigned int i = 0; i < m_uSize; i++)
-			{
-				m_pBuffer[i] = &pItems[i];
-			}
-
-			return true;
-		}
-
-		T* GetAvailable()
-		{
-			T* pItem = NULL;
-			if (m_uPendingCount == m_uSize)
-			{
-				return NULL;
-			}
-
-			pItem = m_pBuffer[m_uAvailableIdx];
-			m_uAvailableIdx = (m_uAvailableIdx + 1) % m_uSize;
-			m_uPendingCount += 1;
-			return pItem;
-		}
-
-		T* GetPending()
-		{
-			if (m_uPendingCount == 0)
-			{
-				return NULL;
-			}
-
-			T* pItem = m_pBuffer[m_uPendingndex];
-			m_uPendingndex = (m_uPendingndex + 1) % m_uSize;
-			m_uPendingCount -= 1;
-			return pItem;
-		}
-	};
-
 	typedef struct _EncodeFrameConfig
 	{
 		ID3D11Texture2D* pRGBTexture;
@@ -109,7 +44,10 @@ namespace StreamingToolkit
 		uint32_t                                m_uEncodeBufferCount;
 		EncodeOutputBuffer						m_stEOSOutputBfr;
 		EncodeBuffer							m_stEncodeBuffer[MAX_ENCODE_QUEUE];
-		CNvQueue<EncodeBuffer>                  m_EncodeBufferQueue;
+		CNvSpscRing<EncodeBuffer*>				m_freeEncodeBuffers;
+		CNvSpscRing<EncodeBuffer*>				m_pendingEncodeBuffers;
+		CNvEncoderOutputQueue*					m_pOutputQueue;
+		uint64_t								m_uOutputSequence[MAX_ENCODE_QUEUE];
 
 		// TestRunner
 		EncodeConfig							m_minEncodeConfig;
@@ -130,5 +68,6 @@ namespace StreamingToolkit
 		void									GetDefaultEncodeConfig();
 		NVENCSTATUS								SetEncodeProfile(int profileIndex);
 		void									Capture();
+		void									ReleaseEncodeBuffer(EncodeBuffer* pEncodeBuffer);
 	};
 }